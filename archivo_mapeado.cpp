@@ -0,0 +1,142 @@
+#include "archivo_mapeado.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <stdexcept>
+
+/**
+ * @brief Abre el archivo y lo proyecta en memoria.
+ * 
+ * Se avisa al sistema de que el acceso será secuencial para que adelante la lectura de páginas.
+ * Un archivo vacío no se proyecta: data() devuelve nullptr y size() devuelve 0.
+ * 
+ * @param ruta Ruta del archivo.
+ * @param escribible Si es verdadero, la proyección admite escrituras privadas (copia en escritura).
+ */
+ArchivoMapeado::ArchivoMapeado(const std::string& ruta, bool escribible) : datos{nullptr}, tam{0} {
+    int fd = ::open(ruta.c_str(), O_RDONLY);
+    if (fd == -1) {
+        throw std::runtime_error("Error: no se pudo abrir el archivo " + ruta + ".");
+    }
+
+    struct stat info;
+    if (::fstat(fd, &info) == -1) {
+        ::close(fd);
+        throw std::runtime_error("Error: no se pudo consultar el tamaño de " + ruta + ".");
+    }
+    tam = static_cast<std::size_t>(info.st_size);
+
+    if (tam > 0) {
+        int proteccion = escribible ? PROT_READ | PROT_WRITE : PROT_READ;
+        void* proyeccion = ::mmap(nullptr, tam, proteccion, MAP_PRIVATE, fd, 0);
+        if (proyeccion == MAP_FAILED) {
+            ::close(fd);
+            throw std::runtime_error("Error: no se pudo proyectar en memoria " + ruta + ".");
+        }
+        ::madvise(proyeccion, tam, MADV_SEQUENTIAL);
+        datos = static_cast<char*>(proyeccion);
+    }
+    // La proyección sigue siendo válida tras cerrar el descriptor
+    ::close(fd);
+}
+
+/**
+ * @brief Crea un archivo temporal y lo proyecta en memoria de forma compartida.
+ * 
+ * Las escrituras en la proyección llegan al archivo, así que el sistema puede descartar las páginas que no se
+ * usan (escribiéndolas antes en disco) y la memoria ocupada no está limitada por la RAM. El archivo se borra
+ * del directorio nada más proyectarlo: su espacio en disco se libera al destruir la proyección, aunque el
+ * programa termine de forma anómala.
+ * 
+ * @param ruta Ruta del archivo temporal; si ya existe, se sobrescribe.
+ * @param tam Tamaño del archivo en bytes; su contenido inicial es cero.
+ * @return Proyección del archivo.
+ */
+std::shared_ptr<ArchivoMapeado> ArchivoMapeado::crearTemporal(const std::string& ruta, std::size_t tam) {
+    int fd = ::open(ruta.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+    if (fd == -1) {
+        throw std::runtime_error("Error: no se pudo crear el archivo " + ruta + ".");
+    }
+    ::unlink(ruta.c_str());
+    if (::ftruncate(fd, static_cast<off_t>(tam)) == -1) {
+        ::close(fd);
+        throw std::runtime_error("Error: no se pudo reservar " + std::to_string(tam) + " bytes en " + ruta + ".");
+    }
+
+    std::shared_ptr<ArchivoMapeado> archivo(new ArchivoMapeado());
+    if (tam > 0) {
+        void* proyeccion = ::mmap(nullptr, tam, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (proyeccion == MAP_FAILED) {
+            ::close(fd);
+            throw std::runtime_error("Error: no se pudo proyectar en memoria " + ruta + ".");
+        }
+        archivo->datos = static_cast<char*>(proyeccion);
+        archivo->tam = tam;
+    }
+    ::close(fd);
+    return archivo;
+}
+
+/**
+ * @brief Libera la proyección del archivo.
+ */
+ArchivoMapeado::~ArchivoMapeado() {
+    if (datos != nullptr) {
+        ::munmap(datos, tam);
+    }
+}
+
+/**
+ * @brief Obtiene el contenido del archivo.
+ * 
+ * @return Puntero al primer byte del archivo (nullptr si el archivo está vacío).
+ */
+const char* ArchivoMapeado::data() const {
+    return datos;
+}
+
+/**
+ * @brief Obtiene el contenido del archivo para modificarlo.
+ * 
+ * Solo se puede escribir si el archivo se proyectó como escribible; los cambios no se guardan en disco.
+ * 
+ * @return Puntero al primer byte del archivo (nullptr si el archivo está vacío).
+ */
+char* ArchivoMapeado::data() {
+    return datos;
+}
+
+/**
+ * @brief Obtiene el tamaño del archivo.
+ * 
+ * @return Tamaño en bytes.
+ */
+std::size_t ArchivoMapeado::size() const {
+    return tam;
+}
+
+/**
+ * @brief Devuelve al sistema las páginas de un tramo de una proyección de archivo.
+ * 
+ * Se liberan las páginas desde la que contiene el comienzo del tramo hasta la última que termina dentro de él; la
+ * página en la que acaba el tramo se conserva, así que al liberar tramos consecutivos se liberan todas. Si se vuelven
+ * a leer, se cargan de nuevo del archivo: en una proyección compartida no se pierde nada, pero en una privada se
+ * pierden las escrituras, así que solo debe usarse en tramos privados que no se han modificado.
+ * 
+ * @param inicio Comienzo del tramo, dentro de una proyección.
+ * @param bytes Tamaño del tramo.
+ */
+void liberarPaginas(const void* inicio, std::size_t bytes) {
+    const std::uintptr_t tam_pagina = static_cast<std::uintptr_t>(::sysconf(_SC_PAGESIZE));
+    std::uintptr_t desde = reinterpret_cast<std::uintptr_t>(inicio);
+    std::uintptr_t hasta = desde + bytes;
+    desde = desde / tam_pagina * tam_pagina;
+    hasta = hasta / tam_pagina * tam_pagina;
+    if (desde < hasta) {
+        ::madvise(reinterpret_cast<void*>(desde), hasta - desde, MADV_DONTNEED);
+    }
+}
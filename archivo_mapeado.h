@@ -0,0 +1,45 @@
+#ifndef ARCHIVO_MAPEADO_H
+#define ARCHIVO_MAPEADO_H
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+/**
+ * @brief Archivo proyectado en memoria.
+ * 
+ * Mantiene la proyección mientras el objeto existe y la libera en el destructor. Permite leer
+ * archivos grandes sin copiarlos a buffers intermedios: el sistema carga las páginas bajo demanda.
+ * Si se proyecta como escribible, las escrituras son privadas (copia en escritura) y nunca
+ * llegan al archivo, salvo en los archivos temporales creados con crearTemporal().
+ */
+class ArchivoMapeado {
+public:
+    // Proyecta el archivo completo; lanza std::runtime_error si no se puede abrir
+    explicit ArchivoMapeado(const std::string& ruta, bool escribible = false);
+    ~ArchivoMapeado();
+
+    // Crea un archivo temporal de 'tam' bytes a cero y lo proyecta compartido (las escrituras llegan al archivo);
+    // el archivo se borra al crearlo y su espacio se libera al destruir la proyección
+    static std::shared_ptr<ArchivoMapeado> crearTemporal(const std::string& ruta, std::size_t tam);
+
+    ArchivoMapeado(const ArchivoMapeado&) = delete;
+    ArchivoMapeado& operator=(const ArchivoMapeado&) = delete;
+
+    // Contenido del archivo y su tamaño en bytes
+    const char* data() const;
+    char* data();
+    std::size_t size() const;
+
+private:
+    ArchivoMapeado() : datos{nullptr}, tam{0} {}
+
+    char* datos;
+    std::size_t tam;
+};
+
+// Devuelve al sistema las páginas de [inicio, inicio + bytes) de una proyección de archivo, salvo aquella en la
+// que termina el tramo; si se vuelven a usar, se leen otra vez del archivo
+void liberarPaginas(const void* inicio, std::size_t bytes);
+
+#endif // ARCHIVO_MAPEADO_H
@@ -0,0 +1,325 @@
+#include "cache_base.h"
+#include "archivo_mapeado.h"
+#include "suma_comprobacion.h"
+#include "tipos_columna.h"
+
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+namespace {
+
+const char MAGIA_CACHE[8] = {'P', 'I', 'R', 'B', 'A', 'S', 'E', '\0'};
+
+// Las columnas empiezan en múltiplos del tamaño de página para poder proyectarlas directamente
+const std::size_t ALINEACION_CACHE = 4096;
+
+/**
+ * @brief Cabecera de la caché, al comienzo del archivo.
+ */
+struct CabeceraCache {
+    char magia[8];
+    uint32_t version;
+    uint32_t num_atributos;
+    int32_t num_filas;
+    int32_t num_columnas;
+    uint64_t csv_tam;
+    int64_t csv_mtime_ns;
+    uint64_t firma_precision;
+    uint64_t num_clases;
+    uint64_t suma;
+};
+
+/**
+ * @brief Esquema de una columna: nombre, tipo y posición en el archivo.
+ * 
+ * La cabecera va seguida de un descriptor por columna.
+ */
+struct DescriptorColumna {
+    char nombre[32];
+    uint32_t tipo;
+    uint32_t tam_elemento;
+    uint64_t desplazamiento;
+    uint64_t bytes;
+};
+
+/**
+ * @brief Llama a funcion(nombre, columna) para cada columna de la base que se guarda en la caché.
+ * 
+ * El orden es el de las columnas en el archivo. El área y el padre no se guardan: el área de un nodo
+ * de la base es 1 si tiene datos y todos empiezan huérfanos.
+ */
+template <typename NivelT, typename Funcion>
+void recorrerColumnasCache(NivelT& base, Funcion funcion) {
+    funcion("homog", base.homog);
+    funcion("clase", base.clase);
+    funcion("estaciones", base.estaciones);
+}
+
+std::size_t alinear(std::size_t desplazamiento) {
+    return (desplazamiento + ALINEACION_CACHE - 1) / ALINEACION_CACHE * ALINEACION_CACHE;
+}
+
+} // namespace
+
+/**
+ * @brief Obtiene el tamaño y la fecha de modificación de un archivo.
+ * 
+ * @param ruta Ruta del archivo.
+ * @param precision Precisión de los atributos con la que se lee el archivo (ver firmaPrecision).
+ * @return Firma del archivo.
+ */
+FirmaCSV firmaArchivo(const std::string& ruta, const PrecisionAtributos& precision) {
+    struct stat info;
+    if (::stat(ruta.c_str(), &info) != 0) {
+        throw std::runtime_error("Error: no se pudo abrir el archivo " + ruta + ".");
+    }
+    FirmaCSV firma;
+    firma.tam = static_cast<uint64_t>(info.st_size);
+    firma.mtime_ns = static_cast<int64_t>(info.st_mtim.tv_sec) * 1000000000 + info.st_mtim.tv_nsec;
+    firma.precision = firmaPrecision(precision);
+    return firma;
+}
+
+/**
+ * @brief Guarda el nivel base en una caché binaria por columnas.
+ * 
+ * Formato (versión VERSION_CACHE_BASE):
+ *   - CabeceraCache: dimensiones, firma del CSV de origen y de la precisión de los atributos, número de clases de atributos y suma de comprobación.
+ *   - Un DescriptorColumna por atributo (nombre, tipo, desplazamiento y tamaño).
+ *   - La tabla de atributos: un AtributosSuelo por clase, en orden de clase.
+ *   - Cada columna, en orden fila-mayor de la base, empezando en un múltiplo de 4096 bytes.
+ * 
+ * Se escribe primero en un archivo temporal que luego se renombra, de modo que un proceso que lea
+ * la caché a la vez nunca ve un archivo a medias.
+ * 
+ * @param ruta Ruta de la caché.
+ * @param base Nivel 0 de la pirámide, ya cargado.
+ * @param firma Firma del CSV del que se leyó la base.
+ * @param num_hilos Número de hilos para la suma de comprobación.
+ */
+void guardarCacheBase(const std::string& ruta, const Nivel& base, const FirmaCSV& firma, int num_hilos) {
+    CabeceraCache cabecera{};
+    std::memcpy(cabecera.magia, MAGIA_CACHE, sizeof(cabecera.magia));
+    cabecera.version = VERSION_CACHE_BASE;
+    cabecera.num_filas = base.num_filas;
+    cabecera.num_columnas = base.num_columnas;
+    cabecera.csv_tam = firma.tam;
+    cabecera.csv_mtime_ns = firma.mtime_ns;
+    cabecera.firma_precision = firma.precision;
+
+    // Calcular el esquema y la posición de cada columna
+    std::vector<DescriptorColumna> descriptores;
+    recorrerColumnasCache(base, [&](const char* nombre, const auto& columna) {
+        using T = typename std::decay_t<decltype(columna)>::value_type;
+        DescriptorColumna descriptor{};
+        std::strncpy(descriptor.nombre, nombre, sizeof(descriptor.nombre) - 1);
+        descriptor.tipo = tipoColumna<T>();
+        descriptor.tam_elemento = sizeof(T);
+        descriptor.bytes = columna.size() * sizeof(T);
+        descriptores.push_back(descriptor);
+    });
+
+    const std::vector<AtributosSuelo>& clases = base.atributos->entradas();
+    std::size_t bytes_tabla = clases.size() * sizeof(AtributosSuelo);
+    std::size_t desplazamiento = alinear(sizeof(CabeceraCache) + descriptores.size() * sizeof(DescriptorColumna)
+                                         + bytes_tabla);
+    uint64_t suma = mezclarSuma(BASE_SUMA, sumaComprobacion(clases.data(), bytes_tabla, num_hilos));
+    std::size_t i = 0;
+    recorrerColumnasCache(base, [&](const char*, const auto& columna) {
+        DescriptorColumna& descriptor = descriptores[i++];
+        descriptor.desplazamiento = desplazamiento;
+        desplazamiento = alinear(desplazamiento + descriptor.bytes);
+        suma = mezclarSuma(suma, sumaComprobacion(columna.data(), descriptor.bytes, num_hilos));
+    });
+    cabecera.num_atributos = static_cast<uint32_t>(descriptores.size());
+    cabecera.num_clases = clases.size();
+    cabecera.suma = suma;
+
+    // Escribir en un archivo temporal
+    std::string temporal = ruta + ".tmp";
+    std::ofstream archivo(temporal, std::ios::binary | std::ios::trunc);
+    if (!archivo) {
+        throw std::runtime_error("Error: no se pudo crear la cache " + temporal + ".");
+    }
+    archivo.write(reinterpret_cast<const char*>(&cabecera), sizeof(cabecera));
+    archivo.write(reinterpret_cast<const char*>(descriptores.data()), descriptores.size() * sizeof(DescriptorColumna));
+    archivo.write(reinterpret_cast<const char*>(clases.data()), static_cast<std::streamsize>(bytes_tabla));
+    i = 0;
+    recorrerColumnasCache(base, [&](const char*, const auto& columna) {
+        const DescriptorColumna& descriptor = descriptores[i++];
+        archivo.seekp(static_cast<std::streamoff>(descriptor.desplazamiento));
+        archivo.write(reinterpret_cast<const char*>(columna.data()), static_cast<std::streamsize>(descriptor.bytes));
+    });
+    archivo.close();
+    if (!archivo) {
+        std::remove(temporal.c_str());
+        throw std::runtime_error("Error: no se pudo escribir la cache " + temporal + ".");
+    }
+
+    if (std::rename(temporal.c_str(), ruta.c_str()) != 0) {
+        std::remove(temporal.c_str());
+        throw std::runtime_error("Error: no se pudo renombrar la cache " + temporal + ".");
+    }
+}
+
+/**
+ * @brief Lee las dimensiones de la base de la cabecera de su caché binaria.
+ * 
+ * Permite construir la pirámide sin indicar sus dimensiones cuando ya existe una caché del CSV.
+ * 
+ * @param ruta Ruta de la caché.
+ * @param firma Firma del CSV actual.
+ * @param num_filas Filas de la base, si la caché es válida.
+ * @param num_columnas Columnas de la base, si la caché es válida.
+ * @return Verdadero si la caché existe y corresponde al CSV, falso en caso contrario.
+ */
+bool leerDimensionesCache(const std::string& ruta, const FirmaCSV& firma, int& num_filas, int& num_columnas) {
+    std::ifstream archivo(ruta, std::ios::binary);
+    CabeceraCache cabecera;
+    if (!archivo.read(reinterpret_cast<char*>(&cabecera), sizeof(cabecera))) {
+        return false;
+    }
+    if (std::memcmp(cabecera.magia, MAGIA_CACHE, sizeof(cabecera.magia)) != 0
+        || cabecera.version != VERSION_CACHE_BASE
+        || cabecera.csv_tam != firma.tam || cabecera.csv_mtime_ns != firma.mtime_ns
+        || cabecera.firma_precision != firma.precision
+        || cabecera.num_filas <= 0 || cabecera.num_columnas <= 0) {
+        return false;
+    }
+    num_filas = cabecera.num_filas;
+    num_columnas = cabecera.num_columnas;
+    return true;
+}
+
+/**
+ * @brief Carga el nivel base desde su caché binaria, proyectando cada columna directamente del archivo.
+ * 
+ * Las columnas de la base pasan a apuntar a la proyección del archivo (privada y con copia en escritura),
+ * de modo que solo se leen de disco las páginas que se usan y solo se copian las que se modifican.
+ * La caché se descarta (devuelve falso) si no existe, si es de otra versión o esquema, si sus dimensiones
+ * no coinciden con las de la base o si se generó a partir de otro CSV o con otra precisión de los atributos.
+ * 
+ * @param ruta Ruta de la caché.
+ * @param base Nivel 0 de la pirámide; no hace falta que tenga las columnas reservadas, pero sí su tabla de atributos.
+ * @param firma Firma del CSV actual.
+ * @param verificar Si es verdadero, se comprueba la suma de las columnas antes de usarlas.
+ * @param num_hilos Número de hilos para la suma de comprobación.
+ * @return Verdadero si la base se cargó de la caché, falso en caso contrario.
+ */
+bool cargarCacheBase(const std::string& ruta, Nivel& base, const FirmaCSV& firma, bool verificar, int num_hilos) {
+    if (!proyectarCacheBase(ruta, base, firma, verificar, num_hilos)) {
+        return false;
+    }
+
+    // Reconstruir las columnas que no se guardan
+    std::size_t tam_base = base.size();
+    base.area.assign(tam_base, -1, base.pool.get(), base.paginas);
+    base.padre.assign(tam_base, -1, base.pool.get(), base.paginas);
+    for (std::size_t k = 0; k < tam_base; k++) {
+        if (base.homog[k] == 1) {
+            base.area[k] = 1;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Proyecta las columnas guardadas en la caché binaria de la base, sin reconstruir las demás.
+ * 
+ * Hace las mismas comprobaciones que cargarCacheBase y carga la tabla de atributos, pero solo proyecta homog,
+ * clase y estaciones: el área y el padre de la base quedan como estuvieran. Sirve para leer la base por tramos
+ * de filas sin tenerla entera en memoria (ver Piramide::construirEnDisco).
+ * 
+ * @param ruta Ruta de la caché.
+ * @param base Nivel en el que se proyectan las columnas; debe tener la tabla de atributos.
+ * @param firma Firma del CSV actual.
+ * @param verificar Si es verdadero, se comprueba la suma de las columnas antes de usarlas.
+ * @param num_hilos Número de hilos para la suma de comprobación.
+ * @return Verdadero si las columnas se proyectaron, falso si hay que leer el CSV.
+ */
+bool proyectarCacheBase(const std::string& ruta, Nivel& base, const FirmaCSV& firma, bool verificar, int num_hilos) {
+    struct stat info;
+    if (::stat(ruta.c_str(), &info) != 0) {
+        return false;
+    }
+
+    std::shared_ptr<ArchivoMapeado> archivo = std::make_shared<ArchivoMapeado>(ruta, true);
+    if (archivo->size() < sizeof(CabeceraCache)) {
+        return false;
+    }
+
+    CabeceraCache cabecera;
+    std::memcpy(&cabecera, archivo->data(), sizeof(cabecera));
+    if (std::memcmp(cabecera.magia, MAGIA_CACHE, sizeof(cabecera.magia)) != 0
+        || cabecera.version != VERSION_CACHE_BASE
+        || cabecera.num_filas != base.num_filas || cabecera.num_columnas != base.num_columnas
+        || cabecera.csv_tam != firma.tam || cabecera.csv_mtime_ns != firma.mtime_ns
+        || cabecera.firma_precision != firma.precision) {
+        return false;
+    }
+
+    std::size_t fin_descriptores = sizeof(CabeceraCache) + cabecera.num_atributos * sizeof(DescriptorColumna);
+    std::size_t bytes_tabla = cabecera.num_clases * sizeof(AtributosSuelo);
+    if (cabecera.num_clases >= CLASE_VACIA || archivo->size() < fin_descriptores + bytes_tabla) {
+        return false;
+    }
+    std::vector<DescriptorColumna> descriptores(cabecera.num_atributos);
+    std::memcpy(descriptores.data(), archivo->data() + sizeof(CabeceraCache), descriptores.size() * sizeof(DescriptorColumna));
+
+    // Comprobar que el esquema coincide con el esperado
+    bool valida = true;
+    std::size_t i = 0;
+    recorrerColumnasCache(base, [&](const char* nombre, auto& columna) {
+        using T = typename std::decay_t<decltype(columna)>::value_type;
+        if (i >= descriptores.size()) {
+            valida = false;
+            return;
+        }
+        const DescriptorColumna& descriptor = descriptores[i++];
+        if (std::strncmp(descriptor.nombre, nombre, sizeof(descriptor.nombre)) != 0
+            || descriptor.tipo != tipoColumna<T>() || descriptor.tam_elemento != sizeof(T)
+            || descriptor.bytes != base.size() * sizeof(T)
+            || descriptor.desplazamiento % ALINEACION_CACHE != 0
+            || descriptor.desplazamiento + descriptor.bytes > archivo->size()) {
+            valida = false;
+        }
+    });
+    if (!valida || i != descriptores.size()) {
+        return false;
+    }
+
+    const char* tabla = archivo->data() + fin_descriptores;
+    if (verificar) {
+        uint64_t suma = mezclarSuma(BASE_SUMA, sumaComprobacion(tabla, bytes_tabla, num_hilos));
+        for (const DescriptorColumna& descriptor : descriptores) {
+            suma = mezclarSuma(suma, sumaComprobacion(archivo->data() + descriptor.desplazamiento, descriptor.bytes,
+                                                  num_hilos, true));
+        }
+        if (suma != cabecera.suma) {
+            std::cerr << "\t\tLa cache " << ruta << " esta corrupta, se descarta." << std::endl;
+            return false;
+        }
+    }
+
+    // Cargar la tabla de atributos y proyectar las columnas guardadas
+    std::vector<AtributosSuelo> clases(cabecera.num_clases);
+    std::memcpy(clases.data(), tabla, bytes_tabla);
+    base.atributos->asignar(std::move(clases));
+
+    i = 0;
+    recorrerColumnasCache(base, [&](const char*, auto& columna) {
+        using T = typename std::decay_t<decltype(columna)>::value_type;
+        const DescriptorColumna& descriptor = descriptores[i++];
+        columna.proyectar(reinterpret_cast<T*>(archivo->data() + descriptor.desplazamiento), base.size(), archivo);
+    });
+    return true;
+}
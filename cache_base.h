@@ -0,0 +1,41 @@
+#ifndef CACHE_BASE_H
+#define CACHE_BASE_H
+
+#include "nivel.h"
+
+#include <cstdint>
+#include <string>
+
+/**
+ * @brief Firma del archivo CSV del que se generó una caché (tamaño y fecha de modificación) y de la precisión
+ * con la que se guardaron sus atributos.
+ * 
+ * Si el CSV o la precisión cambian, su firma deja de coincidir con la guardada y la caché se descarta.
+ */
+struct FirmaCSV {
+    uint64_t tam;
+    int64_t mtime_ns;
+    uint64_t precision;
+};
+
+// Versión del formato de la caché; se incrementa con cada cambio de disposición o de esquema
+const uint32_t VERSION_CACHE_BASE = 3;
+
+// Obtiene la firma de un archivo leído con la precisión dada; lanza std::runtime_error si no existe
+FirmaCSV firmaArchivo(const std::string& ruta, const PrecisionAtributos& precision);
+
+// Escribe el nivel base en la caché binaria 'ruta'
+void guardarCacheBase(const std::string& ruta, const Nivel& base, const FirmaCSV& firma, int num_hilos);
+
+// Lee las dimensiones de la base guardadas en la caché; devuelve falso si no existe, es de otra versión
+// o no corresponde al CSV con la firma dada
+bool leerDimensionesCache(const std::string& ruta, const FirmaCSV& firma, int& num_filas, int& num_columnas);
+
+// Proyecta la caché binaria en las columnas del nivel base; devuelve falso si no existe, es de otra versión
+// o no corresponde al CSV con la firma dada
+bool cargarCacheBase(const std::string& ruta, Nivel& base, const FirmaCSV& firma, bool verificar, int num_hilos);
+
+// Como cargarCacheBase, pero solo proyecta las columnas guardadas (homog, clase y estaciones), sin el área ni el padre
+bool proyectarCacheBase(const std::string& ruta, Nivel& base, const FirmaCSV& firma, bool verificar, int num_hilos);
+
+#endif // CACHE_BASE_H
@@ -0,0 +1,93 @@
+#ifndef COLUMNA_H
+#define COLUMNA_H
+
+#include "pool_memoria.h"
+
+#include <cstddef>
+#include <memory>
+
+/**
+ * @brief Buffer contiguo con los valores de un atributo para todos los nodos de un nivel.
+ * 
+ * La memoria puede ser propia (reservada con assign) o pertenecer a otro objeto, por ejemplo
+ * un archivo proyectado en memoria (proyectar). En el segundo caso la columna mantiene vivo
+ * al propietario mientras la use. Las columnas no se copian, solo se mueven.
+ */
+template <typename T>
+class Columna {
+public:
+    using value_type = T;
+
+    Columna() = default;
+    Columna(Columna&&) noexcept = default;
+    Columna& operator=(Columna&&) noexcept = default;
+    Columna(const Columna&) = delete;
+    Columna& operator=(const Columna&) = delete;
+
+    /**
+     * @brief Reserva memoria propia para n elementos y los inicializa con 'valor'.
+     * 
+     * @param n Número de elementos.
+     * @param valor Valor inicial de todos los elementos.
+     * @param pool Pool del que se toma la memoria, que vuelve a él al liberar la columna (nullptr = reservarla).
+     * @param paginas Tamaño de página de la memoria reservada (ver reservarPaginas).
+     */
+    void assign(std::size_t n, T valor, PoolMemoria* pool = nullptr, PaginasGrandes paginas = PaginasGrandes::No) {
+        reservarSinIniciar(n, pool, paginas);
+        for (std::size_t i = 0; i < n; i++) {
+            datos[i] = valor;
+        }
+    }
+
+    /**
+     * @brief Reserva memoria propia para n elementos sin inicializarlos.
+     * 
+     * Las páginas de un bloque nuevo no se asignan hasta escribirlas por primera vez: quien inicializa la columna
+     * decide en qué nodo NUMA queda cada parte (ver Nivel::reservar).
+     * 
+     * @param n Número de elementos.
+     * @param pool Pool del que se toma la memoria, que vuelve a él al liberar la columna (nullptr = reservarla).
+     * @param paginas Tamaño de página de la memoria reservada (ver reservarPaginas).
+     */
+    void reservarSinIniciar(std::size_t n, PoolMemoria* pool = nullptr, PaginasGrandes paginas = PaginasGrandes::No) {
+        if (pool != nullptr && n > 0) {
+            memoria = pool->tomar(n * sizeof(T), paginas);
+        } else {
+            memoria = reservarPaginas(n * sizeof(T), paginas);
+        }
+        datos = static_cast<T*>(memoria.get());
+        tam = n;
+    }
+
+    /**
+     * @brief Usa como columna n elementos de una memoria ajena.
+     * 
+     * @param externos Primer elemento de la columna.
+     * @param n Número de elementos.
+     * @param propietario Objeto dueño de la memoria, que se mantiene vivo mientras exista la columna.
+     */
+    void proyectar(T* externos, std::size_t n, std::shared_ptr<void> propietario) {
+        memoria = std::move(propietario);
+        datos = externos;
+        tam = n;
+    }
+
+    T& operator[](std::size_t i) { return datos[i]; }
+    const T& operator[](std::size_t i) const { return datos[i]; }
+
+    T* data() { return datos; }
+    const T* data() const { return datos; }
+    std::size_t size() const { return tam; }
+
+    T* begin() { return datos; }
+    T* end() { return datos + tam; }
+    const T* begin() const { return datos; }
+    const T* end() const { return datos + tam; }
+
+private:
+    std::shared_ptr<void> memoria;
+    T* datos = nullptr;
+    std::size_t tam = 0;
+};
+
+#endif // COLUMNA_H
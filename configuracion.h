@@ -0,0 +1,131 @@
+#ifndef CONFIGURACION_H
+#define CONFIGURACION_H
+
+#include "tabla_atributos.h"
+
+#include <cstddef>
+#include <string>
+
+/**
+ * @brief Forma de repartir entre hilos la construcción de los niveles superiores.
+ */
+enum class Particion {
+    // Nivel a nivel, por bandas de filas completas
+    Bandas,
+    // Por teselas cuadradas que se reducen varios niveles seguidos
+    Teselas
+};
+
+/**
+ * @brief Juego de instrucciones usado para comparar los bloques 2x2 al construir los niveles superiores.
+ */
+enum class NucleoSimd {
+    // El mejor disponible en el procesador
+    Auto,
+    // Sin vectorizar: comparación nodo a nodo (nodosSonIguales / nodosSonHomogeneos)
+    Escalar,
+    SSE2,
+    AVX2
+};
+
+/**
+ * @brief Tamaño de las páginas con las que se reservan las columnas de los niveles.
+ */
+enum class PaginasGrandes {
+    // Páginas normales, con new
+    No,
+    // Páginas grandes transparentes, pedidas con madvise; el sistema las da si tiene memoria contigua libre
+    Transparentes,
+    // Páginas grandes explícitas (MAP_HUGETLB), de las reservadas en el sistema; si no quedan, transparentes
+    Explicitas
+};
+
+/**
+ * @brief Parámetros de construcción de la Pirámide.
+ */
+struct Configuracion {
+    // Archivo CSV con los datos de la base de la pirámide
+    std::string archivo_csv = "completo0.csv";
+    // Dimensiones del ráster de la base (0 = tomarlas de la caché binaria de la base)
+    int num_filas = 6715;
+    int num_columnas = 13901;
+
+    // Número de hilos de trabajo (0 = todos los núcleos disponibles)
+    int num_hilos = 0;
+
+    // Reparto de la construcción de los niveles superiores
+    Particion particion = Particion::Bandas;
+    // Filas por banda (0 = automático según el número de hilos)
+    int filas_por_banda = 0;
+    // Niveles que se reducen seguidos dentro de cada tesela (teselas de 2^k x 2^k nodos)
+    int niveles_por_tesela = 4;
+    // Núcleo de comparación de los bloques 2x2
+    NucleoSimd nucleo_2x2 = NucleoSimd::Auto;
+    // Dejar vacíos los nodos no homogéneos al construir los niveles superiores, en lugar de eliminarlos en purga()
+    bool purga_fusionada = true;
+    // Comparar el resultado de la purga fusionada con el de construir y purgar por separado (repite la construcción)
+    bool validar_purga_fusionada = false;
+
+    // Tolerancia de cada atributo de suelo y umbrales para fusionar también los bloques 2x2 homogéneos con atributos
+    // parecidos (caso 2): absoluta, en las unidades del atributo, y relativa, como fracción del mayor valor absoluto
+    // del bloque. El padre recibe la media de los atributos ponderada por el área. Con todas a 0 solo se fusionan los
+    // bloques iguales
+    AtributosSuelo tolerancia_absoluta = {};
+    AtributosSuelo tolerancia_relativa = {};
+
+    // Precisión con la que se guarda cada atributo de suelo y umbrales al leer la base (double, float o punto fijo
+    // de 16 bits); los valores que no se conservan se redondean y se informa de ellos al leer el CSV
+    PrecisionAtributos precision_atributos = {};
+
+    // Páginas de las columnas grandes de los niveles; con páginas grandes cada entrada de la TLB cubre 2 MB en lugar
+    // de 4 KB. Las columnas se inicializan en paralelo por las mismas bandas de filas que luego construye cada hilo,
+    // de modo que en un sistema NUMA cada banda queda en la memoria del nodo que la toca primero
+    PaginasGrandes paginas_grandes = PaginasGrandes::Transparentes;
+
+    // Tras la purga, los niveles con menos de esta fracción de nodos no vacíos se guardan de forma dispersa
+    // (0 = todos los niveles densos)
+    double densidad_dispersa = 0.25;
+
+    // Caché binaria de la base: se reutiliza mientras el CSV no cambie de tamaño ni de fecha y la precisión
+    // de los atributos sea la misma
+    bool usar_cache = true;
+    // Ruta de la caché (vacía = archivo_csv + ".cache")
+    std::string archivo_cache;
+    // Comprobar la suma de las columnas al cargar la caché
+    bool verificar_cache = true;
+
+    // Memoria máxima para los niveles al construir la pirámide, en MB (0 = sin límite); si no caben, se construyen
+    // por teselas con los niveles inferiores en un archivo temporal
+    std::size_t memoria_maxima_mb = 0;
+    // Ruta del archivo temporal de los niveles (vacía = archivo_csv + ".niveles")
+    std::string archivo_niveles;
+
+    // Instantánea de la pirámide construida que se guarda al terminar (vacía = no se guarda); ver
+    // Piramide::guardarInstantanea y Piramide::cargarInstantanea
+    std::string archivo_instantanea;
+    // Comprobar la suma de toda la instantánea al cargarla (la lee entera, en lugar de solo las páginas que se usan)
+    bool verificar_instantanea = false;
+
+    // Informe de métricas de la construcción, en JSON o, si termina en ".csv", en CSV (vacío = sin informe)
+    std::string archivo_metricas;
+
+    // Tabla de estadísticas de las regiones que se guarda al terminar, en binario o, si termina en ".csv", en CSV
+    // (vacía = no se guarda); ver TablaRegiones
+    std::string archivo_regiones;
+
+    // Ráster con la región de cada celda de la base que se exporta al terminar: binario sin cabecera o, si termina en
+    // ".rle" o en ".csv", por tramos o en CSV (vacío = no se exporta); ver exportarEtiquetas
+    std::string archivo_etiquetas;
+
+    // Ruta efectiva de la caché binaria
+    std::string rutaCache() const {
+        return archivo_cache.empty() ? archivo_csv + ".cache" : archivo_cache;
+    }
+
+    // Ruta efectiva del archivo temporal de los niveles
+    std::string rutaNiveles() const {
+        return archivo_niveles.empty() ? archivo_csv + ".niveles" : archivo_niveles;
+    }
+};
+
+#endif // CONFIGURACION_H
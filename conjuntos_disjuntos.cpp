@@ -0,0 +1,100 @@
+#include "conjuntos_disjuntos.h"
+
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+/**
+ * @brief Vacía la estructura y crea un conjunto por elemento.
+ * 
+ * @param num_elementos Número de elementos, que se identifican por su índice en [0, num_elementos).
+ */
+void ConjuntosDisjuntos::reiniciar(std::size_t num_elementos) {
+    if (num_elementos > UINT32_MAX) {
+        throw std::runtime_error("Error: demasiados elementos para los conjuntos disjuntos ("
+                                 + std::to_string(num_elementos) + ").");
+    }
+    padres.reset(new std::atomic<uint32_t>[num_elementos]);
+    tam = num_elementos;
+    for (std::size_t e = 0; e < num_elementos; e++) {
+        padres[e].store(static_cast<uint32_t>(e), std::memory_order_relaxed);
+    }
+}
+
+/**
+ * @brief Busca la raíz del conjunto de un elemento.
+ * 
+ * Por el camino, cada elemento visitado pasa a apuntar a su abuelo (división a la mitad del camino). Si otro
+ * hilo ha cambiado el padre entretanto, la comparación e intercambio falla y el camino simplemente no se acorta.
+ * 
+ * @param elemento Elemento.
+ * @return Raíz del conjunto, que es su elemento menor.
+ */
+uint32_t ConjuntosDisjuntos::buscar(uint32_t elemento) {
+    while (true) {
+        uint32_t padre = padres[elemento].load(std::memory_order_relaxed);
+        if (padre == elemento) {
+            return elemento;
+        }
+        uint32_t abuelo = padres[padre].load(std::memory_order_relaxed);
+        if (abuelo != padre) {
+            padres[elemento].compare_exchange_weak(padre, abuelo, std::memory_order_relaxed);
+        }
+        elemento = abuelo;
+    }
+}
+
+/**
+ * @brief Une los conjuntos de dos elementos.
+ * 
+ * Cuelga la raíz de mayor índice de la de menor índice. Si otro hilo ha colgado antes esa raíz de otro
+ * elemento, se vuelven a buscar las raíces y se repite.
+ * 
+ * @param a Primer elemento.
+ * @param b Segundo elemento.
+ * @return Verdadero si los conjuntos eran distintos, falso si ya estaban unidos.
+ */
+bool ConjuntosDisjuntos::unir(uint32_t a, uint32_t b) {
+    while (true) {
+        a = buscar(a);
+        b = buscar(b);
+        if (a == b) {
+            return false;
+        }
+        if (a < b) {
+            std::swap(a, b);
+        }
+        uint32_t esperado = a;
+        if (padres[a].compare_exchange_strong(esperado, b, std::memory_order_relaxed)) {
+            return true;
+        }
+    }
+}
+
+/**
+ * @brief Numera los conjuntos de forma densa.
+ * 
+ * Como la raíz de cada conjunto es su elemento menor, al recorrer los elementos en orden la raíz aparece antes
+ * que el resto del conjunto: basta una pasada para dar a cada raíz el siguiente número y a cada elemento el
+ * número de su raíz. Los conjuntos quedan numerados en el orden de su elemento menor.
+ * 
+ * @param num_conjuntos Recibe el número de conjuntos distintos.
+ * @return Etiqueta de cada elemento, en [0, num_conjuntos).
+ */
+std::vector<uint32_t> ConjuntosDisjuntos::etiquetasDensas(uint32_t& num_conjuntos) {
+    std::vector<uint32_t> etiquetas(tam);
+    num_conjuntos = 0;
+    for (std::size_t e = 0; e < tam; e++) {
+        uint32_t raiz = buscar(static_cast<uint32_t>(e));
+        etiquetas[e] = raiz == e ? num_conjuntos++ : etiquetas[raiz];
+    }
+    return etiquetas;
+}
+
+/**
+ * @brief Libera la memoria de la estructura.
+ */
+void ConjuntosDisjuntos::clear() {
+    padres.reset();
+    tam = 0;
+}
@@ -0,0 +1,44 @@
+#ifndef CONJUNTOS_DISJUNTOS_H
+#define CONJUNTOS_DISJUNTOS_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+/**
+ * @brief Estructura de conjuntos disjuntos (union-find) que admite uniones concurrentes sin cerrojos.
+ * 
+ * Cada elemento guarda el índice de su padre en un entero atómico. buscar() acorta los caminos a la mitad
+ * mientras sube hasta la raíz, y unir() cuelga la raíz de mayor índice de la de menor índice con una
+ * comparación e intercambio, así que la raíz de cada conjunto es siempre su elemento menor y el resultado
+ * no depende del orden en que los hilos hacen las uniones. buscar() y unir() se pueden llamar desde varios
+ * hilos a la vez; reiniciar() y etiquetasDensas() no.
+ */
+class ConjuntosDisjuntos {
+public:
+    // Vacía la estructura y crea num_elementos conjuntos de un elemento
+    void reiniciar(std::size_t num_elementos);
+
+    // Raíz del conjunto de un elemento
+    uint32_t buscar(uint32_t elemento);
+
+    // Une los conjuntos de dos elementos; devuelve falso si ya estaban en el mismo conjunto
+    bool unir(uint32_t a, uint32_t b);
+
+    // Número de conjuntos distintos y etiqueta de cada elemento, numerando los conjuntos por su elemento menor
+    std::vector<uint32_t> etiquetasDensas(uint32_t& num_conjuntos);
+
+    // Número de elementos
+    std::size_t size() const { return tam; }
+
+    // Libera la memoria de la estructura
+    void clear();
+
+private:
+    std::unique_ptr<std::atomic<uint32_t>[]> padres;
+    std::size_t tam = 0;
+};
+
+#endif // CONJUNTOS_DISJUNTOS_H
@@ -0,0 +1,166 @@
+#include "consultas.h"
+#include "paralelo.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace {
+
+/**
+ * @brief Separa los bits de un entero de 32 bits, dejando un bit vacío entre cada dos.
+ * 
+ * @param x Entero.
+ * @return Entero de 64 bits con el bit k de x en el bit 2k.
+ */
+uint64_t separarBits(uint32_t x) {
+    uint64_t v = x;
+    v = (v | (v << 16)) & 0x0000FFFF0000FFFFull;
+    v = (v | (v << 8)) & 0x00FF00FF00FF00FFull;
+    v = (v | (v << 4)) & 0x0F0F0F0F0F0F0F0Full;
+    v = (v | (v << 2)) & 0x3333333333333333ull;
+    v = (v | (v << 1)) & 0x5555555555555555ull;
+    return v;
+}
+
+/**
+ * @brief Obtiene el código de Morton (orden Z) de una celda.
+ * 
+ * Las celdas con códigos próximos están próximas en el ráster y comparten antecesores en la Pirámide.
+ * 
+ * @param fila Fila de la celda.
+ * @param columna Columna de la celda.
+ * @return Código con los bits de la fila y la columna intercalados.
+ */
+uint64_t codigoMorton(int fila, int columna) {
+    return (separarBits(static_cast<uint32_t>(fila)) << 1) | separarBits(static_cast<uint32_t>(columna));
+}
+
+} // namespace
+
+/**
+ * @brief Constructor de la consulta.
+ * 
+ * @param piramide Pirámide construida, o cargada con Piramide::cargarInstantanea.
+ */
+ConsultaPiramide::ConsultaPiramide(const Piramide& piramide)
+    : niveles{piramide.piramide}, num_filas{piramide.num_filas}, num_columnas{piramide.num_columnas} {}
+
+/**
+ * @brief Consulta una celda de la base.
+ * 
+ * Baja por los antecesores naturales de la celda (el nodo del nivel n que la cubre es (fila >> n, columna >> n))
+ * desde el nivel más alto en el que existe hasta el primero homogéneo, que tiene la clase de todas las celdas de
+ * su bloque. Solo la región se lee de la base, porque enlaza puede haber colgado la celda de un vecino.
+ * 
+ * @param fila Fila de la celda en la base.
+ * @param columna Columna de la celda en la base.
+ * @return Resultado de la consulta, vacío si la celda no tiene datos o está fuera de la base.
+ */
+ResultadoPunto ConsultaPiramide::consultarPunto(int fila, int columna) const {
+    ResultadoPunto resultado;
+    if (fila < 0 || columna < 0 || fila >= num_filas || columna >= num_columnas) {
+        return resultado;
+    }
+
+    for (int n = static_cast<int>(niveles.size()) - 1; n >= 0; n--) {
+        const Nivel& nivel = niveles[n];
+        int i = fila >> n;
+        int j = columna >> n;
+        if (i >= nivel.num_filas || j >= nivel.num_columnas) {
+            continue;
+        }
+        std::size_t p = nivel.posicion(nivel.indice(i, j));
+        if (nivel.homog[p] == 1) {
+            resultado.clase = nivel.clase[p];
+            resultado.nivel = n;
+            resultado.atributos = &(*nivel.atributos)[resultado.clase];
+            break;
+        }
+    }
+
+    const Nivel& base = niveles[0];
+    if (resultado.nivel != -1 && base.region.size() > 0) {
+        resultado.region = base.region[base.posicion(base.indice(fila, columna))];
+    }
+    return resultado;
+}
+
+/**
+ * @brief Consulta un lote de celdas de la base.
+ * 
+ * Las celdas se ordenan por su código de Morton antes de consultarlas, de modo que las consultas seguidas
+ * recorren los mismos antecesores y las mismas páginas de la base. El lote ordenado se reparte en tramos
+ * entre los hilos.
+ * 
+ * @param puntos Celdas a consultar.
+ * @param num_hilos Número de hilos (0 = todos los núcleos disponibles).
+ * @return Resultado de cada celda, en el orden de 'puntos'.
+ */
+std::vector<ResultadoPunto> ConsultaPiramide::consultarPuntos(const std::vector<PuntoConsulta>& puntos,
+                                                              int num_hilos) const {
+    std::vector<std::pair<uint64_t, std::size_t>> orden(puntos.size());
+    for (std::size_t k = 0; k < puntos.size(); k++) {
+        orden[k] = {codigoMorton(puntos[k].fila, puntos[k].columna), k};
+    }
+    std::sort(orden.begin(), orden.end());
+
+    std::vector<ResultadoPunto> resultados(puntos.size());
+    const std::size_t PUNTOS_TAREA = 1 << 12;
+    paraleloPara(num_hilos, (orden.size() + PUNTOS_TAREA - 1) / PUNTOS_TAREA, [&](std::size_t tarea) {
+        std::size_t fin = std::min(orden.size(), (tarea + 1) * PUNTOS_TAREA);
+        for (std::size_t k = tarea * PUNTOS_TAREA; k < fin; k++) {
+            const PuntoConsulta& punto = puntos[orden[k].second];
+            resultados[orden[k].second] = consultarPunto(punto.fila, punto.columna);
+        }
+    });
+    return resultados;
+}
+
+/**
+ * @brief Obtiene el área de cada clase dentro de una ventana rectangular de la base.
+ * 
+ * La ventana se recorta a la base y se suma de una vez la parte que cae en ella de cada bloque homogéneo (ver
+ * recorrerBloques); las celdas sin datos no suman.
+ * 
+ * @param fila_inicio Primera fila de la ventana.
+ * @param columna_inicio Primera columna de la ventana.
+ * @param fila_fin Fila siguiente a la última de la ventana.
+ * @param columna_fin Columna siguiente a la última de la ventana.
+ * @return Área en celdas de la base de cada clase presente en la ventana, ordenada por clase.
+ */
+std::vector<AreaClase> ConsultaPiramide::consultarVentana(int fila_inicio, int columna_inicio, int fila_fin,
+                                                          int columna_fin) const {
+    fila_inicio = std::max(fila_inicio, 0);
+    columna_inicio = std::max(columna_inicio, 0);
+    fila_fin = std::min(fila_fin, num_filas);
+    columna_fin = std::min(columna_fin, num_columnas);
+    if (fila_inicio >= fila_fin || columna_inicio >= columna_fin) {
+        return {};
+    }
+
+    std::unordered_map<uint32_t, uint64_t> areas;
+    // Los bloques seguidos suelen ser de la misma clase: se evita buscarla de nuevo en la tabla
+    std::pair<uint32_t, uint64_t*> ultima{CLASE_VACIA, nullptr};
+    recorrerBloques(niveles, fila_inicio, columna_inicio, fila_fin, columna_fin,
+                    [&](int n, int i, int j, std::size_t p) {
+                        const Nivel& nivel = niveles[n];
+                        if (nivel.homog[p] != 1) {
+                            return;
+                        }
+                        uint64_t filas = std::min(fila_fin, (i + 1) << n) - std::max(fila_inicio, i << n);
+                        uint64_t columnas = std::min(columna_fin, (j + 1) << n) - std::max(columna_inicio, j << n);
+                        if (ultima.first != nivel.clase[p] || ultima.second == nullptr) {
+                            ultima = {nivel.clase[p], &areas[nivel.clase[p]]};
+                        }
+                        *ultima.second += filas * columnas;
+                    });
+
+    std::vector<AreaClase> resultado;
+    resultado.reserve(areas.size());
+    for (const auto& entrada : areas) {
+        resultado.push_back({entrada.first, entrada.second});
+    }
+    std::sort(resultado.begin(), resultado.end(),
+              [](const AreaClase& a, const AreaClase& b) { return a.clase < b.clase; });
+    return resultado;
+}
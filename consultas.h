@@ -0,0 +1,151 @@
+#ifndef CONSULTAS_H
+#define CONSULTAS_H
+
+#include "piramide.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Celda de la base de la Pirámide que se consulta.
+ */
+struct PuntoConsulta {
+    int fila;
+    int columna;
+};
+
+/**
+ * @brief Resultado de la consulta de una celda de la base.
+ */
+struct ResultadoPunto {
+    // Clase de los atributos de suelo y umbrales de la celda (CLASE_VACIA si está vacía o fuera de la base)
+    uint32_t clase = CLASE_VACIA;
+    // Región de la celda tras Piramide::clasifica (REGION_VACIA si está vacía o no se ha clasificado)
+    uint32_t region = REGION_VACIA;
+    // Nivel del antecesor homogéneo más alto de la celda (-1 si está vacía)
+    int nivel = -1;
+    // Atributos de suelo y umbrales de la clase (nullptr si la celda está vacía)
+    const AtributosSuelo* atributos = nullptr;
+};
+
+/**
+ * @brief Área de una clase dentro de una ventana, en celdas de la base.
+ */
+struct AreaClase {
+    uint32_t clase;
+    uint64_t area;
+};
+
+/**
+ * @brief Baja por el bloque de un nodo hasta sus bloques homogéneos que cortan una ventana (ver recorrerBloques).
+ * 
+ * @param niveles Niveles de la Pirámide.
+ * @param n Nivel del nodo.
+ * @param i Fila del nodo en su nivel.
+ * @param j Columna del nodo en su nivel.
+ * @param fila_inicio Primera fila de la ventana.
+ * @param columna_inicio Primera columna de la ventana.
+ * @param fila_fin Fila siguiente a la última de la ventana.
+ * @param columna_fin Columna siguiente a la última de la ventana.
+ * @param funcion Función a la que se pasa cada bloque.
+ */
+template <typename Funcion>
+void recorrerBloque(const std::vector<Nivel>& niveles, int n, int i, int j, int fila_inicio, int columna_inicio,
+                    int fila_fin, int columna_fin, Funcion& funcion) {
+    const Nivel& nivel = niveles[n];
+    std::size_t p = nivel.posicion(nivel.indice(i, j));
+    if (nivel.homog[p] == 1 || n == 0) {
+        funcion(n, i, j, p);
+        return;
+    }
+
+    const int lado = 1 << (n - 1);
+    for (int hi = i * 2; hi <= i * 2 + 1; hi++) {
+        if ((hi + 1) * lado <= fila_inicio || hi * lado >= fila_fin) {
+            continue;
+        }
+        for (int hj = j * 2; hj <= j * 2 + 1; hj++) {
+            if ((hj + 1) * lado <= columna_inicio || hj * lado >= columna_fin) {
+                continue;
+            }
+            recorrerBloque(niveles, n - 1, hi, hj, fila_inicio, columna_inicio, fila_fin, columna_fin, funcion);
+        }
+    }
+}
+
+/**
+ * @brief Llama a funcion(n, i, j, posicion) para cada bloque homogéneo de la Pirámide que corta una ventana de la
+ * base, y para cada celda de la base sin datos.
+ * 
+ * Cada celda pertenece al bloque de un único nodo raíz: los nodos del nivel más alto y, en los demás niveles, los
+ * de las filas y columnas impares del borde que no tienen padre natural en el nivel siguiente. Se recorren las
+ * raíces que cortan la ventana y se baja por sus hijos naturales hasta el primer nodo homogéneo, que cubre un
+ * bloque de 2^n x 2^n celdas con la misma clase (y la misma región), o hasta una celda de la base que no lo es
+ * (homog distinto de 1). Los bloques no se recortan a la ventana.
+ * 
+ * @param niveles Niveles de la Pirámide.
+ * @param fila_inicio Primera fila de la ventana, ya recortada a la base.
+ * @param columna_inicio Primera columna de la ventana.
+ * @param fila_fin Fila siguiente a la última de la ventana, mayor que fila_inicio.
+ * @param columna_fin Columna siguiente a la última de la ventana, mayor que columna_inicio.
+ * @param funcion Función a la que se pasa cada bloque: su nivel, su fila y columna en el nivel y su posición en
+ *                las columnas del nivel.
+ */
+template <typename Funcion>
+void recorrerBloques(const std::vector<Nivel>& niveles, int fila_inicio, int columna_inicio, int fila_fin,
+                     int columna_fin, Funcion funcion) {
+    const int superior = static_cast<int>(niveles.size()) - 1;
+    for (int n = superior; n >= 0; n--) {
+        const Nivel& nivel = niveles[n];
+        int i_fin = std::min((fila_fin - 1) >> n, nivel.num_filas - 1);
+        int j_fin = std::min((columna_fin - 1) >> n, nivel.num_columnas - 1);
+        // Las filas y columnas por debajo de estas tienen padre natural en el nivel n + 1
+        int filas_con_padre = n == superior ? 0 : niveles[n + 1].num_filas * 2;
+        int columnas_con_padre = n == superior ? 0 : niveles[n + 1].num_columnas * 2;
+        for (int i = fila_inicio >> n; i <= i_fin; i++) {
+            int j_inicio = i >= filas_con_padre ? columna_inicio >> n
+                                                : std::max(columna_inicio >> n, columnas_con_padre);
+            for (int j = j_inicio; j <= j_fin; j++) {
+                recorrerBloque(niveles, n, i, j, fila_inicio, columna_inicio, fila_fin, columna_fin, funcion);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Consultas de solo lectura sobre una Pirámide construida (o cargada de una instantánea).
+ * 
+ * Un nodo homogéneo del nivel n cubre un bloque de 2^n x 2^n celdas de la base con la misma clase, así que las
+ * consultas bajan desde los niveles superiores, que son pequeños y suelen estar en la caché, y se detienen en el
+ * primer nodo homogéneo: la clase de una celda se obtiene de su antecesor homogéneo más alto y el área de una
+ * ventana se suma por bloques en lugar de celda a celda. Si la Pirámide se construyó con tolerancias de similitud
+ * (caso 2), la clase de un bloque fusionado por parecido es la media de las de sus celdas.
+ * 
+ * Los métodos son constantes y no guardan estado, así que varios hilos pueden consultar a la vez mientras nadie
+ * modifique la Pirámide.
+ */
+class ConsultaPiramide {
+public:
+    // Constructor a partir de una Pirámide, que debe existir mientras se use la consulta
+    explicit ConsultaPiramide(const Piramide& piramide);
+
+    // Clase, región y atributos de una celda de la base
+    ResultadoPunto consultarPunto(int fila, int columna) const;
+
+    // Consulta un lote de celdas en orden de Morton, con resultados en el orden de los puntos
+    std::vector<ResultadoPunto> consultarPuntos(const std::vector<PuntoConsulta>& puntos, int num_hilos = 1) const;
+
+    // Área de cada clase en las celdas [fila_inicio, fila_fin) x [columna_inicio, columna_fin), ordenada por clase
+    std::vector<AreaClase> consultarVentana(int fila_inicio, int columna_inicio, int fila_fin, int columna_fin) const;
+
+private:
+    // Niveles de la Pirámide y dimensiones de la base
+    const std::vector<Nivel>& niveles;
+    int num_filas, num_columnas;
+};
+
+#endif // CONSULTAS_H
@@ -0,0 +1,232 @@
+#include "estadisticas_regiones.h"
+#include "suma_comprobacion.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+namespace {
+
+const char MAGIA_TABLA_REGIONES[8] = {'P', 'I', 'R', 'R', 'E', 'G', 'S', '\0'};
+
+static_assert(std::is_trivially_copyable<EstadisticasRegion>::value,
+              "EstadisticasRegion se guarda tal cual en la tabla binaria");
+
+/**
+ * @brief Cabecera de la tabla binaria de regiones, seguida de un EstadisticasRegion por región.
+ */
+struct CabeceraTablaRegiones {
+    char magia[8];
+    uint32_t version;
+    uint32_t num_regiones;
+    int32_t num_filas;
+    int32_t num_columnas;
+    uint64_t suma;
+};
+
+} // namespace
+
+/**
+ * @brief Suma a la región un bloque de celdas con los mismos atributos.
+ * 
+ * @param atributos Atributos de suelo y umbrales de las celdas del bloque.
+ * @param fila_inicio Primera fila del bloque.
+ * @param columna_inicio Primera columna del bloque.
+ * @param fila_fin Fila siguiente a la última del bloque.
+ * @param columna_fin Columna siguiente a la última del bloque.
+ */
+void EstadisticasRegion::anotar(const AtributosSuelo& atributos, int fila_inicio, int columna_inicio, int fila_fin,
+                                int columna_fin) {
+    uint64_t celdas = static_cast<uint64_t>(fila_fin - fila_inicio) * static_cast<uint64_t>(columna_fin - columna_inicio);
+    area += celdas;
+    this->fila_inicio = std::min(this->fila_inicio, fila_inicio);
+    this->columna_inicio = std::min(this->columna_inicio, columna_inicio);
+    this->fila_fin = std::max(this->fila_fin, fila_fin);
+    this->columna_fin = std::max(this->columna_fin, columna_fin);
+    suma_capacidad_campo += atributos.capacidad_campo_media * static_cast<double>(celdas);
+    suma_porosidad += atributos.porosidad_media * static_cast<double>(celdas);
+    umbral_humedo_min = std::min(umbral_humedo_min, atributos.umbral_humedo);
+    umbral_humedo_max = std::max(umbral_humedo_max, atributos.umbral_humedo);
+    umbral_intermedio_min = std::min(umbral_intermedio_min, atributos.umbral_intermedio);
+    umbral_intermedio_max = std::max(umbral_intermedio_max, atributos.umbral_intermedio);
+    umbral_seco_min = std::min(umbral_seco_min, atributos.umbral_seco);
+    umbral_seco_max = std::max(umbral_seco_max, atributos.umbral_seco);
+}
+
+/**
+ * @brief Suma las estadísticas de otra parte de la misma región.
+ * 
+ * @param otra Estadísticas de la otra parte.
+ */
+void EstadisticasRegion::combinar(const EstadisticasRegion& otra) {
+    area += otra.area;
+    fila_inicio = std::min(fila_inicio, otra.fila_inicio);
+    columna_inicio = std::min(columna_inicio, otra.columna_inicio);
+    fila_fin = std::max(fila_fin, otra.fila_fin);
+    columna_fin = std::max(columna_fin, otra.columna_fin);
+    suma_capacidad_campo += otra.suma_capacidad_campo;
+    suma_porosidad += otra.suma_porosidad;
+    umbral_humedo_min = std::min(umbral_humedo_min, otra.umbral_humedo_min);
+    umbral_humedo_max = std::max(umbral_humedo_max, otra.umbral_humedo_max);
+    umbral_intermedio_min = std::min(umbral_intermedio_min, otra.umbral_intermedio_min);
+    umbral_intermedio_max = std::max(umbral_intermedio_max, otra.umbral_intermedio_max);
+    umbral_seco_min = std::min(umbral_seco_min, otra.umbral_seco_min);
+    umbral_seco_max = std::max(umbral_seco_max, otra.umbral_seco_max);
+}
+
+/**
+ * @brief Vacía la tabla y la prepara para un número de regiones.
+ * 
+ * @param num_regiones Número de regiones, numeradas en [0, num_regiones).
+ * @param num_filas Filas de la base.
+ * @param num_columnas Columnas de la base.
+ */
+void TablaRegiones::reiniciar(uint32_t num_regiones, int num_filas, int num_columnas) {
+    regiones.assign(num_regiones, EstadisticasRegion());
+    this->num_filas = num_filas;
+    this->num_columnas = num_columnas;
+}
+
+/**
+ * @brief Suma a la tabla unas estadísticas parciales.
+ * 
+ * Los bloques se recortan a la base, cuyas filas y columnas impares del borde no tienen padre natural.
+ * 
+ * @param parcial Bloques anotados por un hilo.
+ * @param atributos Tabla de atributos de la Pirámide.
+ * @param etiquetas Región definitiva de cada región parcial (vacío = las regiones parciales ya son las definitivas).
+ */
+void TablaRegiones::combinar(const AcumuladorRegiones& parcial, const TablaAtributos& atributos,
+                             const std::vector<uint32_t>& etiquetas) {
+    for (const BloqueRegion& bloque : parcial.anotados()) {
+        uint32_t region = etiquetas.empty() ? bloque.region : etiquetas[bloque.region];
+        regiones[region].anotar(atributos[bloque.clase], bloque.fila << bloque.nivel, bloque.columna << bloque.nivel,
+                                std::min((bloque.fila + 1) << bloque.nivel, num_filas),
+                                std::min((bloque.columna + 1) << bloque.nivel, num_columnas));
+    }
+}
+
+/**
+ * @brief Busca las regiones cuyo rectángulo corta una ventana de la base.
+ * 
+ * @param fila_inicio Primera fila de la ventana.
+ * @param columna_inicio Primera columna de la ventana.
+ * @param fila_fin Fila siguiente a la última de la ventana.
+ * @param columna_fin Columna siguiente a la última de la ventana.
+ * @return Regiones, en orden creciente.
+ */
+std::vector<uint32_t> TablaRegiones::regionesEnVentana(int fila_inicio, int columna_inicio, int fila_fin,
+                                                       int columna_fin) const {
+    std::vector<uint32_t> resultado;
+    for (std::size_t r = 0; r < regiones.size(); r++) {
+        const EstadisticasRegion& region = regiones[r];
+        if (region.area > 0 && region.fila_inicio < fila_fin && fila_inicio < region.fila_fin
+            && region.columna_inicio < columna_fin && columna_inicio < region.columna_fin) {
+            resultado.push_back(static_cast<uint32_t>(r));
+        }
+    }
+    return resultado;
+}
+
+/**
+ * @brief Escribe la tabla en CSV, con una fila por región.
+ * 
+ * @param salida Flujo de salida.
+ */
+void TablaRegiones::escribirCSV(std::ostream& salida) const {
+    salida << std::setprecision(std::numeric_limits<double>::digits10);
+    salida << "region,area,fila_inicio,columna_inicio,fila_fin,columna_fin,capacidad_campo_media,porosidad_media,"
+              "umbral_humedo_min,umbral_humedo_max,umbral_intermedio_min,umbral_intermedio_max,umbral_seco_min,"
+              "umbral_seco_max\n";
+    for (std::size_t r = 0; r < regiones.size(); r++) {
+        const EstadisticasRegion& region = regiones[r];
+        if (region.area == 0) {
+            continue;
+        }
+        salida << r << "," << region.area << "," << region.fila_inicio << "," << region.columna_inicio << ","
+               << region.fila_fin << "," << region.columna_fin << "," << region.capacidadCampoMedia() << ","
+               << region.porosidadMedia() << "," << region.umbral_humedo_min << "," << region.umbral_humedo_max
+               << "," << region.umbral_intermedio_min << "," << region.umbral_intermedio_max << ","
+               << region.umbral_seco_min << "," << region.umbral_seco_max << "\n";
+    }
+}
+
+/**
+ * @brief Guarda la tabla en un archivo.
+ * 
+ * En binario se escribe una CabeceraTablaRegiones (versión, número de regiones, dimensiones de la base y suma de
+ * comprobación) seguida de un EstadisticasRegion por región, tal como están en memoria; las regiones sin celdas
+ * (números libres tras actualizar) también se guardan, para que el número de región sea el índice. En CSV solo se
+ * escriben las regiones con celdas.
+ * 
+ * @param ruta Ruta de la tabla; si termina en ".csv" se escribe en CSV y, si no, en binario.
+ */
+void TablaRegiones::guardar(const std::string& ruta) const {
+    std::ofstream archivo(ruta, std::ios::binary);
+    if (!archivo) {
+        throw std::runtime_error("Error: no se pudo crear la tabla de regiones " + ruta + ".");
+    }
+    const std::string extension = ".csv";
+    if (ruta.size() >= extension.size() && ruta.compare(ruta.size() - extension.size(), extension.size(), extension) == 0) {
+        escribirCSV(archivo);
+    } else {
+        CabeceraTablaRegiones cabecera{};
+        std::memcpy(cabecera.magia, MAGIA_TABLA_REGIONES, sizeof(cabecera.magia));
+        cabecera.version = VERSION_TABLA_REGIONES;
+        cabecera.num_regiones = static_cast<uint32_t>(regiones.size());
+        cabecera.num_filas = num_filas;
+        cabecera.num_columnas = num_columnas;
+        cabecera.suma = sumaComprobacion(regiones.data(), regiones.size() * sizeof(EstadisticasRegion), 1);
+        archivo.write(reinterpret_cast<const char*>(&cabecera), sizeof(cabecera));
+        archivo.write(reinterpret_cast<const char*>(regiones.data()),
+                      static_cast<std::streamsize>(regiones.size() * sizeof(EstadisticasRegion)));
+    }
+    if (!archivo) {
+        throw std::runtime_error("Error: no se pudo escribir la tabla de regiones " + ruta + ".");
+    }
+}
+
+/**
+ * @brief Carga una tabla de regiones guardada en binario (ver guardar).
+ * 
+ * @param ruta Ruta de la tabla.
+ */
+void TablaRegiones::cargar(const std::string& ruta) {
+    std::ifstream archivo(ruta, std::ios::binary);
+    if (!archivo) {
+        throw std::runtime_error("Error: no se pudo abrir la tabla de regiones " + ruta + ".");
+    }
+    CabeceraTablaRegiones cabecera;
+    if (!archivo.read(reinterpret_cast<char*>(&cabecera), sizeof(cabecera))
+        || std::memcmp(cabecera.magia, MAGIA_TABLA_REGIONES, sizeof(cabecera.magia)) != 0) {
+        throw std::runtime_error("Error: " + ruta + " no es una tabla de regiones binaria.");
+    }
+    if (cabecera.version != VERSION_TABLA_REGIONES) {
+        throw std::runtime_error("Error: la tabla de regiones " + ruta + " es de la version "
+                                 + std::to_string(cabecera.version) + " y se esperaba la "
+                                 + std::to_string(VERSION_TABLA_REGIONES) + ".");
+    }
+    std::vector<EstadisticasRegion> leidas(cabecera.num_regiones);
+    if (!archivo.read(reinterpret_cast<char*>(leidas.data()),
+                      static_cast<std::streamsize>(leidas.size() * sizeof(EstadisticasRegion)))
+        || sumaComprobacion(leidas.data(), leidas.size() * sizeof(EstadisticasRegion), 1) != cabecera.suma) {
+        throw std::runtime_error("Error: la tabla de regiones " + ruta + " esta incompleta o corrupta.");
+    }
+    regiones = std::move(leidas);
+    num_filas = cabecera.num_filas;
+    num_columnas = cabecera.num_columnas;
+}
+
+/**
+ * @brief Libera la tabla.
+ */
+void TablaRegiones::clear() {
+    regiones.clear();
+    regiones.shrink_to_fit();
+    num_filas = 0;
+    num_columnas = 0;
+}
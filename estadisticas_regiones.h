@@ -0,0 +1,131 @@
+#ifndef ESTADISTICAS_REGIONES_H
+#define ESTADISTICAS_REGIONES_H
+
+#include "tabla_atributos.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Versión del formato binario de la tabla de regiones; cambia si cambian la cabecera o EstadisticasRegion
+const uint32_t VERSION_TABLA_REGIONES = 1;
+
+/**
+ * @brief Estadísticas de una región de la Pirámide, en celdas de la base.
+ * 
+ * Se acumulan por bloques: cada bloque de celdas con una misma clase suma su área de una vez (ver
+ * Piramide::anotarBloqueRegion). La estructura no tiene punteros y se guarda tal cual en la tabla binaria.
+ */
+struct EstadisticasRegion {
+    // Número de celdas de la base
+    uint64_t area = 0;
+    // Rectángulo que contiene la región: filas [fila_inicio, fila_fin) y columnas [columna_inicio, columna_fin)
+    int32_t fila_inicio = std::numeric_limits<int32_t>::max();
+    int32_t columna_inicio = std::numeric_limits<int32_t>::max();
+    int32_t fila_fin = 0;
+    int32_t columna_fin = 0;
+    // Sumas de los atributos ponderadas por el área (la media es la suma entre el área)
+    double suma_capacidad_campo = 0;
+    double suma_porosidad = 0;
+    // Rango de cada umbral en las celdas de la región
+    double umbral_humedo_min = std::numeric_limits<double>::infinity();
+    double umbral_humedo_max = -std::numeric_limits<double>::infinity();
+    double umbral_intermedio_min = std::numeric_limits<double>::infinity();
+    double umbral_intermedio_max = -std::numeric_limits<double>::infinity();
+    double umbral_seco_min = std::numeric_limits<double>::infinity();
+    double umbral_seco_max = -std::numeric_limits<double>::infinity();
+
+    // Suma un bloque de celdas [fila_inicio, fila_fin) x [columna_inicio, columna_fin) con los mismos atributos
+    void anotar(const AtributosSuelo& atributos, int fila_inicio, int columna_inicio, int fila_fin, int columna_fin);
+
+    // Suma las estadísticas de otra parte de la misma región
+    void combinar(const EstadisticasRegion& otra);
+
+    // Medias ponderadas por el área (0 si la región no tiene celdas)
+    double capacidadCampoMedia() const { return area > 0 ? suma_capacidad_campo / static_cast<double>(area) : 0; }
+    double porosidadMedia() const { return area > 0 ? suma_porosidad / static_cast<double>(area) : 0; }
+};
+
+/**
+ * @brief Bloque de celdas de la base con una misma clase que se suma a una región.
+ */
+struct BloqueRegion {
+    uint32_t region;
+    uint32_t clase;
+    // Nivel del nodo que cubre el bloque y su fila y columna en ese nivel: celdas [fila << nivel, (fila + 1) << nivel)
+    int32_t nivel;
+    int32_t fila;
+    int32_t columna;
+};
+
+/**
+ * @brief Estadísticas parciales de las regiones que se acumulan desde un hilo, sin cerrojos.
+ * 
+ * Los bloques se guardan en el orden en el que se anotan y se suman a la TablaRegiones al combinarla: escribir
+ * seguido en un vector propio es mucho más barato que sumar en una tabla por región, que se visitaría en un orden
+ * casi aleatorio. Las regiones son las provisionales de clasifica() o las definitivas; al combinar se traducen
+ * con las etiquetas densas.
+ */
+class AcumuladorRegiones {
+public:
+    // Anota el bloque del nodo (nivel, fila, columna), de una clase, para una región
+    void anotar(uint32_t region, uint32_t clase, int nivel, int fila, int columna) {
+        bloques.push_back({region, clase, nivel, fila, columna});
+    }
+
+    // Bloques anotados
+    const std::vector<BloqueRegion>& anotados() const { return bloques; }
+
+private:
+    std::vector<BloqueRegion> bloques;
+};
+
+/**
+ * @brief Tabla de estadísticas de las regiones de una Pirámide clasificada, indexada por región.
+ * 
+ * Se construye en Piramide::clasifica a la vez que se etiquetan las regiones, o después con
+ * Piramide::calcularEstadisticasRegiones, y se puede guardar en CSV o en un archivo binario que se vuelve a
+ * cargar sin la Pirámide.
+ */
+class TablaRegiones {
+public:
+    // Vacía la tabla y la prepara para las regiones [0, num_regiones) de una base de num_filas x num_columnas
+    void reiniciar(uint32_t num_regiones, int num_filas, int num_columnas);
+
+    // Suma unas estadísticas parciales, con los atributos de cada clase en 'atributos' y la región definitiva de
+    // cada región parcial en 'etiquetas' (vacío = las regiones parciales ya son las definitivas)
+    void combinar(const AcumuladorRegiones& parcial, const TablaAtributos& atributos,
+                  const std::vector<uint32_t>& etiquetas = {});
+
+    // Número de regiones (0 si la tabla no se ha calculado)
+    std::size_t size() const { return regiones.size(); }
+    bool empty() const { return regiones.empty(); }
+
+    // Estadísticas de una región
+    const EstadisticasRegion& operator[](uint32_t region) const { return regiones[region]; }
+
+    // Regiones cuyo rectángulo corta las celdas [fila_inicio, fila_fin) x [columna_inicio, columna_fin)
+    std::vector<uint32_t> regionesEnVentana(int fila_inicio, int columna_inicio, int fila_fin, int columna_fin) const;
+
+    // Guarda la tabla en CSV si la ruta termina en ".csv" y, si no, en binario
+    void guardar(const std::string& ruta) const;
+    void escribirCSV(std::ostream& salida) const;
+
+    // Carga una tabla guardada en binario
+    void cargar(const std::string& ruta);
+
+    // Libera la tabla
+    void clear();
+
+    // Dimensiones de la base de las regiones
+    int num_filas = 0;
+    int num_columnas = 0;
+
+private:
+    std::vector<EstadisticasRegion> regiones;
+};
+
+#endif // ESTADISTICAS_REGIONES_H
@@ -0,0 +1,323 @@
+#include "exportacion_etiquetas.h"
+#include "consultas.h"
+#include "paralelo.h"
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+namespace {
+
+const char MAGIA_ETIQUETAS_RLE[8] = {'P', 'I', 'R', 'R', 'L', 'E', '\0', '\0'};
+
+// Etiquetas de cada banda, en bytes: cada uno de los dos buffers tiene una banda
+const std::size_t BYTES_BANDA_EXPORTACION = std::size_t(8) << 20;
+
+/**
+ * @brief Cabecera del ráster de etiquetas por tramos, seguida de los tramos de cada fila.
+ */
+struct CabeceraEtiquetasRLE {
+    char magia[8];
+    uint32_t version;
+    int32_t num_filas;
+    int32_t num_columnas;
+    uint32_t reservado;
+};
+
+/**
+ * @brief Filas de una banda que expande y codifica un hilo.
+ */
+struct TramoExportacion {
+    int fila_inicio = 0;
+    int fila_fin = 0;
+    // Etiqueta de cada celda de las filas, en orden fila-mayor
+    std::vector<uint32_t> etiquetas;
+    // Etiquetas codificadas por tramos o en CSV (vacío en binario, donde se escriben las etiquetas tal cual)
+    std::vector<char> bytes;
+};
+
+/**
+ * @brief Uno de los dos buffers de la exportación: una banda de filas, repartida en tramos.
+ */
+struct BufferExportacion {
+    std::vector<TramoExportacion> tramos;
+    // Verdadero desde que la banda está expandida hasta que el escritor termina de escribirla
+    bool llena = false;
+};
+
+/**
+ * @brief Escribe las etiquetas de todas las celdas de un tramo de filas.
+ * 
+ * Todos los descendientes de un nodo homogéneo cuelgan de él por su padre natural, así que tienen su misma región:
+ * cada bloque homogéneo (ver recorrerBloques) se rellena de una vez con la suya y las celdas vacías de la base
+ * reciben REGION_VACIA.
+ * 
+ * @param niveles Niveles de la Pirámide.
+ * @param tramo Tramo, con sus filas ya fijadas.
+ */
+void expandirTramo(const std::vector<Nivel>& niveles, TramoExportacion& tramo) {
+    const int num_columnas = niveles[0].num_columnas;
+    tramo.etiquetas.resize(static_cast<std::size_t>(tramo.fila_fin - tramo.fila_inicio) * num_columnas);
+    recorrerBloques(niveles, tramo.fila_inicio, 0, tramo.fila_fin, num_columnas,
+                    [&](int n, int i, int j, std::size_t p) {
+                        const Nivel& nivel = niveles[n];
+                        uint32_t etiqueta = nivel.homog[p] == 1 ? nivel.region[p] : REGION_VACIA;
+                        int fila_fin = std::min(tramo.fila_fin, (i + 1) << n);
+                        uint32_t* primera = tramo.etiquetas.data() + static_cast<std::size_t>(j << n);
+                        std::size_t ancho = static_cast<std::size_t>(std::min(num_columnas, (j + 1) << n) - (j << n));
+                        for (int fila = std::max(tramo.fila_inicio, i << n); fila < fila_fin; fila++) {
+                            uint32_t* celda = primera + static_cast<std::size_t>(fila - tramo.fila_inicio)
+                                                            * num_columnas;
+                            std::fill(celda, celda + ancho, etiqueta);
+                        }
+                    });
+}
+
+/**
+ * @brief Añade un entero de 32 bits, tal como está en memoria, al final de un buffer.
+ */
+void anadirEntero(std::vector<char>& bytes, uint32_t valor) {
+    const char* primero = reinterpret_cast<const char*>(&valor);
+    bytes.insert(bytes.end(), primero, primero + sizeof(valor));
+}
+
+/**
+ * @brief Codifica las etiquetas de un tramo por tramos de celdas iguales: por cada fila, el número de tramos y un
+ * par (etiqueta, longitud) por tramo.
+ * 
+ * @param tramo Tramo ya expandido.
+ * @param num_columnas Columnas de la base.
+ */
+void codificarRLE(TramoExportacion& tramo, int num_columnas) {
+    tramo.bytes.clear();
+    for (int fila = 0; fila < tramo.fila_fin - tramo.fila_inicio; fila++) {
+        const uint32_t* celdas = tramo.etiquetas.data() + static_cast<std::size_t>(fila) * num_columnas;
+        // El número de tramos de la fila se rellena al terminarla
+        std::size_t cabecera_fila = tramo.bytes.size();
+        anadirEntero(tramo.bytes, 0);
+        uint32_t num_tramos = 0;
+        for (int j = 0; j < num_columnas;) {
+            int fin = j + 1;
+            while (fin < num_columnas && celdas[fin] == celdas[j]) {
+                fin++;
+            }
+            anadirEntero(tramo.bytes, celdas[j]);
+            anadirEntero(tramo.bytes, static_cast<uint32_t>(fin - j));
+            num_tramos++;
+            j = fin;
+        }
+        std::memcpy(tramo.bytes.data() + cabecera_fila, &num_tramos, sizeof(num_tramos));
+    }
+}
+
+/**
+ * @brief Codifica las etiquetas de un tramo en CSV, con una línea por fila y -1 en las celdas vacías.
+ * 
+ * @param tramo Tramo ya expandido.
+ * @param num_columnas Columnas de la base.
+ */
+void codificarCSV(TramoExportacion& tramo, int num_columnas) {
+    // Cada etiqueta ocupa como mucho 10 cifras y su separador
+    tramo.bytes.resize(tramo.etiquetas.size() * 11);
+    char* escrito = tramo.bytes.data();
+    char* fin = escrito + tramo.bytes.size();
+    for (std::size_t k = 0; k < tramo.etiquetas.size(); k += num_columnas) {
+        for (int j = 0; j < num_columnas; j++) {
+            uint32_t etiqueta = tramo.etiquetas[k + j];
+            if (etiqueta == REGION_VACIA) {
+                *escrito++ = '-';
+                *escrito++ = '1';
+            } else {
+                escrito = std::to_chars(escrito, fin, etiqueta).ptr;
+            }
+            *escrito++ = ',';
+        }
+        escrito[-1] = '\n';
+    }
+    tramo.bytes.resize(static_cast<std::size_t>(escrito - tramo.bytes.data()));
+}
+
+} // namespace
+
+/**
+ * @brief Obtiene el formato del ráster de etiquetas que corresponde a la extensión de una ruta.
+ * 
+ * @param ruta Ruta del ráster.
+ * @return RLE si termina en ".rle", CSV si termina en ".csv" y binario en cualquier otro caso.
+ */
+FormatoEtiquetas formatoEtiquetas(const std::string& ruta) {
+    auto terminaEn = [&](const std::string& extension) {
+        return ruta.size() >= extension.size()
+               && ruta.compare(ruta.size() - extension.size(), extension.size(), extension) == 0;
+    };
+    if (terminaEn(".rle")) {
+        return FormatoEtiquetas::RLE;
+    }
+    if (terminaEn(".csv")) {
+        return FormatoEtiquetas::CSV;
+    }
+    return FormatoEtiquetas::Binario;
+}
+
+/**
+ * @brief Exporta el ráster de etiquetas de región de la base de unos niveles clasificados.
+ * 
+ * La base se recorre por bandas de filas de unos BYTES_BANDA_EXPORTACION bytes con dos buffers: mientras los hilos
+ * expanden (y codifican) una banda en un buffer, repartida en un tramo de filas por hilo, un hilo en segundo plano
+ * escribe en el archivo la banda anterior del otro buffer, de modo que la expansión se solapa con la escritura.
+ * Las etiquetas se obtienen de los antecesores homogéneos de cada celda (ver expandirTramo), sin leer la
+ * columna de regiones de la base, y las celdas vacías tienen REGION_VACIA (-1 en CSV). Los enteros binarios se
+ * escriben en el orden de bytes del procesador.
+ * 
+ * @param ruta Ruta del ráster; el formato depende de su extensión (ver formatoEtiquetas).
+ * @param niveles Niveles de una Pirámide clasificada.
+ * @param num_hilos Número de hilos de la expansión (0 = todos los núcleos disponibles), además del escritor.
+ * @return Celdas y bytes escritos, tiempo total y tiempo que ha esperado cada parte a la otra.
+ */
+ResumenExportacion exportarEtiquetas(const std::string& ruta, const std::vector<Nivel>& niveles, int num_hilos) {
+    if (niveles.empty() || niveles[0].region.size() == 0) {
+        throw std::runtime_error("Error: solo se pueden exportar las etiquetas de una piramide ya clasificada.");
+    }
+    auto inicio = std::chrono::steady_clock::now();
+    const Nivel& base = niveles[0];
+    ResumenExportacion resumen;
+    resumen.formato = formatoEtiquetas(ruta);
+    resumen.celdas = base.size();
+
+    std::ofstream archivo(ruta, std::ios::binary);
+    if (!archivo) {
+        throw std::runtime_error("Error: no se pudo crear el raster de etiquetas " + ruta + ".");
+    }
+    if (resumen.formato == FormatoEtiquetas::RLE) {
+        CabeceraEtiquetasRLE cabecera{};
+        std::memcpy(cabecera.magia, MAGIA_ETIQUETAS_RLE, sizeof(cabecera.magia));
+        cabecera.version = VERSION_ETIQUETAS_RLE;
+        cabecera.num_filas = base.num_filas;
+        cabecera.num_columnas = base.num_columnas;
+        archivo.write(reinterpret_cast<const char*>(&cabecera), sizeof(cabecera));
+        resumen.bytes += sizeof(cabecera);
+    }
+
+    num_hilos = hilosEfectivos(num_hilos);
+    const std::size_t bytes_fila = static_cast<std::size_t>(base.num_columnas) * sizeof(uint32_t);
+    const int filas_banda = static_cast<int>(std::min<std::size_t>(
+        std::max<std::size_t>(BYTES_BANDA_EXPORTACION / std::max<std::size_t>(bytes_fila, 1), 1), base.num_filas));
+    resumen.bandas = base.num_filas > 0 ? (base.num_filas + filas_banda - 1) / filas_banda : 0;
+    const int filas_tramo = (filas_banda + num_hilos - 1) / num_hilos;
+    BufferExportacion buffers[2];
+    for (BufferExportacion& buffer : buffers) {
+        buffer.tramos.resize((filas_banda + filas_tramo - 1) / filas_tramo);
+    }
+
+    std::mutex mutex;
+    std::condition_variable cambio;
+    // La expansión se ha interrumpido, o la escritura ha fallado, y la otra parte debe terminar
+    bool interrumpida = false;
+    std::exception_ptr error_escritura;
+
+    std::thread escritor([&]() {
+        try {
+            for (std::size_t banda = 0; banda < resumen.bandas; banda++) {
+                BufferExportacion& buffer = buffers[banda % 2];
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    auto antes = std::chrono::steady_clock::now();
+                    cambio.wait(lock, [&]() { return buffer.llena || interrumpida; });
+                    resumen.segundos_espera_escritura += segundosDesde(antes);
+                    if (!buffer.llena) {
+                        return;
+                    }
+                }
+                for (const TramoExportacion& tramo : buffer.tramos) {
+                    if (tramo.fila_inicio >= tramo.fila_fin) {
+                        continue;
+                    }
+                    const char* datos = tramo.bytes.data();
+                    std::size_t bytes = tramo.bytes.size();
+                    if (resumen.formato == FormatoEtiquetas::Binario) {
+                        datos = reinterpret_cast<const char*>(tramo.etiquetas.data());
+                        bytes = tramo.etiquetas.size() * sizeof(uint32_t);
+                    }
+                    archivo.write(datos, static_cast<std::streamsize>(bytes));
+                    resumen.bytes += bytes;
+                }
+                if (!archivo) {
+                    throw std::runtime_error("Error: no se pudo escribir el raster de etiquetas " + ruta + ".");
+                }
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    buffer.llena = false;
+                }
+                cambio.notify_all();
+            }
+        } catch (...) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                error_escritura = std::current_exception();
+                interrumpida = true;
+            }
+            cambio.notify_all();
+        }
+    });
+
+    try {
+        for (std::size_t banda = 0; banda < resumen.bandas; banda++) {
+            BufferExportacion& buffer = buffers[banda % 2];
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                auto antes = std::chrono::steady_clock::now();
+                cambio.wait(lock, [&]() { return !buffer.llena || interrumpida; });
+                resumen.segundos_espera_expansion += segundosDesde(antes);
+                if (interrumpida) {
+                    break;
+                }
+            }
+            const int fila_banda = static_cast<int>(banda) * filas_banda;
+            paraleloPara(num_hilos, buffer.tramos.size(), [&](std::size_t t) {
+                TramoExportacion& tramo = buffer.tramos[t];
+                tramo.fila_inicio = std::min(fila_banda + static_cast<int>(t) * filas_tramo, base.num_filas);
+                tramo.fila_fin = std::min({tramo.fila_inicio + filas_tramo, fila_banda + filas_banda, base.num_filas});
+                if (tramo.fila_inicio >= tramo.fila_fin) {
+                    return;
+                }
+                expandirTramo(niveles, tramo);
+                if (resumen.formato == FormatoEtiquetas::RLE) {
+                    codificarRLE(tramo, base.num_columnas);
+                } else if (resumen.formato == FormatoEtiquetas::CSV) {
+                    codificarCSV(tramo, base.num_columnas);
+                }
+            });
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                buffer.llena = true;
+            }
+            cambio.notify_all();
+        }
+    } catch (...) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            interrumpida = true;
+        }
+        cambio.notify_all();
+        escritor.join();
+        throw;
+    }
+    escritor.join();
+    if (error_escritura) {
+        std::rethrow_exception(error_escritura);
+    }
+
+    archivo.close();
+    if (!archivo) {
+        throw std::runtime_error("Error: no se pudo escribir el raster de etiquetas " + ruta + ".");
+    }
+    resumen.segundos = segundosDesde(inicio);
+    return resumen;
+}
@@ -0,0 +1,47 @@
+#ifndef EXPORTACION_ETIQUETAS_H
+#define EXPORTACION_ETIQUETAS_H
+
+#include "nivel.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Versión del formato por tramos del ráster de etiquetas; cambia si cambian la cabecera o los registros
+const uint32_t VERSION_ETIQUETAS_RLE = 1;
+
+/**
+ * @brief Formato del ráster de etiquetas de región exportado.
+ */
+enum class FormatoEtiquetas {
+    // Una etiqueta uint32_t por celda, en orden fila-mayor y sin cabecera (num_filas x num_columnas x 4 bytes)
+    Binario,
+    // Cabecera y, por cada fila, el número de tramos seguido de un par (etiqueta, longitud) uint32_t por tramo
+    RLE,
+    // Una línea por fila, con las etiquetas separadas por comas
+    CSV
+};
+
+/**
+ * @brief Resultado de una exportación del ráster de etiquetas.
+ */
+struct ResumenExportacion {
+    FormatoEtiquetas formato = FormatoEtiquetas::Binario;
+    uint64_t celdas = 0;
+    uint64_t bytes = 0;
+    std::size_t bandas = 0;
+    double segundos = 0;
+    // Tiempo que la expansión ha esperado a que el escritor liberara un buffer (el disco va por detrás) y tiempo que
+    // el escritor ha esperado una banda nueva (la expansión va por detrás)
+    double segundos_espera_expansion = 0;
+    double segundos_espera_escritura = 0;
+};
+
+// Formato que corresponde a la extensión de una ruta: ".rle" por tramos, ".csv" en CSV y cualquier otra en binario
+FormatoEtiquetas formatoEtiquetas(const std::string& ruta);
+
+// Escribe la región de cada celda de la base de unos niveles clasificados, expandiendo la de sus antecesores
+// homogéneos, mientras un hilo en segundo plano escribe la banda anterior; lanza std::runtime_error si falla
+ResumenExportacion exportarEtiquetas(const std::string& ruta, const std::vector<Nivel>& niveles, int num_hilos);
+
+#endif // EXPORTACION_ETIQUETAS_H
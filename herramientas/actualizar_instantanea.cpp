@@ -0,0 +1,39 @@
+/**
+ * @brief Actualiza una instantánea de la Pirámide con un archivo CSV de celdas de la base cambiadas.
+ * 
+ * Uso: actualizar_instantanea instantanea cambios.csv [salida]
+ * 
+ * Carga la instantánea (ver Piramide::cargarInstantanea), aplica los cambios sin reconstruir la pirámide (ver
+ * Piramide::actualizar) y guarda el resultado en 'salida' o, si no se indica, sobre la propia instantánea. El CSV
+ * de cambios tiene el formato del CSV de la base, con una fila por celda cambiada. Se usan las tolerancias y la
+ * precisión de los atributos guardadas en la instantánea, que son las de su construcción.
+ * Compilación desde el directorio raíz:
+ * 
+ *   g++ -std=c++17 -O2 -pthread -I. herramientas/actualizar_instantanea.cpp $(ls *.cpp | grep -v main.cpp) \
+ *       -o actualizar_instantanea
+ */
+#include "piramide.h"
+
+#include <string>
+
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        std::cerr << "Uso: actualizar_instantanea instantanea cambios.csv [salida]" << std::endl;
+        return 1;
+    }
+    std::string salida = argc > 3 ? argv[3] : argv[1];
+
+    try {
+        Piramide piramide(Configuracion(), false);
+        std::cout << "Cargando " << argv[1] << "..." << std::endl;
+        piramide.cargarInstantanea(argv[1]);
+        std::cout << std::endl << "Iniciando actualizar()..." << std::endl;
+        piramide.actualizarDesdeCSV(argv[2]);
+        std::cout << "Escribiendo " << salida << "..." << std::endl;
+        piramide.guardarInstantanea(salida);
+    } catch (const std::exception& error) {
+        std::cerr << error.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
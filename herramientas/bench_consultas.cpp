@@ -0,0 +1,215 @@
+/**
+ * @brief Mide la latencia y el rendimiento de las consultas sobre una Pirámide cargada de una instantánea.
+ * 
+ * Uso: bench_consultas instantanea [consultas] [lado_ventana] [semilla] [hilos]
+ * 
+ * Carga la instantánea (ver Piramide::cargarInstantanea; se crea con el sexto argumento de piramide) y hace
+ * 'consultas' consultas de celdas al azar de la base:
+ *  - una a una con consultarPunto, midiendo cada una para obtener las latencias p50 y p99;
+ *  - en un lote con consultarPuntos, con un hilo y con 'hilos' hilos (0 = todos los núcleos);
+ *  - una a una desde 'hilos' hilos a la vez, para medir el rendimiento con lectores concurrentes.
+ * Después hace consultas / 100 consultas de ventanas cuadradas de lado_ventana celdas con consultarVentana.
+ * 
+ * Los resultados se comprueban contra la base: la clase de cada celda con la de su nodo de la base y el área de
+ * las primeras ventanas con la suma celda a celda (con tolerancias de similitud, las celdas de los bloques
+ * fusionados por parecido cuentan como discrepancias). Escribe en la salida estándar un JSON con las latencias en
+ * microsegundos, las consultas por segundo y las discrepancias; los mensajes de la Pirámide se descartan.
+ * Compilación desde el directorio raíz:
+ * 
+ *   g++ -std=c++17 -O2 -pthread -I. herramientas/bench_consultas.cpp $(ls *.cpp | grep -v main.cpp) \
+ *       -o bench_consultas
+ */
+#include "consultas.h"
+#include "paralelo.h"
+#include "salida_nula.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+/**
+ * @brief Latencias de una serie de consultas y su rendimiento total.
+ */
+struct Medida {
+    Medida(const char* nombre) : nombre{nombre} {}
+
+    std::string nombre;
+    std::size_t consultas = 0;
+    double segundos = 0;
+    // Latencia de cada consulta, en segundos (vacía si solo se mide el total)
+    std::vector<double> latencias;
+};
+
+/**
+ * @brief Obtiene un percentil de las latencias de una medida.
+ * 
+ * @param latencias Latencias, que se ordenan.
+ * @param percentil Percentil, en [0, 100].
+ * @return Latencia del percentil en microsegundos (0 si no hay latencias).
+ */
+double percentil(std::vector<double>& latencias, double percentil) {
+    if (latencias.empty()) {
+        return 0;
+    }
+    std::sort(latencias.begin(), latencias.end());
+    std::size_t k = static_cast<std::size_t>(percentil / 100 * static_cast<double>(latencias.size() - 1) + 0.5);
+    return latencias[k] * 1e6;
+}
+
+// Evita que el compilador descarte los resultados de las consultas
+volatile std::size_t sumidero;
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        std::cerr << "Uso: bench_consultas instantanea [consultas] [lado_ventana] [semilla] [hilos]" << std::endl;
+        return 1;
+    }
+    std::size_t num_consultas = argc > 2 ? std::max(std::atoll(argv[2]), 1LL) : 1000000;
+    int lado_ventana = argc > 3 ? std::max(std::atoi(argv[3]), 1) : 256;
+    uint64_t semilla = argc > 4 ? std::strtoull(argv[4], nullptr, 10) : 1;
+    int num_hilos = hilosEfectivos(argc > 5 ? std::atoi(argv[5]) : 0);
+
+    Piramide piramide(Configuracion(), false);
+    double segundos_carga = 0;
+    try {
+        SilenciarFlujo silencio(std::cout);
+        auto inicio = std::chrono::steady_clock::now();
+        piramide.cargarInstantanea(argv[1]);
+        segundos_carga = segundosDesde(inicio);
+    } catch (const std::exception& error) {
+        std::cerr << error.what() << std::endl;
+        return 1;
+    }
+    const Nivel& base = piramide.piramide[0];
+    ConsultaPiramide consulta(piramide);
+
+    // Celdas y ventanas al azar, reproducibles con la misma semilla
+    std::mt19937_64 aleatorio(semilla);
+    std::uniform_int_distribution<int> fila_al_azar(0, piramide.num_filas - 1);
+    std::uniform_int_distribution<int> columna_al_azar(0, piramide.num_columnas - 1);
+    std::vector<PuntoConsulta> puntos(num_consultas);
+    for (PuntoConsulta& punto : puntos) {
+        punto = {fila_al_azar(aleatorio), columna_al_azar(aleatorio)};
+    }
+    std::vector<PuntoConsulta> ventanas(std::max<std::size_t>(num_consultas / 100, 1));
+    std::uniform_int_distribution<int> inicio_fila(0, std::max(piramide.num_filas - lado_ventana, 0));
+    std::uniform_int_distribution<int> inicio_columna(0, std::max(piramide.num_columnas - lado_ventana, 0));
+    for (PuntoConsulta& ventana : ventanas) {
+        ventana = {inicio_fila(aleatorio), inicio_columna(aleatorio)};
+    }
+
+    std::vector<Medida> medidas = {{"consultarPunto"}, {"consultarPuntos_1_hilo"}, {"consultarPuntos"},
+                                   {"consultarPunto_concurrente"}, {"consultarVentana"}};
+    std::size_t discrepancias = 0;
+
+    // Consultas una a una
+    Medida& una_a_una = medidas[0];
+    una_a_una.latencias.resize(puntos.size());
+    std::size_t suma = 0;
+    auto inicio = std::chrono::steady_clock::now();
+    for (std::size_t k = 0; k < puntos.size(); k++) {
+        auto antes = std::chrono::steady_clock::now();
+        ResultadoPunto resultado = consulta.consultarPunto(puntos[k].fila, puntos[k].columna);
+        una_a_una.latencias[k] = std::chrono::duration<double>(std::chrono::steady_clock::now() - antes).count();
+        suma += resultado.clase;
+        discrepancias += resultado.clase != base.clase[base.posicion(base.indice(puntos[k].fila, puntos[k].columna))];
+    }
+    una_a_una.segundos = segundosDesde(inicio);
+    una_a_una.consultas = puntos.size();
+    sumidero = suma;
+
+    // Consultas en lote
+    for (int m = 1; m <= 2; m++) {
+        inicio = std::chrono::steady_clock::now();
+        std::vector<ResultadoPunto> resultados = consulta.consultarPuntos(puntos, m == 1 ? 1 : num_hilos);
+        medidas[m].segundos = segundosDesde(inicio);
+        medidas[m].consultas = puntos.size();
+        for (std::size_t k = 0; k < puntos.size(); k++) {
+            discrepancias += resultados[k].clase != consulta.consultarPunto(puntos[k].fila, puntos[k].columna).clase;
+        }
+    }
+
+    // Lectores concurrentes, cada uno con su parte de las consultas
+    inicio = std::chrono::steady_clock::now();
+    paraleloPara(num_hilos, num_hilos, [&](std::size_t hilo) {
+        std::size_t suma_hilo = 0;
+        for (std::size_t k = hilo; k < puntos.size(); k += num_hilos) {
+            suma_hilo += consulta.consultarPunto(puntos[k].fila, puntos[k].columna).clase;
+        }
+        sumidero = suma_hilo;
+    });
+    medidas[3].segundos = segundosDesde(inicio);
+    medidas[3].consultas = puntos.size();
+
+    // Ventanas; las primeras se comprueban con la suma celda a celda
+    Medida& por_ventanas = medidas[4];
+    por_ventanas.latencias.resize(ventanas.size());
+    uint64_t area_total = 0;
+    inicio = std::chrono::steady_clock::now();
+    for (std::size_t k = 0; k < ventanas.size(); k++) {
+        auto antes = std::chrono::steady_clock::now();
+        std::vector<AreaClase> areas = consulta.consultarVentana(ventanas[k].fila, ventanas[k].columna,
+                                                                 ventanas[k].fila + lado_ventana,
+                                                                 ventanas[k].columna + lado_ventana);
+        por_ventanas.latencias[k] = std::chrono::duration<double>(std::chrono::steady_clock::now() - antes).count();
+        for (const AreaClase& area : areas) {
+            area_total += area.area;
+        }
+    }
+    por_ventanas.segundos = segundosDesde(inicio);
+    por_ventanas.consultas = ventanas.size();
+    for (std::size_t k = 0; k < std::min<std::size_t>(ventanas.size(), 100); k++) {
+        std::map<uint32_t, uint64_t> esperadas;
+        int fila_fin = std::min(ventanas[k].fila + lado_ventana, piramide.num_filas);
+        int columna_fin = std::min(ventanas[k].columna + lado_ventana, piramide.num_columnas);
+        for (int i = ventanas[k].fila; i < fila_fin; i++) {
+            for (int j = ventanas[k].columna; j < columna_fin; j++) {
+                uint32_t clase = base.clase[base.posicion(base.indice(i, j))];
+                if (clase != CLASE_VACIA) {
+                    esperadas[clase]++;
+                }
+            }
+        }
+        std::vector<AreaClase> areas = consulta.consultarVentana(ventanas[k].fila, ventanas[k].columna, fila_fin,
+                                                                 columna_fin);
+        bool iguales = areas.size() == esperadas.size();
+        for (const AreaClase& area : areas) {
+            iguales = iguales && esperadas.count(area.clase) > 0 && esperadas[area.clase] == area.area;
+        }
+        discrepancias += !iguales;
+    }
+
+    // Informe en JSON
+    std::printf("{\n");
+    std::printf("  \"instantanea\": \"%s\",\n  \"filas\": %d,\n  \"columnas\": %d,\n  \"niveles\": %d,\n", argv[1],
+                piramide.num_filas, piramide.num_columnas, piramide.num_niv);
+    std::printf("  \"segundos_carga\": %.6f,\n  \"hilos\": %d,\n  \"semilla\": %" PRIu64 ",\n  \"lado_ventana\": %d,\n",
+                segundos_carga, num_hilos, semilla, lado_ventana);
+    std::printf("  \"area_media_ventana\": %.1f,\n  \"discrepancias\": %zu,\n",
+                static_cast<double>(area_total) / static_cast<double>(ventanas.size()), discrepancias);
+    std::printf("  \"medidas\": [\n");
+    for (std::size_t m = 0; m < medidas.size(); m++) {
+        Medida& medida = medidas[m];
+        std::printf("    {\"nombre\": \"%s\", \"consultas\": %zu, \"segundos\": %.6f, \"consultas_por_segundo\": %.0f",
+                    medida.nombre.c_str(), medida.consultas, medida.segundos,
+                    medida.segundos > 0 ? medida.consultas / medida.segundos : 0.0);
+        if (!medida.latencias.empty()) {
+            std::printf(", \"p50_us\": %.3f, \"p99_us\": %.3f", percentil(medida.latencias, 50),
+                        percentil(medida.latencias, 99));
+        }
+        std::printf("}%s\n", m + 1 < medidas.size() ? "," : "");
+    }
+    std::printf("  ]\n}\n");
+    return discrepancias == 0 ? 0 : 2;
+}
@@ -0,0 +1,78 @@
+/**
+ * @brief Mide inicializarNivelesRestantes con cada núcleo de comparación 2x2 sobre unos datos reales.
+ * 
+ * Uso: bench_nucleo_2x2 [archivo.csv] [repeticiones] [filas columnas]
+ * 
+ * Carga la base (de la caché si es válida), construye los niveles superiores con un solo hilo usando el
+ * núcleo escalar, SSE2 y AVX2, y muestra el mejor tiempo de cada uno y su aceleración frente al escalar.
+ * Compilación desde el directorio raíz:
+ * 
+ *   g++ -std=c++17 -O2 -pthread -I. herramientas/bench_nucleo_2x2.cpp $(ls *.cpp | grep -v main.cpp) \
+ *       -o bench_nucleo_2x2
+ */
+#include "piramide.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+
+int main(int argc, char* argv[]) {
+    Configuracion config;
+    if (argc > 1) {
+        config.archivo_csv = argv[1];
+    }
+    int repeticiones = argc > 2 ? std::atoi(argv[2]) : 3;
+    if (argc > 4) {
+        config.num_filas = std::atoi(argv[3]);
+        config.num_columnas = std::atoi(argv[4]);
+    }
+    config.num_hilos = 1;
+
+    try {
+        Piramide piramide(config, false);
+        piramide.inicializarPiramide();
+        if (!piramide.leerCacheBase()) {
+            piramide.leerArchivoCSV();
+        }
+
+        std::size_t num_padres = 0;
+        for (int n = 1; n < piramide.num_niv; n++) {
+            num_padres += piramide.piramide[n].size();
+        }
+
+        double segundos_escalar = 0;
+        for (NucleoSimd nucleo : {NucleoSimd::Escalar, NucleoSimd::SSE2, NucleoSimd::AVX2}) {
+            if (nucleoDisponible(nucleo) != nucleo) {
+                std::cout << nombreNucleo(nucleo) << ": no disponible" << std::endl;
+                continue;
+            }
+            piramide.config.nucleo_2x2 = nucleo;
+            piramide.prepararReduccion();
+
+            double mejor = 0;
+            for (int r = 0; r < repeticiones; r++) {
+                // Deshacer la construcción anterior; inicializarNivelesRestantes vuelve a reservar los niveles
+                Nivel& base = piramide.piramide[0];
+                std::fill(base.padre.begin(), base.padre.end(), -1);
+
+                auto inicio = std::chrono::steady_clock::now();
+                piramide.inicializarNivelesRestantes();
+                std::chrono::duration<double> duracion = std::chrono::steady_clock::now() - inicio;
+                if (r == 0 || duracion.count() < mejor) {
+                    mejor = duracion.count();
+                }
+            }
+            if (nucleo == NucleoSimd::Escalar) {
+                segundos_escalar = mejor;
+            }
+
+            std::cout << std::fixed << std::setprecision(3)
+                      << nombreNucleo(nucleo) << ": " << mejor << " s, "
+                      << num_padres / mejor / 1e6 << " Mpadres/s, aceleracion x" << segundos_escalar / mejor << std::endl;
+        }
+    } catch (const std::exception& error) {
+        std::cerr << error.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
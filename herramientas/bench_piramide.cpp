@@ -0,0 +1,217 @@
+/**
+ * @brief Mide cada fase de la construcción de la Pirámide sobre un ráster sintético reproducible.
+ * 
+ * Uso: bench_piramide [filas columnas] [clases] [lado_mancha] [repeticiones] [semilla] [hilos] [bin|rle|csv]
+ * 
+ * Genera un CSV sintético de filas x columnas celdas, todas con datos, repartidas en manchas cuadradas de
+ * lado_mancha celdas (la coherencia espacial: 1 = cada celda con una clase al azar) a las que se asigna una de
+ * 'clases' combinaciones de atributos. La rejilla de manchas se desplaza al azar para que no coincida con la de
+ * los bloques 2x2, y con la misma semilla siempre se genera el mismo ráster.
+ * 
+ * Construye la pirámide 'repeticiones' veces sin caché y mide por separado inicializarPiramide, leerArchivoCSV,
+ * inicializarNivelesRestantes, purga, enlaza, clasifica y la exportación de las etiquetas de región (en binario, por
+ * tramos o en CSV según el último argumento, a un archivo temporal), además de los núcleos nodosSonIguales (por
+ * nodos y por columnas), get_nivel_fila_columna y get_id sobre la base. Escribe en la salida estándar un JSON con
+ * el mejor tiempo y el tiempo medio de cada medida y su rendimiento en nodos por segundo (y en MB por segundo la
+ * exportación); los mensajes de la Pirámide se descartan. Compilación desde el directorio raíz:
+ * 
+ *   g++ -std=c++17 -O2 -pthread -I. herramientas/bench_piramide.cpp $(ls *.cpp | grep -v main.cpp) \
+ *       -o bench_piramide
+ */
+#include "piramide.h"
+#include "paralelo.h"
+#include "raster_sintetico.h"
+#include "salida_nula.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+/**
+ * @brief Tiempos de una medida en todas las repeticiones.
+ */
+struct Medida {
+    Medida(const char* nombre) : nombre{nombre} {}
+
+    std::string nombre;
+    // Nodos (o llamadas) procesados en cada repetición
+    std::size_t nodos = 0;
+    // Bytes escritos en cada repetición (0 si la medida no escribe)
+    std::size_t bytes = 0;
+    std::vector<double> segundos;
+};
+
+/**
+ * @brief Mide el tiempo de una función y lo añade a una medida.
+ * 
+ * @param medida Medida a la que se añade el tiempo.
+ * @param nodos Nodos (o llamadas) que procesa la función.
+ * @param funcion Función a medir.
+ */
+void medir(Medida& medida, std::size_t nodos, const std::function<void()>& funcion) {
+    auto inicio = std::chrono::steady_clock::now();
+    funcion();
+    std::chrono::duration<double> duracion = std::chrono::steady_clock::now() - inicio;
+    medida.nodos = nodos;
+    medida.segundos.push_back(duracion.count());
+}
+
+// Evita que el compilador descarte los resultados de los núcleos
+volatile std::size_t sumidero;
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    RasterSintetico raster;
+    if (argc > 2) {
+        raster.num_filas = std::atoi(argv[1]);
+        raster.num_columnas = std::atoi(argv[2]);
+    }
+    if (argc > 3) {
+        raster.num_clases = std::atoi(argv[3]);
+    }
+    if (argc > 4) {
+        raster.lado_mancha = std::atoi(argv[4]);
+    }
+    int repeticiones = argc > 5 ? std::max(std::atoi(argv[5]), 1) : 3;
+    if (argc > 6) {
+        raster.semilla = std::strtoull(argv[6], nullptr, 10);
+    }
+
+    Configuracion config;
+    config.archivo_csv = "bench_piramide_sintetico.csv";
+    config.num_filas = raster.num_filas;
+    config.num_columnas = raster.num_columnas;
+    config.usar_cache = false;
+    if (argc > 7) {
+        config.num_hilos = std::atoi(argv[7]);
+    }
+    const std::string archivo_etiquetas = std::string("bench_piramide_etiquetas.") + (argc > 8 ? argv[8] : "bin");
+
+    std::vector<Medida> fases = {{"inicializarPiramide"}, {"leerArchivoCSV"}, {"inicializarNivelesRestantes"},
+                                 {"purga"}, {"enlaza"}, {"clasifica"}, {"exportarEtiquetas"}};
+    std::vector<Medida> nucleos = {{"nodosSonIguales"}, {"nodosSonIguales_columnas"}, {"get_nivel_fila_columna"},
+                                   {"get_id"}};
+    std::size_t num_nodos = 0;
+    int num_niveles = 0;
+
+    try {
+        generarRasterSintetico(config.archivo_csv, raster);
+
+        for (int r = 0; r < repeticiones; r++) {
+            SilenciarFlujo silencio(std::cout);
+            Piramide piramide(config, false);
+            medir(fases[0], static_cast<std::size_t>(raster.num_filas) * raster.num_columnas,
+                  [&] { piramide.inicializarPiramide(); });
+            num_nodos = static_cast<std::size_t>(piramide.geometria->inicio_ids[piramide.num_niv]);
+            num_niveles = piramide.num_niv;
+            Nivel& base = piramide.piramide[0];
+            medir(fases[1], base.size(), [&] { piramide.leerArchivoCSV(); });
+
+            // Núcleos sobre los bloques 2x2 y los ids de la base
+            const int filas_bloques = base.num_filas / 2;
+            const int columnas_bloques = base.num_columnas / 2;
+            const std::size_t num_bloques = static_cast<std::size_t>(filas_bloques) * columnas_bloques;
+            medir(nucleos[0], num_bloques, [&] {
+                std::size_t iguales = 0;
+                for (int i = 0; i < filas_bloques; i++) {
+                    for (int j = 0; j < columnas_bloques; j++) {
+                        Nodo no = piramide.nodo(0, i * 2, j * 2);
+                        Nodo ne = piramide.nodo(0, i * 2, j * 2 + 1);
+                        Nodo so = piramide.nodo(0, i * 2 + 1, j * 2);
+                        Nodo se = piramide.nodo(0, i * 2 + 1, j * 2 + 1);
+                        iguales += piramide.nodosSonIguales(no, ne, so, se);
+                    }
+                }
+                sumidero = iguales;
+            });
+            medir(nucleos[1], num_bloques, [&] {
+                std::size_t iguales = 0;
+                for (int i = 0; i < filas_bloques; i++) {
+                    for (int j = 0; j < columnas_bloques; j++) {
+                        std::size_t no = base.indice(i * 2, j * 2);
+                        std::size_t so = no + base.num_columnas;
+                        iguales += piramide.nodosSonIguales(base, no, no + 1, so, so + 1);
+                    }
+                }
+                sumidero = iguales;
+            });
+            medir(nucleos[2], num_nodos, [&] {
+                std::size_t suma = 0;
+                for (int id = 0; id < static_cast<int>(num_nodos); id++) {
+                    int n, f, c;
+                    std::tie(n, f, c) = piramide.get_nivel_fila_columna(id);
+                    suma += static_cast<std::size_t>(n + f + c);
+                }
+                sumidero = suma;
+            });
+            medir(nucleos[3], base.size(), [&] {
+                std::size_t suma = 0;
+                for (int i = 0; i < base.num_filas; i++) {
+                    for (int j = 0; j < base.num_columnas; j++) {
+                        suma += static_cast<std::size_t>(piramide.get_id(0, i, j));
+                    }
+                }
+                sumidero = suma;
+            });
+
+            // Los enlaces de la base de la repetición anterior apuntan a niveles que se van a reconstruir
+            std::fill(base.padre.begin(), base.padre.end(), -1);
+            piramide.prepararReduccion();
+            medir(fases[2], num_nodos - base.size(), [&] { piramide.inicializarNivelesRestantes(); });
+            medir(fases[3], num_nodos, [&] { piramide.purga(); });
+            medir(fases[4], num_nodos, [&] { piramide.enlaza(); });
+            medir(fases[5], num_nodos, [&] { piramide.clasifica(); });
+            medir(fases[6], base.size(),
+                  [&] { fases[6].bytes = piramide.exportarEtiquetas(archivo_etiquetas).bytes; });
+        }
+    } catch (const std::exception& error) {
+        std::remove(config.archivo_csv.c_str());
+        std::remove(archivo_etiquetas.c_str());
+        std::cerr << error.what() << std::endl;
+        return 1;
+    }
+    std::remove(config.archivo_csv.c_str());
+    std::remove(archivo_etiquetas.c_str());
+
+    // Informe en JSON
+    auto escribir = [&](const std::vector<Medida>& medidas) {
+        for (std::size_t m = 0; m < medidas.size(); m++) {
+            const Medida& medida = medidas[m];
+            double mejor = *std::min_element(medida.segundos.begin(), medida.segundos.end());
+            double media = 0;
+            for (double segundos : medida.segundos) {
+                media += segundos / medida.segundos.size();
+            }
+            std::printf("    {\"nombre\": \"%s\", \"nodos\": %zu, \"segundos\": %.6f, \"segundos_medios\": %.6f, "
+                        "\"nodos_por_segundo\": %.0f", medida.nombre.c_str(), medida.nodos, mejor, media,
+                        mejor > 0 ? medida.nodos / mejor : 0.0);
+            if (medida.bytes > 0) {
+                std::printf(", \"bytes\": %zu, \"mb_por_segundo\": %.1f", medida.bytes,
+                            mejor > 0 ? medida.bytes / mejor / (1 << 20) : 0.0);
+            }
+            std::printf("}%s\n", m + 1 < medidas.size() ? "," : "");
+        }
+    };
+    std::printf("{\n");
+    std::printf("  \"raster\": {\"filas\": %d, \"columnas\": %d, \"clases\": %d, \"lado_mancha\": %d, "
+                "\"semilla\": %" PRIu64 "},\n", raster.num_filas, raster.num_columnas, raster.num_clases,
+                raster.lado_mancha, raster.semilla);
+    std::printf("  \"niveles\": %d,\n  \"nodos\": %zu,\n", num_niveles, num_nodos);
+    std::printf("  \"hilos\": %d,\n  \"nucleo_2x2\": \"%s\",\n  \"repeticiones\": %d,\n",
+                hilosEfectivos(config.num_hilos), nombreNucleo(nucleoDisponible(config.nucleo_2x2)), repeticiones);
+    std::printf("  \"fases\": [\n");
+    escribir(fases);
+    std::printf("  ],\n  \"nucleos\": [\n");
+    escribir(nucleos);
+    std::printf("  ]\n}\n");
+    return 0;
+}
@@ -0,0 +1,368 @@
+/**
+ * @brief Compara Piramide::actualizar con la reconstrucción completa sobre cambios al azar de un ráster sintético.
+ * 
+ * Uso: comprobar_actualizar [filas columnas] [clases] [lado_mancha] [rondas] [lado_cambio] [semilla] [tolerancia]
+ *                           [directorio]
+ * 
+ * Construye la Pirámide de un ráster sintético (ver raster_sintetico.h) y, en cada ronda, cambia la clase de entre
+ * 1 y 4 cuadrados de hasta lado_cambio celdas (y de alguna celda suelta dentro de ellos) con actualizar(). Tras
+ * cada ronda comprueba que:
+ * 
+ *   - homog, los atributos y las estaciones de cada nodo de cada nivel son los de la Pirámide construida desde cero
+ *     con el CSV cambiado (los niveles que solo tiene una de las dos deben estar vacíos);
+ *   - el área de cada nodo es la suma de las de sus hijos, las listas de hijos corresponden a los enlaces y una
+ *     pasada completa de enlaza no cambia ningún enlace;
+ *   - las regiones son las mismas que da clasifica sobre los mismos enlaces (guardando una instantánea y
+ *     clasificándola de nuevo), con las mismas estadísticas, y los números libres son justo los que no usa ningún
+ *     nodo.
+ * 
+ * La tolerancia, si se indica, es la tolerancia absoluta de todos los atributos. El CSV y la instantánea se escriben
+ * en el directorio (por defecto, /tmp) y se borran al terminar. Escribe una línea por cada ronda que falla y un
+ * resumen, y termina con código 1 si alguna falla. Compilación desde el directorio raíz:
+ * 
+ *   g++ -std=c++17 -O2 -pthread -I. herramientas/comprobar_actualizar.cpp $(ls *.cpp | grep -v main.cpp) \
+ *       -o comprobar_actualizar
+ */
+#include "piramide.h"
+#include "raster_sintetico.h"
+#include "salida_nula.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+/**
+ * @brief Compara la estructura de cada nivel de la Pirámide actualizada con la de la construida desde cero.
+ * 
+ * @param actualizada Pirámide tras actualizar().
+ * @param completa Pirámide construida desde cero con el CSV cambiado (tras init y purga).
+ * @return Descripción de la primera diferencia, o vacía si no hay ninguna.
+ */
+std::string compararEstructura(const Piramide& actualizada, const Piramide& completa) {
+    const int num_niveles = std::max(actualizada.num_niv, completa.num_niv);
+    for (int n = 0; n < num_niveles; n++) {
+        // Un nivel que solo tiene una de las dos debe estar vacío
+        if (n >= actualizada.num_niv || n >= completa.num_niv) {
+            const Nivel& nivel = n < actualizada.num_niv ? actualizada.piramide[n] : completa.piramide[n];
+            if (nivel.numNoVacios() != 0) {
+                return "nivel " + std::to_string(n) + " sobrante con nodos";
+            }
+            continue;
+        }
+        const Nivel& a = actualizada.piramide[n];
+        const Nivel& b = completa.piramide[n];
+        if (a.size() != b.size()) {
+            return "nivel " + std::to_string(n) + " con otras dimensiones";
+        }
+        for (std::size_t k = 0; k < a.size(); k++) {
+            std::string nodo = "nodo " + std::to_string(k) + " del nivel " + std::to_string(n);
+            if (a.esVacio(k) != b.esVacio(k)) {
+                return nodo + (a.esVacio(k) ? " vacio" : " no vacio");
+            }
+            if (a.esVacio(k)) {
+                continue;
+            }
+            std::size_t p = a.posicion(k);
+            std::size_t q = b.posicion(k);
+            if (a.homog[p] != b.homog[q]) {
+                return nodo + " con otro homog";
+            }
+            if (!(a.atributosDe(k) == b.atributosDe(k))) {
+                return nodo + " con otros atributos";
+            }
+            if (a.estaciones[p] != b.estaciones[q]) {
+                return nodo + " con otras estaciones";
+            }
+        }
+    }
+    return "";
+}
+
+/**
+ * @brief Comprueba las áreas, las listas de hijos y que los enlaces son un punto fijo de enlaza.
+ * 
+ * @param piramide Pirámide tras actualizar(); enlaza() se vuelve a ejecutar sobre ella.
+ * @return Descripción de la primera diferencia, o vacía si no hay ninguna.
+ */
+std::string comprobarEnlaces(Piramide& piramide) {
+    for (int n = 0; n < piramide.num_niv; n++) {
+        const Nivel& nivel = piramide.piramide[n];
+        // Área y número de hijos enlazados de cada nodo, desde los enlaces del nivel inferior
+        std::vector<long long> areas(nivel.size(), n == 0 ? 1 : 0);
+        std::vector<std::size_t> num_hijos(nivel.size(), 0);
+        if (n > 0) {
+            const Nivel& inferior = piramide.piramide[n - 1];
+            inferior.recorrerNodos([&](std::size_t k) {
+                std::size_t q = inferior.posicion(k);
+                if (inferior.padre[q] != -1) {
+                    areas[static_cast<std::size_t>(inferior.padre[q])] += inferior.area[q];
+                    num_hijos[static_cast<std::size_t>(inferior.padre[q])]++;
+                }
+            });
+        }
+        std::string diferencia;
+        nivel.recorrerNodos([&](std::size_t k) {
+            if (!diferencia.empty()) {
+                return;
+            }
+            std::string nodo = "nodo " + std::to_string(k) + " del nivel " + std::to_string(n);
+            if (nivel.area[nivel.posicion(k)] != areas[k]) {
+                diferencia = nodo + " con otra area";
+                return;
+            }
+            if (n == 0 || nivel.inicio_hijos.size() == 0) {
+                return;
+            }
+            if (nivel.numHijos(k) != num_hijos[k]) {
+                diferencia = nodo + " con otro numero de hijos";
+                return;
+            }
+            const Nivel& inferior = piramide.piramide[n - 1];
+            for (std::size_t i = 0; i < nivel.numHijos(k); i++) {
+                std::size_t hijo = nivel.hijo(k, i);
+                if (inferior.esVacio(hijo) || inferior.padre[inferior.posicion(hijo)] != static_cast<int>(k)) {
+                    diferencia = nodo + " con un hijo que no lo tiene de padre";
+                    return;
+                }
+            }
+        });
+        if (!diferencia.empty()) {
+            return diferencia;
+        }
+    }
+
+    std::vector<std::vector<int>> padres(static_cast<std::size_t>(piramide.num_niv));
+    for (int n = 0; n < piramide.num_niv; n++) {
+        const Nivel& nivel = piramide.piramide[n];
+        nivel.recorrerNodos([&](std::size_t k) { padres[n].push_back(nivel.padre[nivel.posicion(k)]); });
+    }
+    {
+        SilenciarFlujo silencio(std::cout);
+        piramide.enlaza();
+    }
+    for (int n = 0; n < piramide.num_niv; n++) {
+        const Nivel& nivel = piramide.piramide[n];
+        std::size_t i = 0;
+        bool iguales = true;
+        nivel.recorrerNodos([&](std::size_t k) { iguales &= padres[n][i++] == nivel.padre[nivel.posicion(k)]; });
+        if (!iguales) {
+            return "enlaza cambia enlaces del nivel " + std::to_string(n);
+        }
+    }
+    return "";
+}
+
+/**
+ * @brief Región de cada nodo de cada nivel.
+ * 
+ * @param piramide Pirámide clasificada.
+ * @return Región de cada nodo de cada nivel, por índice plano (REGION_VACIA en los vacíos).
+ */
+std::vector<std::vector<uint32_t>> regionesNodos(const Piramide& piramide) {
+    std::vector<std::vector<uint32_t>> regiones(static_cast<std::size_t>(piramide.num_niv));
+    for (int n = 0; n < piramide.num_niv; n++) {
+        const Nivel& nivel = piramide.piramide[n];
+        regiones[n].assign(nivel.size(), REGION_VACIA);
+        nivel.recorrerNodos([&](std::size_t k) { regiones[n][k] = nivel.region[nivel.posicion(k)]; });
+    }
+    return regiones;
+}
+
+/**
+ * @brief Compara las estadísticas de una región con las de la misma región calculadas por otro camino.
+ * 
+ * Las sumas de los atributos se comparan con un margen relativo, porque se acumulan en otro orden.
+ * 
+ * @param a Estadísticas de la región.
+ * @param b Estadísticas esperadas.
+ * @return Verdadero si coinciden.
+ */
+bool mismasEstadisticas(const EstadisticasRegion& a, const EstadisticasRegion& b) {
+    auto parecida = [](double x, double y) { return std::fabs(x - y) <= 1e-9 * std::max(std::fabs(x), std::fabs(y)); };
+    return a.area == b.area && a.fila_inicio == b.fila_inicio && a.columna_inicio == b.columna_inicio
+        && a.fila_fin == b.fila_fin && a.columna_fin == b.columna_fin
+        && parecida(a.suma_capacidad_campo, b.suma_capacidad_campo) && parecida(a.suma_porosidad, b.suma_porosidad)
+        && a.umbral_humedo_min == b.umbral_humedo_min && a.umbral_humedo_max == b.umbral_humedo_max
+        && a.umbral_intermedio_min == b.umbral_intermedio_min && a.umbral_intermedio_max == b.umbral_intermedio_max
+        && a.umbral_seco_min == b.umbral_seco_min && a.umbral_seco_max == b.umbral_seco_max;
+}
+
+/**
+ * @brief Compara las regiones con las que da clasifica sobre los mismos enlaces y comprueba los números libres.
+ * 
+ * @param piramide Pirámide tras actualizar().
+ * @param ruta_instantanea Ruta de la instantánea con la que se vuelve a clasificar.
+ * @return Descripción de la primera diferencia, o vacía si no hay ninguna.
+ */
+std::string comprobarRegiones(const Piramide& piramide, const std::string& ruta_instantanea) {
+    std::vector<std::vector<uint32_t>> actualizadas = regionesNodos(piramide);
+
+    // Los números usados y los libres deben repartirse [0, num_regiones)
+    std::vector<char> usado(piramide.num_regiones, 0);
+    std::size_t vivas = 0;
+    for (const std::vector<uint32_t>& nivel : actualizadas) {
+        for (uint32_t region : nivel) {
+            if (region == REGION_VACIA) {
+                continue;
+            }
+            if (region >= piramide.num_regiones) {
+                return "region " + std::to_string(region) + " fuera de num_regiones";
+            }
+            vivas += !usado[region];
+            usado[region] = 1;
+        }
+    }
+    for (uint32_t libre : piramide.regiones_libres) {
+        if (libre >= piramide.num_regiones || usado[libre]) {
+            return "numero libre " + std::to_string(libre) + " en uso o fuera de num_regiones";
+        }
+    }
+    if (vivas + piramide.regiones_libres.size() != piramide.num_regiones) {
+        return "numeros de region ni usados ni libres";
+    }
+
+    // Clasificar de nuevo los mismos enlaces
+    Piramide clasificada(Configuracion(), false);
+    {
+        SilenciarFlujo silencio(std::cout);
+        piramide.guardarInstantanea(ruta_instantanea);
+        clasificada.cargarInstantanea(ruta_instantanea);
+        clasificada.clasifica();
+    }
+    if (clasificada.num_regiones != vivas) {
+        return std::to_string(vivas) + " regiones de " + std::to_string(clasificada.num_regiones) + " de clasifica";
+    }
+    std::vector<std::vector<uint32_t>> esperadas = regionesNodos(clasificada);
+    std::unordered_map<uint32_t, uint32_t> a_esperada;
+    std::unordered_map<uint32_t, uint32_t> a_actualizada;
+    for (std::size_t n = 0; n < actualizadas.size(); n++) {
+        for (std::size_t k = 0; k < actualizadas[n].size(); k++) {
+            uint32_t a = actualizadas[n][k];
+            uint32_t b = esperadas[n][k];
+            if (a == REGION_VACIA) {
+                continue;
+            }
+            if (a_esperada.emplace(a, b).first->second != b || a_actualizada.emplace(b, a).first->second != a) {
+                return "nodo " + std::to_string(k) + " del nivel " + std::to_string(n) + " en otra region";
+            }
+        }
+    }
+
+    // actualizar() vuelve a calcular la tabla de estadísticas
+    if (piramide.tabla_regiones.size() != piramide.num_regiones) {
+        return "tabla de regiones sin calcular";
+    }
+    for (const auto& region : a_esperada) {
+        if (!mismasEstadisticas(piramide.tabla_regiones[region.first], clasificada.tabla_regiones[region.second])) {
+            return "region " + std::to_string(region.first) + " con otras estadisticas";
+        }
+    }
+    return "";
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    RasterSintetico raster;
+    raster.num_filas = 96;
+    raster.num_columnas = 160;
+    raster.num_clases = 8;
+    raster.lado_mancha = 6;
+    if (argc > 2) {
+        raster.num_filas = std::atoi(argv[1]);
+        raster.num_columnas = std::atoi(argv[2]);
+    }
+    if (argc > 3) {
+        raster.num_clases = std::atoi(argv[3]);
+    }
+    if (argc > 4) {
+        raster.lado_mancha = std::atoi(argv[4]);
+    }
+    int rondas = argc > 5 ? std::atoi(argv[5]) : 50;
+    int lado_cambio = argc > 6 ? std::max(std::atoi(argv[6]), 1) : 12;
+    if (argc > 7) {
+        raster.semilla = std::strtoull(argv[7], nullptr, 10);
+    }
+    double tolerancia = argc > 8 ? std::atof(argv[8]) : 0.0;
+    std::string directorio = argc > 9 ? argv[9] : "/tmp";
+    const std::string ruta_csv = directorio + "/comprobar_actualizar.csv";
+    const std::string ruta_instantanea = directorio + "/comprobar_actualizar.inst";
+
+    Configuracion config;
+    config.archivo_csv = ruta_csv;
+    config.num_filas = raster.num_filas;
+    config.num_columnas = raster.num_columnas;
+    config.usar_cache = false;
+    config.tolerancia_absoluta = {tolerancia, tolerancia, tolerancia, tolerancia, tolerancia, tolerancia, tolerancia};
+
+    int fallos = 0;
+    try {
+        std::vector<int> clases = clasesRasterSintetico(raster);
+        escribirCSVSintetico(ruta_csv, clases);
+        Piramide piramide(config, false);
+        {
+            SilenciarFlujo silencio(std::cout);
+            piramide.init();
+            piramide.purga();
+            piramide.enlaza();
+            piramide.clasifica();
+        }
+
+        std::mt19937_64 aleatorio(raster.semilla);
+        std::uniform_int_distribution<int> clase_al_azar(0, std::max(raster.num_clases, 1) - 1);
+        for (int ronda = 0; ronda < rondas; ronda++) {
+            // Cuadrados de una clase, con alguna celda suelta de otra
+            std::vector<FilaCSV> cambios;
+            int num_cuadrados = 1 + static_cast<int>(aleatorio() % 4);
+            for (int c = 0; c < num_cuadrados; c++) {
+                int lado = 1 + static_cast<int>(aleatorio() % static_cast<uint64_t>(lado_cambio));
+                int fila = static_cast<int>(aleatorio() % static_cast<uint64_t>(raster.num_filas));
+                int columna = static_cast<int>(aleatorio() % static_cast<uint64_t>(raster.num_columnas));
+                int clase = clase_al_azar(aleatorio);
+                for (int i = fila; i < std::min(fila + lado, raster.num_filas); i++) {
+                    for (int j = columna; j < std::min(columna + lado, raster.num_columnas); j++) {
+                        int id = i * raster.num_columnas + j;
+                        int& clase_celda = clases[static_cast<std::size_t>(id)];
+                        clase_celda = aleatorio() % 8 == 0 ? clase_al_azar(aleatorio) : clase;
+                        cambios.push_back(filaSintetica(id, clase_celda));
+                    }
+                }
+            }
+
+            Piramide completa(config, false);
+            {
+                SilenciarFlujo silencio(std::cout);
+                piramide.actualizar(cambios);
+                escribirCSVSintetico(ruta_csv, clases);
+                completa.init();
+                completa.purga();
+            }
+            std::string diferencia = compararEstructura(piramide, completa);
+            if (diferencia.empty()) {
+                diferencia = comprobarEnlaces(piramide);
+            }
+            if (diferencia.empty()) {
+                diferencia = comprobarRegiones(piramide, ruta_instantanea);
+            }
+            if (!diferencia.empty()) {
+                std::cout << "ronda " << ronda << ": " << diferencia << std::endl;
+                fallos++;
+            }
+        }
+        std::cout << rondas << " rondas, " << fallos << " con fallos; " << piramide.num_niv << " niveles, "
+                  << piramide.num_regiones - piramide.regiones_libres.size() << " regiones" << std::endl;
+    } catch (const std::exception& error) {
+        std::cerr << error.what() << std::endl;
+        fallos++;
+    }
+    std::remove(ruta_csv.c_str());
+    std::remove(ruta_instantanea.c_str());
+    return fallos == 0 ? 0 : 1;
+}
@@ -0,0 +1,259 @@
+/**
+ * @brief Compara los núcleos vectorizados de la comparación 2x2 y de la similitud con los escalares.
+ * 
+ * Uso: comprobar_nucleos [pruebas] [semilla] [directorio]
+ * 
+ * Para cada núcleo vectorizado que admite el procesador (SSE2 y AVX2):
+ * 
+ *   - compara sus máscaras de homogeneidad y de igualdad con las escalares en 'pruebas' bloques al azar de cada
+ *     anchura de 0 a 64 padres, con las filas de hijos desalineadas;
+ *   - construye la Pirámide de rásteres sintéticos de 4 filas cuyo nivel 1 tiene de 0 a 70 padres por fila, con el
+ *     núcleo y con el escalar, y compara las columnas de todos los niveles (así se cubren también los bloques
+ *     incompletos y el paso de un bloque de 64 padres al siguiente);
+ *   - compara su comparación de cuatro clases por similitud con la escalar en 100 x 'pruebas' cuaternas al azar,
+ *     la mitad con valores cercanos a los límites de la tolerancia y la otra mitad con valores, holguras y
+ *     tolerancias extremos.
+ * 
+ * Los CSV se escriben en el directorio (por defecto, /tmp) y se borran al terminar. Escribe una línea por
+ * comprobación y termina con código 1 si alguna falla. Compilación desde el directorio raíz:
+ * 
+ *   g++ -std=c++17 -O2 -pthread -I. herramientas/comprobar_nucleos.cpp $(ls *.cpp | grep -v main.cpp) \
+ *       -o comprobar_nucleos
+ */
+#include "nucleo_2x2.h"
+#include "piramide.h"
+#include "raster_sintetico.h"
+#include "salida_nula.h"
+#include "similitud.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+// Mayor número de padres de una máscara
+const int PADRES_MASCARA = 64;
+// Mayor número de padres por fila del nivel 1 en las pirámides de prueba
+const int PADRES_FILA = 70;
+
+/**
+ * @brief Compara las máscaras de un núcleo con las escalares en bloques al azar de 0 a PADRES_MASCARA padres.
+ * 
+ * La mitad de los padres tienen los cuatro hijos homogéneos y de la misma clase; en el resto, cada hijo es
+ * homogéneo, no homogéneo o vacío, y tiene una de dos clases, al azar.
+ * 
+ * @param nucleo Núcleo vectorizado.
+ * @param pruebas Bloques al azar de cada anchura.
+ * @param aleatorio Generador de números aleatorios.
+ * @return Número de bloques cuyas máscaras no coinciden con las escalares.
+ */
+int compararMascaras(NucleoSimd nucleo, int pruebas, std::mt19937_64& aleatorio) {
+    const FuncionHomogeneos2x2 homogeneos = funcionHomogeneos2x2(nucleo);
+    const FuncionIguales2x2 iguales = funcionIguales2x2(nucleo);
+    const FuncionHomogeneos2x2 homogeneos_escalar = funcionHomogeneos2x2(NucleoSimd::Escalar);
+    const FuncionIguales2x2 iguales_escalar = funcionIguales2x2(NucleoSimd::Escalar);
+
+    // Filas de hijos con margen para desplazarlas y que no empiecen alineadas
+    const int margen = 8;
+    std::vector<int8_t> homog_sup(2 * PADRES_MASCARA + margen), homog_inf(2 * PADRES_MASCARA + margen);
+    std::vector<uint32_t> clase_sup(2 * PADRES_MASCARA + margen), clase_inf(2 * PADRES_MASCARA + margen);
+    int fallos = 0;
+    for (int num = 0; num <= PADRES_MASCARA; num++) {
+        for (int prueba = 0; prueba < pruebas; prueba++) {
+            const int desplazamiento = static_cast<int>(aleatorio() % margen);
+            int8_t* hs = homog_sup.data() + desplazamiento;
+            int8_t* hi = homog_inf.data() + desplazamiento;
+            uint32_t* cs = clase_sup.data() + desplazamiento;
+            uint32_t* ci = clase_inf.data() + desplazamiento;
+            for (int h = 0; h < 2 * PADRES_MASCARA; h++) {
+                hs[h] = hi[h] = 1;
+                cs[h] = ci[h] = 7;
+            }
+            for (int p = 0; p < num; p++) {
+                if (aleatorio() % 2 == 0) {
+                    continue;
+                }
+                int8_t* homog[4] = {hs + 2 * p, hs + 2 * p + 1, hi + 2 * p, hi + 2 * p + 1};
+                uint32_t* clase[4] = {cs + 2 * p, cs + 2 * p + 1, ci + 2 * p, ci + 2 * p + 1};
+                for (int h = 0; h < 4; h++) {
+                    *homog[h] = static_cast<int8_t>(static_cast<int>(aleatorio() % 3) - 1);
+                    *clase[h] = 7 + static_cast<uint32_t>(aleatorio() % 2);
+                }
+            }
+            bool correcto = homogeneos(hs, hi, num) == homogeneos_escalar(hs, hi, num)
+                         && iguales(cs, ci, num) == iguales_escalar(cs, ci, num);
+            fallos += !correcto;
+        }
+    }
+    return fallos;
+}
+
+/**
+ * @brief Configuración de las Pirámides de prueba.
+ * 
+ * @param ruta Ruta del CSV.
+ * @param num_columnas Columnas del ráster (4 filas).
+ * @param nucleo Núcleo de la comparación 2x2.
+ * @return Configuración con un solo hilo y sin caché.
+ */
+Configuracion configuracionPrueba(const std::string& ruta, int num_columnas, NucleoSimd nucleo) {
+    Configuracion config;
+    config.archivo_csv = ruta;
+    config.num_filas = 4;
+    config.num_columnas = num_columnas;
+    config.num_hilos = 1;
+    config.nucleo_2x2 = nucleo;
+    config.usar_cache = false;
+    return config;
+}
+
+/**
+ * @brief Compara las columnas de todos los niveles de dos Pirámides construidas con núcleos distintos.
+ * 
+ * @param a Pirámide construida con un núcleo.
+ * @param b Pirámide construida con otro núcleo.
+ * @return Verdadero si tienen los mismos niveles y cada nodo tiene el mismo homog, área, padre, clase y estaciones.
+ */
+bool mismosNiveles(const Piramide& a, const Piramide& b) {
+    if (a.num_niv != b.num_niv) {
+        return false;
+    }
+    for (int n = 0; n < a.num_niv; n++) {
+        const Nivel& x = a.piramide[n];
+        const Nivel& y = b.piramide[n];
+        if (x.size() != y.size()) {
+            return false;
+        }
+        for (std::size_t k = 0; k < x.size(); k++) {
+            std::size_t p = x.posicion(k);
+            std::size_t q = y.posicion(k);
+            if (x.homog[p] != y.homog[q] || x.area[p] != y.area[q] || x.padre[p] != y.padre[q]
+                || x.clase[p] != y.clase[q] || x.estaciones[p] != y.estaciones[q]) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Compara las Pirámides construidas con un núcleo y con el escalar para cada anchura del nivel 1.
+ * 
+ * Cada anchura se prueba con una clase al azar por celda y con manchas de 3x3 celdas, ambas de dos clases.
+ * 
+ * @param nucleo Núcleo vectorizado.
+ * @param semilla Semilla de los rásteres.
+ * @param directorio Directorio en el que se escriben los CSV.
+ * @return Número de rásteres cuyas Pirámides no coinciden.
+ */
+int compararNiveles(NucleoSimd nucleo, uint64_t semilla, const std::string& directorio) {
+    const std::string ruta = directorio + "/comprobar_nucleos.csv";
+    int fallos = 0;
+    for (int num_columnas = 1; num_columnas <= 2 * PADRES_FILA + 1; num_columnas++) {
+        for (int lado_mancha : {1, 3}) {
+            RasterSintetico raster;
+            raster.num_filas = 4;
+            raster.num_columnas = num_columnas;
+            raster.num_clases = 2;
+            raster.lado_mancha = lado_mancha;
+            raster.semilla = semilla + static_cast<uint64_t>(num_columnas);
+            generarRasterSintetico(ruta, raster);
+            Piramide vectorizada(configuracionPrueba(ruta, num_columnas, nucleo), false);
+            Piramide escalar(configuracionPrueba(ruta, num_columnas, NucleoSimd::Escalar), false);
+            {
+                SilenciarFlujo silencio(std::cout);
+                vectorizada.init();
+                escalar.init();
+            }
+            fallos += !mismosNiveles(vectorizada, escalar);
+        }
+    }
+    std::remove(ruta.c_str());
+    return fallos;
+}
+
+/**
+ * @brief Compara la comparación por similitud de un núcleo con la escalar en cuaternas de clases al azar.
+ * 
+ * En las pruebas pares los carriles de las clases son un valor común más una diferencia pequeña, del orden de la
+ * tolerancia y la holgura, así que salen cuaternas parecidas y no parecidas; en las impares, valores, holguras y
+ * tolerancias llegan a los extremos que admite la cuantización (2^29).
+ * 
+ * @param nucleo Núcleo vectorizado.
+ * @param pruebas Número de cuaternas.
+ * @param aleatorio Generador de números aleatorios.
+ * @param num_parecidas Cuaternas parecidas según el núcleo escalar.
+ * @return Número de cuaternas en las que el núcleo no coincide con el escalar.
+ */
+int compararParecidas(NucleoSimd nucleo, int pruebas, std::mt19937_64& aleatorio, int& num_parecidas) {
+    const FuncionParecidas parecidas = funcionParecidas(nucleo);
+    const FuncionParecidas parecidas_escalar = funcionParecidas(NucleoSimd::Escalar);
+    const int num_clases = 16;
+    const int32_t limite = 1 << 29;
+    std::vector<int32_t> valores(num_clases * CARRILES_SIMILITUD), holguras(num_clases * CARRILES_SIMILITUD);
+    int32_t tolerancias[CARRILES_SIMILITUD];
+    // Entero al azar de [minimo, maximo]
+    auto entre = [&aleatorio](int32_t minimo, int32_t maximo) {
+        uint64_t ancho = static_cast<uint64_t>(static_cast<int64_t>(maximo) - minimo) + 1;
+        return static_cast<int32_t>(minimo + static_cast<int64_t>(aleatorio() % ancho));
+    };
+    int fallos = 0;
+    num_parecidas = 0;
+    for (int prueba = 0; prueba < pruebas; prueba++) {
+        const bool extremos = prueba % 2 == 1;
+        for (int c = 0; c < CARRILES_SIMILITUD; c++) {
+            const int32_t comun = entre(-(1 << 27), 1 << 27);
+            tolerancias[c] = extremos ? entre(0, limite) : entre(0, 64);
+            for (int k = 0; k < num_clases; k++) {
+                std::size_t carril = static_cast<std::size_t>(k) * CARRILES_SIMILITUD + c;
+                valores[carril] = extremos ? entre(-limite, limite) : comun + entre(0, 16);
+                holguras[carril] = extremos ? entre(0, limite) : entre(0, 8);
+            }
+        }
+        uint32_t clases[4];
+        for (uint32_t& clase : clases) {
+            clase = static_cast<uint32_t>(aleatorio() % num_clases);
+        }
+        bool esperado = parecidas_escalar(valores.data(), holguras.data(), tolerancias, clases);
+        num_parecidas += esperado;
+        fallos += parecidas(valores.data(), holguras.data(), tolerancias, clases) != esperado;
+    }
+    return fallos;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    int pruebas = argc > 1 ? std::atoi(argv[1]) : 200;
+    uint64_t semilla = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 1;
+    std::string directorio = argc > 3 ? argv[3] : "/tmp";
+
+    int fallos = 0;
+    try {
+        std::mt19937_64 aleatorio(semilla);
+        for (NucleoSimd nucleo : {NucleoSimd::SSE2, NucleoSimd::AVX2}) {
+            if (nucleoDisponible(nucleo) != nucleo) {
+                std::cout << nombreNucleo(nucleo) << ": no disponible" << std::endl;
+                continue;
+            }
+            int fallos_mascaras = compararMascaras(nucleo, pruebas, aleatorio);
+            std::cout << nombreNucleo(nucleo) << ": mascaras de 0 a " << PADRES_MASCARA << " padres, "
+                      << (fallos_mascaras == 0 ? "correcto" : "FALLO") << std::endl;
+            int fallos_niveles = compararNiveles(nucleo, semilla, directorio);
+            std::cout << nombreNucleo(nucleo) << ": niveles con 0 a " << PADRES_FILA << " padres por fila, "
+                      << (fallos_niveles == 0 ? "correcto" : "FALLO") << std::endl;
+            int num_parecidas = 0;
+            int fallos_parecidas = compararParecidas(nucleo, 100 * pruebas, aleatorio, num_parecidas);
+            std::cout << nombreNucleo(nucleo) << ": similitud de " << 100 * pruebas << " cuaternas (" << num_parecidas
+                      << " parecidas), " << (fallos_parecidas == 0 ? "correcto" : "FALLO") << std::endl;
+            fallos += fallos_mascaras + fallos_niveles + fallos_parecidas;
+        }
+    } catch (const std::exception& error) {
+        std::cerr << error.what() << std::endl;
+        return 1;
+    }
+    return fallos == 0 ? 0 : 1;
+}
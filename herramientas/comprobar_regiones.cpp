@@ -0,0 +1,141 @@
+/**
+ * @brief Comprueba las regiones de clasifica sobre rásteres pequeños cuyas regiones se conocen de antemano.
+ * 
+ * Uso: comprobar_regiones [directorio]
+ * 
+ * Cada caso da la clase de cada celda con una letra y, en otra rejilla, la región que se espera: dos celdas deben
+ * quedar en la misma región si y solo si tienen la misma letra en la rejilla de regiones. Escribe el CSV de cada
+ * caso en el directorio (por defecto, /tmp), construye la Pirámide sin caché y compara la región de cada celda de
+ * la base con la esperada. Escribe una línea por caso y termina con código 1 si alguno falla. Compilación desde el
+ * directorio raíz:
+ * 
+ *   g++ -std=c++17 -O2 -pthread -I. herramientas/comprobar_regiones.cpp $(ls *.cpp | grep -v main.cpp) \
+ *       -o comprobar_regiones
+ */
+#include "piramide.h"
+#include "salida_nula.h"
+
+#include <cstdio>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+/**
+ * @brief Ráster de prueba con sus regiones esperadas, fila a fila.
+ */
+struct CasoRegiones {
+    std::string nombre;
+    // Clase de cada celda: celdas con la misma letra tienen los mismos atributos
+    std::vector<std::string> clases;
+    // Región esperada de cada celda: celdas con la misma letra están en la misma región
+    std::vector<std::string> regiones;
+};
+
+/**
+ * @brief Casos de prueba.
+ */
+std::vector<CasoRegiones> casosRegiones() {
+    return {
+        // Un bloque de una sola clase es una sola región
+        {"uniforme", {"AAAA", "AAAA", "AAAA", "AAAA"}, {"aaaa", "aaaa", "aaaa", "aaaa"}},
+        // Las celdas de la misma clase que solo se tocan por una esquina no forman región
+        {"tablero", {"ABAB", "BABA", "ABAB", "BABA"}, {"abcd", "efgh", "ijkl", "mnop"}},
+        // Las raíces vecinas de la misma clase del nivel 1 forman una sola región por clase
+        {"franja_nivel_1", {"AAAAAAAA", "AAAAAAAA", "AABBBBAA", "AABBBBAA"},
+                           {"aaaaaaaa", "aaaaaaaa", "aabbbbaa", "aabbbbaa"}},
+        // Las celdas de la última fila se enlazan con los nodos de la franja del nivel 1, que forman una sola región
+        // aunque sus raíces tengan distinta área
+        {"franja_borde", {"AAAAAAAA", "AAAAAAAA", "AABBBBAA"}, {"aaaaaaaa", "aaaaaaaa", "aabbbbaa"}},
+    };
+}
+
+/**
+ * @brief Escribe el CSV de un caso.
+ * 
+ * @param ruta Ruta del CSV.
+ * @param caso Caso de prueba.
+ */
+void escribirCaso(const std::string& ruta, const CasoRegiones& caso) {
+    std::FILE* archivo = std::fopen(ruta.c_str(), "w");
+    if (archivo == nullptr) {
+        throw std::runtime_error("Error: no se pudo crear el archivo " + ruta + ".");
+    }
+    std::fputs("id,capacidad_campo_media,estaciones,pendiente_3clases,porosidad_media,punto_marchitez_medio,"
+               "umbral_humedo,umbral_intermedio,umbral_seco\n", archivo);
+    int id = 0;
+    for (const std::string& fila : caso.clases) {
+        for (char letra : fila) {
+            int c = letra - 'A';
+            std::fprintf(archivo, "%d,%.4f,%d,%d,%.4f,%.4f,%.4f,%.4f,%.4f\n", id++, 0.1 + 0.01 * c, c % 4 + 1,
+                         c % 3 + 1, 0.3 + 0.005 * c, 0.05 + 0.002 * c, 0.8, 0.5, 0.2 + 0.001 * c);
+        }
+    }
+    if (std::fclose(archivo) != 0) {
+        throw std::runtime_error("Error: no se pudo escribir el archivo " + ruta + ".");
+    }
+}
+
+/**
+ * @brief Construye la Pirámide de un caso y compara sus regiones con las esperadas.
+ * 
+ * @param directorio Directorio en el que se escribe el CSV del caso.
+ * @param caso Caso de prueba.
+ * @return Verdadero si cada región de la base corresponde a una sola región esperada y al revés.
+ */
+bool comprobarCaso(const std::string& directorio, const CasoRegiones& caso) {
+    const std::string ruta = directorio + "/comprobar_regiones_" + caso.nombre + ".csv";
+    escribirCaso(ruta, caso);
+
+    Configuracion config;
+    config.archivo_csv = ruta;
+    config.num_filas = static_cast<int>(caso.clases.size());
+    config.num_columnas = static_cast<int>(caso.clases[0].size());
+    config.usar_cache = false;
+    Piramide piramide(config, false);
+    try {
+        SilenciarFlujo silencio(std::cout);
+        piramide.init();
+        piramide.purga();
+        piramide.enlaza();
+        piramide.clasifica();
+    } catch (...) {
+        std::remove(ruta.c_str());
+        throw;
+    }
+    std::remove(ruta.c_str());
+
+    const Nivel& base = piramide.piramide[0];
+    std::map<char, uint32_t> region_esperada;
+    std::map<uint32_t, char> letra_region;
+    bool correcto = true;
+    for (int i = 0; i < config.num_filas; i++) {
+        for (int j = 0; j < config.num_columnas; j++) {
+            uint32_t region = base.region[base.posicion(base.indice(i, j))];
+            char letra = caso.regiones[i][j];
+            correcto &= region_esperada.emplace(letra, region).first->second == region;
+            correcto &= letra_region.emplace(region, letra).first->second == letra;
+        }
+    }
+    std::cout << caso.nombre << ": " << letra_region.size() << " regiones de " << region_esperada.size()
+              << " esperadas, " << (correcto ? "correcto" : "FALLO") << std::endl;
+    return correcto;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::string directorio = argc > 1 ? argv[1] : "/tmp";
+    int fallos = 0;
+    try {
+        for (const CasoRegiones& caso : casosRegiones()) {
+            fallos += !comprobarCaso(directorio, caso);
+        }
+    } catch (const std::exception& error) {
+        std::cerr << error.what() << std::endl;
+        return 1;
+    }
+    return fallos == 0 ? 0 : 1;
+}
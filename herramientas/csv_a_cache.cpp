@@ -0,0 +1,47 @@
+/**
+ * @brief Convierte el CSV de la base de la pirámide en su caché binaria por columnas.
+ * 
+ * Uso: csv_a_cache [archivo.csv] [archivo.cache] [filas columnas]
+ * 
+ * Por defecto lee "completo0.csv" y escribe "completo0.csv.cache", la ruta en la que la Pirámide
+ * busca la caché. Compilación desde el directorio raíz:
+ * 
+ *   g++ -std=c++17 -O2 -pthread -I. herramientas/csv_a_cache.cpp lector_csv.cpp cache_base.cpp \
+ *       archivo_mapeado.cpp nivel.cpp tabla_atributos.cpp pool_memoria.cpp memoria_paginas.cpp \
+ *       suma_comprobacion.cpp -o csv_a_cache
+ */
+#include "piramide.h"
+#include "cache_base.h"
+#include "lector_csv.h"
+
+#include <cstdlib>
+
+int main(int argc, char* argv[]) {
+    Configuracion config;
+    if (argc > 1) {
+        config.archivo_csv = argv[1];
+    }
+    if (argc > 2) {
+        config.archivo_cache = argv[2];
+    }
+    if (argc > 4) {
+        config.num_filas = std::atoi(argv[3]);
+        config.num_columnas = std::atoi(argv[4]);
+    }
+
+    try {
+        Nivel base(0, config.num_filas, config.num_columnas, 0);
+        base.reservar();
+        base.atributos = std::make_shared<TablaAtributos>();
+        std::cout << "Leyendo " << config.archivo_csv << "..." << std::endl;
+        leerCSV(config.archivo_csv, base, config.precision_atributos, config.num_hilos);
+        std::cout << base.atributos->size() << " combinaciones distintas de atributos." << std::endl;
+        std::cout << "Escribiendo " << config.rutaCache() << "..." << std::endl;
+        guardarCacheBase(config.rutaCache(), base, firmaArchivo(config.archivo_csv, config.precision_atributos),
+                         config.num_hilos);
+    } catch (const std::exception& error) {
+        std::cerr << error.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,46 @@
+/**
+ * @brief Construye las pirámides de un lote de escenarios de la misma malla, varios a la vez.
+ * 
+ * Uso: lote_piramides manifiesto filas columnas [simultaneos] [hilos] [pool_mb]
+ * 
+ * El manifiesto tiene una línea "archivo.csv [instantanea]" por escenario (ver leerManifiesto). Se construyen
+ * 'simultaneos' escenarios a la vez (2 por defecto) repartiéndose 'hilos' hilos (0 = todos los núcleos), con la
+ * geometría y un pool de memoria compartidos (ver construirLote); pool_mb limita la memoria libre que retiene el
+ * pool (0 = sin límite). Al terminar escribe el tiempo total, los escenarios por hora y el uso del pool, y
+ * devuelve 2 si algún escenario ha fallado. Compilación desde el directorio raíz:
+ * 
+ *   g++ -std=c++17 -O2 -pthread -I. herramientas/lote_piramides.cpp $(ls *.cpp | grep -v main.cpp) \
+ *       -o lote_piramides
+ */
+#include "lote.h"
+
+#include <cstdlib>
+
+int main(int argc, char* argv[]) {
+    if (argc < 4) {
+        std::cerr << "Uso: lote_piramides manifiesto filas columnas [simultaneos] [hilos] [pool_mb]" << std::endl;
+        return 1;
+    }
+    Configuracion config;
+    config.num_filas = std::atoi(argv[2]);
+    config.num_columnas = std::atoi(argv[3]);
+    int simultaneos = argc > 4 ? std::max(std::atoi(argv[4]), 1) : 2;
+    config.num_hilos = argc > 5 ? std::atoi(argv[5]) : 0;
+    std::size_t pool_mb = argc > 6 ? static_cast<std::size_t>(std::atoll(argv[6])) : 0;
+
+    ResumenLote resumen;
+    try {
+        resumen = construirLote(leerManifiesto(argv[1]), config, simultaneos, pool_mb);
+    } catch (const std::exception& error) {
+        std::cerr << error.what() << std::endl;
+        return 1;
+    }
+
+    double por_hora = resumen.segundos > 0 ? static_cast<double>(resumen.correctos) * 3600 / resumen.segundos : 0;
+    std::cout << resumen.correctos << " de " << resumen.escenarios.size() << " escenarios construidos en "
+              << resumen.segundos << " s (" << por_hora << " escenarios por hora)." << std::endl;
+    std::cout << "Pool de memoria: " << resumen.pool.reutilizados << " bloques reutilizados ("
+              << (resumen.pool.bytes_reutilizados >> 20) << " MB) y " << resumen.pool.nuevos << " nuevos ("
+              << (resumen.pool.bytes_nuevos >> 20) << " MB)." << std::endl;
+    return resumen.correctos == resumen.escenarios.size() ? 0 : 2;
+}
@@ -0,0 +1,137 @@
+#ifndef RASTER_SINTETICO_H
+#define RASTER_SINTETICO_H
+
+#include "lector_csv.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Parámetros de un ráster sintético para las herramientas de medida y comprobación.
+ * 
+ * Todas las celdas tienen datos y están repartidas en manchas cuadradas de lado_mancha celdas (la coherencia
+ * espacial: 1 = cada celda con una clase al azar) a las que se asigna una de num_clases combinaciones de atributos.
+ * Con la misma semilla siempre se genera el mismo ráster.
+ */
+struct RasterSintetico {
+    int num_filas = 1024;
+    int num_columnas = 2048;
+    int num_clases = 16;
+    int lado_mancha = 32;
+    uint64_t semilla = 1;
+};
+
+/**
+ * @brief Escribe en un buffer la línea del CSV de una celda con los atributos de una clase sintética, sin el salto.
+ * 
+ * Los atributos de cada clase se derivan de su número, así que dos clases distintas nunca tienen los mismos.
+ * 
+ * @param linea Buffer de la línea.
+ * @param tam Tamaño del buffer.
+ * @param id Id de la celda.
+ * @param clase Número de la clase.
+ * @return Longitud de la línea (como std::snprintf).
+ */
+inline int formatearFilaSintetica(char* linea, std::size_t tam, int id, int clase) {
+    const int c = clase;
+    return std::snprintf(linea, tam, "%d,%.4f,%d,%d,%.4f,%.4f,%.4f,%.4f,%.4f", id, 0.1 + 0.001 * c, c % 4 + 1,
+                         c % 3 + 1, 0.3 + 0.0005 * c, 0.05 + 0.0002 * c, 0.8, 0.5, 0.2 + 0.0001 * c);
+}
+
+/**
+ * @brief Fila de una celda con los atributos de una clase sintética, con los valores que se leen del CSV.
+ * 
+ * La línea se escribe como en el CSV y se lee con analizarFilaCSV, así que los valores son los que tendría la
+ * celda en una base leída del archivo.
+ * 
+ * @param id Id de la celda.
+ * @param clase Número de la clase.
+ * @return Fila de la celda.
+ */
+inline FilaCSV filaSintetica(int id, int clase) {
+    char linea[160];
+    int longitud = formatearFilaSintetica(linea, sizeof(linea), id, clase);
+    FilaCSV fila;
+    std::string motivo;
+    if (longitud < 0 || !analizarFilaCSV(linea, linea + longitud, fila, motivo)) {
+        throw std::runtime_error("Error: fila sintetica mal formada (" + motivo + ").");
+    }
+    return fila;
+}
+
+/**
+ * @brief Clase de cada celda de un ráster sintético.
+ * 
+ * La rejilla de manchas se desplaza al azar para que no coincida con la de los bloques 2x2.
+ * 
+ * @param raster Parámetros del ráster.
+ * @return Clase de cada celda, en orden fila-mayor.
+ */
+inline std::vector<int> clasesRasterSintetico(const RasterSintetico& raster) {
+    std::mt19937_64 aleatorio(raster.semilla);
+    const int lado = std::max(raster.lado_mancha, 1);
+    std::uniform_int_distribution<int> desplazamiento(0, lado - 1);
+    std::uniform_int_distribution<int> clase_al_azar(0, std::max(raster.num_clases, 1) - 1);
+    const int desplazamiento_fila = desplazamiento(aleatorio);
+    const int desplazamiento_columna = desplazamiento(aleatorio);
+
+    // Clase de cada mancha, en orden fila-mayor
+    const int manchas_fila = (raster.num_filas + desplazamiento_fila) / lado + 1;
+    const int manchas_columna = (raster.num_columnas + desplazamiento_columna) / lado + 1;
+    std::vector<int> manchas(static_cast<std::size_t>(manchas_fila) * manchas_columna);
+    for (int& clase : manchas) {
+        clase = clase_al_azar(aleatorio);
+    }
+
+    std::vector<int> clases(static_cast<std::size_t>(raster.num_filas) * raster.num_columnas);
+    std::size_t id = 0;
+    for (int i = 0; i < raster.num_filas; i++) {
+        int mancha_fila = (i + desplazamiento_fila) / lado;
+        for (int j = 0; j < raster.num_columnas; j++) {
+            int mancha_columna = (j + desplazamiento_columna) / lado;
+            clases[id++] = manchas[static_cast<std::size_t>(mancha_fila) * manchas_columna + mancha_columna];
+        }
+    }
+    return clases;
+}
+
+/**
+ * @brief Escribe el CSV de la base con la clase sintética de cada celda.
+ * 
+ * @param ruta Ruta del CSV.
+ * @param clases Clase de cada celda, en orden fila-mayor (el id de cada celda es su posición).
+ */
+inline void escribirCSVSintetico(const std::string& ruta, const std::vector<int>& clases) {
+    std::FILE* archivo = std::fopen(ruta.c_str(), "w");
+    if (archivo == nullptr) {
+        throw std::runtime_error("Error: no se pudo crear el archivo " + ruta + ".");
+    }
+    std::fputs("id,capacidad_campo_media,estaciones,pendiente_3clases,porosidad_media,punto_marchitez_medio,"
+               "umbral_humedo,umbral_intermedio,umbral_seco\n", archivo);
+    char linea[160];
+    for (std::size_t id = 0; id < clases.size(); id++) {
+        formatearFilaSintetica(linea, sizeof(linea), static_cast<int>(id), clases[id]);
+        std::fputs(linea, archivo);
+        std::fputc('\n', archivo);
+    }
+    if (std::fclose(archivo) != 0) {
+        throw std::runtime_error("Error: no se pudo escribir el archivo " + ruta + ".");
+    }
+}
+
+/**
+ * @brief Escribe el CSV de un ráster sintético.
+ * 
+ * @param ruta Ruta del CSV.
+ * @param raster Parámetros del ráster.
+ */
+inline void generarRasterSintetico(const std::string& ruta, const RasterSintetico& raster) {
+    escribirCSVSintetico(ruta, clasesRasterSintetico(raster));
+}
+
+#endif // RASTER_SINTETICO_H
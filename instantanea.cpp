@@ -0,0 +1,354 @@
+#include "instantanea.h"
+#include "archivo_mapeado.h"
+#include "suma_comprobacion.h"
+#include "tipos_columna.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+
+namespace {
+
+const char MAGIA_INSTANTANEA[8] = {'P', 'I', 'R', 'I', 'N', 'S', 'T', '\0'};
+
+// Las columnas empiezan en múltiplos del tamaño de página para poder proyectarlas directamente
+const std::size_t ALINEACION_INSTANTANEA = 4096;
+
+/**
+ * @brief Cabecera de la instantánea, al comienzo del archivo.
+ */
+struct CabeceraInstantanea {
+    char magia[8];
+    uint32_t version;
+    uint32_t num_niveles;
+    int32_t num_filas;
+    int32_t num_columnas;
+    uint32_t num_columnas_guardadas;
+    uint32_t num_regiones;
+    uint64_t num_clases;
+    uint64_t suma;
+    // Parámetros de la construcción (ver ParametrosInstantanea); la precisión se guarda campo a campo, sin el
+    // relleno de PrecisionAtributo
+    AtributosSuelo tolerancia_absoluta;
+    AtributosSuelo tolerancia_relativa;
+    uint32_t precision[NUM_ATRIBUTOS_SUELO];
+    uint32_t reservado;
+    double escala[NUM_ATRIBUTOS_SUELO];
+};
+
+/**
+ * @brief Forma de un nivel. La cabecera va seguida de un descriptor por nivel.
+ */
+struct DescriptorNivel {
+    int32_t num_filas;
+    int32_t num_columnas;
+    int32_t id_base;
+    uint32_t disperso;
+};
+
+/**
+ * @brief Esquema de una columna: nivel, nombre, tipo y posición en el archivo.
+ * 
+ * Los descriptores de los niveles van seguidos de un descriptor por columna, nivel a nivel y en el orden de
+ * Nivel::recorrerColumnas.
+ */
+struct DescriptorColumna {
+    char nombre[32];
+    uint32_t nivel;
+    uint32_t tipo;
+    uint32_t tam_elemento;
+    uint32_t reservado;
+    uint64_t desplazamiento;
+    uint64_t bytes;
+};
+
+std::size_t alinear(std::size_t desplazamiento) {
+    return (desplazamiento + ALINEACION_INSTANTANEA - 1) / ALINEACION_INSTANTANEA * ALINEACION_INSTANTANEA;
+}
+
+/**
+ * @brief Comprueba la magia, la versión y los campos de la cabecera de una instantánea.
+ * 
+ * @param cabecera Cabecera leída.
+ * @param ruta Ruta de la instantánea, para los mensajes de error.
+ */
+void comprobarCabecera(const CabeceraInstantanea& cabecera, const std::string& ruta) {
+    if (std::memcmp(cabecera.magia, MAGIA_INSTANTANEA, sizeof(cabecera.magia)) != 0) {
+        throw std::runtime_error("Error: " + ruta + " no es una instantanea de la piramide.");
+    }
+    if (cabecera.version != VERSION_INSTANTANEA) {
+        throw std::runtime_error("Error: la instantanea " + ruta + " es de la version " + std::to_string(cabecera.version)
+                                 + " y se esperaba la " + std::to_string(VERSION_INSTANTANEA) + ".");
+    }
+    bool valida = cabecera.num_filas > 0 && cabecera.num_columnas > 0 && cabecera.num_niveles > 0
+                  && cabecera.num_clases < CLASE_VACIA;
+    for (int a = 0; a < NUM_ATRIBUTOS_SUELO; a++) {
+        valida = valida && cabecera.precision[a] <= static_cast<uint32_t>(Precision::Fijo16) && cabecera.escala[a] > 0;
+    }
+    if (!valida) {
+        throw std::runtime_error("Error: la cabecera de la instantanea " + ruta + " no es valida.");
+    }
+}
+
+/**
+ * @brief Lee y comprueba la cabecera de una instantánea proyectada.
+ * 
+ * @param archivo Instantánea proyectada en memoria.
+ * @param ruta Ruta de la instantánea, para los mensajes de error.
+ * @return Cabecera.
+ */
+CabeceraInstantanea leerCabecera(const ArchivoMapeado& archivo, const std::string& ruta) {
+    CabeceraInstantanea cabecera;
+    if (archivo.size() < sizeof(cabecera)) {
+        throw std::runtime_error("Error: " + ruta + " no es una instantanea de la piramide.");
+    }
+    std::memcpy(&cabecera, archivo.data(), sizeof(cabecera));
+    comprobarCabecera(cabecera, ruta);
+    return cabecera;
+}
+
+} // namespace
+
+/**
+ * @brief Guarda una Pirámide construida en una instantánea binaria que se puede proyectar en memoria.
+ * 
+ * Formato (versión VERSION_INSTANTANEA):
+ *   - CabeceraInstantanea: dimensiones de la base, número de niveles, de columnas, de clases de atributos y de
+ *     regiones, suma de comprobación y las tolerancias y la precisión de los atributos con que se construyó.
+ *   - Un DescriptorNivel por nivel (forma, primer identificador y si es disperso).
+ *   - Un DescriptorColumna por cada columna de cada nivel (ver Nivel::recorrerColumnas), incluidas las vacías.
+ *   - La tabla de atributos: un AtributosSuelo por clase, en orden de clase.
+ *   - Cada columna no vacía, tal como está en memoria, empezando en un múltiplo de 4096 bytes.
+ * Solo hay desplazamientos desde el comienzo del archivo, sin punteros, así que se puede proyectar en cualquier
+ * dirección. Los enteros se guardan en el orden de bytes de la máquina.
+ * 
+ * Se escribe primero en un archivo temporal que luego se renombra, de modo que un proceso que lea
+ * la instantánea a la vez nunca ve un archivo a medias.
+ * 
+ * @param ruta Ruta de la instantánea.
+ * @param niveles Niveles de la Pirámide, ya clasificada.
+ * @param num_regiones Número de regiones de la Pirámide.
+ * @param parametros Tolerancias y precisión de los atributos con las que se construyó la Pirámide.
+ * @param num_hilos Número de hilos para la suma de comprobación.
+ */
+void escribirInstantanea(const std::string& ruta, const std::vector<Nivel>& niveles, uint32_t num_regiones,
+                         const ParametrosInstantanea& parametros, int num_hilos) {
+    if (niveles.empty()) {
+        throw std::runtime_error("Error: no se puede guardar una piramide sin niveles en " + ruta + ".");
+    }
+    CabeceraInstantanea cabecera{};
+    std::memcpy(cabecera.magia, MAGIA_INSTANTANEA, sizeof(cabecera.magia));
+    cabecera.version = VERSION_INSTANTANEA;
+    cabecera.num_niveles = static_cast<uint32_t>(niveles.size());
+    cabecera.num_filas = niveles[0].num_filas;
+    cabecera.num_columnas = niveles[0].num_columnas;
+    cabecera.num_regiones = num_regiones;
+    cabecera.tolerancia_absoluta = parametros.tolerancia_absoluta;
+    cabecera.tolerancia_relativa = parametros.tolerancia_relativa;
+    for (int a = 0; a < NUM_ATRIBUTOS_SUELO; a++) {
+        cabecera.precision[a] = static_cast<uint32_t>(parametros.precision_atributos[a].tipo);
+        cabecera.escala[a] = parametros.precision_atributos[a].escala;
+    }
+
+    // Calcular la forma de los niveles y el esquema de las columnas
+    std::vector<DescriptorNivel> descriptores_niveles;
+    std::vector<DescriptorColumna> descriptores;
+    for (const Nivel& nivel : niveles) {
+        descriptores_niveles.push_back({nivel.num_filas, nivel.num_columnas, nivel.id_base,
+                                        static_cast<uint32_t>(nivel.disperso)});
+        Nivel::recorrerColumnas(nivel, [&](const char* nombre, const auto& columna) {
+            using T = typename std::decay_t<decltype(columna)>::value_type;
+            DescriptorColumna descriptor{};
+            std::strncpy(descriptor.nombre, nombre, sizeof(descriptor.nombre) - 1);
+            descriptor.nivel = static_cast<uint32_t>(nivel.nivel);
+            descriptor.tipo = tipoColumna<T>();
+            descriptor.tam_elemento = sizeof(T);
+            descriptor.bytes = columna.size() * sizeof(T);
+            descriptores.push_back(descriptor);
+        });
+    }
+
+    const std::vector<AtributosSuelo>& clases = niveles[0].atributos->entradas();
+    std::size_t bytes_tabla = clases.size() * sizeof(AtributosSuelo);
+    std::size_t desplazamiento = alinear(sizeof(CabeceraInstantanea)
+                                         + descriptores_niveles.size() * sizeof(DescriptorNivel)
+                                         + descriptores.size() * sizeof(DescriptorColumna) + bytes_tabla);
+    uint64_t suma = mezclarSuma(BASE_SUMA, sumaComprobacion(clases.data(), bytes_tabla, num_hilos));
+    std::size_t i = 0;
+    for (const Nivel& nivel : niveles) {
+        Nivel::recorrerColumnas(nivel, [&](const char*, const auto& columna) {
+            DescriptorColumna& descriptor = descriptores[i++];
+            if (descriptor.bytes > 0) {
+                descriptor.desplazamiento = desplazamiento;
+                desplazamiento = alinear(desplazamiento + descriptor.bytes);
+            }
+            suma = mezclarSuma(suma, sumaComprobacion(columna.data(), descriptor.bytes, num_hilos));
+        });
+    }
+    cabecera.num_columnas_guardadas = static_cast<uint32_t>(descriptores.size());
+    cabecera.num_clases = clases.size();
+    cabecera.suma = suma;
+
+    // Escribir en un archivo temporal
+    std::string temporal = ruta + ".tmp";
+    std::ofstream archivo(temporal, std::ios::binary | std::ios::trunc);
+    if (!archivo) {
+        throw std::runtime_error("Error: no se pudo crear la instantanea " + temporal + ".");
+    }
+    archivo.write(reinterpret_cast<const char*>(&cabecera), sizeof(cabecera));
+    archivo.write(reinterpret_cast<const char*>(descriptores_niveles.data()),
+                  descriptores_niveles.size() * sizeof(DescriptorNivel));
+    archivo.write(reinterpret_cast<const char*>(descriptores.data()), descriptores.size() * sizeof(DescriptorColumna));
+    archivo.write(reinterpret_cast<const char*>(clases.data()), static_cast<std::streamsize>(bytes_tabla));
+    i = 0;
+    for (const Nivel& nivel : niveles) {
+        Nivel::recorrerColumnas(nivel, [&](const char*, const auto& columna) {
+            const DescriptorColumna& descriptor = descriptores[i++];
+            if (descriptor.bytes > 0) {
+                archivo.seekp(static_cast<std::streamoff>(descriptor.desplazamiento));
+                archivo.write(reinterpret_cast<const char*>(columna.data()),
+                              static_cast<std::streamsize>(descriptor.bytes));
+            }
+        });
+    }
+    archivo.close();
+    if (!archivo) {
+        std::remove(temporal.c_str());
+        throw std::runtime_error("Error: no se pudo escribir la instantanea " + temporal + ".");
+    }
+
+    if (std::rename(temporal.c_str(), ruta.c_str()) != 0) {
+        std::remove(temporal.c_str());
+        throw std::runtime_error("Error: no se pudo renombrar la instantanea " + temporal + ".");
+    }
+}
+
+/**
+ * @brief Lee las dimensiones, el número de niveles, el número de regiones y los parámetros de la construcción de
+ * una instantánea.
+ * 
+ * @param ruta Ruta de la instantánea.
+ * @return Datos de la cabecera.
+ */
+ResumenInstantanea leerResumenInstantanea(const std::string& ruta) {
+    std::ifstream archivo(ruta, std::ios::binary);
+    if (!archivo) {
+        throw std::runtime_error("Error: no se pudo abrir la instantanea " + ruta + ".");
+    }
+    CabeceraInstantanea cabecera{};
+    archivo.read(reinterpret_cast<char*>(&cabecera), sizeof(cabecera));
+    if (!archivo) {
+        throw std::runtime_error("Error: " + ruta + " no es una instantanea de la piramide.");
+    }
+    comprobarCabecera(cabecera, ruta);
+    ParametrosInstantanea parametros{cabecera.tolerancia_absoluta, cabecera.tolerancia_relativa, {}};
+    for (int a = 0; a < NUM_ATRIBUTOS_SUELO; a++) {
+        parametros.precision_atributos[a].tipo = static_cast<Precision>(cabecera.precision[a]);
+        parametros.precision_atributos[a].escala = cabecera.escala[a];
+    }
+    return {cabecera.num_filas, cabecera.num_columnas, static_cast<int>(cabecera.num_niveles), cabecera.num_regiones,
+            parametros};
+}
+
+/**
+ * @brief Proyecta una instantánea en los niveles de una Pirámide, sin copiar ni convertir sus columnas.
+ * 
+ * Las columnas de los niveles pasan a apuntar a la proyección del archivo (privada y con copia en escritura):
+ * solo se leen de disco las páginas que se usan, varios procesos que abren la misma instantánea comparten sus
+ * páginas en la caché del sistema y las modificaciones, si las hay, nunca llegan al archivo. Se comprueba que la
+ * forma de cada nivel y el esquema de cada columna coinciden con los esperados y que todas las columnas están
+ * dentro del archivo.
+ * 
+ * @param ruta Ruta de la instantánea.
+ * @param niveles Niveles de la Pirámide, con la forma de los guardados y sin columnas; reciben las columnas y la
+ *                tabla de atributos.
+ * @param verificar Si es verdadero, se comprueba la suma de todo el archivo (lo lee entero).
+ * @param num_hilos Número de hilos para la suma de comprobación.
+ */
+void proyectarInstantanea(const std::string& ruta, std::vector<Nivel>& niveles, bool verificar, int num_hilos) {
+    std::shared_ptr<ArchivoMapeado> archivo = std::make_shared<ArchivoMapeado>(ruta, true);
+    CabeceraInstantanea cabecera = leerCabecera(*archivo, ruta);
+    const std::string error_esquema = "Error: la instantanea " + ruta + " no coincide con la forma de la piramide.";
+    if (cabecera.num_niveles != niveles.size()) {
+        throw std::runtime_error(error_esquema);
+    }
+
+    std::size_t inicio_columnas = sizeof(CabeceraInstantanea) + cabecera.num_niveles * sizeof(DescriptorNivel);
+    std::size_t inicio_tabla = inicio_columnas + cabecera.num_columnas_guardadas * sizeof(DescriptorColumna);
+    std::size_t bytes_tabla = cabecera.num_clases * sizeof(AtributosSuelo);
+    if (archivo->size() < inicio_tabla + bytes_tabla) {
+        throw std::runtime_error("Error: la instantanea " + ruta + " esta truncada.");
+    }
+    std::vector<DescriptorNivel> descriptores_niveles(cabecera.num_niveles);
+    std::memcpy(descriptores_niveles.data(), archivo->data() + sizeof(CabeceraInstantanea),
+                descriptores_niveles.size() * sizeof(DescriptorNivel));
+    std::vector<DescriptorColumna> descriptores(cabecera.num_columnas_guardadas);
+    std::memcpy(descriptores.data(), archivo->data() + inicio_columnas,
+                descriptores.size() * sizeof(DescriptorColumna));
+
+    // Comprobar la forma de los niveles y el esquema de las columnas
+    std::size_t i = 0;
+    for (Nivel& nivel : niveles) {
+        const DescriptorNivel& forma = descriptores_niveles[nivel.nivel];
+        if (forma.num_filas != nivel.num_filas || forma.num_columnas != nivel.num_columnas
+            || forma.id_base != nivel.id_base) {
+            throw std::runtime_error(error_esquema);
+        }
+        Nivel::recorrerColumnas(nivel, [&](const char* nombre, auto& columna) {
+            using T = typename std::decay_t<decltype(columna)>::value_type;
+            if (i >= descriptores.size()) {
+                throw std::runtime_error(error_esquema);
+            }
+            const DescriptorColumna& descriptor = descriptores[i++];
+            if (std::strncmp(descriptor.nombre, nombre, sizeof(descriptor.nombre)) != 0
+                || descriptor.nivel != static_cast<uint32_t>(nivel.nivel) || descriptor.tipo != tipoColumna<T>()
+                || descriptor.tam_elemento != sizeof(T) || descriptor.bytes % sizeof(T) != 0
+                || descriptor.desplazamiento % ALINEACION_INSTANTANEA != 0
+                || descriptor.desplazamiento + descriptor.bytes > archivo->size()) {
+                throw std::runtime_error(error_esquema);
+            }
+        });
+    }
+    if (i != descriptores.size()) {
+        throw std::runtime_error(error_esquema);
+    }
+
+    const char* tabla = archivo->data() + inicio_tabla;
+    if (verificar) {
+        uint64_t suma = mezclarSuma(BASE_SUMA, sumaComprobacion(tabla, bytes_tabla, num_hilos));
+        for (const DescriptorColumna& descriptor : descriptores) {
+            suma = mezclarSuma(suma, sumaComprobacion(archivo->data() + descriptor.desplazamiento, descriptor.bytes,
+                                                      num_hilos));
+        }
+        if (suma != cabecera.suma) {
+            throw std::runtime_error("Error: la instantanea " + ruta + " esta corrupta.");
+        }
+    }
+
+    // Cargar la tabla de atributos, compartida por todos los niveles, y proyectar las columnas
+    std::vector<AtributosSuelo> clases(cabecera.num_clases);
+    std::memcpy(clases.data(), tabla, bytes_tabla);
+    niveles[0].atributos->asignar(std::move(clases));
+
+    i = 0;
+    for (Nivel& nivel : niveles) {
+        nivel.disperso = descriptores_niveles[nivel.nivel].disperso != 0;
+        Nivel::recorrerColumnas(nivel, [&](const char*, auto& columna) {
+            using T = std::remove_reference_t<decltype(columna)>;
+            using Elemento = typename T::value_type;
+            const DescriptorColumna& descriptor = descriptores[i++];
+            if (descriptor.bytes == 0) {
+                columna = T();
+                return;
+            }
+            columna.proyectar(reinterpret_cast<Elemento*>(archivo->data() + descriptor.desplazamiento),
+                              descriptor.bytes / sizeof(Elemento), archivo);
+        });
+        if (!nivel.columnasValidas()) {
+            throw std::runtime_error(error_esquema);
+        }
+    }
+}
@@ -0,0 +1,45 @@
+#ifndef INSTANTANEA_H
+#define INSTANTANEA_H
+
+#include "nivel.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Versión del formato de las instantáneas; se incrementa con cada cambio de disposición o de esquema
+const uint32_t VERSION_INSTANTANEA = 2;
+
+/**
+ * @brief Parámetros de la construcción que cambian los niveles y que actualizar() debe repetir.
+ */
+struct ParametrosInstantanea {
+    AtributosSuelo tolerancia_absoluta;
+    AtributosSuelo tolerancia_relativa;
+    PrecisionAtributos precision_atributos;
+};
+
+/**
+ * @brief Datos de la cabecera de una instantánea, para crear los niveles antes de proyectarlos.
+ */
+struct ResumenInstantanea {
+    int num_filas;
+    int num_columnas;
+    int num_niveles;
+    uint32_t num_regiones;
+    ParametrosInstantanea parametros;
+};
+
+// Guarda todos los niveles de una Pirámide construida con unos parámetros en la instantánea 'ruta'
+void escribirInstantanea(const std::string& ruta, const std::vector<Nivel>& niveles, uint32_t num_regiones,
+                         const ParametrosInstantanea& parametros, int num_hilos);
+
+// Lee la cabecera de una instantánea, con los parámetros de su construcción; lanza std::runtime_error si no
+// existe o no es válida
+ResumenInstantanea leerResumenInstantanea(const std::string& ruta);
+
+// Proyecta las columnas de la instantánea en los niveles, que deben tener ya la forma guardada y la tabla de
+// atributos; lanza std::runtime_error si la instantánea no es válida
+void proyectarInstantanea(const std::string& ruta, std::vector<Nivel>& niveles, bool verificar, int num_hilos);
+
+#endif // INSTANTANEA_H
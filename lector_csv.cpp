@@ -0,0 +1,367 @@
+#include "lector_csv.h"
+#include "archivo_mapeado.h"
+#include "paralelo.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace {
+
+// Nombres de las columnas del archivo, para los mensajes de error
+const char* const NOMBRES_CAMPOS[] = {
+    "id", "capacidad_campo_media", "estaciones", "pendiente_3clases", "porosidad_media",
+    "punto_marchitez_medio", "umbral_humedo", "umbral_intermedio", "umbral_seco"
+};
+
+// Número máximo de filas con mensaje (mal formadas o con valores que no se conservan)
+const std::size_t MAX_FILAS_MOSTRADAS = 20;
+
+// Nombre de cada precisión, para los mensajes
+const char* nombrePrecision(Precision precision) {
+    switch (precision) {
+    case Precision::Simple:
+        return "float";
+    case Precision::Fijo16:
+        return "punto fijo de 16 bits";
+    default:
+        return "double";
+    }
+}
+
+// Escribe un valor con los menos dígitos que lo identifican, para los mensajes
+std::string textoValor(double valor) {
+    char texto[32];
+    return std::string(texto, std::to_chars(texto, texto + sizeof(texto), valor).ptr);
+}
+
+/**
+ * @brief Informa de las filas mal formadas de un archivo y lanza una excepción si hay alguna.
+ * 
+ * @param ruta Ruta del archivo.
+ * @param errores Filas mal formadas, con su número de línea en el archivo.
+ */
+void informarErrores(const std::string& ruta, const std::vector<ErrorCSV>& errores) {
+    if (errores.empty()) {
+        return;
+    }
+    for (std::size_t e = 0; e < errores.size() && e < MAX_FILAS_MOSTRADAS; e++) {
+        std::cerr << "\t\t" << ruta << ":" << errores[e].linea << ": " << errores[e].motivo << std::endl;
+    }
+    throw std::runtime_error("Error: " + std::to_string(errores.size()) + " filas mal formadas en "
+                             + ruta + " (primera en la linea " + std::to_string(errores[0].linea) + ").");
+}
+
+/**
+ * @brief Clase de una combinación de atributos ya vista en un bloque.
+ */
+struct ClaseVista {
+    uint32_t clase;
+    // Algún valor de la combinación no se conserva con la precisión elegida
+    bool redondeada;
+};
+
+bool esEspacio(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+/**
+ * @brief Lee un campo numérico a partir de 'p' y avanza hasta el comienzo del campo siguiente.
+ * 
+ * Se admiten espacios alrededor del valor. El campo debe terminar en una coma o en el final
+ * de la línea.
+ * 
+ * @param p Posición de lectura, se actualiza.
+ * @param fin Final de la línea.
+ * @param valor Valor leído.
+ * @return Verdadero si el campo es válido, falso en caso contrario.
+ */
+template <typename T>
+bool leerCampo(const char*& p, const char* fin, T& valor) {
+    while (p < fin && esEspacio(*p)) {
+        p++;
+    }
+    std::from_chars_result resultado = std::from_chars(p, fin, valor);
+    if (resultado.ec != std::errc() || resultado.ptr == p) {
+        return false;
+    }
+    p = resultado.ptr;
+    while (p < fin && esEspacio(*p)) {
+        p++;
+    }
+    if (p == fin) {
+        return true;
+    }
+    if (*p != ',') {
+        return false;
+    }
+    p++;
+    return true;
+}
+
+} // namespace
+
+/**
+ * @brief Obtiene el comienzo de la línea siguiente.
+ * 
+ * @param inicio Posición dentro de una línea.
+ * @param fin Final del texto.
+ * @return Posición siguiente al salto de línea, o 'fin' si no hay más líneas.
+ */
+const char* saltarLinea(const char* inicio, const char* fin) {
+    const void* salto = std::memchr(inicio, '\n', fin - inicio);
+    return salto != nullptr ? static_cast<const char*>(salto) + 1 : fin;
+}
+
+/**
+ * @brief Divide el texto en tramos de tamaño parecido que empiezan y terminan en un límite de línea.
+ * 
+ * Cada corte se desplaza hasta después del siguiente salto de línea, de modo que ninguna línea
+ * queda partida entre dos tramos. Los tramos vacíos se descartan.
+ * 
+ * @param inicio Comienzo del texto (comienzo de una línea).
+ * @param fin Final del texto.
+ * @param num_bloques Número de tramos deseado.
+ * @return Tramos consecutivos que cubren todo el texto.
+ */
+std::vector<BloqueCSV> dividirEnBloques(const char* inicio, const char* fin, std::size_t num_bloques) {
+    std::vector<BloqueCSV> bloques;
+    std::size_t tam = fin - inicio;
+    num_bloques = std::max<std::size_t>(num_bloques, 1);
+
+    const char* actual = inicio;
+    for (std::size_t b = 1; b <= num_bloques && actual < fin; b++) {
+        const char* corte = fin;
+        if (b < num_bloques) {
+            corte = inicio + tam / num_bloques * b;
+            corte = corte <= actual ? saltarLinea(actual, fin) : saltarLinea(corte - 1, fin);
+        }
+        bloques.push_back({actual, corte});
+        actual = corte;
+    }
+    return bloques;
+}
+
+/**
+ * @brief Verifica si una línea no tiene contenido.
+ * 
+ * @param inicio Comienzo de la línea.
+ * @param fin Final de la línea (sin el salto).
+ * @return Verdadero si la línea solo contiene espacios, falso en caso contrario.
+ */
+bool esLineaVacia(const char* inicio, const char* fin) {
+    for (const char* p = inicio; p < fin; p++) {
+        if (!esEspacio(*p)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Convierte una línea del CSV en sus valores numéricos.
+ * 
+ * Usa std::from_chars directamente sobre el texto, sin crear cadenas intermedias. Los campos
+ * que siguen a umbral_seco se ignoran.
+ * 
+ * @param inicio Comienzo de la línea.
+ * @param fin Final de la línea (sin el salto).
+ * @param fila Valores leídos.
+ * @param motivo Descripción del error si la línea no es válida.
+ * @return Verdadero si la línea es válida, falso en caso contrario.
+ */
+bool analizarFilaCSV(const char* inicio, const char* fin, FilaCSV& fila, std::string& motivo) {
+    auto error = [&motivo](int campo) {
+        motivo = std::string("campo '") + NOMBRES_CAMPOS[campo] + "' ausente o no numérico";
+        return false;
+    };
+
+    const char* p = inicio;
+    if (!leerCampo(p, fin, fila.id)) return error(0);
+    if (!leerCampo(p, fin, fila.capacidad_campo_media)) return error(1);
+    if (!leerCampo(p, fin, fila.estaciones)) return error(2);
+    if (!leerCampo(p, fin, fila.pendiente_3clases)) return error(3);
+    if (!leerCampo(p, fin, fila.porosidad_media)) return error(4);
+    if (!leerCampo(p, fin, fila.punto_marchitez_medio)) return error(5);
+    if (!leerCampo(p, fin, fila.umbral_humedo)) return error(6);
+    if (!leerCampo(p, fin, fila.umbral_intermedio)) return error(7);
+    if (!leerCampo(p, fin, fila.umbral_seco)) return error(8);
+    return true;
+}
+
+/**
+ * @brief Lee un archivo CSV y vuelca sus filas en las columnas del nivel base.
+ * 
+ * El archivo se proyecta en memoria y se divide en bloques de líneas completas que se analizan en paralelo con
+ * std::from_chars, sin crear cadenas por línea. Cada hilo escribe directamente en las columnas del nivel base
+ * (el id de cada fila es su índice plano en el nivel 0). Si hay filas mal formadas o con un id fuera de la base,
+ * se informa de ellas con su número de línea y se lanza una excepción.
+ * 
+ * Los atributos de suelo y umbrales de cada fila se redondean a su precisión (ver redondearPrecision) y se internan
+ * en la tabla de atributos de la base. Cada hilo recuerda las combinaciones que ya ha visto, así que solo redondea
+ * y consulta la tabla compartida con las nuevas. Al terminar, la tabla se ordena para que las clases no dependan
+ * del reparto entre hilos. Si algún valor no se conserva con la precisión elegida, se informa del número de filas
+ * afectadas y de las primeras, con el valor leído y el guardado, pero la lectura continúa.
+ * 
+ * @param ruta Ruta del archivo CSV.
+ * @param base Nivel 0 de la pirámide, ya reservado y con su tabla de atributos.
+ * @param precision Precisión de cada atributo.
+ * @param num_hilos Número de hilos (0 = todos los núcleos disponibles).
+ */
+void leerCSV(const std::string& ruta, Nivel& base, const PrecisionAtributos& precision, int num_hilos) {
+    // Proyectar el archivo CSV en memoria
+    ArchivoMapeado archivo(ruta);
+    const char* fin = archivo.data() + archivo.size();
+
+    // Saltar encabezado
+    const char* datos = archivo.size() > 0 ? saltarLinea(archivo.data(), fin) : fin;
+
+    // Varios bloques por hilo para repartir mejor la carga
+    num_hilos = hilosEfectivos(num_hilos);
+    std::vector<BloqueCSV> bloques = dividirEnBloques(datos, fin, static_cast<std::size_t>(num_hilos) * 4);
+    std::vector<std::size_t> lineas_bloque(bloques.size(), 0);
+    std::vector<std::vector<ErrorCSV>> errores_bloque(bloques.size());
+    // Filas con valores que no se conservan: número y las primeras de cada bloque
+    std::vector<std::size_t> redondeadas_bloque(bloques.size(), 0);
+    std::vector<std::vector<ErrorCSV>> avisos_bloque(bloques.size());
+
+    const std::size_t tam_base = base.size();
+    TablaAtributos& tabla = *base.atributos;
+    tabla.clear();
+    paraleloPara(num_hilos, bloques.size(), [&](std::size_t b) {
+        FilaCSV fila;
+        std::string motivo;
+        std::size_t linea = 0;
+        // Clases ya vistas en este bloque, por sus atributos antes de redondear
+        std::unordered_map<AtributosSuelo, ClaseVista, HashAtributos> clases_bloque;
+
+        for (const char* p = bloques[b].inicio; p < bloques[b].fin; ) {
+            const char* siguiente = saltarLinea(p, bloques[b].fin);
+            const char* fin_linea = siguiente[-1] == '\n' ? siguiente - 1 : siguiente;
+            linea++;
+
+            if (esLineaVacia(p, fin_linea)) {
+                // Las líneas vacías (p. ej. al final del archivo) se ignoran
+            }
+            else if (!analizarFilaCSV(p, fin_linea, fila, motivo)) {
+                errores_bloque[b].push_back({linea, motivo});
+            }
+            else if (fila.id < 0 || static_cast<std::size_t>(fila.id) >= tam_base) {
+                errores_bloque[b].push_back({linea, "id " + std::to_string(fila.id) + " fuera de la base"});
+            }
+            else {
+                // Los ids de la base coinciden con el índice plano del nivel 0
+                std::size_t k = static_cast<std::size_t>(fila.id);
+                AtributosSuelo atributos{fila.capacidad_campo_media, fila.pendiente_3clases, fila.porosidad_media,
+                                         fila.punto_marchitez_medio, fila.umbral_humedo, fila.umbral_intermedio,
+                                         fila.umbral_seco};
+                auto vista = clases_bloque.find(atributos);
+                if (vista == clases_bloque.end()) {
+                    AtributosSuelo guardados = atributos;
+                    bool redondeada = false;
+                    for (int c = 0; c < NUM_ATRIBUTOS_SUELO; c++) {
+                        double& valor = guardados.*CAMPOS_ATRIBUTOS[c];
+                        double leido = valor;
+                        if (!redondearPrecision(valor, precision[c])) {
+                            redondeada = true;
+                            if (avisos_bloque[b].size() < MAX_FILAS_MOSTRADAS) {
+                                // Los atributos son las columnas del CSV salvo id y estaciones
+                                avisos_bloque[b].push_back({linea, std::string(NOMBRES_CAMPOS[c == 0 ? 1 : c + 2])
+                                    + " = " + textoValor(leido) + " no se conserva en "
+                                    + nombrePrecision(precision[c].tipo) + " (se guarda "
+                                    + textoValor(valor) + ")"});
+                            }
+                        }
+                    }
+                    vista = clases_bloque.emplace(atributos, ClaseVista{tabla.internar(guardados), redondeada}).first;
+                }
+                redondeadas_bloque[b] += vista->second.redondeada;
+                base.clase[k] = vista->second.clase;
+                base.estaciones[k] = fila.estaciones;
+                base.homog[k] = 1;
+                base.area[k] = 1;
+            }
+            p = siguiente;
+        }
+        lineas_bloque[b] = linea;
+    });
+
+    // Pasar los números de línea de cada bloque a líneas del archivo (la 1 es el encabezado)
+    std::vector<ErrorCSV> errores;
+    std::vector<ErrorCSV> avisos;
+    std::size_t redondeadas = 0;
+    std::size_t primera_linea = 2;
+    for (std::size_t b = 0; b < bloques.size(); b++) {
+        for (const ErrorCSV& error : errores_bloque[b]) {
+            errores.push_back({primera_linea + error.linea - 1, error.motivo});
+        }
+        for (const ErrorCSV& aviso : avisos_bloque[b]) {
+            avisos.push_back({primera_linea + aviso.linea - 1, aviso.motivo});
+        }
+        redondeadas += redondeadas_bloque[b];
+        primera_linea += lineas_bloque[b];
+    }
+
+    informarErrores(ruta, errores);
+
+    if (redondeadas > 0) {
+        for (std::size_t a = 0; a < avisos.size() && a < MAX_FILAS_MOSTRADAS; a++) {
+            std::cerr << "\t\t" << ruta << ":" << avisos[a].linea << ": " << avisos[a].motivo << std::endl;
+        }
+        std::cout << "\t\t" << redondeadas << " filas con valores que no se conservan con la precision elegida "
+                  << "(primera en la linea " << avisos[0].linea << "); se guardan redondeados." << std::endl;
+    }
+
+    // Numerar las clases en el orden de sus atributos
+    std::vector<uint32_t> nuevas = tabla.ordenar();
+    const std::size_t tam_tramo = 1 << 20;
+    paraleloPara(num_hilos, (tam_base + tam_tramo - 1) / tam_tramo, [&](std::size_t t) {
+        std::size_t fin_tramo = std::min(tam_base, (t + 1) * tam_tramo);
+        for (std::size_t k = t * tam_tramo; k < fin_tramo; k++) {
+            if (base.clase[k] != CLASE_VACIA) {
+                base.clase[k] = nuevas[base.clase[k]];
+            }
+        }
+    });
+}
+
+/**
+ * @brief Lee un archivo CSV de cambios de la base, con el mismo formato que el archivo de la base.
+ * 
+ * Los archivos de cambios son pequeños, así que se leen desde un solo hilo y sus filas se devuelven sin volcarlas
+ * en ningún nivel (ver Piramide::actualizar). Si hay filas mal formadas, se informa de ellas con su número de línea
+ * y se lanza una excepción.
+ * 
+ * @param ruta Ruta del archivo CSV.
+ * @return Filas del archivo, en orden.
+ */
+std::vector<FilaCSV> leerCambiosCSV(const std::string& ruta) {
+    ArchivoMapeado archivo(ruta);
+    const char* fin = archivo.data() + archivo.size();
+
+    std::vector<FilaCSV> filas;
+    std::vector<ErrorCSV> errores;
+    FilaCSV fila;
+    std::string motivo;
+    std::size_t linea = 1;
+    for (const char* p = archivo.size() > 0 ? saltarLinea(archivo.data(), fin) : fin; p < fin; ) {
+        const char* siguiente = saltarLinea(p, fin);
+        const char* fin_linea = siguiente[-1] == '\n' ? siguiente - 1 : siguiente;
+        linea++;
+        if (esLineaVacia(p, fin_linea)) {
+            // Las líneas vacías se ignoran
+        }
+        else if (!analizarFilaCSV(p, fin_linea, fila, motivo)) {
+            errores.push_back({linea, motivo});
+        }
+        else {
+            filas.push_back(fila);
+        }
+        p = siguiente;
+    }
+    informarErrores(ruta, errores);
+    return filas;
+}
@@ -0,0 +1,65 @@
+#ifndef LECTOR_CSV_H
+#define LECTOR_CSV_H
+
+#include "nivel.h"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Valores de una fila del archivo CSV de la base de la pirámide.
+ * 
+ * El orden de los campos es el de las columnas del archivo:
+ * id, capacidad_campo_media, estaciones, pendiente_3clases, porosidad_media,
+ * punto_marchitez_medio, umbral_humedo, umbral_intermedio, umbral_seco.
+ */
+struct FilaCSV {
+    int id;
+    double capacidad_campo_media;
+    int estaciones;
+    double pendiente_3clases;
+    double porosidad_media;
+    double punto_marchitez_medio;
+    double umbral_humedo;
+    double umbral_intermedio;
+    double umbral_seco;
+};
+
+/**
+ * @brief Fila mal formada del archivo CSV.
+ */
+struct ErrorCSV {
+    // Número de línea en el archivo (la del encabezado es la 1)
+    std::size_t linea;
+    std::string motivo;
+};
+
+/**
+ * @brief Tramo del archivo que contiene solo líneas completas, [inicio, fin).
+ */
+struct BloqueCSV {
+    const char* inicio;
+    const char* fin;
+};
+
+// Devuelve el comienzo de la línea siguiente a la que empieza en 'inicio' (o 'fin' si no hay más)
+const char* saltarLinea(const char* inicio, const char* fin);
+
+// Divide [inicio, fin) en como mucho num_bloques tramos alineados a saltos de línea
+std::vector<BloqueCSV> dividirEnBloques(const char* inicio, const char* fin, std::size_t num_bloques);
+
+// Verifica si la línea [inicio, fin) está vacía o solo contiene espacios
+bool esLineaVacia(const char* inicio, const char* fin);
+
+// Convierte la línea [inicio, fin) en una FilaCSV sin reservar memoria; si falla, rellena 'motivo'
+bool analizarFilaCSV(const char* inicio, const char* fin, FilaCSV& fila, std::string& motivo);
+
+// Lee el archivo CSV en paralelo y vuelca sus filas en el nivel base, con los atributos redondeados a la precisión
+// dada; lanza std::runtime_error si hay filas mal formadas
+void leerCSV(const std::string& ruta, Nivel& base, const PrecisionAtributos& precision, int num_hilos);
+
+// Lee las filas de un archivo CSV de cambios de la base; lanza std::runtime_error si hay filas mal formadas
+std::vector<FilaCSV> leerCambiosCSV(const std::string& ruta);
+
+#endif // LECTOR_CSV_H
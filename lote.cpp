@@ -0,0 +1,123 @@
+#include "lote.h"
+#include "paralelo.h"
+#include "salida_nula.h"
+
+#include <chrono>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+
+/**
+ * @brief Lee un manifiesto de escenarios.
+ * 
+ * Cada línea tiene la ruta del CSV del escenario y, opcionalmente, separada por espacios, la de la instantánea
+ * en la que se guarda su pirámide. Se saltan las líneas vacías y las que empiezan por '#'.
+ * 
+ * @param ruta Ruta del manifiesto.
+ * @return Escenarios, en el orden del manifiesto.
+ */
+std::vector<EscenarioLote> leerManifiesto(const std::string& ruta) {
+    std::ifstream archivo(ruta);
+    if (!archivo.is_open()) {
+        throw std::runtime_error("Error: no se pudo abrir el archivo " + ruta + ".");
+    }
+    std::vector<EscenarioLote> escenarios;
+    std::string linea;
+    while (std::getline(archivo, linea)) {
+        std::istringstream campos(linea);
+        EscenarioLote escenario;
+        if (!(campos >> escenario.archivo_csv) || escenario.archivo_csv[0] == '#') {
+            continue;
+        }
+        campos >> escenario.archivo_instantanea;
+        escenarios.push_back(escenario);
+    }
+    return escenarios;
+}
+
+/**
+ * @brief Construye las pirámides de varios escenarios de la misma malla.
+ * 
+ * Los escenarios se reparten entre escenarios_simultaneos trabajadores, que toman el siguiente pendiente al
+ * terminar el suyo, y los hilos de config.num_hilos se dividen entre ellos: buena parte de la construcción
+ * (enlaza, clasifica) es secuencial, así que varios escenarios a la vez aprovechan mejor los núcleos que uno
+ * detrás de otro con todos los hilos. Todas las pirámides comparten:
+ *  - la geometría (número de niveles y primer ID de cada nivel), calculada una vez si config tiene dimensiones;
+ *  - un pool de memoria del que los niveles toman sus columnas y al que vuelven al destruir cada pirámide, de modo
+ *    que el escenario siguiente reutiliza las páginas ya en memoria en lugar de pedirlas de nuevo al sistema.
+ * 
+ * Cada escenario se construye con todas sus fases (ver Piramide::ejecutarFases) y se guarda en su instantánea, si
+ * la tiene. Los mensajes de las pirámides se descartan; por la salida estándar solo sale una línea por escenario
+ * terminado. Un escenario que falla no detiene los demás: su error queda en el resumen.
+ * 
+ * @param escenarios Escenarios a construir.
+ * @param config Configuración común. En cada escenario se cambian el CSV, la instantánea y el número de hilos, la
+ *               caché y el archivo temporal de los niveles pasan a ser los del CSV y no se guardan métricas,
+ *               regiones ni etiquetas.
+ * @param escenarios_simultaneos Escenarios que se construyen a la vez (al menos 1).
+ * @param pool_maximo_mb Memoria máxima libre retenida en el pool, en MB (0 = sin límite).
+ * @return Resumen con el resultado de cada escenario, en el orden de 'escenarios'.
+ */
+ResumenLote construirLote(const std::vector<EscenarioLote>& escenarios, const Configuracion& config,
+                          int escenarios_simultaneos, std::size_t pool_maximo_mb) {
+    ResumenLote resumen;
+    resumen.escenarios.resize(escenarios.size());
+    int num_trabajadores = std::max(1, std::min<int>(escenarios_simultaneos, static_cast<int>(escenarios.size())));
+    int hilos_escenario = std::max(1, hilosEfectivos(config.num_hilos) / num_trabajadores);
+
+    std::shared_ptr<const GeometriaPiramide> geometria;
+    if (config.num_filas > 0 && config.num_columnas > 0) {
+        geometria = calcularGeometria(config.num_filas, config.num_columnas);
+    }
+    auto pool = std::make_shared<PoolMemoria>(pool_maximo_mb << 20);
+
+    std::ostream salida(std::cout.rdbuf());
+    std::mutex mutex_salida;
+    std::size_t terminados = 0;
+    salida << "Construyendo " << escenarios.size() << " escenarios, " << num_trabajadores << " a la vez con "
+           << hilos_escenario << " hilos cada uno..." << std::endl;
+
+    SilenciarFlujo silencio(std::cout);
+    auto inicio = std::chrono::steady_clock::now();
+    paraleloPara(num_trabajadores, escenarios.size(), [&](std::size_t e) {
+        ResultadoEscenario& resultado = resumen.escenarios[e];
+        resultado.archivo_csv = escenarios[e].archivo_csv;
+        auto inicio_escenario = std::chrono::steady_clock::now();
+        try {
+            Configuracion config_escenario = config;
+            config_escenario.archivo_csv = escenarios[e].archivo_csv;
+            config_escenario.archivo_instantanea = escenarios[e].archivo_instantanea;
+            config_escenario.num_hilos = hilos_escenario;
+            config_escenario.archivo_cache.clear();
+            config_escenario.archivo_niveles.clear();
+            config_escenario.archivo_metricas.clear();
+            config_escenario.archivo_regiones.clear();
+            config_escenario.archivo_etiquetas.clear();
+            Piramide piramide(config_escenario, false);
+            piramide.geometria = geometria;
+            piramide.pool = pool;
+            piramide.ejecutarFases();
+            resultado.num_regiones = piramide.num_regiones;
+        } catch (const std::exception& error) {
+            resultado.error = error.what();
+        }
+        resultado.segundos = segundosDesde(inicio_escenario);
+
+        std::lock_guard<std::mutex> lock(mutex_salida);
+        terminados++;
+        salida << "\t[" << terminados << "/" << escenarios.size() << "] " << resultado.archivo_csv << ": ";
+        if (resultado.error.empty()) {
+            salida << resultado.num_regiones << " regiones en " << resultado.segundos << " s" << std::endl;
+        } else {
+            salida << resultado.error << std::endl;
+        }
+    });
+
+    resumen.segundos = segundosDesde(inicio);
+    for (const ResultadoEscenario& resultado : resumen.escenarios) {
+        resumen.correctos += resultado.error.empty();
+    }
+    resumen.pool = pool->estadisticas();
+    return resumen;
+}
@@ -0,0 +1,50 @@
+#ifndef LOTE_H
+#define LOTE_H
+
+#include "piramide.h"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Escenario de un lote: un CSV de la misma malla que los demás y la instantánea en la que se guarda.
+ */
+struct EscenarioLote {
+    std::string archivo_csv;
+    // Instantánea de la pirámide construida (vacía = no se guarda)
+    std::string archivo_instantanea;
+};
+
+/**
+ * @brief Resultado de la construcción de un escenario de un lote.
+ */
+struct ResultadoEscenario {
+    std::string archivo_csv;
+    // Mensaje de error si la construcción ha fallado (vacío si ha terminado bien)
+    std::string error;
+    double segundos = 0;
+    uint32_t num_regiones = 0;
+};
+
+/**
+ * @brief Resumen de la construcción de un lote.
+ */
+struct ResumenLote {
+    std::vector<ResultadoEscenario> escenarios;
+    std::size_t correctos = 0;
+    double segundos = 0;
+    // Uso del pool de memoria compartido por los escenarios
+    EstadisticasPool pool;
+};
+
+// Lee un manifiesto de escenarios (una línea "archivo.csv [instantanea]" por escenario; se saltan las líneas vacías
+// y las que empiezan por '#'); lanza std::runtime_error si no se puede abrir
+std::vector<EscenarioLote> leerManifiesto(const std::string& ruta);
+
+// Construye las pirámides de varios escenarios de la misma malla, varios a la vez, con la geometría y un pool de
+// memoria compartidos
+ResumenLote construirLote(const std::vector<EscenarioLote>& escenarios, const Configuracion& config,
+                          int escenarios_simultaneos, std::size_t pool_maximo_mb = 0);
+
+#endif // LOTE_H
@@ -1,6 +1,51 @@
 #include "piramide.h"
 
-int main() {
-    Piramide piramide;
+#include <cstdlib>
+
+/**
+ * @brief Construye la Pirámide de un archivo CSV.
+ * 
+ * Uso: piramide [archivo.csv] [filas columnas [memoria_mb [metricas.json|metricas.csv [instantanea [regiones
+ *        [etiquetas]]]]]]
+ * 
+ * Sin dimensiones se usan las de la configuración por defecto; con "0 0" se toman de la caché de la base.
+ * Con memoria_mb, la pirámide se construye por teselas en disco si no cabe en esa memoria (0 = sin límite).
+ * Con un archivo de métricas, se guarda en él el informe de tiempos y nodos de cada fase y nivel ("" = sin informe).
+ * Con una instantánea, la pirámide construida se guarda en ella para cargarla después sin reconstruirla ("" = sin
+ * instantánea). Con un archivo de regiones, se guarda en él la tabla de estadísticas de cada región, en CSV si
+ * termina en ".csv" y si no en binario. Con un archivo de etiquetas, se exporta en él la región de cada celda de la
+ * base: por tramos si termina en ".rle", en CSV si termina en ".csv" y si no en binario sin cabecera.
+ */
+int main(int argc, char* argv[]) {
+    Configuracion config;
+    if (argc > 1) {
+        config.archivo_csv = argv[1];
+    }
+    if (argc > 3) {
+        config.num_filas = std::atoi(argv[2]);
+        config.num_columnas = std::atoi(argv[3]);
+    }
+    if (argc > 4) {
+        config.memoria_maxima_mb = static_cast<std::size_t>(std::atoll(argv[4]));
+    }
+    if (argc > 5) {
+        config.archivo_metricas = argv[5];
+    }
+    if (argc > 6) {
+        config.archivo_instantanea = argv[6];
+    }
+    if (argc > 7) {
+        config.archivo_regiones = argv[7];
+    }
+    if (argc > 8) {
+        config.archivo_etiquetas = argv[8];
+    }
+
+    try {
+        Piramide piramide(config);
+    } catch (const std::exception& error) {
+        std::cerr << error.what() << std::endl;
+        return 1;
+    }
     return 0;
 }
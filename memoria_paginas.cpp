@@ -0,0 +1,90 @@
+#include "memoria_paginas.h"
+
+#include <sys/mman.h>
+
+#include <atomic>
+#include <cstdint>
+#include <new>
+
+namespace {
+
+// Bytes reservados con mmap desde el comienzo del programa
+std::atomic<std::size_t> bytes_proyectados{0};
+
+/**
+ * @brief Reserva memoria anónima alineada a página grande y pide al sistema páginas grandes transparentes.
+ * 
+ * Se reserva una página grande de más para poder alinear el comienzo; lo que sobra por delante y por detrás se
+ * devuelve. Las páginas no se tocan: se asignan al escribirlas por primera vez, en el nodo NUMA del hilo que las
+ * escribe.
+ * 
+ * @param bytes Tamaño, ya redondeado a páginas grandes.
+ * @return Comienzo del bloque, o nullptr si mmap falla.
+ */
+void* proyectarTransparentes(std::size_t bytes) {
+    std::size_t tam = bytes + BYTES_PAGINA_GRANDE;
+    void* proyeccion = ::mmap(nullptr, tam, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (proyeccion == MAP_FAILED) {
+        return nullptr;
+    }
+    uintptr_t inicio = reinterpret_cast<uintptr_t>(proyeccion);
+    uintptr_t alineado = (inicio + BYTES_PAGINA_GRANDE - 1) & ~(BYTES_PAGINA_GRANDE - 1);
+    if (alineado > inicio) {
+        ::munmap(proyeccion, alineado - inicio);
+    }
+    std::size_t sobrante = inicio + tam - (alineado + bytes);
+    if (sobrante > 0) {
+        ::munmap(reinterpret_cast<void*>(alineado + bytes), sobrante);
+    }
+#ifdef MADV_HUGEPAGE
+    ::madvise(reinterpret_cast<void*>(alineado), bytes, MADV_HUGEPAGE);
+#endif
+    return reinterpret_cast<void*>(alineado);
+}
+
+} // namespace
+
+/**
+ * @brief Reserva un bloque de memoria sin inicializar con el tamaño de página pedido.
+ * 
+ * Los bloques de menos de una página grande, y todos con PaginasGrandes::No, se piden con new. Los demás se
+ * proyectan en memoria anónima redondeada a páginas grandes: explícitas (MAP_HUGETLB) si se piden y el sistema
+ * tiene páginas reservadas, y si no transparentes (ver proyectarTransparentes). En los sistemas sin páginas
+ * grandes, madvise no tiene efecto y el bloque usa páginas normales.
+ * 
+ * @param bytes Tamaño del bloque, en bytes.
+ * @param paginas Tamaño de página pedido.
+ * @return Bloque (con al menos la alineación de new), que se libera al liberar el último shared_ptr.
+ */
+std::shared_ptr<void> reservarPaginas(std::size_t bytes, PaginasGrandes paginas) {
+    if (paginas == PaginasGrandes::No || bytes < BYTES_PAGINA_GRANDE) {
+        void* bloque = ::operator new(bytes);
+        return std::shared_ptr<void>(bloque, [](void* liberado) { ::operator delete(liberado); });
+    }
+
+    std::size_t tam = (bytes + BYTES_PAGINA_GRANDE - 1) & ~(BYTES_PAGINA_GRANDE - 1);
+    void* bloque = nullptr;
+#ifdef MAP_HUGETLB
+    if (paginas == PaginasGrandes::Explicitas) {
+        bloque = ::mmap(nullptr, tam, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (bloque == MAP_FAILED) {
+            bloque = nullptr;
+        }
+    }
+#endif
+    if (bloque == nullptr) {
+        bloque = proyectarTransparentes(tam);
+    }
+    if (bloque == nullptr) {
+        throw std::bad_alloc();
+    }
+    bytes_proyectados.fetch_add(tam, std::memory_order_relaxed);
+    return std::shared_ptr<void>(bloque, [tam](void* liberado) { ::munmap(liberado, tam); });
+}
+
+/**
+ * @brief Obtiene los bytes reservados con reservarPaginas fuera de new (proyectados con mmap).
+ */
+std::size_t bytesReservadosPaginas() {
+    return bytes_proyectados.load(std::memory_order_relaxed);
+}
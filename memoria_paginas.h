@@ -0,0 +1,18 @@
+#ifndef MEMORIA_PAGINAS_H
+#define MEMORIA_PAGINAS_H
+
+#include "configuracion.h"
+
+#include <cstddef>
+#include <memory>
+
+// Tamaño de una página grande (x86-64 y ARM64 con páginas base de 4 KB)
+const std::size_t BYTES_PAGINA_GRANDE = std::size_t{2} << 20;
+
+// Reserva un bloque de memoria sin inicializar con el tamaño de página pedido (ver reservarPaginas)
+std::shared_ptr<void> reservarPaginas(std::size_t bytes, PaginasGrandes paginas);
+
+// Bytes reservados con reservarPaginas fuera de new desde el comienzo del programa
+std::size_t bytesReservadosPaginas();
+
+#endif // MEMORIA_PAGINAS_H
@@ -0,0 +1,397 @@
+#include "metricas.h"
+
+#if PIRAMIDE_METRICAS
+
+#include "memoria_paginas.h"
+
+#include <sys/resource.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <new>
+#include <stdexcept>
+#include <utility>
+
+namespace {
+
+double segundosReales() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+double segundosCPU() {
+    timespec tiempo;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &tiempo);
+    return tiempo.tv_sec + tiempo.tv_nsec * 1e-9;
+}
+
+long rssMaximoKB() {
+    struct rusage uso;
+    getrusage(RUSAGE_SELF, &uso);
+    return uso.ru_maxrss;
+}
+
+long fallosPagina() {
+    struct rusage uso;
+    getrusage(RUSAGE_SELF, &uso);
+    return uso.ru_minflt + uso.ru_majflt;
+}
+
+/**
+ * @brief Abre un contador de los fallos de la TLB de datos en lecturas del hilo actual y de los hilos que cree.
+ * 
+ * Los hilos de trabajo (ver paraleloPara) se crean dentro de cada fase, así que heredan el contador y sus fallos
+ * se suman a él al terminar. Muchos sistemas no permiten abrirlo sin privilegios (perf_event_paranoid).
+ * 
+ * @return Descriptor del contador, o -1 si no está disponible.
+ */
+int abrirContadorTLB() {
+#ifdef __linux__
+    perf_event_attr atributos = {};
+    atributos.type = PERF_TYPE_HW_CACHE;
+    atributos.size = sizeof(atributos);
+    atributos.config = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+                     | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    atributos.inherit = 1;
+    atributos.exclude_kernel = 1;
+    atributos.exclude_hv = 1;
+    return static_cast<int>(syscall(SYS_perf_event_open, &atributos, 0, -1, -1, 0));
+#else
+    return -1;
+#endif
+}
+
+/**
+ * @brief Lee y cierra un contador abierto con abrirContadorTLB.
+ * 
+ * @param contador Descriptor del contador (-1 si no hay).
+ * @return Fallos contados, o -1 si no hay contador o no se puede leer.
+ */
+long long cerrarContadorTLB(int contador) {
+    if (contador < 0) {
+        return -1;
+    }
+    long long fallos = -1;
+    if (read(contador, &fallos, sizeof(fallos)) != static_cast<ssize_t>(sizeof(fallos))) {
+        fallos = -1;
+    }
+    close(contador);
+    return fallos;
+}
+
+#if PIRAMIDE_CONTAR_MEMORIA
+
+// Contadores de los bytes pedidos con new desde el comienzo del programa. Cada hilo suma en uno (ver
+// contarBytesPedidos), para que los hilos que reservan a la vez no compitan por la misma línea de caché
+const std::size_t NUM_CONTADORES_NEW = 64;
+
+/**
+ * @brief Contador de bytes pedidos con new, en su propia línea de caché.
+ */
+struct alignas(64) ContadorBytes {
+    std::atomic<std::size_t> bytes{0};
+};
+
+ContadorBytes bytes_pedidos[NUM_CONTADORES_NEW];
+std::atomic<std::size_t> siguiente_contador{0};
+
+/**
+ * @brief Suma bytes pedidos con new al contador del hilo actual.
+ * 
+ * Cada hilo toma un contador la primera vez que reserva, por turnos; si hay más hilos que contadores, algunos
+ * comparten el suyo.
+ * 
+ * @param tam Bytes pedidos.
+ */
+void contarBytesPedidos(std::size_t tam) {
+    thread_local const std::size_t contador = siguiente_contador.fetch_add(1, std::memory_order_relaxed)
+                                              % NUM_CONTADORES_NEW;
+    bytes_pedidos[contador].bytes.fetch_add(tam, std::memory_order_relaxed);
+}
+
+/**
+ * @brief Obtiene los bytes pedidos con new por todos los hilos desde el comienzo del programa.
+ */
+std::size_t bytesPedidos() {
+    std::size_t total = 0;
+    for (const ContadorBytes& contador : bytes_pedidos) {
+        total += contador.bytes.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+/**
+ * @brief Reserva la memoria de new y cuenta los bytes pedidos.
+ * 
+ * Como el new de la biblioteca estándar, si no hay memoria llama al new_handler instalado y lo vuelve a intentar,
+ * hasta que la reserva se consigue o no hay new_handler; entonces lanza std::bad_alloc.
+ * 
+ * @param tam Bytes pedidos.
+ * @param alineacion Alineación pedida (0 = la de malloc).
+ * @return Memoria reservada, que se libera con free.
+ */
+void* reservarContando(std::size_t tam, std::size_t alineacion) {
+    contarBytesPedidos(tam);
+    if (tam == 0) {
+        tam = 1;
+    }
+    while (true) {
+        void* memoria = nullptr;
+        if (alineacion == 0) {
+            memoria = std::malloc(tam);
+        } else if (posix_memalign(&memoria, alineacion, tam) != 0) {
+            memoria = nullptr;
+        }
+        if (memoria != nullptr) {
+            return memoria;
+        }
+        std::new_handler manejador = std::get_new_handler();
+        if (manejador == nullptr) {
+            throw std::bad_alloc();
+        }
+        manejador();
+    }
+}
+
+#else
+
+/**
+ * @brief Sin PIRAMIDE_CONTAR_MEMORIA, new no se sustituye y no hay bytes pedidos que contar.
+ */
+std::size_t bytesPedidos() {
+    return 0;
+}
+
+#endif // PIRAMIDE_CONTAR_MEMORIA
+
+} // namespace
+
+#if PIRAMIDE_CONTAR_MEMORIA
+
+// Con PIRAMIDE_CONTAR_MEMORIA, new cuenta los bytes que se piden. Se sustituyen las formas simple y alineada; las
+// de arrays y las nothrow no, porque por defecto llaman a estas y así también se cuentan
+void* operator new(std::size_t tam) {
+    return reservarContando(tam, 0);
+}
+
+void* operator new(std::size_t tam, std::align_val_t alineacion) {
+    return reservarContando(tam, static_cast<std::size_t>(alineacion));
+}
+
+void operator delete(void* memoria) noexcept {
+    std::free(memoria);
+}
+
+void operator delete(void* memoria, std::size_t) noexcept {
+    std::free(memoria);
+}
+
+void operator delete(void* memoria, std::align_val_t) noexcept {
+    std::free(memoria);
+}
+
+void operator delete(void* memoria, std::size_t, std::align_val_t) noexcept {
+    std::free(memoria);
+}
+
+#endif // PIRAMIDE_CONTAR_MEMORIA
+
+/**
+ * @brief Empieza a medir el tiempo dedicado a un nivel.
+ * 
+ * @param metricas Registro en el que se anota el tiempo.
+ * @param nivel Nivel medido.
+ */
+Metricas::MedidaNivel::MedidaNivel(Metricas& metricas, int nivel)
+    : metricas{metricas}, nivel{nivel}, inicio{segundosReales()}, inicio_cpu{segundosCPU()} {}
+
+/**
+ * @brief Suma al nivel el tiempo transcurrido desde que se creó la medida.
+ */
+Metricas::MedidaNivel::~MedidaNivel() {
+    MetricasNivel& metricas_nivel = metricas.nivelActual(nivel);
+    metricas_nivel.segundos += segundosReales() - inicio;
+    metricas_nivel.segundos_cpu += segundosCPU() - inicio_cpu;
+}
+
+/**
+ * @brief Destructor: cierra el contador de la fase abierta, si la hay.
+ */
+Metricas::~Metricas() {
+    cerrarContadorTLB(contador_tlb);
+}
+
+/**
+ * @brief Abre una fase de la construcción.
+ * 
+ * @param nombre Nombre de la fase.
+ */
+void Metricas::iniciarFase(const char* nombre) {
+    actual = MetricasFase();
+    actual.nombre = nombre;
+    bytes_inicio = bytesPedidos() + bytesReservadosPaginas();
+    fallos_inicio = fallosPagina();
+    cerrarContadorTLB(contador_tlb);
+    contador_tlb = abrirContadorTLB();
+    inicio = segundosReales();
+    inicio_cpu = segundosCPU();
+}
+
+/**
+ * @brief Cierra la fase abierta y la añade a las fases registradas.
+ * 
+ * Anota el tiempo total, la memoria y, para cada nivel, los nodos homogéneos y los fusionados en un padre. Contar
+ * los nodos recorre todos los niveles, por lo que el tiempo de la fase se toma antes.
+ * 
+ * @param niveles Niveles de la pirámide al terminar la fase.
+ * @param contar_nodos Si es falso, no se cuentan los nodos (por ejemplo, para no traer a memoria niveles en disco).
+ */
+void Metricas::terminarFase(const std::vector<Nivel>& niveles, bool contar_nodos) {
+    actual.segundos = segundosReales() - inicio;
+    actual.segundos_cpu = segundosCPU() - inicio_cpu;
+    actual.bytes_reservados = bytesPedidos() + bytesReservadosPaginas() - bytes_inicio;
+    actual.rss_maximo_kb = rssMaximoKB();
+    actual.fallos_pagina = fallosPagina() - fallos_inicio;
+    actual.fallos_tlb = cerrarContadorTLB(contador_tlb);
+    contador_tlb = -1;
+
+    actual.niveles.resize(std::max(actual.niveles.size(), niveles.size()));
+    for (std::size_t n = 0; n < niveles.size(); n++) {
+        const Nivel& nivel = niveles[n];
+        MetricasNivel& metricas_nivel = actual.niveles[n];
+        actual.nodos_visitados += metricas_nivel.nodos_visitados;
+        if (!contar_nodos || nivel.homog.size() == 0) {
+            continue;
+        }
+        // Se recorren las columnas por posición: en un nivel disperso, el centinela está vacío
+        std::size_t homogeneos = 0, fusionados = 0;
+        for (std::size_t p = 0; p < nivel.homog.size(); p++) {
+            homogeneos += nivel.homog[p] == 1;
+            fusionados += nivel.homog[p] != -1 && nivel.padre[p] != -1;
+        }
+        metricas_nivel.homogeneos = homogeneos;
+        metricas_nivel.fusionados = fusionados;
+    }
+    registradas.push_back(std::move(actual));
+}
+
+/**
+ * @brief Anota nodos recorridos por la fase abierta.
+ * 
+ * @param nivel Nivel de los nodos.
+ * @param nodos Número de nodos.
+ */
+void Metricas::anotarVisitas(int nivel, std::size_t nodos) {
+    nivelActual(nivel).nodos_visitados += nodos;
+}
+
+/**
+ * @brief Obtiene las métricas de un nivel en la fase abierta, añadiendo los niveles que falten.
+ * 
+ * @param nivel Nivel.
+ * @return Métricas del nivel.
+ */
+MetricasNivel& Metricas::nivelActual(int nivel) {
+    if (static_cast<std::size_t>(nivel) >= actual.niveles.size()) {
+        actual.niveles.resize(nivel + 1);
+    }
+    return actual.niveles[nivel];
+}
+
+/**
+ * @brief Anota una pasada completa de la fase abierta por la pirámide.
+ */
+void Metricas::anotarIteracion() {
+    actual.iteraciones++;
+}
+
+/**
+ * @brief Anota bytes escritos por la fase abierta en un archivo de salida.
+ * 
+ * @param bytes Número de bytes.
+ */
+void Metricas::anotarBytesEscritos(std::size_t bytes) {
+    actual.bytes_escritos += bytes;
+}
+
+/**
+ * @brief Escribe las métricas en JSON: una lista de fases, cada una con la lista de sus niveles.
+ * 
+ * @param salida Flujo de salida.
+ */
+void Metricas::escribirJSON(std::ostream& salida) const {
+    salida << std::setprecision(6) << std::fixed;
+    salida << "{\n  \"fases\": [\n";
+    for (std::size_t f = 0; f < registradas.size(); f++) {
+        const MetricasFase& fase = registradas[f];
+        salida << "    {\"nombre\": \"" << fase.nombre << "\", \"segundos\": " << fase.segundos
+               << ", \"segundos_cpu\": " << fase.segundos_cpu << ", \"nodos_visitados\": " << fase.nodos_visitados
+               << ", \"iteraciones\": " << fase.iteraciones << ", \"rss_maximo_kb\": " << fase.rss_maximo_kb
+               << ", \"bytes_reservados\": " << fase.bytes_reservados << ", \"fallos_pagina\": " << fase.fallos_pagina
+               << ", \"fallos_tlb\": " << fase.fallos_tlb << ", \"bytes_escritos\": " << fase.bytes_escritos
+               << ",\n     \"niveles\": [\n";
+        for (std::size_t n = 0; n < fase.niveles.size(); n++) {
+            const MetricasNivel& nivel = fase.niveles[n];
+            salida << "       {\"nivel\": " << n << ", \"segundos\": " << nivel.segundos
+                   << ", \"segundos_cpu\": " << nivel.segundos_cpu << ", \"nodos_visitados\": " << nivel.nodos_visitados
+                   << ", \"homogeneos\": " << nivel.homogeneos << ", \"fusionados\": " << nivel.fusionados << "}"
+                   << (n + 1 < fase.niveles.size() ? "," : "") << "\n";
+        }
+        salida << "     ]}" << (f + 1 < registradas.size() ? "," : "") << "\n";
+    }
+    salida << "  ]\n}\n";
+}
+
+/**
+ * @brief Escribe las métricas en CSV: una fila por fase y nivel, y una fila con el total de cada fase (nivel "total").
+ * 
+ * @param salida Flujo de salida.
+ */
+void Metricas::escribirCSV(std::ostream& salida) const {
+    salida << std::setprecision(6) << std::fixed;
+    salida << "fase,nivel,segundos,segundos_cpu,nodos_visitados,homogeneos,fusionados,iteraciones,rss_maximo_kb,"
+              "bytes_reservados,fallos_pagina,fallos_tlb,bytes_escritos\n";
+    for (const MetricasFase& fase : registradas) {
+        for (std::size_t n = 0; n < fase.niveles.size(); n++) {
+            const MetricasNivel& nivel = fase.niveles[n];
+            salida << fase.nombre << "," << n << "," << nivel.segundos << "," << nivel.segundos_cpu << ","
+                   << nivel.nodos_visitados << "," << nivel.homogeneos << "," << nivel.fusionados << ",,,,,,\n";
+        }
+        salida << fase.nombre << ",total," << fase.segundos << "," << fase.segundos_cpu << ","
+               << fase.nodos_visitados << ",,," << fase.iteraciones << "," << fase.rss_maximo_kb << ","
+               << fase.bytes_reservados << "," << fase.fallos_pagina << "," << fase.fallos_tlb << ","
+               << fase.bytes_escritos << "\n";
+    }
+}
+
+/**
+ * @brief Guarda el informe de las métricas en un archivo.
+ * 
+ * @param ruta Ruta del informe; si termina en ".csv" se escribe en CSV y, si no, en JSON.
+ */
+void Metricas::guardar(const std::string& ruta) const {
+    std::ofstream archivo(ruta);
+    if (!archivo) {
+        throw std::runtime_error("Error: no se pudo crear el informe de metricas " + ruta + ".");
+    }
+    const std::string extension = ".csv";
+    if (ruta.size() >= extension.size() && ruta.compare(ruta.size() - extension.size(), extension.size(), extension) == 0) {
+        escribirCSV(archivo);
+    } else {
+        escribirJSON(archivo);
+    }
+    if (!archivo) {
+        throw std::runtime_error("Error: no se pudo escribir el informe de metricas " + ruta + ".");
+    }
+}
+
+#endif // PIRAMIDE_METRICAS
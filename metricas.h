@@ -0,0 +1,170 @@
+#ifndef METRICAS_H
+#define METRICAS_H
+
+#include "nivel.h"
+
+#include <chrono>
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Con PIRAMIDE_METRICAS = 0 (compilando con -DPIRAMIDE_METRICAS=0), las métricas no se registran y todas las
+// llamadas a Metricas se quedan en funciones vacías que el compilador elimina
+#ifndef PIRAMIDE_METRICAS
+#define PIRAMIDE_METRICAS 1
+#endif
+
+// Con PIRAMIDE_CONTAR_MEMORIA = 1 (compilando con -DPIRAMIDE_CONTAR_MEMORIA=1 y las métricas activadas), metricas.cpp
+// sustituye el operator new global para contar los bytes que se piden en cada fase. Por defecto no se sustituye, para
+// no cambiar el reparto de memoria de los programas que enlazan la Pirámide; solo se cuentan las columnas en páginas
+// grandes
+#ifndef PIRAMIDE_CONTAR_MEMORIA
+#define PIRAMIDE_CONTAR_MEMORIA 0
+#endif
+
+/**
+ * @brief Métricas de un nivel durante una fase de la construcción.
+ */
+struct MetricasNivel {
+    // Tiempo real y de CPU (de todos los hilos) dedicado al nivel
+    double segundos = 0;
+    double segundos_cpu = 0;
+    // Nodos recorridos por la fase en el nivel
+    std::size_t nodos_visitados = 0;
+    // Estado del nivel al terminar la fase: nodos homogéneos y nodos fusionados en un padre
+    std::size_t homogeneos = 0;
+    std::size_t fusionados = 0;
+};
+
+/**
+ * @brief Métricas de una fase de la construcción (init, purga, enlaza o clasifica) o de la exportación.
+ */
+struct MetricasFase {
+    std::string nombre;
+    double segundos = 0;
+    double segundos_cpu = 0;
+    // Suma de los nodos visitados en todos los niveles
+    std::size_t nodos_visitados = 0;
+    // Pasadas completas por la pirámide (las de enlaza)
+    std::size_t iteraciones = 0;
+    // Máximo de memoria residente del proceso al terminar la fase, en KB
+    long rss_maximo_kb = 0;
+    // Bytes reservados para las columnas en páginas grandes durante la fase, más los pedidos con new si se compila
+    // con PIRAMIDE_CONTAR_MEMORIA = 1 (no incluye los archivos proyectados en memoria)
+    std::size_t bytes_reservados = 0;
+    // Fallos de página del proceso durante la fase y fallos de la TLB de datos en las lecturas de sus hilos
+    // (-1 si el sistema no da acceso al contador, ver perf_event_open)
+    long fallos_pagina = 0;
+    long long fallos_tlb = -1;
+    // Bytes escritos en archivos de salida durante la fase (los de la exportación de etiquetas)
+    std::size_t bytes_escritos = 0;
+    std::vector<MetricasNivel> niveles;
+};
+
+/**
+ * @brief Segundos transcurridos desde un instante del reloj monótono.
+ */
+inline double segundosDesde(std::chrono::steady_clock::time_point inicio) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - inicio).count();
+}
+
+#if PIRAMIDE_METRICAS
+
+/**
+ * @brief Registro de las métricas de la construcción de la Pirámide, por fase y por nivel.
+ * 
+ * Cada fase se abre con iniciarFase y se cierra con terminarFase, que anota el tiempo, la memoria y el estado de
+ * cada nivel. Dentro de la fase, medirNivel mide el tiempo dedicado a un nivel y anotarVisitas los nodos que se
+ * recorren. Las métricas se consultan con fases() o se guardan en un informe JSON o CSV.
+ */
+class Metricas {
+public:
+    Metricas() = default;
+    ~Metricas();
+    Metricas(const Metricas&) = delete;
+    Metricas& operator=(const Metricas&) = delete;
+
+    /**
+     * @brief Mide el tiempo de un nivel mientras existe el objeto.
+     */
+    class MedidaNivel {
+    public:
+        MedidaNivel(Metricas& metricas, int nivel);
+        ~MedidaNivel();
+        MedidaNivel(const MedidaNivel&) = delete;
+        MedidaNivel& operator=(const MedidaNivel&) = delete;
+
+    private:
+        Metricas& metricas;
+        int nivel;
+        double inicio, inicio_cpu;
+    };
+
+    // Abre una fase
+    void iniciarFase(const char* nombre);
+    // Cierra la fase abierta, anotando el estado de los niveles si contar_nodos es verdadero
+    void terminarFase(const std::vector<Nivel>& niveles, bool contar_nodos = true);
+
+    // Mide el tiempo dedicado a un nivel hasta el final del ámbito
+    MedidaNivel medirNivel(int nivel) { return MedidaNivel(*this, nivel); }
+    // Anota nodos recorridos en un nivel
+    void anotarVisitas(int nivel, std::size_t nodos);
+    // Anota una pasada completa por la pirámide
+    void anotarIteracion();
+    // Anota bytes escritos en un archivo de salida
+    void anotarBytesEscritos(std::size_t bytes);
+
+    // Métricas de las fases terminadas
+    const std::vector<MetricasFase>& fases() const { return registradas; }
+    void clear() { registradas.clear(); }
+
+    // Informe de las métricas
+    void escribirJSON(std::ostream& salida) const;
+    void escribirCSV(std::ostream& salida) const;
+    // Guarda el informe en JSON, o en CSV si la ruta termina en ".csv"; lanza std::runtime_error si falla
+    void guardar(const std::string& ruta) const;
+
+private:
+    // Métricas del nivel en la fase abierta
+    MetricasNivel& nivelActual(int nivel);
+
+    std::vector<MetricasFase> registradas;
+    MetricasFase actual;
+    double inicio = 0, inicio_cpu = 0;
+    std::size_t bytes_inicio = 0;
+    long fallos_inicio = 0;
+    // Descriptor del contador de fallos de la TLB de la fase abierta (-1 si no hay)
+    int contador_tlb = -1;
+};
+
+#else
+
+/**
+ * @brief Versión vacía de Metricas, con las métricas desactivadas (PIRAMIDE_METRICAS = 0).
+ */
+class Metricas {
+public:
+    struct MedidaNivel {
+        ~MedidaNivel() {}
+    };
+
+    void iniciarFase(const char*) {}
+    void terminarFase(const std::vector<Nivel>&, bool = true) {}
+    MedidaNivel medirNivel(int) { return MedidaNivel(); }
+    void anotarVisitas(int, std::size_t) {}
+    void anotarIteracion() {}
+    void anotarBytesEscritos(std::size_t) {}
+    const std::vector<MetricasFase>& fases() const { return registradas; }
+    void clear() {}
+    void escribirJSON(std::ostream&) const {}
+    void escribirCSV(std::ostream&) const {}
+    void guardar(const std::string&) const {}
+
+private:
+    std::vector<MetricasFase> registradas;
+};
+
+#endif // PIRAMIDE_METRICAS
+
+#endif // METRICAS_H
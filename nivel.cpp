@@ -0,0 +1,531 @@
+#include "nivel.h"
+#include "paralelo.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+/**
+ * @brief Constructor de la clase Nivel.
+ * 
+ * Solo establece la forma del nivel. Las columnas se reservan con reservar() o se proyectan
+ * desde otra memoria (por ejemplo, la caché binaria de la base).
+ * 
+ * @param nivel Número de nivel dentro de la Pirámide.
+ * @param num_filas Número de filas del nivel.
+ * @param num_columnas Número de columnas del nivel.
+ * @param id_base Identificador del primer nodo del nivel.
+ */
+Nivel::Nivel(int nivel, int num_filas, int num_columnas, int id_base)
+    : nivel{nivel}, num_filas{num_filas}, num_columnas{num_columnas}, id_base{id_base} {}
+
+/**
+ * @brief Reserva las columnas del nivel.
+ * 
+ * Reserva una columna contigua por atributo con tantos elementos como nodos tiene el nivel,
+ * inicializados a -1 (nodo vacío y huérfano). Si el nivel era disperso, vuelve a ser denso. La columna de
+ * regiones y las listas de hijos se liberan: se vuelven a crear al enlazar y al clasificar.
+ * 
+ * Las columnas se reservan sin inicializar y se vacían por bandas de filas repartidas entre los hilos (ver
+ * vaciarFilas). Con las mismas bandas que después construyen los hilos, en un sistema NUMA cada banda queda en la
+ * memoria del nodo de uno de los hilos que la recorren (política de primer toque del sistema), en lugar de toda en
+ * la del hilo principal; en los sistemas sin NUMA solo reparte el coste de los fallos de página.
+ * 
+ * @param num_hilos Número de hilos que inicializan las columnas (0 = todos los núcleos disponibles).
+ * @param filas_banda Filas de cada banda (0 = todo el nivel en una banda).
+ */
+void Nivel::reservar(int num_hilos, int filas_banda) {
+    disperso = false;
+    ocupadas = Columna<uint64_t>();
+    rangos = Columna<uint32_t>();
+    std::size_t n = size();
+    homog.reservarSinIniciar(n, pool.get(), paginas);
+    area.reservarSinIniciar(n, pool.get(), paginas);
+    padre.reservarSinIniciar(n, pool.get(), paginas);
+    clase.reservarSinIniciar(n, pool.get(), paginas);
+    estaciones.reservarSinIniciar(n, pool.get(), paginas);
+    region = Columna<uint32_t>();
+    inicio_hijos = Columna<uint32_t>();
+    hijos = Columna<uint32_t>();
+
+    filas_banda = filas_banda > 0 ? filas_banda : std::max(num_filas, 1);
+    std::size_t num_bandas = static_cast<std::size_t>((num_filas + filas_banda - 1) / filas_banda);
+    paraleloPara(num_hilos, num_bandas, [&](std::size_t banda) {
+        int fila_inicio = static_cast<int>(banda) * filas_banda;
+        vaciarFilas(fila_inicio, std::min(fila_inicio + filas_banda, num_filas));
+    });
+}
+
+/**
+ * @brief Vacía los nodos de un tramo de filas.
+ * 
+ * Da a los nodos de las filas indicadas los mismos valores que reservar(), sin reservar las columnas: sirve
+ * para inicializar por partes columnas proyectadas en otra memoria (ver proyectarNivelesEnDisco).
+ * 
+ * @param fila_inicio Primera fila.
+ * @param fila_fin Fila siguiente a la última.
+ */
+void Nivel::vaciarFilas(int fila_inicio, int fila_fin) {
+    std::size_t desde = indice(fila_inicio, 0);
+    std::size_t hasta = indice(fila_fin, 0);
+    std::fill(homog.begin() + desde, homog.begin() + hasta, int8_t{-1});
+    std::fill(area.begin() + desde, area.begin() + hasta, -1);
+    std::fill(padre.begin() + desde, padre.begin() + hasta, -1);
+    std::fill(clase.begin() + desde, clase.begin() + hasta, CLASE_VACIA);
+    std::fill(estaciones.begin() + desde, estaciones.begin() + hasta, -1);
+}
+
+/**
+ * @brief Reserva la columna de regiones del nivel.
+ * 
+ * Tiene tantas posiciones como las demás columnas (en un nivel disperso, los nodos empaquetados y el centinela),
+ * todas con REGION_VACIA. Debe llamarse después de compactar el nivel.
+ */
+void Nivel::reservarRegiones() {
+    region.assign(homog.size(), REGION_VACIA, pool.get(), paginas);
+}
+
+/**
+ * @brief Construye las listas de hijos de los nodos del nivel en forma CSR (compressed sparse row).
+ * 
+ * Recorre una vez los nodos no vacíos del nivel inferior para contar los hijos de cada padre, acumula las
+ * cuentas en inicio_hijos y vuelve a recorrerlos para colocar cada hijo en el tramo de su padre. Los hijos de
+ * cada nodo quedan en orden fila-mayor. Como inicio_hijos se indexa por posición, un nivel disperso solo tiene
+ * listas para sus nodos no vacíos (y el centinela, sin hijos). Las columnas son arrays planos de enteros de
+ * 32 bits, así que se pueden guardar en disco tal cual.
+ * 
+ * @param inferior Nivel inferior, con los enlaces con el padre ya definitivos.
+ */
+void Nivel::construirHijos(const Nivel& inferior) {
+    if (inferior.size() > UINT32_MAX) {
+        throw std::runtime_error("Error: el nivel " + std::to_string(inferior.nivel)
+                                 + " tiene demasiados nodos para las listas de hijos.");
+    }
+    std::size_t num_posiciones = homog.size();
+    inicio_hijos.assign(num_posiciones + 1, 0, pool.get(), paginas);
+
+    // Contar los hijos de cada padre en la posición siguiente a la suya y acumular
+    inferior.recorrerTramo(0, inferior.size(), [&](std::size_t, std::size_t p) {
+        if (inferior.padre[p] != -1) {
+            inicio_hijos[posicion(static_cast<std::size_t>(inferior.padre[p])) + 1]++;
+        }
+    });
+    for (std::size_t p = 0; p < num_posiciones; p++) {
+        inicio_hijos[p + 1] += inicio_hijos[p];
+    }
+
+    // Colocar los hijos: inicio_hijos[p] avanza hasta el comienzo de p + 1, así que después se desplaza
+    hijos.assign(inicio_hijos[num_posiciones], 0, pool.get(), paginas);
+    inferior.recorrerTramo(0, inferior.size(), [&](std::size_t k, std::size_t p) {
+        if (inferior.padre[p] != -1) {
+            hijos[inicio_hijos[posicion(static_cast<std::size_t>(inferior.padre[p]))]++] = static_cast<uint32_t>(k);
+        }
+    });
+    for (std::size_t p = num_posiciones; p > 0; p--) {
+        inicio_hijos[p] = inicio_hijos[p - 1];
+    }
+    inicio_hijos[0] = 0;
+}
+
+/**
+ * @brief Vuelve a calcular las listas de hijos de algunos nodos, tras cambiar enlaces del nivel inferior.
+ * 
+ * Los hijos de un nodo están en el bloque de 4x4 nodos del nivel inferior centrado en sus hijos naturales (ver
+ * recorrerBloqueHijos), así que cada lista nueva se obtiene mirando 16 nodos. Las demás listas no cambian: se copian
+ * por tramos en las columnas nuevas, desplazadas lo que crecen o menguan las recalculadas. Si las listas de hijos
+ * no están construidas, no hace nada.
+ * 
+ * @param inferior Nivel inferior, con los enlaces con el padre ya definitivos.
+ * @param padres Índices planos de los nodos cuyas listas han cambiado (se admiten repetidos y nodos vacíos).
+ */
+void Nivel::actualizarHijos(const Nivel& inferior, std::vector<std::size_t> padres) {
+    if (inicio_hijos.size() == 0 || padres.empty()) {
+        return;
+    }
+    std::sort(padres.begin(), padres.end());
+    padres.erase(std::unique(padres.begin(), padres.end()), padres.end());
+
+    // Listas nuevas, en orden de posición; las celdas vacías sin posición (el centinela) no tienen hijos
+    std::vector<std::size_t> posiciones;
+    std::vector<std::size_t> inicio_nuevas = {0};
+    std::vector<uint32_t> nuevas;
+    for (std::size_t k : padres) {
+        std::size_t p = posicion(k);
+        if (disperso && p == homog.size() - 1) {
+            continue;
+        }
+        inferior.recorrerBloqueHijos(fila(k), columna(k), [&](std::size_t h, std::size_t q) {
+            if (inferior.padre[q] == static_cast<int>(k)) {
+                nuevas.push_back(static_cast<uint32_t>(h));
+            }
+        });
+        posiciones.push_back(p);
+        inicio_nuevas.push_back(nuevas.size());
+    }
+
+    // Copiar las listas que no cambian y poner las nuevas en su lugar
+    std::size_t num_posiciones = homog.size();
+    std::size_t num_hijos = hijos.size();
+    for (std::size_t c = 0; c < posiciones.size(); c++) {
+        num_hijos = num_hijos - (inicio_hijos[posiciones[c] + 1] - inicio_hijos[posiciones[c]])
+                  + (inicio_nuevas[c + 1] - inicio_nuevas[c]);
+    }
+    Columna<uint32_t> nuevo_inicio;
+    Columna<uint32_t> nuevos_hijos;
+    nuevo_inicio.assign(num_posiciones + 1, 0, pool.get(), paginas);
+    nuevos_hijos.assign(num_hijos, 0, pool.get(), paginas);
+    std::size_t origen = 0;
+    std::size_t destino = 0;
+    std::size_t c = 0;
+    for (std::size_t p = 0; p <= num_posiciones; p++) {
+        nuevo_inicio[p] = static_cast<uint32_t>(destino + inicio_hijos[p] - origen);
+        if (c < posiciones.size() && posiciones[c] == p) {
+            // Tramo sin cambios hasta esta lista, y la lista nueva
+            destino = std::copy(hijos.begin() + origen, hijos.begin() + inicio_hijos[p], nuevos_hijos.begin() + destino)
+                    - nuevos_hijos.begin();
+            destino = std::copy(nuevas.begin() + inicio_nuevas[c], nuevas.begin() + inicio_nuevas[c + 1],
+                                nuevos_hijos.begin() + destino) - nuevos_hijos.begin();
+            origen = inicio_hijos[p + 1];
+            c++;
+        }
+    }
+    std::copy(hijos.begin() + origen, hijos.end(), nuevos_hijos.begin() + destino);
+    inicio_hijos = std::move(nuevo_inicio);
+    hijos = std::move(nuevos_hijos);
+}
+
+/**
+ * @brief Obtiene el número de hijos de un nodo.
+ * 
+ * @param indice Índice plano del nodo en el nivel.
+ * @return Número de hijos (0 si las listas de hijos no están construidas).
+ */
+std::size_t Nivel::numHijos(std::size_t indice) const {
+    if (inicio_hijos.size() == 0) {
+        return 0;
+    }
+    std::size_t p = posicion(indice);
+    return inicio_hijos[p + 1] - inicio_hijos[p];
+}
+
+/**
+ * @brief Obtiene un hijo de un nodo.
+ * 
+ * @param indice Índice plano del nodo en el nivel.
+ * @param i Número del hijo, menor que numHijos(indice).
+ * @return Índice plano del hijo en el nivel inferior.
+ */
+std::size_t Nivel::hijo(std::size_t indice, std::size_t i) const {
+    return hijos[inicio_hijos[posicion(indice)] + i];
+}
+
+/**
+ * @brief Obtiene el número de nodos del nivel.
+ * 
+ * @return Número de filas por número de columnas.
+ */
+std::size_t Nivel::size() const {
+    return static_cast<std::size_t>(num_filas) * static_cast<std::size_t>(num_columnas);
+}
+
+/**
+ * @brief Cuenta los nodos no vacíos del nivel.
+ * 
+ * @return Número de celdas con homog distinto de -1.
+ */
+std::size_t Nivel::numNoVacios() const {
+    std::size_t num = 0;
+    recorrerNodos([&num](std::size_t) { num++; });
+    return num;
+}
+
+/**
+ * @brief Obtiene la posición de una celda en las columnas del nivel.
+ * 
+ * En un nivel denso coincide con el índice de la celda. En uno disperso es el número de celdas
+ * ocupadas que la preceden, que se obtiene del rango de su palabra del mapa de bits más los bits
+ * activos anteriores dentro de la palabra. Todas las celdas vacías comparten la última posición
+ * (el centinela), que guarda un nodo vacío y no debe modificarse.
+ * 
+ * @param indice Índice plano de la celda.
+ * @return Posición de la celda en las columnas.
+ */
+std::size_t Nivel::posicion(std::size_t indice) const {
+    if (!disperso) {
+        return indice;
+    }
+    uint64_t palabra = ocupadas[indice >> 6];
+    uint64_t bit = uint64_t{1} << (indice & 63);
+    if ((palabra & bit) == 0) {
+        return homog.size() - 1;
+    }
+    return rangos[indice >> 6] + static_cast<std::size_t>(__builtin_popcountll(palabra & (bit - 1)));
+}
+
+/**
+ * @brief Compacta el nivel, guardando solo sus nodos no vacíos.
+ * 
+ * Construye el mapa de bits de las celdas ocupadas y el rango de cada palabra, y sustituye cada columna
+ * por otra con los nodos no vacíos en orden fila-mayor seguidos de un centinela vacío. Las columnas densas
+ * se liberan (o dejan de usar la proyección de la caché).
+ */
+void Nivel::compactar() {
+    if (disperso) {
+        return;
+    }
+    std::size_t tam = size();
+    std::size_t num_palabras = (tam + 63) / 64;
+    Columna<uint64_t> nuevas_ocupadas;
+    Columna<uint32_t> nuevos_rangos;
+    nuevas_ocupadas.assign(num_palabras, 0, pool.get(), paginas);
+    nuevos_rangos.assign(num_palabras, 0, pool.get(), paginas);
+
+    std::size_t num = 0;
+    for (std::size_t w = 0; w < num_palabras; w++) {
+        nuevos_rangos[w] = static_cast<uint32_t>(num);
+        std::size_t fin = std::min(tam, (w + 1) * 64);
+        uint64_t palabra = 0;
+        for (std::size_t k = w * 64; k < fin; k++) {
+            if (homog[k] != -1) {
+                palabra |= uint64_t{1} << (k & 63);
+            }
+        }
+        nuevas_ocupadas[w] = palabra;
+        num += static_cast<std::size_t>(__builtin_popcountll(palabra));
+    }
+
+    // Empaquetar cada columna: nodos no vacíos y, al final, el centinela
+    auto empaquetar = [&](auto& columna, auto vacio) {
+        std::decay_t<decltype(columna)> empaquetada;
+        empaquetada.assign(num + 1, vacio, pool.get(), paginas);
+        std::size_t p = 0;
+        for (std::size_t w = 0; w < num_palabras; w++) {
+            for (uint64_t palabra = nuevas_ocupadas[w]; palabra != 0; palabra &= palabra - 1) {
+                empaquetada[p++] = columna[w * 64 + static_cast<std::size_t>(__builtin_ctzll(palabra))];
+            }
+        }
+        columna = std::move(empaquetada);
+    };
+    empaquetar(homog, int8_t{-1});
+    empaquetar(area, -1);
+    empaquetar(padre, -1);
+    empaquetar(clase, CLASE_VACIA);
+    empaquetar(estaciones, -1);
+    if (region.size() > 0) {
+        empaquetar(region, REGION_VACIA);
+    }
+
+    // Las listas de hijos se indexan por posición: hay que volver a construirlas
+    inicio_hijos = Columna<uint32_t>();
+    hijos = Columna<uint32_t>();
+
+    ocupadas = std::move(nuevas_ocupadas);
+    rangos = std::move(nuevos_rangos);
+    disperso = true;
+}
+
+/**
+ * @brief Da posición en las columnas de un nivel disperso a celdas vacías, para poder escribir en ellas.
+ * 
+ * Las celdas se insertan en su lugar del orden fila-mayor con los valores de un nodo vacío (y una lista de hijos
+ * vacía), y se desplazan las posiciones siguientes: cuesta una copia de las columnas, sin recorrer las celdas
+ * vacías. En un nivel denso, y con las celdas que ya tienen posición, no hace nada.
+ * 
+ * @param indices Índices planos de las celdas (se admiten repetidos).
+ */
+void Nivel::ocupar(std::vector<std::size_t> indices) {
+    if (!disperso) {
+        return;
+    }
+    std::sort(indices.begin(), indices.end());
+    indices.erase(std::unique(indices.begin(), indices.end()), indices.end());
+    indices.erase(std::remove_if(indices.begin(), indices.end(), [this](std::size_t k) {
+        return (ocupadas[k >> 6] & (uint64_t{1} << (k & 63))) != 0;
+    }), indices.end());
+    if (indices.empty()) {
+        return;
+    }
+
+    // Posición actual delante de la que se inserta cada celda
+    std::vector<std::size_t> destinos(indices.size());
+    for (std::size_t i = 0; i < indices.size(); i++) {
+        uint64_t bit = uint64_t{1} << (indices[i] & 63);
+        destinos[i] = rangos[indices[i] >> 6]
+                    + static_cast<std::size_t>(__builtin_popcountll(ocupadas[indices[i] >> 6] & (bit - 1)));
+    }
+
+    // Insertar en cada columna un valor vacío o, en inicio_hijos, el comienzo de la lista siguiente
+    auto insertar = [&](auto& columna, auto vacio, bool repetir_siguiente) {
+        std::decay_t<decltype(columna)> nueva;
+        nueva.assign(columna.size() + indices.size(), vacio, pool.get(), paginas);
+        std::size_t origen = 0;
+        auto destino = nueva.begin();
+        for (std::size_t d : destinos) {
+            destino = std::copy(columna.begin() + origen, columna.begin() + d, destino);
+            if (repetir_siguiente) {
+                *destino = columna[d];
+            }
+            destino++;
+            origen = d;
+        }
+        std::copy(columna.begin() + origen, columna.end(), destino);
+        columna = std::move(nueva);
+    };
+    insertar(homog, int8_t{-1}, false);
+    insertar(area, -1, false);
+    insertar(padre, -1, false);
+    insertar(clase, CLASE_VACIA, false);
+    insertar(estaciones, -1, false);
+    if (region.size() > 0) {
+        insertar(region, REGION_VACIA, false);
+    }
+    if (inicio_hijos.size() > 0) {
+        insertar(inicio_hijos, uint32_t{0}, true);
+    }
+
+    for (std::size_t k : indices) {
+        ocupadas[k >> 6] |= uint64_t{1} << (k & 63);
+    }
+    for (std::size_t w = (indices[0] >> 6) + 1; w < rangos.size(); w++) {
+        rangos[w] = rangos[w - 1] + static_cast<uint32_t>(__builtin_popcountll(ocupadas[w - 1]));
+    }
+}
+
+/**
+ * @brief Comprueba que los tamaños de las columnas son coherentes con la forma del nivel.
+ * 
+ * Las columnas de atributos tienen una posición por celda (denso) o por nodo empaquetado más el centinela
+ * (disperso), la región tiene esas mismas posiciones o ninguna, las listas de hijos una más o ninguna, y el mapa
+ * de bits de un nivel disperso una palabra por cada 64 celdas. Sirve para validar columnas proyectadas desde un
+ * archivo antes de usarlas.
+ * 
+ * @return Verdadero si las columnas son coherentes.
+ */
+bool Nivel::columnasValidas() const {
+    std::size_t posiciones = homog.size();
+    std::size_t num_palabras = (size() + 63) / 64;
+    if (area.size() != posiciones || padre.size() != posiciones || clase.size() != posiciones
+        || estaciones.size() != posiciones) {
+        return false;
+    }
+    if (disperso ? (posiciones == 0 || ocupadas.size() != num_palabras || rangos.size() != num_palabras)
+                 : (posiciones != size() || ocupadas.size() != 0 || rangos.size() != 0)) {
+        return false;
+    }
+    if (disperso && rangos.size() > 0
+        && rangos[num_palabras - 1] + static_cast<std::size_t>(__builtin_popcountll(ocupadas[num_palabras - 1]))
+               != posiciones - 1) {
+        return false;
+    }
+    return (region.size() == 0 || region.size() == posiciones)
+        && (inicio_hijos.size() == 0 || (inicio_hijos.size() == posiciones + 1
+                                         && inicio_hijos[posiciones] == hijos.size()));
+}
+
+/**
+ * @brief Calcula la memoria que ocupa el nivel.
+ * 
+ * @return Bytes de las columnas y, si es disperso, del mapa de bits y los rangos.
+ */
+std::size_t Nivel::memoria() const {
+    std::size_t bytes = homog.size() * sizeof(int8_t) + area.size() * sizeof(int) + padre.size() * sizeof(int)
+                      + clase.size() * sizeof(uint32_t) + estaciones.size() * sizeof(int)
+                      + region.size() * sizeof(uint32_t) + inicio_hijos.size() * sizeof(uint32_t)
+                      + hijos.size() * sizeof(uint32_t);
+    return bytes + ocupadas.size() * sizeof(uint64_t) + rangos.size() * sizeof(uint32_t);
+}
+
+/**
+ * @brief Obtiene el índice plano de un nodo a partir de su fila y columna.
+ * 
+ * @param fila Fila del nodo en el nivel.
+ * @param columna Columna del nodo en el nivel.
+ * @return Índice del nodo en las columnas del nivel.
+ */
+std::size_t Nivel::indice(int fila, int columna) const {
+    return static_cast<std::size_t>(fila) * static_cast<std::size_t>(num_columnas) + columna;
+}
+
+/**
+ * @brief Obtiene la fila de un nodo a partir de su índice plano.
+ * 
+ * @param indice Índice del nodo en el nivel.
+ * @return Fila del nodo.
+ */
+int Nivel::fila(std::size_t indice) const {
+    return static_cast<int>(indice / num_columnas);
+}
+
+/**
+ * @brief Obtiene la columna de un nodo a partir de su índice plano.
+ * 
+ * @param indice Índice del nodo en el nivel.
+ * @return Columna del nodo.
+ */
+int Nivel::columna(std::size_t indice) const {
+    return static_cast<int>(indice % num_columnas);
+}
+
+/**
+ * @brief Verifica si el nodo está vacío.
+ * 
+ * Un nodo está vacío si nunca recibió datos o si fue eliminado por la purga; en ambos casos
+ * su atributo 'homog' vale -1.
+ * 
+ * @param indice Índice del nodo en el nivel.
+ * @return Verdadero si el nodo está vacío, falso en caso contrario.
+ */
+bool Nivel::esVacio(std::size_t indice) const {
+    return homog[posicion(indice)] == -1;
+}
+
+/**
+ * @brief Comprueba si el nivel tiene algún nodo homogéneo.
+ * 
+ * Se detiene en el primero, así que en los niveles con nodos homogéneos suele leer muy poco de la columna.
+ * 
+ * @return Verdadero si algún nodo del nivel es homogéneo.
+ */
+bool Nivel::tieneHomogeneos() const {
+    return std::find(homog.begin(), homog.end(), 1) != homog.end();
+}
+
+/**
+ * @brief Copia los atributos de suelo y umbrales de un nodo de otro nivel.
+ * 
+ * @param destino Índice del nodo que recibe los atributos.
+ * @param origen Nivel del nodo del que se copian los atributos.
+ * @param indice_origen Índice del nodo origen en su nivel.
+ */
+void Nivel::copiarAtributos(std::size_t destino, const Nivel& origen, std::size_t indice_origen) {
+    std::size_t p = posicion(destino);
+    std::size_t p_origen = origen.posicion(indice_origen);
+    clase[p] = origen.clase[p_origen];
+    estaciones[p] = origen.estaciones[p_origen];
+}
+
+/**
+ * @brief Obtiene los atributos de suelo y umbrales de un nodo a partir de su clase.
+ * 
+ * @param indice Índice del nodo en el nivel; el nodo no debe estar vacío.
+ * @return Atributos del nodo en la tabla de atributos.
+ */
+const AtributosSuelo& Nivel::atributosDe(std::size_t indice) const {
+    return (*atributos)[clase[posicion(indice)]];
+}
+
+/**
+ * @brief Reinicia el nodo indicado a sus valores predeterminados.
+ * 
+ * @param indice Índice del nodo en el nivel.
+ */
+void Nivel::reset(std::size_t indice) {
+    std::size_t p = posicion(indice);
+    homog[p] = -1;
+    area[p] = -1;
+    padre[p] = -1;
+    clase[p] = CLASE_VACIA;
+    estaciones[p] = -1;
+}
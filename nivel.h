@@ -0,0 +1,290 @@
+#ifndef NIVEL_H
+#define NIVEL_H
+
+#include "columna.h"
+#include "tabla_atributos.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Región de los nodos vacíos
+const uint32_t REGION_VACIA = UINT32_MAX;
+
+// Bytes que ocupa un nodo en un nivel denso (uno por columna)
+const std::size_t BYTES_NODO = sizeof(int8_t) + sizeof(int) + sizeof(int) + sizeof(uint32_t) + sizeof(int);
+
+/**
+ * @brief Clase Nivel que almacena los nodos de un nivel de la Pirámide por columnas.
+ * 
+ * Cada atributo de los nodos se guarda en un buffer contiguo propio (estructura de arrays),
+ * en orden fila-mayor. Cada fase de la construcción recorre solo las columnas que necesita
+ * en lugar de arrastrar el nodo completo por la caché.
+ * 
+ * Los atributos de suelo y umbrales no se guardan por nodo: cada nodo tiene la clase de su
+ * combinación de atributos en la tabla compartida por todos los niveles.
+ * 
+ * Un nivel puede ser denso (una posición de las columnas por celda) o disperso (ver compactar()):
+ * entonces solo guarda los nodos no vacíos, empaquetados en orden fila-mayor, y un mapa de bits de
+ * las celdas ocupadas. Los métodos que reciben un 'indice' esperan el índice plano de la celda en
+ * el nivel y lo traducen con posicion(); las columnas se indexan por posición.
+ */
+class Nivel {
+public:
+    // Número de nivel y dimensiones del nivel
+    int nivel, num_filas, num_columnas;
+    // Identificador del primer nodo del nivel (los ids son consecutivos en orden fila-mayor)
+    int id_base;
+
+    // Columnas de atributos, una entrada por nodo
+    Columna<int8_t> homog;
+    Columna<int> area;
+    // Índice plano del padre en el nivel superior (-1 si el nodo es huérfano)
+    Columna<int> padre;
+    // Clase de los atributos de suelo y umbrales en la tabla 'atributos' (CLASE_VACIA si el nodo está vacío)
+    Columna<uint32_t> clase;
+    Columna<int> estaciones;
+    // Región a la que pertenece cada nodo tras Piramide::clasifica (REGION_VACIA si el nodo está vacío); no forma
+    // parte de BYTES_NODO: se reserva aparte con reservarRegiones()
+    Columna<uint32_t> region;
+
+    // Hijos de cada nodo en forma CSR (ver construirHijos): los índices planos en el nivel inferior de los hijos del
+    // nodo de la posición p son hijos[inicio_hijos[p]] ... hijos[inicio_hijos[p + 1] - 1]
+    Columna<uint32_t> inicio_hijos;
+    Columna<uint32_t> hijos;
+
+    // Tabla de atributos, compartida por todos los niveles de la Pirámide
+    std::shared_ptr<TablaAtributos> atributos;
+
+    // Pool del que se toman las columnas propias del nivel (nullptr = memoria nueva en cada reserva) y tamaño de
+    // página de la memoria nueva
+    std::shared_ptr<PoolMemoria> pool;
+    PaginasGrandes paginas = PaginasGrandes::No;
+
+    // Verdadero si el nivel está compactado en forma dispersa
+    bool disperso = false;
+
+    // Constructor de la clase Nivel; las columnas se reservan aparte con reservar()
+    Nivel(int nivel, int num_filas, int num_columnas, int id_base);
+
+    // Reserva todas las columnas con los nodos vacíos (el nivel pasa a ser denso), inicializándolas en paralelo
+    // por bandas de filas
+    void reservar(int num_hilos = 1, int filas_banda = 0);
+
+    // Vacía los nodos de las filas [fila_inicio, fila_fin) de un nivel denso cuyas columnas ya existen
+    void vaciarFilas(int fila_inicio, int fila_fin);
+
+    // Reserva la columna de regiones, con una posición por posición de las demás columnas
+    void reservarRegiones();
+
+    // Construye las listas de hijos a partir de los enlaces con el padre del nivel inferior
+    void construirHijos(const Nivel& inferior);
+
+    // Vuelve a calcular las listas de hijos de los nodos dados, tras cambiar algunos enlaces del nivel inferior
+    void actualizarHijos(const Nivel& inferior, std::vector<std::size_t> padres);
+
+    // Número de hijos de un nodo e índice plano del hijo i en el nivel inferior (0 si no hay listas de hijos)
+    std::size_t numHijos(std::size_t indice) const;
+    std::size_t hijo(std::size_t indice, std::size_t i) const;
+
+    // Número de celdas del nivel
+    std::size_t size() const;
+
+    // Número de nodos no vacíos
+    std::size_t numNoVacios() const;
+
+    // Posición de una celda en las columnas (en un nivel disperso, las celdas vacías comparten el centinela)
+    std::size_t posicion(std::size_t indice) const;
+
+    // Pasa el nivel a la forma dispersa, conservando solo los nodos no vacíos
+    void compactar();
+
+    // Da posición en las columnas de un nivel disperso a celdas vacías que van a dejar de estarlo
+    void ocupar(std::vector<std::size_t> indices);
+
+    // Memoria ocupada por las columnas y el mapa de bits, en bytes
+    std::size_t memoria() const;
+
+    // Llama a funcion(indice) para cada celda no vacía, en orden fila-mayor
+    template <typename Funcion>
+    void recorrerNodos(Funcion funcion) const;
+
+    // Llama a funcion(indice, posicion) para cada celda no vacía de [desde, hasta), en orden fila-mayor
+    template <typename Funcion>
+    void recorrerTramo(std::size_t desde, std::size_t hasta, Funcion funcion) const;
+
+    // Llama a funcion(indice, posicion) para cada nodo no vacío que puede ser hijo del nodo (fila, columna) del nivel
+    // superior: el bloque de 4x4 nodos centrado en sus hijos naturales
+    template <typename Funcion>
+    void recorrerBloqueHijos(int fila, int columna, Funcion funcion) const;
+
+    // Llama a funcion(indice, posicion) para cada vecino no vacío de un nodo (arriba, izquierda, derecha y abajo)
+    template <typename Funcion>
+    void recorrerVecinos(std::size_t nodo, Funcion funcion) const;
+
+    // Conversión entre (fila, columna) e índice plano
+    std::size_t indice(int fila, int columna) const;
+    int fila(std::size_t indice) const;
+    int columna(std::size_t indice) const;
+
+    // Método para verificar si el nodo está vacío (purgado o sin datos)
+    bool esVacio(std::size_t indice) const;
+
+    // Verdadero si algún nodo del nivel es homogéneo
+    bool tieneHomogeneos() const;
+
+    // Copia los atributos de un nodo de otro nivel al nodo indicado
+    void copiarAtributos(std::size_t destino, const Nivel& origen, std::size_t indice_origen);
+
+    // Atributos de suelo y umbrales de un nodo no vacío
+    const AtributosSuelo& atributosDe(std::size_t indice) const;
+
+    // Reinicia el nodo indicado a sus valores predeterminados
+    void reset(std::size_t indice);
+
+    // Comprueba que el tamaño de cada columna corresponde a la forma del nivel
+    bool columnasValidas() const;
+
+    // Llama a funcion(nombre, columna) para cada columna guardada del nivel, incluidos el mapa de bits de un nivel
+    // disperso y las columnas vacías
+    template <typename NivelT, typename Funcion>
+    static void recorrerColumnas(NivelT& nivel, Funcion funcion);
+
+private:
+    // Forma dispersa: bit k de 'ocupadas' = celda k no vacía; rangos[w] = celdas ocupadas antes de la palabra w
+    Columna<uint64_t> ocupadas;
+    Columna<uint32_t> rangos;
+};
+
+/**
+ * @brief Recorre las celdas no vacías del nivel.
+ * 
+ * @param funcion Función a la que se pasa el índice plano de cada celda no vacía.
+ */
+template <typename Funcion>
+void Nivel::recorrerNodos(Funcion funcion) const {
+    recorrerTramo(0, size(), [&funcion](std::size_t indice, std::size_t) { funcion(indice); });
+}
+
+/**
+ * @brief Recorre las celdas no vacías de un tramo del nivel.
+ * 
+ * En un nivel denso se comprueba cada celda; en uno disperso solo se visitan los bits activos del
+ * mapa de celdas ocupadas, saltando de 64 en 64 las celdas vacías. La posición de la primera celda
+ * del tramo se obtiene de los rangos, así que recorrer un tramo no exige recorrer los anteriores y
+ * varios hilos pueden recorrer tramos distintos a la vez.
+ * 
+ * @param desde Índice plano de la primera celda del tramo.
+ * @param hasta Índice plano de la celda siguiente a la última.
+ * @param funcion Función a la que se pasan el índice plano y la posición en las columnas de cada celda no vacía.
+ */
+template <typename Funcion>
+void Nivel::recorrerTramo(std::size_t desde, std::size_t hasta, Funcion funcion) const {
+    if (!disperso) {
+        for (std::size_t k = desde; k < hasta; k++) {
+            if (homog[k] != -1) {
+                funcion(k, k);
+            }
+        }
+        return;
+    }
+    if (desde >= hasta) {
+        return;
+    }
+
+    std::size_t w_fin = (hasta + 63) / 64;
+    std::size_t p = rangos[desde / 64];
+    for (std::size_t w = desde / 64; w < w_fin; w++) {
+        uint64_t palabra = ocupadas[w];
+        // Descartar las celdas de la primera palabra anteriores al tramo, pero contarlas en la posición
+        if (w == desde / 64) {
+            uint64_t anteriores = (uint64_t{1} << (desde & 63)) - 1;
+            p += static_cast<std::size_t>(__builtin_popcountll(palabra & anteriores));
+            palabra &= ~anteriores;
+        }
+        if (w + 1 == w_fin && (hasta & 63) != 0) {
+            palabra &= (uint64_t{1} << (hasta & 63)) - 1;
+        }
+        for (; palabra != 0; palabra &= palabra - 1) {
+            // Un nodo empaquetado puede haberse vaciado después de compactar
+            if (homog[p] != -1) {
+                funcion(w * 64 + static_cast<std::size_t>(__builtin_ctzll(palabra)), p);
+            }
+            p++;
+        }
+    }
+}
+
+/**
+ * @brief Recorre los nodos que pueden ser hijos de un nodo del nivel superior.
+ * 
+ * Un nodo es candidato de los nodos del bloque de 4x4 centrado en sus hijos naturales (ver
+ * Piramide::enlazarConMejorCandidato), así que sus hijos, naturales o enlazados, están en ese bloque. Los nodos se
+ * visitan en orden fila-mayor.
+ * 
+ * @param fila Fila del nodo en el nivel superior.
+ * @param columna Columna del nodo en el nivel superior.
+ * @param funcion Función a la que se pasan el índice plano y la posición de cada nodo no vacío del bloque.
+ */
+template <typename Funcion>
+void Nivel::recorrerBloqueHijos(int fila, int columna, Funcion funcion) const {
+    for (int i = std::max(fila * 2 - 1, 0); i <= std::min(fila * 2 + 2, num_filas - 1); i++) {
+        for (int j = std::max(columna * 2 - 1, 0); j <= std::min(columna * 2 + 2, num_columnas - 1); j++) {
+            std::size_t k = indice(i, j);
+            std::size_t p = posicion(k);
+            if (homog[p] != -1) {
+                funcion(k, p);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Recorre los vecinos de un nodo que comparten un lado con él, en orden fila-mayor.
+ * 
+ * @param nodo Índice plano del nodo.
+ * @param funcion Función a la que se pasan el índice plano y la posición de cada vecino no vacío.
+ */
+template <typename Funcion>
+void Nivel::recorrerVecinos(std::size_t nodo, Funcion funcion) const {
+    const int i = fila(nodo);
+    const int j = columna(nodo);
+    const int vecinos[4][2] = {{i - 1, j}, {i, j - 1}, {i, j + 1}, {i + 1, j}};
+    for (const auto& vecino : vecinos) {
+        if (vecino[0] < 0 || vecino[0] >= num_filas || vecino[1] < 0 || vecino[1] >= num_columnas) {
+            continue;
+        }
+        std::size_t k = indice(vecino[0], vecino[1]);
+        std::size_t p = posicion(k);
+        if (homog[p] != -1) {
+            funcion(k, p);
+        }
+    }
+}
+
+/**
+ * @brief Recorre todas las columnas del nivel, con su nombre.
+ * 
+ * Sirve para guardar el nivel completo o proyectarlo desde un archivo (ver instantanea.h) sin que el código de
+ * fuera tenga que conocer la forma dispersa. El orden es fijo: atributos, región, listas de hijos y mapa de bits.
+ * 
+ * @param nivel Nivel (constante o no).
+ * @param funcion Función a la que se pasan el nombre y la columna.
+ */
+template <typename NivelT, typename Funcion>
+void Nivel::recorrerColumnas(NivelT& nivel, Funcion funcion) {
+    funcion("homog", nivel.homog);
+    funcion("area", nivel.area);
+    funcion("padre", nivel.padre);
+    funcion("clase", nivel.clase);
+    funcion("estaciones", nivel.estaciones);
+    funcion("region", nivel.region);
+    funcion("inicio_hijos", nivel.inicio_hijos);
+    funcion("hijos", nivel.hijos);
+    funcion("ocupadas", nivel.ocupadas);
+    funcion("rangos", nivel.rangos);
+}
+
+#endif // NIVEL_H
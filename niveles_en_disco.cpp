@@ -0,0 +1,94 @@
+#include "niveles_en_disco.h"
+
+#include <iostream>
+#include <type_traits>
+
+namespace {
+
+// Las columnas empiezan en múltiplos del tamaño de página para poder liberarlas por filas
+const std::size_t ALINEACION_NIVELES = 4096;
+
+std::size_t alinear(std::size_t desplazamiento) {
+    return (desplazamiento + ALINEACION_NIVELES - 1) / ALINEACION_NIVELES * ALINEACION_NIVELES;
+}
+
+/**
+ * @brief Llama a funcion(columna) para cada columna del nivel, en el orden en que se guardan en el archivo.
+ */
+template <typename Funcion>
+void recorrerColumnas(Nivel& nivel, Funcion funcion) {
+    funcion(nivel.homog);
+    funcion(nivel.area);
+    funcion(nivel.padre);
+    funcion(nivel.clase);
+    funcion(nivel.estaciones);
+}
+
+} // namespace
+
+/**
+ * @brief Proyecta los niveles inferiores de la pirámide en un archivo temporal.
+ * 
+ * Cada columna de los niveles [0, num_niveles) ocupa un tramo del archivo que empieza en un múltiplo de
+ * 4096 bytes. La proyección es compartida: el sistema escribe en disco las páginas modificadas y puede
+ * descartarlas cuando hace falta memoria, así que los niveles pueden ocupar más que la RAM. El archivo se
+ * borra al crearlo y desaparece cuando dejan de usarlo las columnas.
+ * 
+ * Las columnas se reservan sin inicializar (a cero); antes de usar cada tramo de filas hay que vaciarlo con
+ * Nivel::vaciarFilas.
+ * 
+ * @param ruta Ruta del archivo temporal.
+ * @param niveles Niveles de la pirámide, densos y sin columnas reservadas.
+ * @param num_niveles Número de niveles, desde la base, que se guardan en el archivo.
+ * @return Proyección del archivo, que las columnas mantienen viva.
+ */
+std::shared_ptr<ArchivoMapeado> proyectarNivelesEnDisco(const std::string& ruta, std::vector<Nivel>& niveles,
+                                                        int num_niveles) {
+    // Calcular el tamaño del archivo
+    std::size_t tam = 0;
+    for (int n = 0; n < num_niveles; n++) {
+        std::size_t num_nodos = niveles[n].size();
+        recorrerColumnas(niveles[n], [&](auto& columna) {
+            using T = typename std::decay_t<decltype(columna)>::value_type;
+            tam = alinear(tam + num_nodos * sizeof(T));
+        });
+    }
+    std::cout << "\t\tReservando " << (tam >> 20) << " MB para los niveles 0 a " << num_niveles - 1
+              << " en " << ruta << "..." << std::endl;
+
+    std::shared_ptr<ArchivoMapeado> archivo = ArchivoMapeado::crearTemporal(ruta, tam);
+
+    // Proyectar cada columna en su tramo
+    std::size_t desplazamiento = 0;
+    for (int n = 0; n < num_niveles; n++) {
+        Nivel& nivel = niveles[n];
+        std::size_t num_nodos = nivel.size();
+        recorrerColumnas(nivel, [&](auto& columna) {
+            using T = typename std::decay_t<decltype(columna)>::value_type;
+            columna.proyectar(reinterpret_cast<T*>(archivo->data() + desplazamiento), num_nodos, archivo);
+            desplazamiento = alinear(desplazamiento + num_nodos * sizeof(T));
+        });
+    }
+    return archivo;
+}
+
+/**
+ * @brief Devuelve al sistema la memoria de un tramo de filas de un nivel proyectado en un archivo.
+ * 
+ * Los valores no se pierden: las páginas se vuelven a leer del archivo si se usan otra vez. Se libera también
+ * la página compartida con la fila anterior, pero no la compartida con la siguiente (ver liberarPaginas).
+ * 
+ * @param nivel Nivel cuyas columnas están proyectadas en un archivo (compartido, o privado sin modificar).
+ * @param fila_inicio Primera fila.
+ * @param fila_fin Fila siguiente a la última.
+ */
+void liberarFilas(Nivel& nivel, int fila_inicio, int fila_fin) {
+    std::size_t desde = nivel.indice(fila_inicio, 0);
+    std::size_t num_nodos = nivel.indice(fila_fin, 0) - desde;
+    recorrerColumnas(nivel, [&](auto& columna) {
+        using T = typename std::decay_t<decltype(columna)>::value_type;
+        if (columna.size() == nivel.size()) {
+            liberarPaginas(columna.data() + desde, num_nodos * sizeof(T));
+        }
+    });
+}
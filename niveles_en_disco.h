@@ -0,0 +1,19 @@
+#ifndef NIVELES_EN_DISCO_H
+#define NIVELES_EN_DISCO_H
+
+#include "archivo_mapeado.h"
+#include "nivel.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+// Proyecta las columnas de los niveles [0, num_niveles) en un archivo temporal compartido; los nodos no se
+// inicializan (ver Nivel::vaciarFilas)
+std::shared_ptr<ArchivoMapeado> proyectarNivelesEnDisco(const std::string& ruta, std::vector<Nivel>& niveles,
+                                                        int num_niveles);
+
+// Devuelve al sistema las páginas de las filas [fila_inicio, fila_fin) de un nivel proyectado en un archivo
+void liberarFilas(Nivel& nivel, int fila_inicio, int fila_fin);
+
+#endif // NIVELES_EN_DISCO_H
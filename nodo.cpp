@@ -1,14 +1,50 @@
 #include "nodo.h"
 
 /**
- * @brief Constructor por defecto para la clase Nodo.
+ * @brief Constructor de la vista Nodo sobre un nodo de la Pirámide.
  * 
- * @param id Identificador del Nodo (por defecto es -1).
+ * @param niveles Niveles de la Pirámide.
+ * @param nivel Nivel del Nodo.
+ * @param indice Índice plano de la celda del Nodo en su nivel.
  */
-Nodo::Nodo(int id)
-    : id{id}, capacidad_campo_media{-1}, estaciones{-1}, pendiente_3clases{-1},
-      porosidad_media{-1}, punto_marchitez_medio{-1}, umbral_humedo{-1},
-      umbral_intermedio{-1}, umbral_seco{-1}, homog{-1}, area{-1}, padre{nullptr} {}
+Nodo::Nodo(std::vector<Nivel>& niveles, int nivel, std::size_t indice)
+    : Nodo(niveles, nivel, indice, niveles[nivel].posicion(indice)) {}
+
+/**
+ * @brief Constructor de la vista Nodo a partir de la posición de su celda en las columnas del nivel.
+ * 
+ * En un nivel disperso, la vista de una celda vacía apunta al centinela del nivel.
+ * 
+ * @param niveles Niveles de la Pirámide.
+ * @param nivel Nivel del Nodo.
+ * @param indice Índice plano de la celda del Nodo en su nivel.
+ * @param posicion Posición de la celda en las columnas del nivel.
+ */
+Nodo::Nodo(std::vector<Nivel>& niveles, int nivel, std::size_t indice, std::size_t posicion)
+    : id{niveles[nivel].homog[posicion] == -1 ? -1 : niveles[nivel].id_base + static_cast<int>(indice)},
+      nivel{nivel}, fila{niveles[nivel].fila(indice)}, columna{niveles[nivel].columna(indice)},
+      padre{niveles[nivel].padre[posicion]}, homog{niveles[nivel].homog[posicion]},
+      area{niveles[nivel].area[posicion]}, clase{niveles[nivel].clase[posicion]},
+      estaciones{niveles[nivel].estaciones[posicion]},
+      niveles{&niveles}, indice{indice} {}
+
+/**
+ * @brief Obtiene el índice plano de la celda del Nodo en su nivel.
+ * 
+ * @return Índice del Nodo.
+ */
+std::size_t Nodo::getIndice() const {
+    return indice;
+}
+
+/**
+ * @brief Obtiene los atributos de suelo y umbrales del Nodo de la tabla de atributos.
+ * 
+ * @return Atributos de la clase del Nodo; el Nodo no debe estar vacío.
+ */
+const AtributosSuelo& Nodo::atributos() const {
+    return (*niveles)[nivel].atributosDe(indice);
+}
 
 /**
  * @brief Verifica si el Nodo es homogéneo.
@@ -22,26 +58,45 @@ bool Nodo::esHomogeneo() {
 /**
  * @brief Establece el Nodo padre del Nodo actual.
  * 
- * @param nodo_padre Referencia al Nodo padre.
+ * @param nodo_padre Referencia al Nodo padre, que debe pertenecer al nivel superior.
  */
 void Nodo::setPadre(Nodo& nodo_padre) {
-    padre = &nodo_padre;
+    padre = static_cast<int>(nodo_padre.getIndice());
 }
 
 /**
  * @brief Obtiene el Nodo padre del Nodo actual.
  * 
- * @return Referencia al Nodo padre.
+ * @return Vista sobre el Nodo padre.
  */
-Nodo& Nodo::getPadre() {
-    return *padre;
+Nodo Nodo::getPadre() {
+    return Nodo(*niveles, nivel + 1, padre);
+}
+
+/**
+ * @brief Obtiene el número de hijos del Nodo.
+ * 
+ * @return Número de hijos en el nivel inferior (0 si las listas de hijos de su nivel no están construidas).
+ */
+int Nodo::numHijos() {
+    return static_cast<int>((*niveles)[nivel].numHijos(indice));
+}
+
+/**
+ * @brief Obtiene un hijo del Nodo.
+ * 
+ * @param i Número del hijo, menor que numHijos().
+ * @return Vista sobre el hijo, en el nivel inferior.
+ */
+Nodo Nodo::getHijo(int i) {
+    return Nodo(*niveles, nivel - 1, (*niveles)[nivel].hijo(indice, static_cast<std::size_t>(i)));
 }
 
 /**
  * @brief Elimina la referencia al Nodo padre.
  */
 void Nodo::parricida(){
-    padre = nullptr;
+    padre = -1;
 }
 
 /**
@@ -50,50 +105,35 @@ void Nodo::parricida(){
  * @return Verdadero si el Nodo es huérfano, falso en caso contrario.
  */
 bool Nodo::esHuerfano(){
-    return padre == nullptr;    
+    return padre == -1;
 }
 
 /**
  * @brief Verifica si el Nodo es enlazable.
  * 
+ * Un Nodo es enlazable si es homogéneo, hay un nivel por encima y no forma parte del bloque 2x2 de su padre: es
+ * huérfano o su padre no es el natural (lo enlazó Piramide::enlazarConMejorCandidato). Los hijos naturales no
+ * cambian de padre, porque el padre está formado por ellos.
+ * 
  * @return Verdadero si el Nodo es enlazable, falso en caso contrario.
  */
 bool Nodo::esEnlazable(){
-    // Falta por implementar
-    return true;
-}
-
-/**
- * @brief Verifica si el Nodo es fusionable según el área mínima.
- * 
- * @param area_min Área mínima requerida para que el Nodo sea fusionable.
- * @return Verdadero si el Nodo es fusionable, falso en caso contrario.
- */
-bool Nodo::esFusionable(int area_min){
-    //Falta por implementar
-    return true;
+    if (homog != 1 || static_cast<std::size_t>(nivel) + 1 >= niveles->size()) {
+        return false;
+    }
+    return padre == -1 || static_cast<std::size_t>(padre) != (*niveles)[nivel + 1].indice(fila / 2, columna / 2);
 }
 
 
 /**
  * @brief Reinicia los atributos del objeto Nodo a sus valores predeterminados.
  * 
- * La función reset() establece todos los atributos del objeto Nodo a sus valores 
- * predeterminados.
+ * La función reset() establece todos los atributos del objeto Nodo a sus valores
+ * predeterminados en las columnas de su nivel.
  */
 void Nodo::reset() {
+    (*niveles)[nivel].reset(indice);
     id = -1;
-    capacidad_campo_media = -1;
-    estaciones = -1;
-    pendiente_3clases = -1;
-    porosidad_media = -1;
-    punto_marchitez_medio = -1;
-    umbral_humedo = -1;
-    umbral_intermedio = -1;
-    umbral_seco = -1;
-    homog = -1;
-    area = -1;
-    padre = nullptr;
 }
 
 
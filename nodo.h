@@ -1,6 +1,8 @@
 #ifndef NODO_H
 #define NODO_H
 
+#include "nivel.h"
+
 #include <iostream>
 #include <fstream>
 #include <sstream>
@@ -9,33 +11,43 @@
 
 /**
  * @brief Clase Nodo que representa un nodo en una estructura de datos tipo Pirámide.
+ *
+ * El Nodo es una vista ligera sobre las columnas de un Nivel: sus atributos son referencias
+ * a la posición del nodo en cada columna, de modo que leerlos o modificarlos actúa
+ * directamente sobre el almacenamiento del nivel.
  */
 class Nodo {
 public:
     // Variables miembro que almacenan información relevante del nodo
+    // (id vale -1 si el nodo está vacío)
     int id, nivel, fila, columna;
-    Nodo* padre;
-    //añadir la lista de  hijos.
-    int homog;
-    int area;
-    double capacidad_campo_media;
-    int estaciones;
-    double pendiente_3clases;
-    double porosidad_media;
-    double punto_marchitez_medio;
-    double umbral_humedo;
-    double umbral_intermedio;
-    double umbral_seco;
-
-    // Constructor de la clase Nodo
-    Nodo(int id = -1);
+    // Índice del padre en el nivel superior (-1 si es huérfano)
+    int& padre;
+    int8_t& homog;
+    int& area;
+    // Clase de los atributos de suelo y umbrales (ver atributos())
+    uint32_t& clase;
+    int& estaciones;
+
+    // Constructor de la vista sobre el nodo de la celda 'indice' del nivel 'nivel'
+    Nodo(std::vector<Nivel>& niveles, int nivel, std::size_t indice);
+
+    // Método para obtener el índice plano del nodo en su nivel
+    std::size_t getIndice() const;
+
+    // Método para obtener los atributos de suelo y umbrales del nodo
+    const AtributosSuelo& atributos() const;
 
     // Método para verificar si el nodo es homogéneo
     bool esHomogeneo();
 
     // Métodos para establecer y obtener el nodo padre
     void setPadre(Nodo& nodo_padre);
-    Nodo& getPadre();
+    Nodo getPadre();
+
+    // Métodos para obtener los hijos del nodo (ver Nivel::construirHijos)
+    int numHijos();
+    Nodo getHijo(int i);
 
     // Método para liberar al nodo de su padre
     void parricida();
@@ -46,11 +58,17 @@ public:
     // Método para verificar si el nodo es enlazable
     bool esEnlazable();
 
-    // Método para verificar si el nodo es fusionable
-    bool esFusionable(int area_min);
-
     // Reinicia los valores de las variables miembro del nodo a sus valores predeterminados
     void reset();
+
+private:
+    // Constructor de la vista a partir de la posición de la celda en las columnas de su nivel
+    Nodo(std::vector<Nivel>& niveles, int nivel, std::size_t indice, std::size_t posicion);
+
+    // Niveles de la Pirámide a la que pertenece el nodo
+    std::vector<Nivel>* niveles;
+    // Índice plano de la celda del nodo en su nivel
+    std::size_t indice;
 };
 
 #endif // NODO_H
@@ -0,0 +1,456 @@
+#include "nucleo_2x2.h"
+
+#include <algorithm>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define NUCLEO_2X2_X86 1
+#endif
+
+namespace {
+
+// Padres por bloque: la máscara de un bloque cabe en un uint64_t
+const int PADRES_BLOQUE = 64;
+
+/**
+ * @brief Compacta los bits pares de x (bit 2q -> bit q).
+ */
+uint32_t compactarPares(uint32_t x) {
+    x &= 0x55555555u;
+    x = (x | (x >> 1)) & 0x33333333u;
+    x = (x | (x >> 2)) & 0x0F0F0F0Fu;
+    x = (x | (x >> 4)) & 0x00FF00FFu;
+    x = (x | (x >> 8)) & 0x0000FFFFu;
+    return x;
+}
+
+/**
+ * @brief Máscara de homogeneidad de 'num' padres sin vectorizar, a partir de 'desde'.
+ * 
+ * El bit p vale 1 si los cuatro hijos del padre p tienen homog == 1. 'sup' e 'inf' apuntan a las
+ * filas de hijos (NO NE NO NE ... / SO SE SO SE ...) del primer padre del bloque.
+ */
+uint64_t homogeneosEscalar(const int8_t* sup, const int8_t* inf, int desde, int num) {
+    uint64_t bits = 0;
+    for (int p = desde; p < num; p++) {
+        if (sup[2*p] == 1 && sup[2*p+1] == 1 && inf[2*p] == 1 && inf[2*p+1] == 1) {
+            bits |= uint64_t{1} << p;
+        }
+    }
+    return bits;
+}
+
+/**
+ * @brief Máscara de igualdad de 'num' padres sin vectorizar, a partir de 'desde'.
+ * 
+ * El bit p vale 1 si los cuatro hijos del padre p tienen la misma clase de atributos.
+ */
+uint64_t igualesEscalar(const uint32_t* sup, const uint32_t* inf, int desde, int num) {
+    uint64_t bits = 0;
+    for (int p = desde; p < num; p++) {
+        uint32_t NO = sup[2*p];
+        if (sup[2*p+1] == NO && inf[2*p] == NO && inf[2*p+1] == NO) {
+            bits |= uint64_t{1} << p;
+        }
+    }
+    return bits;
+}
+
+/**
+ * @brief Máscara de homogeneidad de un bloque de 'num' padres sin vectorizar.
+ */
+uint64_t homogeneosEscalarBloque(const int8_t* sup, const int8_t* inf, int num) {
+    return homogeneosEscalar(sup, inf, 0, num);
+}
+
+/**
+ * @brief Máscara de igualdad de un bloque de 'num' padres sin vectorizar.
+ */
+uint64_t igualesEscalarBloque(const uint32_t* sup, const uint32_t* inf, int num) {
+    return igualesEscalar(sup, inf, 0, num);
+}
+
+#ifdef NUCLEO_2X2_X86
+
+__attribute__((target("sse2")))
+uint64_t homogeneosSSE2(const int8_t* sup, const int8_t* inf, int num) {
+    const __m128i uno = _mm_set1_epi8(1);
+    uint64_t bits = 0;
+    int p = 0;
+    // 16 hijos por fila = 8 padres por iteración
+    for (; p + 8 <= num; p += 8) {
+        __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(sup + 2*p));
+        __m128i i = _mm_loadu_si128(reinterpret_cast<const __m128i*>(inf + 2*p));
+        __m128i unos = _mm_and_si128(_mm_cmpeq_epi8(s, uno), _mm_cmpeq_epi8(i, uno));
+        uint32_t m = static_cast<uint32_t>(_mm_movemask_epi8(unos));
+        bits |= static_cast<uint64_t>(compactarPares(m & (m >> 1))) << p;
+    }
+    return bits | homogeneosEscalar(sup, inf, p, num);
+}
+
+__attribute__((target("sse2")))
+uint64_t igualesSSE2(const uint32_t* sup, const uint32_t* inf, int num) {
+    uint64_t bits = 0;
+    int p = 0;
+    // 8 padres por iteración; cada registro contiene los hijos de 2 padres: [NO0 NE0 NO1 NE1]
+    for (; p + 8 <= num; p += 8) {
+        uint32_t m = 0;
+        for (int q = 0; q < 4; q++) {
+            __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(sup + 2*p + 4*q));
+            __m128i i = _mm_loadu_si128(reinterpret_cast<const __m128i*>(inf + 2*p + 4*q));
+            __m128i iguales = _mm_and_si128(_mm_cmpeq_epi32(s, i),
+                                            _mm_cmpeq_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(2, 3, 0, 1))));
+            m |= static_cast<uint32_t>(_mm_movemask_ps(_mm_castsi128_ps(iguales))) << (4*q);
+        }
+        bits |= static_cast<uint64_t>(compactarPares(m & (m >> 1))) << p;
+    }
+    return bits | igualesEscalar(sup, inf, p, num);
+}
+
+__attribute__((target("avx2")))
+uint64_t homogeneosAVX2(const int8_t* sup, const int8_t* inf, int num) {
+    const __m256i uno = _mm256_set1_epi8(1);
+    uint64_t bits = 0;
+    int p = 0;
+    // 32 hijos por fila = 16 padres por iteración
+    for (; p + 16 <= num; p += 16) {
+        __m256i s = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(sup + 2*p));
+        __m256i i = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(inf + 2*p));
+        __m256i unos = _mm256_and_si256(_mm256_cmpeq_epi8(s, uno), _mm256_cmpeq_epi8(i, uno));
+        uint32_t m = static_cast<uint32_t>(_mm256_movemask_epi8(unos));
+        bits |= static_cast<uint64_t>(compactarPares(m & (m >> 1))) << p;
+    }
+    return bits | homogeneosEscalar(sup, inf, p, num);
+}
+
+__attribute__((target("avx2")))
+uint64_t igualesAVX2(const uint32_t* sup, const uint32_t* inf, int num) {
+    uint64_t bits = 0;
+    int p = 0;
+    // 16 padres por iteración; cada registro contiene los hijos de 4 padres: [NO0 NE0 NO1 NE1 ...]
+    for (; p + 16 <= num; p += 16) {
+        uint32_t m = 0;
+        for (int q = 0; q < 4; q++) {
+            __m256i s = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(sup + 2*p + 8*q));
+            __m256i i = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(inf + 2*p + 8*q));
+            __m256i iguales = _mm256_and_si256(_mm256_cmpeq_epi32(s, i),
+                                               _mm256_cmpeq_epi32(s, _mm256_shuffle_epi32(s, _MM_SHUFFLE(2, 3, 0, 1))));
+            m |= static_cast<uint32_t>(_mm256_movemask_ps(_mm256_castsi256_ps(iguales))) << (8*q);
+        }
+        bits |= static_cast<uint64_t>(compactarPares(m & (m >> 1))) << p;
+    }
+    return bits | igualesEscalar(sup, inf, p, num);
+}
+
+#endif // NUCLEO_2X2_X86
+
+/**
+ * @brief Escribe los padres [desde, num) de un bloque a partir de su máscara sin vectorizar.
+ * 
+ * Los padres con su bit a 1 (caso 1: hijos iguales y homogéneos) reciben homog = 1, la suma de las áreas
+ * y los atributos del hijo NO, y pasan a ser el padre de sus cuatro hijos. El resto (caso 3) recibe
+ * homog = sin_fusion.
+ * 
+ * @param nivel Nivel de los padres.
+ * @param base Nivel de los hijos.
+ * @param k0 Índice del primer padre del bloque.
+ * @param sup Índice del hijo NO del primer padre.
+ * @param desde Primer padre a escribir.
+ * @param num Número de padres del bloque.
+ * @param bits Máscara de padres iguales y homogéneos.
+ * @param sin_fusion Valor de homog de los padres no fusionados.
+ */
+void escribirEscalar(Nivel& nivel, Nivel& base, std::size_t k0, std::size_t sup, int desde, int num, uint64_t bits,
+                     int8_t sin_fusion) {
+    std::size_t inf = sup + base.num_columnas;
+    for (int p = desde; p < num; p++) {
+        std::size_t Nodoi = k0 + p;
+        if ((bits >> p) & 1) {
+            std::size_t Base_NO = sup + 2*p;
+            std::size_t Base_NE = Base_NO + 1;
+            std::size_t Base_SO = inf + 2*p;
+            std::size_t Base_SE = Base_SO + 1;
+            nivel.homog[Nodoi] = 1;
+            nivel.area[Nodoi] = base.area[Base_NO] + base.area[Base_NE] + base.area[Base_SO] + base.area[Base_SE];
+            nivel.copiarAtributos(Nodoi, base, Base_NO);
+            base.padre[Base_NO] = static_cast<int>(Nodoi);
+            base.padre[Base_NE] = static_cast<int>(Nodoi);
+            base.padre[Base_SO] = static_cast<int>(Nodoi);
+            base.padre[Base_SE] = static_cast<int>(Nodoi);
+        }
+        else {
+            nivel.homog[Nodoi] = sin_fusion;
+        }
+    }
+}
+
+/**
+ * @brief Columnas de 32 bits que los padres fusionados copian de su hijo NO (clase y estaciones).
+ */
+struct ColumnasCopiadas {
+    int32_t* destino[2];
+    const int32_t* origen[2];
+
+    ColumnasCopiadas(Nivel& nivel, const Nivel& base)
+        : destino{reinterpret_cast<int32_t*>(nivel.clase.data()), nivel.estaciones.data()},
+          origen{reinterpret_cast<const int32_t*>(base.clase.data()), base.estaciones.data()} {}
+};
+
+#ifdef NUCLEO_2X2_X86
+
+/**
+ * @brief Escribe los padres de un bloque a partir de su máscara con SSE2, de dos en dos.
+ * 
+ * Mismas reglas que escribirEscalar. Los valores de los padres no fusionados se conservan mezclando
+ * el resultado con el contenido anterior según la máscara.
+ */
+__attribute__((target("sse2")))
+void escribirSSE2(Nivel& nivel, Nivel& base, std::size_t k0, std::size_t sup, int num, uint64_t bits, int8_t sin_fusion) {
+    std::size_t inf = sup + base.num_columnas;
+    ColumnasCopiadas columnas(nivel, base);
+    int* area = nivel.area.data();
+    int* padre = base.padre.data();
+
+    int p = 0;
+    for (; p + 2 <= num; p += 2) {
+        int grupo = static_cast<int>((bits >> p) & 0x3);
+        std::size_t k = k0 + p;
+        nivel.homog[k] = (grupo & 1) ? 1 : sin_fusion;
+        nivel.homog[k + 1] = (grupo >> 1) ? 1 : sin_fusion;
+        if (grupo == 0) {
+            continue;
+        }
+        std::size_t no = sup + 2*p;
+        std::size_t so = inf + 2*p;
+
+        // Máscara de 64 bits por padre (como 32 bits: m0 m0 m1 m1)
+        __m128i mascara = _mm_set_epi64x(-static_cast<int64_t>(grupo >> 1), -static_cast<int64_t>(grupo & 1));
+        __m128i mascara32 = _mm_shuffle_epi32(mascara, _MM_SHUFFLE(2, 0, 2, 0));
+
+        // Clase y estaciones del hijo NO: [NO0 NE0 NO1 NE1] -> [NO0 NO1]
+        for (int c = 0; c < 2; c++) {
+            __m128i NO = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(columnas.origen[c] + no)),
+                                           _MM_SHUFFLE(2, 0, 2, 0));
+            __m128i* destino = reinterpret_cast<__m128i*>(columnas.destino[c] + k);
+            __m128i anterior = _mm_loadl_epi64(destino);
+            _mm_storel_epi64(destino, _mm_or_si128(_mm_and_si128(mascara32, NO), _mm_andnot_si128(mascara32, anterior)));
+        }
+
+        // Área: suma de las cuatro áreas de cada padre
+        __m128i a = _mm_add_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(base.area.data() + no)),
+                                  _mm_loadu_si128(reinterpret_cast<const __m128i*>(base.area.data() + so)));
+        __m128i suma = _mm_add_epi32(_mm_shuffle_epi32(a, _MM_SHUFFLE(2, 0, 2, 0)), _mm_shuffle_epi32(a, _MM_SHUFFLE(3, 1, 3, 1)));
+        __m128i a_anterior = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(area + k));
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(area + k),
+                         _mm_or_si128(_mm_and_si128(mascara32, suma), _mm_andnot_si128(mascara32, a_anterior)));
+
+        // Padre de los cuatro hijos
+        int id = static_cast<int>(k);
+        __m128i ids = _mm_set_epi32(id + 1, id + 1, id, id);
+        for (std::size_t fila : {no, so}) {
+            __m128i* destino = reinterpret_cast<__m128i*>(padre + fila);
+            __m128i anterior = _mm_loadu_si128(destino);
+            _mm_storeu_si128(destino, _mm_or_si128(_mm_and_si128(mascara, ids), _mm_andnot_si128(mascara, anterior)));
+        }
+    }
+    escribirEscalar(nivel, base, k0, sup, p, num, bits, sin_fusion);
+}
+
+/**
+ * @brief Escribe los padres de un bloque a partir de su máscara con AVX2, de cuatro en cuatro.
+ * 
+ * Mismas reglas que escribirEscalar. Los valores de los padres no fusionados se conservan mezclando
+ * el resultado con el contenido anterior según la máscara.
+ */
+__attribute__((target("avx2")))
+void escribirAVX2(Nivel& nivel, Nivel& base, std::size_t k0, std::size_t sup, int num, uint64_t bits, int8_t sin_fusion) {
+    std::size_t inf = sup + base.num_columnas;
+    ColumnasCopiadas columnas(nivel, base);
+    int* area = nivel.area.data();
+    int* padre = base.padre.data();
+
+    const __m256i bit_carril = _mm256_setr_epi64x(1, 2, 4, 8);
+    const __m256i pares_impares = _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7);
+    const __m256i desplazamiento_hijos = _mm256_setr_epi32(0, 0, 1, 1, 2, 2, 3, 3);
+
+    int p = 0;
+    for (; p + 4 <= num; p += 4) {
+        int grupo = static_cast<int>((bits >> p) & 0xF);
+        std::size_t k = k0 + p;
+        for (int q = 0; q < 4; q++) {
+            nivel.homog[k + q] = ((grupo >> q) & 1) ? 1 : sin_fusion;
+        }
+        if (grupo == 0) {
+            continue;
+        }
+        std::size_t no = sup + 2*p;
+        std::size_t so = inf + 2*p;
+
+        // Máscara de 64 bits por padre; vista como 32 bits es m0 m0 m1 m1 m2 m2 m3 m3
+        __m256i mascara = _mm256_cmpeq_epi64(_mm256_and_si256(_mm256_set1_epi64x(grupo), bit_carril), bit_carril);
+        __m128i mascara32 = _mm256_castsi256_si128(_mm256_permutevar8x32_epi32(mascara, pares_impares));
+
+        // Clase y estaciones del hijo NO: [NO0 NE0 NO1 NE1 NO2 NE2 NO3 NE3] -> [NO0 NO1 NO2 NO3]
+        for (int c = 0; c < 2; c++) {
+            __m256i NO = _mm256_permutevar8x32_epi32(
+                _mm256_loadu_si256(reinterpret_cast<const __m256i*>(columnas.origen[c] + no)), pares_impares);
+            __m128i* destino = reinterpret_cast<__m128i*>(columnas.destino[c] + k);
+            _mm_storeu_si128(destino, _mm_blendv_epi8(_mm_loadu_si128(destino), _mm256_castsi256_si128(NO), mascara32));
+        }
+
+        // Área: (NO + SO) + (NE + SE) de cada padre
+        __m256i a = _mm256_add_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(base.area.data() + no)),
+                                     _mm256_loadu_si256(reinterpret_cast<const __m256i*>(base.area.data() + so)));
+        a = _mm256_permutevar8x32_epi32(a, pares_impares);
+        __m128i suma = _mm_add_epi32(_mm256_castsi256_si128(a), _mm256_extracti128_si256(a, 1));
+        __m128i* destino_a = reinterpret_cast<__m128i*>(area + k);
+        _mm_storeu_si128(destino_a, _mm_blendv_epi8(_mm_loadu_si128(destino_a), suma, mascara32));
+
+        // Padre de los cuatro hijos de cada padre
+        __m256i ids = _mm256_add_epi32(_mm256_set1_epi32(static_cast<int>(k)), desplazamiento_hijos);
+        for (std::size_t fila : {no, so}) {
+            __m256i* destino = reinterpret_cast<__m256i*>(padre + fila);
+            _mm256_storeu_si256(destino, _mm256_blendv_epi8(_mm256_loadu_si256(destino), ids, mascara));
+        }
+    }
+    escribirEscalar(nivel, base, k0, sup, p, num, bits, sin_fusion);
+}
+
+#endif // NUCLEO_2X2_X86
+
+/**
+ * @brief Reduce una fila de padres por bloques de 64 con las máscaras de homogeneidad e igualdad dadas.
+ * 
+ * Para cada bloque se calcula primero la máscara de homogeneidad y, si algún padre sigue siendo candidato,
+ * se restringe con la de igualdad de las clases de atributos. Por último se escriben en la misma pasada,
+ * mientras el bloque sigue en caché, el área y los atributos de los padres fusionados y el padre de sus hijos.
+ */
+template <uint64_t (*Homogeneos)(const int8_t*, const int8_t*, int),
+          uint64_t (*Iguales)(const uint32_t*, const uint32_t*, int),
+          void (*Escribir)(Nivel&, Nivel&, std::size_t, std::size_t, int, uint64_t, int8_t)>
+void reducirFila(Nivel& nivel, Nivel& base, int i, int j_inicio, int j_fin, int8_t homog_sin_fusion) {
+    for (int j0 = j_inicio; j0 < j_fin; j0 += PADRES_BLOQUE) {
+        int num = std::min(PADRES_BLOQUE, j_fin - j0);
+        std::size_t sup = base.indice(i*2, j0*2);
+        std::size_t inf = sup + base.num_columnas;
+
+        uint64_t bits = Homogeneos(base.homog.data() + sup, base.homog.data() + inf, num);
+        if (bits != 0) {
+            bits &= Iguales(base.clase.data() + sup, base.clase.data() + inf, num);
+        }
+        Escribir(nivel, base, nivel.indice(i, j0), sup, num, bits, homog_sin_fusion);
+    }
+}
+
+#ifdef NUCLEO_2X2_X86
+
+bool admiteAVX2() {
+    return __builtin_cpu_supports("avx2");
+}
+
+#endif // NUCLEO_2X2_X86
+
+} // namespace
+
+/**
+ * @brief Obtiene el núcleo que se usará realmente para el núcleo pedido.
+ * 
+ * 'Auto' elige AVX2 si el procesador lo admite y SSE2 en caso contrario (en x86-64 siempre existe).
+ * Un núcleo pedido que el procesador no admite se sustituye por el mejor disponible por debajo de él.
+ * Fuera de x86 solo existe el núcleo escalar.
+ * 
+ * @param pedido Núcleo configurado.
+ * @return Núcleo disponible.
+ */
+NucleoSimd nucleoDisponible(NucleoSimd pedido) {
+#ifdef NUCLEO_2X2_X86
+    if (pedido == NucleoSimd::Escalar) {
+        return NucleoSimd::Escalar;
+    }
+    if ((pedido == NucleoSimd::Auto || pedido == NucleoSimd::AVX2) && admiteAVX2()) {
+        return NucleoSimd::AVX2;
+    }
+    return NucleoSimd::SSE2;
+#else
+    (void)pedido;
+    return NucleoSimd::Escalar;
+#endif
+}
+
+/**
+ * @brief Obtiene la función de reducción de un núcleo.
+ * 
+ * @param nucleo Núcleo ya resuelto con nucleoDisponible.
+ * @return Función de reducción, o nullptr para el núcleo escalar.
+ */
+FuncionReduccion2x2 funcionReduccion2x2(NucleoSimd nucleo) {
+    switch (nucleo) {
+#ifdef NUCLEO_2X2_X86
+    case NucleoSimd::SSE2:
+        return reducirFila<homogeneosSSE2, igualesSSE2, escribirSSE2>;
+    case NucleoSimd::AVX2:
+        return reducirFila<homogeneosAVX2, igualesAVX2, escribirAVX2>;
+#endif
+    default:
+        return nullptr;
+    }
+}
+
+/**
+ * @brief Obtiene la función de máscara de homogeneidad de un núcleo.
+ * 
+ * @param nucleo Núcleo ya resuelto con nucleoDisponible.
+ * @return Función de máscara del núcleo (la escalar para el núcleo escalar).
+ */
+FuncionHomogeneos2x2 funcionHomogeneos2x2(NucleoSimd nucleo) {
+    switch (nucleo) {
+#ifdef NUCLEO_2X2_X86
+    case NucleoSimd::SSE2:
+        return homogeneosSSE2;
+    case NucleoSimd::AVX2:
+        return homogeneosAVX2;
+#endif
+    default:
+        return homogeneosEscalarBloque;
+    }
+}
+
+/**
+ * @brief Obtiene la función de máscara de igualdad de un núcleo.
+ * 
+ * @param nucleo Núcleo ya resuelto con nucleoDisponible.
+ * @return Función de máscara del núcleo (la escalar para el núcleo escalar).
+ */
+FuncionIguales2x2 funcionIguales2x2(NucleoSimd nucleo) {
+    switch (nucleo) {
+#ifdef NUCLEO_2X2_X86
+    case NucleoSimd::SSE2:
+        return igualesSSE2;
+    case NucleoSimd::AVX2:
+        return igualesAVX2;
+#endif
+    default:
+        return igualesEscalarBloque;
+    }
+}
+
+/**
+ * @brief Obtiene el nombre de un núcleo.
+ * 
+ * @param nucleo Núcleo.
+ * @return Nombre del núcleo.
+ */
+const char* nombreNucleo(NucleoSimd nucleo) {
+    switch (nucleo) {
+    case NucleoSimd::Auto:
+        return "auto";
+    case NucleoSimd::Escalar:
+        return "escalar";
+    case NucleoSimd::SSE2:
+        return "sse2";
+    case NucleoSimd::AVX2:
+        return "avx2";
+    }
+    return "desconocido";
+}
@@ -0,0 +1,29 @@
+#ifndef NUCLEO_2X2_H
+#define NUCLEO_2X2_H
+
+#include "configuracion.h"
+#include "nivel.h"
+
+// Reduce los padres [j_inicio, j_fin) de la fila i de 'nivel' a partir de sus hijos en 'base'; los padres que no se
+// fusionan reciben homog = homog_sin_fusion (0, o -1 si la purga se hace a la vez)
+using FuncionReduccion2x2 = void (*)(Nivel& nivel, Nivel& base, int i, int j_inicio, int j_fin, int8_t homog_sin_fusion);
+
+// Máscara de homogeneidad o de igualdad de 'num' padres consecutivos (num <= 64) a partir de las filas de sus hijos:
+// el bit p vale 1 si los cuatro hijos del padre p son homogéneos o tienen la misma clase
+using FuncionHomogeneos2x2 = uint64_t (*)(const int8_t* sup, const int8_t* inf, int num);
+using FuncionIguales2x2 = uint64_t (*)(const uint32_t* sup, const uint32_t* inf, int num);
+
+// Resuelve 'Auto' y los núcleos que el procesador no admite al mejor núcleo disponible
+NucleoSimd nucleoDisponible(NucleoSimd pedido);
+
+// Función de reducción vectorizada del núcleo (nullptr para el núcleo escalar)
+FuncionReduccion2x2 funcionReduccion2x2(NucleoSimd nucleo);
+
+// Funciones de máscara del núcleo (las escalares para el núcleo escalar), para comprobar los núcleos vectorizados
+FuncionHomogeneos2x2 funcionHomogeneos2x2(NucleoSimd nucleo);
+FuncionIguales2x2 funcionIguales2x2(NucleoSimd nucleo);
+
+// Nombre del núcleo, para los mensajes
+const char* nombreNucleo(NucleoSimd nucleo);
+
+#endif // NUCLEO_2X2_H
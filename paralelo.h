@@ -0,0 +1,80 @@
+#ifndef PARALELO_H
+#define PARALELO_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Obtiene el número de hilos a usar a partir del valor configurado.
+ * 
+ * @param num_hilos Número de hilos pedido (0 o negativo = todos los núcleos disponibles).
+ * @return Número de hilos, al menos 1.
+ */
+inline int hilosEfectivos(int num_hilos) {
+    if (num_hilos <= 0) {
+        num_hilos = static_cast<int>(std::thread::hardware_concurrency());
+    }
+    return std::max(num_hilos, 1);
+}
+
+/**
+ * @brief Ejecuta funcion(tarea) para cada tarea en [0, num_tareas) repartiendo las tareas entre varios hilos.
+ * 
+ * Los hilos toman las tareas en orden de un contador compartido, de modo que los bloques lentos no dejan
+ * hilos parados. Si alguna tarea lanza una excepción, se termina el resto y se relanza la primera en el
+ * hilo que llama.
+ * 
+ * @param num_hilos Número de hilos (0 = todos los núcleos disponibles).
+ * @param num_tareas Número de tareas.
+ * @param funcion Función a ejecutar para cada tarea, recibe el índice de la tarea.
+ */
+template <typename Funcion>
+void paraleloPara(int num_hilos, std::size_t num_tareas, Funcion funcion) {
+    std::size_t hilos = std::min<std::size_t>(hilosEfectivos(num_hilos), num_tareas);
+    if (hilos <= 1) {
+        for (std::size_t tarea = 0; tarea < num_tareas; tarea++) {
+            funcion(tarea);
+        }
+        return;
+    }
+
+    std::atomic<std::size_t> siguiente{0};
+    std::exception_ptr error;
+    std::mutex mutex_error;
+
+    auto trabajador = [&]() {
+        std::size_t tarea;
+        while ((tarea = siguiente.fetch_add(1)) < num_tareas) {
+            try {
+                funcion(tarea);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(mutex_error);
+                if (!error) {
+                    error = std::current_exception();
+                }
+                siguiente = num_tareas;
+            }
+        }
+    };
+
+    std::vector<std::thread> trabajadores;
+    trabajadores.reserve(hilos - 1);
+    for (std::size_t h = 1; h < hilos; h++) {
+        trabajadores.emplace_back(trabajador);
+    }
+    trabajador();
+    for (std::thread& t : trabajadores) {
+        t.join();
+    }
+
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+#endif // PARALELO_H
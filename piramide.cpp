@@ -1,339 +1,1814 @@
 #include "piramide.h"
+#include "cache_base.h"
+#include "instantanea.h"
+#include "lector_csv.h"
+#include "niveles_en_disco.h"
+#include "paralelo.h"
+
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <unordered_set>
 
 void Piramide::init(){
+    metricas.iniciarFase("init");
     std::cout << "\tIncializando datos de la piramide..." << std::endl;
     inicializarPiramide();
-    std::cout << "\tLeyendo datos del archivo CSV..." << std::endl;
-    leerArchivoCSV();
-    std::cout << "\tInicializando niveles restantes..." << std::endl;
-    inicializarNivelesRestantes();
-    std::cout << "\tBase creada." << std::endl;    
+    prepararReduccion();
+
+    // Si la pirámide no cabe en la memoria máxima, construirla por teselas en disco
+    std::size_t memoria_maxima = config.memoria_maxima_mb << 20;
+    std::size_t memoria_piramide = static_cast<std::size_t>(geometria->inicio_ids[num_niv]) * BYTES_NODO;
+    bool en_disco = memoria_maxima > 0 && memoria_piramide > memoria_maxima;
+    if (en_disco) {
+        std::cout << "\tLa piramide ocupa " << (memoria_piramide >> 20) << " MB, mas que el limite de "
+                  << config.memoria_maxima_mb << " MB: se construye por teselas en disco..." << std::endl;
+        construirEnDisco();
+    } else {
+        {
+            auto medida = metricas.medirNivel(0);
+            if (config.usar_cache && leerCacheBase()) {
+                std::cout << "\tBase cargada de la cache " << config.rutaCache() << "." << std::endl;
+            } else {
+                std::cout << "\tLeyendo datos del archivo CSV..." << std::endl;
+                leerArchivoCSV();
+                if (config.usar_cache) {
+                    escribirCacheBase();
+                }
+            }
+            metricas.anotarVisitas(0, piramide[0].size());
+        }
+        std::cout << "\t" << piramide[0].atributos->size() << " combinaciones distintas de atributos." << std::endl;
+        std::cout << "\tInicializando niveles restantes..." << std::endl;
+        inicializarNivelesRestantes();
+    }
+    std::cout << "\tBase creada." << std::endl;
+    // Contar los nodos traería a memoria todos los niveles en disco
+    metricas.terminarFase(piramide, !en_disco);
+}
+
+/**
+ * @brief Calcula la geometría de una pirámide: número de niveles y primer ID de cada nivel.
+ * 
+ * El número de niveles es el número de bits del lado mayor de la base, de modo que el último nivel tiene un solo
+ * nodo de ancho; el nivel n tiene (num_filas >> n) x (num_columnas >> n) nodos.
+ * 
+ * @param num_filas Filas de la base.
+ * @param num_columnas Columnas de la base.
+ * @return Geometría, que pueden compartir todas las pirámides de las mismas dimensiones.
+ */
+std::shared_ptr<const GeometriaPiramide> calcularGeometria(int num_filas, int num_columnas) {
+    auto geometria = std::make_shared<GeometriaPiramide>();
+    geometria->num_filas = num_filas;
+    geometria->num_columnas = num_columnas;
+    for (int lado = std::max(num_filas, num_columnas); lado > 0; lado >>= 1) {
+        geometria->num_niv++;
+    }
+
+    geometria->inicio_ids.assign(geometria->num_niv + 1, 0);
+    long long id_nodo = 0;
+    for (int n = 0; n < geometria->num_niv; n++) {
+        geometria->inicio_ids[n] = static_cast<int>(id_nodo);
+        id_nodo += static_cast<long long>(num_filas >> n) * (num_columnas >> n);
+        if (id_nodo > std::numeric_limits<int>::max()) {
+            throw std::runtime_error("Error: la piramide de " + std::to_string(num_filas) + " x "
+                                     + std::to_string(num_columnas) + " tiene demasiados nodos.");
+        }
+    }
+    geometria->inicio_ids[geometria->num_niv] = static_cast<int>(id_nodo);
+    return geometria;
 }
 
 /**
  * @brief Inicializa la estructura de datos de la pirámide, estableciendo las dimensiones y configurando los nodos.
  * 
- * Esta función crea una pirámide de niveles basada en las constantes FILAS y COLUMNAS, donde cada nivel es una matriz
- * de nodos. El número de niveles se calcula a partir de las dimensiones de la base de la pirámide.
+ * Esta función crea una pirámide de niveles basada en las dimensiones config.num_filas y config.num_columnas (o, si
+ * son 0, en las guardadas en la caché de la base), donde cada nivel es una matriz de nodos. El número de niveles se
+ * calcula a partir de las dimensiones de la base de la pirámide.
+ * 
+ * Los niveles se crean sin columnas: se reservan en memoria (o en disco, ver construirEnDisco) al construirlos,
+ * y las de la base al cargarla del CSV o de la caché. Los niveles por encima del primero sin nodos homogéneos no
+ * se llegan a reservar (ver inicializarNivelesRestantes). Los identificadores de los nodos son consecutivos en orden
+ * fila-mayor, de modo que basta con guardar el identificador del primer nodo de cada nivel. Todos los niveles
+ * comparten una misma tabla de atributos, que se llena al cargar la base.
+ * 
+ * La geometría guarda en inicio_ids el primer ID de cada nivel, para convertir IDs en (nivel, fila, columna) y al
+ * revés sin recorrer los niveles. Si la Pirámide tiene un pool de memoria (ver construirLote), los niveles toman
+ * de él sus columnas.
  * 
- * La función inicializa cada nodo con un identificador único, nivel, fila y columna correspondientes. Luego, se añade
- * cada nivel a la estructura pirámide. 
- *
  */
 void Piramide::inicializarPiramide(){
-    // Establecer el tamaño de la pirámide utilizando las constantes FILAS y COLUMNAS
-    num_filas = FILAS;
-    num_columnas = COLUMNAS;
+    // Establecer el tamaño de la pirámide a partir de la configuración o de la caché
+    num_filas = config.num_filas;
+    num_columnas = config.num_columnas;
+    if (num_filas <= 0 || num_columnas <= 0) {
+        FirmaCSV firma = firmaArchivo(config.archivo_csv, config.precision_atributos);
+        if (!leerDimensionesCache(config.rutaCache(), firma, num_filas, num_columnas)) {
+            throw std::runtime_error("Error: no se han indicado las dimensiones de la base y no hay una cache valida de "
+                                     + config.archivo_csv + ".");
+        }
+    }
+    std::cout << "\t\tDimensiones de la base: " << num_filas << " x " << num_columnas << std::endl;
 
-    // Calcular el número de niveles a partir de las dimensiones de la base de la pirámide
+    // Calcular el número de niveles y el primer ID de cada nivel, salvo que ya se tengan para estas dimensiones
+    // (ver construirLote, que los comparte entre todas las pirámides de la misma malla)
     std::cout << "\t\tCalculando numero de niveles de la piramide..." << std::endl;
-    num_niv = static_cast<int>(floor(log2(std::max(num_filas, num_columnas))) + 1);
+    if (!geometria || geometria->num_filas != num_filas || geometria->num_columnas != num_columnas) {
+        geometria = calcularGeometria(num_filas, num_columnas);
+    }
+    num_niv = geometria->num_niv;
 
     // Reservar memoria para el número de niveles en la pirámide
     std::cout << "\t\tReservando memoria para la piramide..." << std::endl;
+    piramide.clear();
     piramide.reserve(num_niv);
-    
-    int id_nodo = 0;
+
+    std::shared_ptr<TablaAtributos> atributos = std::make_shared<TablaAtributos>();
     // Recorrer todos los niveles de la pirámide
     for (int n = 0; n < num_niv; n++) {
         int tam_fila, tam_columna;
         // Obtener el tamaño del nivel actual
         std::tie(tam_fila, tam_columna) = getTam(n);
 
-        // Inicializar la matriz del nivel actual
-        std::vector<std::vector<Nodo>> level(tam_fila, std::vector<Nodo>(tam_columna));
-        
-        // Recorrer las filas y columnas del nivel actual
-        for (int i = 0; i < tam_fila; i++) {
-            for (int j = 0; j < tam_columna; j++) {
-                Nodo& Nodoi = level[i][j];
-                // Inicializar el nodo con un identificador único
-                Nodoi = Nodo(id_nodo);
-                // Establecer las propiedades del nodo: nivel, fila y columna
-                Nodoi.nivel = n;
-                Nodoi.fila = i;
-                Nodoi.columna = j;
+        // Añadir el nivel, cuyos nodos empiezan en el identificador inicio_ids[n] de la geometría
+        piramide.emplace_back(n, tam_fila, tam_columna, geometria->inicio_ids[n]);
+        piramide.back().atributos = atributos;
+        piramide.back().pool = pool;
+        piramide.back().paginas = config.paginas_grandes;
+    }
+    std::cout << "\t\tPiramide inicializada..." << std::endl;
+}
+
+
+/**
+ * @brief Reserva las columnas de un nivel, inicializándolas con los hilos de la construcción.
+ * 
+ * Las bandas de filas son las mismas que reparte inicializarNivelesRestantes con la partición por bandas, de modo
+ * que cada banda se inicializa, y en un sistema NUMA queda en memoria, como después se construye (ver
+ * Nivel::reservar).
+ * 
+ * @param n Nivel.
+ */
+void Piramide::reservarNivel(int n) {
+    int num_hilos = hilosEfectivos(config.num_hilos);
+    piramide[n].reservar(num_hilos, filasPorBanda(piramide[n].num_filas, num_hilos));
+}
+
+/**
+ * @brief Descarta los niveles de la pirámide a partir de uno dado.
+ * 
+ * Los niveles descartados no tienen nodos (ver inicializarNivelesRestantes); sus columnas se liberan y num_niv
+ * pasa a ser el número de niveles que quedan. La geometría conserva el número de niveles de las dimensiones de la
+ * base, por si actualizar() necesita volver a añadirlos (ver ampliarNivel).
+ * 
+ * @param niveles Número de niveles que se conservan (al menos 1).
+ */
+void Piramide::truncarNiveles(int niveles) {
+    if (niveles >= num_niv) {
+        return;
+    }
+    std::cout << "\t\tEl nivel " << niveles << " no tiene nodos homogeneos: la piramide se queda en " << niveles
+              << " de " << num_niv << " niveles" << std::endl;
+    piramide.erase(piramide.begin() + niveles, piramide.end());
+    num_niv = niveles;
+}
+
+/**
+ * @brief Añade a la pirámide el siguiente nivel de su geometría, con todos los nodos vacíos.
+ * 
+ * Deshace un truncarNiveles cuando una actualización hace homogéneo algún nodo del nivel más alto. El nivel nuevo
+ * tiene la columna de regiones y, si las de los demás niveles están construidas, listas de hijos vacías.
+ */
+void Piramide::ampliarNivel() {
+    const int n = num_niv;
+    int tam_fila, tam_columna;
+    std::tie(tam_fila, tam_columna) = getTam(n);
+    piramide.emplace_back(n, tam_fila, tam_columna, geometria->inicio_ids[n]);
+    Nivel& nivel = piramide.back();
+    nivel.atributos = piramide[0].atributos;
+    nivel.pool = pool;
+    nivel.paginas = config.paginas_grandes;
+    num_niv++;
+    reservarNivel(n);
+    nivel.reservarRegiones();
+    if (piramide[n - 1].inicio_hijos.size() > 0) {
+        nivel.construirHijos(piramide[n - 1]);
+    }
+    std::cout << "\t\tLa piramide crece hasta " << num_niv << " niveles" << std::endl;
+}
+
+/**
+ * @brief Lee los datos de un archivo CSV y asigna los valores a los nodos de la pirámide.
+ * 
+ * Esta función lee el archivo CSV indicado en la configuración (por defecto "completo0.csv") y extrae los datos
+ * para cada nodo. A continuación, asigna los valores extraídos a las propiedades de los nodos correspondientes en
+ * la base de la pirámide (ver leerCSV).
+ * 
+ */
+void Piramide::leerArchivoCSV() {
+    std::cout << "\t\tLeyendo cada linea del archivo..." << std::endl;
+    reservarNivel(0);
+    leerCSV(config.archivo_csv, piramide[0], config.precision_atributos, config.num_hilos);
+    std::cout << "\t\tArchivo CSV leido y asignado a la base..." << std::endl;
+}
+
+/**
+ * @brief Carga la base de la pirámide desde la caché binaria del CSV, si es válida.
+ * 
+ * La caché solo se usa si se generó a partir de un CSV con el mismo tamaño y fecha de modificación que el actual
+ * y con la misma precisión de los atributos.
+ * 
+ * @return Verdadero si la base se cargó de la caché, falso si hay que leer el CSV.
+ */
+bool Piramide::leerCacheBase() {
+    FirmaCSV firma = firmaArchivo(config.archivo_csv, config.precision_atributos);
+    return cargarCacheBase(config.rutaCache(), piramide[0], firma, config.verificar_cache, config.num_hilos);
+}
+
+/**
+ * @brief Guarda la base de la pirámide en la caché binaria para las siguientes ejecuciones.
+ * 
+ * Un fallo al escribir la caché no es fatal: se avisa y se continúa sin ella.
+ */
+void Piramide::escribirCacheBase() {
+    std::cout << "\t\tGuardando cache de la base en " << config.rutaCache() << "..." << std::endl;
+    try {
+        guardarCacheBase(config.rutaCache(), piramide[0], firmaArchivo(config.archivo_csv, config.precision_atributos),
+                         config.num_hilos);
+    } catch (const std::runtime_error& error) {
+        std::cerr << "\t\t" << error.what() << std::endl;
+    }
+}
+
+/**
+ * @brief Elige cómo se reducen los bloques 2x2 al construir los niveles superiores.
+ * 
+ * Las comparaciones de los bloques 2x2 usan el núcleo vectorizado config.nucleo_2x2 (AVX2 o SSE2, elegido en
+ * tiempo de ejecución) o, si no hay ninguno disponible, la comparación escalar nodo a nodo.
+ * 
+ * Con config.purga_fusionada, los padres que no se fusionan se dejan vacíos en lugar de marcarse como no homogéneos,
+ * que es exactamente lo que haría después la primera pasada de purga(); así purga() no tiene que recorrer la pirámide.
+ * 
+ * Si hay alguna tolerancia de similitud, el mismo núcleo se usa para comparar los atributos cuantizados de los bloques
+ * parecidos (ver fusionarParecidos).
+ * 
+ */
+void Piramide::prepararReduccion(){
+    niveles_purgados = config.purga_fusionada;
+    if (niveles_purgados) {
+        std::cout << "\t\tLos nodos no homogeneos se eliminan al construir cada nivel" << std::endl;
+    }
+
+    NucleoSimd nucleo = nucleoDisponible(config.nucleo_2x2);
+    reduccion_2x2 = funcionReduccion2x2(nucleo);
+    std::cout << "\t\tNucleo de comparacion 2x2: " << nombreNucleo(nucleo) << std::endl;
+
+    similitud.preparar(config.tolerancia_absoluta, config.tolerancia_relativa, nucleo);
+    if (similitud.activa()) {
+        std::cout << "\t\tSe fusionan tambien los bloques con atributos parecidos (caso 2)" << std::endl;
+    }
+}
+
+/**
+ * @brief Inicializa los niveles restantes de la pirámide, estableciendo relaciones entre nodos y calculando sus atributos.
+ * 
+ * Esta función inicializa los niveles restantes de la pirámide (niveles superiores) a partir de los nodos de nivel inferior.
+ * La reducción debe estar elegida con prepararReduccion(). Las columnas de cada nivel se reservan justo antes de
+ * construirlo (ver reservarNivel), y la construcción se detiene en el primer nivel sin nodos homogéneos: un padre
+ * solo es homogéneo si lo son sus cuatro hijos, así que por encima de ese nivel todos los nodos estarían vacíos, y
+ * enlaza no tendría candidatos en él. Ese nivel y los siguientes se descartan (ver truncarNiveles) y num_niv pasa a
+ * ser el número de niveles efectivos, el único que recorren las fases siguientes.
+ * Cada padre solo depende de sus cuatro hijos, así que el trabajo se reparte entre config.num_hilos hilos:
+ *  - Particion::Bandas: nivel a nivel, cada hilo construye bandas de filas completas.
+ *  - Particion::Teselas: cada hilo toma una tesela de 2^k x 2^k nodos (k = config.niveles_por_tesela) y la reduce
+ *    k niveles seguidos mientras sigue en caché; después se pasa al siguiente grupo de k niveles.
+ * El resultado no depende del número de hilos ni de la partición (ver inicializarTramo). Con tolerancias de similitud
+ * los niveles se construyen siempre por bandas, y tras cada nivel se fusionan los bloques parecidos (ver
+ * fusionarParecidos).
+ * 
+ * @param primer_nivel Primer nivel a construir (los anteriores ya están construidos).
+ */
+void Piramide::inicializarNivelesRestantes(int primer_nivel){
+    // Recorrer todos los niveles restantes
+    std::cout << "\t\tInicializando el resto de niveles..." << std::endl;
+    int num_hilos = hilosEfectivos(config.num_hilos);
+    std::size_t num_parecidos = 0;
+    if (similitud.activa()) {
+        similitud.actualizar(*piramide[0].atributos);
+        if (config.particion == Particion::Teselas) {
+            std::cout << "\t\tLa fusion de bloques parecidos construye los niveles por bandas" << std::endl;
+        }
+    }
+
+    if (config.particion == Particion::Teselas && config.niveles_por_tesela > 0 && !similitud.activa()) {
+        const int k = std::min(config.niveles_por_tesela, num_niv);
+        const int lado = 1 << k;
+
+        // Grupos de k niveles: el nivel n0 se reduce hasta el n_fin dentro de cada tesela
+        for (int n0 = primer_nivel - 1; n0 + 1 < num_niv; n0 += k) {
+            int n_fin = std::min(n0 + k, num_niv - 1);
+            int tam_fila0, tam_columna0;
+            std::tie(tam_fila0, tam_columna0) = getTam(n0);
+            int teselas_fila = (tam_fila0 + lado - 1) / lado;
+            int teselas_columna = (tam_columna0 + lado - 1) / lado;
+
+            // El tiempo del grupo se anota en su último nivel
+            auto medida = metricas.medirNivel(n_fin);
+            for (int n = n0 + 1; n <= n_fin; n++) {
+                reservarNivel(n);
+            }
+            paraleloPara(num_hilos, static_cast<std::size_t>(teselas_fila) * teselas_columna, [&](std::size_t t) {
+                inicializarTesela(n0, n_fin, lado, static_cast<int>(t / teselas_columna),
+                                  static_cast<int>(t % teselas_columna));
+            });
+            for (int n = n0 + 1; n <= n_fin; n++) {
+                metricas.anotarVisitas(n, piramide[n].size());
+            }
+
+            // Los niveles del grupo por encima del primero sin nodos homogéneos también están vacíos
+            int vacio = n0 + 1;
+            while (vacio <= n_fin && piramide[vacio].tieneHomogeneos()) {
+                vacio++;
+            }
+            if (vacio <= n_fin) {
+                truncarNiveles(vacio);
+                break;
+            }
+        }
+    }
+    else {
+        for (int n = primer_nivel; n < num_niv; n++) {
+            int tam_fila, tam_columna;
+            // Obtener el tamaño del nivel actual
+            std::tie(tam_fila, tam_columna) = getTam(n);
+
+            // Repartir las filas del nivel en bandas (varias por hilo para equilibrar la carga)
+            int filas_banda = filasPorBanda(tam_fila, num_hilos);
+            int num_bandas = (tam_fila + filas_banda - 1) / filas_banda;
+
+            auto medida = metricas.medirNivel(n);
+            metricas.anotarVisitas(n, piramide[n].size());
+
+            reservarNivel(n);
+            paraleloPara(num_hilos, num_bandas, [&](std::size_t banda) {
+                int fila_inicio = static_cast<int>(banda) * filas_banda;
+                int fila_fin = std::min(fila_inicio + filas_banda, tam_fila);
+                for (int i = fila_inicio; i < fila_fin; i++) {
+                    inicializarTramo(n, i, 0, tam_columna);
+                }
+            });
+            if (similitud.activa()) {
+                num_parecidos += fusionarParecidos(n);
+            }
+            if (!piramide[n].tieneHomogeneos()) {
+                truncarNiveles(n);
+                break;
+            }
+        }
+    }
+    if (similitud.activa()) {
+        std::cout << "\t\t" << num_parecidos << " bloques parecidos fusionados, " << piramide[0].atributos->size()
+                  << " combinaciones de atributos" << std::endl;
+    }
+    std::cout << "\t\tTerminado de inicializar los demás niveles..." << std::endl;
+}
+
+/**
+ * @brief Reduce una tesela del nivel n0 hasta el nivel n_fin.
+ * 
+ * La tesela (tf, tc) ocupa lado x lado nodos del nivel n0 y, en el nivel n0 + m, lado >> m filas y columnas.
+ * Las teselas no comparten nodos, así que se pueden reducir a la vez desde hilos diferentes.
+ * 
+ * @param n0 Nivel de partida, ya construido.
+ * @param n_fin Último nivel a construir.
+ * @param lado Lado de la tesela en el nivel n0 (potencia de dos).
+ * @param tf Fila de la tesela.
+ * @param tc Columna de la tesela.
+ */
+void Piramide::inicializarTesela(int n0, int n_fin, int lado, int tf, int tc){
+    for (int n = n0 + 1; n <= n_fin; n++) {
+        int m = n - n0;
+        int tam_fila, tam_columna;
+        std::tie(tam_fila, tam_columna) = getTam(n);
+        int fila_fin = std::min(((tf + 1) * lado) >> m, tam_fila);
+        int columna_inicio = (tc * lado) >> m;
+        int columna_fin = std::min(((tc + 1) * lado) >> m, tam_columna);
+        for (int i = (tf * lado) >> m; i < fila_fin; i++) {
+            inicializarTramo(n, i, columna_inicio, columna_fin);
+        }
+    }
+}
+
+/**
+ * @brief Inicializa los nodos [j_inicio, j_fin) de la fila i del nivel n a partir de sus hijos del nivel n-1.
+ * 
+ * Comprueba si los nodos de la base son iguales y homogéneos, y en caso afirmativo, establece sus atributos y relaciones.
+ * Los nodos parecidos y homogéneos (caso 2) quedan aquí como no fusionados; se fusionan después con fusionarParecidos.
+ * Cada padre solo escribe en su propia posición y en el padre de sus cuatro hijos, por lo que tramos distintos se pueden
+ * inicializar a la vez desde hilos diferentes. Si hay un núcleo vectorizado seleccionado, el tramo se delega en él,
+ * que aplica las mismas reglas a bloques de padres. Si la purga está fusionada con la construcción, los padres del
+ * caso 3 quedan vacíos (homog = -1) en lugar de no homogéneos (homog = 0).
+ * 
+ * Base_NO  Base_NE
+ * Base_SO  Base_SE
+ * 
+ * @param n Nivel de los nodos a inicializar (n >= 1).
+ * @param i Fila del tramo en el nivel n.
+ * @param j_inicio Primera columna del tramo.
+ * @param j_fin Columna siguiente a la última del tramo.
+ */
+void Piramide::inicializarTramo(int n, int i, int j_inicio, int j_fin){
+    Nivel& nivel = piramide[n];
+    Nivel& base = piramide[n-1];
+    const int8_t homog_sin_fusion = niveles_purgados ? -1 : 0;
+    if (reduccion_2x2 != nullptr) {
+        reduccion_2x2(nivel, base, i, j_inicio, j_fin, homog_sin_fusion);
+        return;
+    }
+
+    for (int j = j_inicio; j < j_fin; j++) {
+        std::size_t Nodoi = nivel.indice(i, j);
+        std::size_t Base_NO = base.indice(i*2, j*2);
+        std::size_t Base_NE = Base_NO + 1;
+        std::size_t Base_SO = Base_NO + base.num_columnas;
+        std::size_t Base_SE = Base_SO + 1;
+        
+        //Caso 1: Nodos de la base son iguales y homogéneos.
+        // (la homogeneidad solo lee una columna, por eso se comprueba primero)
+        if(nodosSonHomogeneos(base, Base_NO, Base_NE, Base_SO, Base_SE) && nodosSonIguales(base, Base_NO, Base_NE, Base_SO, Base_SE)){
+            nivel.homog[Nodoi] = 1;
+            nivel.area[Nodoi] = base.area[Base_NO] + base.area[Base_NE] + base.area[Base_SO] + base.area[Base_SE];
+            nivel.copiarAtributos(Nodoi, base, Base_NO);
+            base.padre[Base_NO] = static_cast<int>(Nodoi);
+            base.padre[Base_NE] = static_cast<int>(Nodoi);
+            base.padre[Base_SO] = static_cast<int>(Nodoi);
+            base.padre[Base_SE] = static_cast<int>(Nodoi);
+        }
+        //Caso 2: Nodos de la base son suficientemente parecidos (umbral de similitud) y homogéneos.
+        // (se resuelve con el nivel completo en fusionarParecidos, porque crea clases nuevas en la tabla de atributos)
+
+        //Caso 3: Los nodos de la base son diferentes o no homogéneos.   
+        else{
+            nivel.homog[Nodoi] = homog_sin_fusion;
+        }
+    }
+}
+
+/**
+ * @brief Construye la base y los niveles superiores por teselas, sin superar config.memoria_maxima_mb.
+ * 
+ * Los niveles 0 a k se guardan en un archivo temporal proyectado en memoria (ver proyectarNivelesEnDisco), donde
+ * k es el mayor número de niveles tal que una banda de teselas de 2^k x 2^k nodos de la base quepa en la memoria
+ * máxima. La base se recorre por bandas de teselas: de cada banda se leen solo sus filas de la caché de la base,
+ * cada tesela se reduce hasta el nivel k (ver inicializarTesela) y las páginas de la banda se devuelven al
+ * sistema, que ya las tiene en el archivo. Los niveles por encima de k, que ocupan 4^k veces menos que la base,
+ * se construyen en memoria a partir de las raíces de las teselas en el nivel k.
+ * 
+ * Si no hay una caché válida, el CSV se lee entero directamente en el archivo temporal (y se guarda la caché
+ * para las siguientes ejecuciones). El resultado es el mismo que el de la construcción en memoria.
+ * 
+ */
+void Piramide::construirEnDisco(){
+    // Cada fila de la base ocupa BYTES_NODO por columna en los niveles de la tesela (4/3 contando los
+    // superiores) más lo que se lee de la caché; se reserva el doble
+    if (similitud.activa()) {
+        throw std::runtime_error("Error: la fusion de bloques parecidos no se puede usar al construir por teselas en "
+                                 "disco; aumente la memoria maxima o quite las tolerancias.");
+    }
+    const std::size_t memoria_maxima = config.memoria_maxima_mb << 20;
+    const std::size_t bytes_fila = 2 * BYTES_NODO * static_cast<std::size_t>(num_columnas);
+    int k = 0;
+    while (k + 1 < num_niv && (std::size_t{2} << k) * bytes_fila <= memoria_maxima) {
+        k++;
+    }
+    if (k == 0) {
+        throw std::runtime_error("Error: " + std::to_string(config.memoria_maxima_mb) + " MB no bastan para construir "
+                                 + "por teselas una base de " + std::to_string(num_columnas) + " columnas.");
+    }
+    const int lado = 1 << k;
+    std::cout << "\t\tTeselas de " << lado << " x " << lado << " nodos de la base, reducidas hasta el nivel " << k
+              << std::endl;
+
+    std::shared_ptr<ArchivoMapeado> archivo_niveles = proyectarNivelesEnDisco(config.rutaNiveles(), piramide, k + 1);
+    Nivel& base = piramide[0];
+
+    // Proyectar la caché de la base para leerla por bandas o, si no la hay, leer el CSV en el archivo temporal
+    Nivel cache(0, num_filas, num_columnas, 0);
+    cache.atributos = base.atributos;
+    bool desde_cache = config.usar_cache
+                    && proyectarCacheBase(config.rutaCache(), cache,
+                                          firmaArchivo(config.archivo_csv, config.precision_atributos),
+                                          config.verificar_cache, config.num_hilos);
+    if (desde_cache) {
+        std::cout << "\tBase leida por bandas de la cache " << config.rutaCache() << "." << std::endl;
+    } else {
+        std::cout << "\tLeyendo datos del archivo CSV..." << std::endl;
+        base.vaciarFilas(0, num_filas);
+        leerCSV(config.archivo_csv, base, config.precision_atributos, config.num_hilos);
+        if (config.usar_cache) {
+            escribirCacheBase();
+        }
+        liberarFilas(base, 0, num_filas);
+    }
+    std::cout << "\t" << base.atributos->size() << " combinaciones distintas de atributos." << std::endl;
+
+    std::cout << "\tInicializando niveles por teselas..." << std::endl;
+    {
+        // El tiempo de las teselas se anota en el nivel de sus raíces
+        auto medida = metricas.medirNivel(k);
+        int teselas_fila = (num_filas + lado - 1) / lado;
+        int teselas_columna = (num_columnas + lado - 1) / lado;
+        for (int tf = 0; tf < teselas_fila; tf++) {
+            // Filas de la banda en el nivel n: [fila_inicio(n), fila_fin(n))
+            auto fila_inicio = [&](int n) { return std::min((tf * lado) >> n, piramide[n].num_filas); };
+            auto fila_fin = [&](int n) { return std::min(((tf + 1) * lado) >> n, piramide[n].num_filas); };
+            for (int n = desde_cache ? 0 : 1; n <= k; n++) {
+                piramide[n].vaciarFilas(fila_inicio(n), fila_fin(n));
+            }
+
+            paraleloPara(config.num_hilos, teselas_columna, [&](std::size_t t) {
+                int tc = static_cast<int>(t);
+                if (desde_cache) {
+                    // Copiar la tesela de la caché; el área se reconstruye y todos los nodos empiezan huérfanos
+                    int columna_inicio = tc * lado;
+                    int columna_fin = std::min(columna_inicio + lado, num_columnas);
+                    std::size_t num = static_cast<std::size_t>(columna_fin - columna_inicio);
+                    for (int i = fila_inicio(0); i < fila_fin(0); i++) {
+                        std::size_t desde = base.indice(i, columna_inicio);
+                        std::memcpy(&base.homog[desde], &cache.homog[desde], num * sizeof(int8_t));
+                        std::memcpy(&base.clase[desde], &cache.clase[desde], num * sizeof(uint32_t));
+                        std::memcpy(&base.estaciones[desde], &cache.estaciones[desde], num * sizeof(int));
+                        for (std::size_t c = desde; c < desde + num; c++) {
+                            if (base.homog[c] == 1) {
+                                base.area[c] = 1;
+                            }
+                        }
+                    }
+                }
+                inicializarTesela(0, k, lado, tf, tc);
+            });
+
+            // Devolver la banda al sistema, salvo las raíces de las teselas
+            for (int n = 0; n < k; n++) {
+                liberarFilas(piramide[n], fila_inicio(n), fila_fin(n));
+            }
+            if (desde_cache) {
+                liberarFilas(cache, fila_inicio(0), fila_fin(0));
+            }
+        }
+        for (int n = 0; n <= k; n++) {
+            metricas.anotarVisitas(n, piramide[n].size());
+        }
+    }
+
+    // Si algún nivel de las teselas se ha quedado sin nodos homogéneos, los superiores tampoco los tendrían (ver
+    // inicializarNivelesRestantes); se busca desde abajo, donde el primero aparece enseguida
+    int vacio = 1;
+    while (vacio <= k && piramide[vacio].tieneHomogeneos()) {
+        vacio++;
+    }
+    if (vacio <= k) {
+        truncarNiveles(vacio);
+        return;
+    }
+
+    // Niveles superiores, en memoria
+    inicializarNivelesRestantes(k + 1);
+}
+
+/**
+ * @brief Elimina nodos no homogéneos de la pirámide y actualiza las relaciones entre nodos y sus padres.
+ * 
+ * Esta función purga la pirámide eliminando nodos no homogéneos y actualizando las relaciones de los nodos restantes con sus padres
+ * (ver purgarNoHomogeneos y cortarEnlacesPurgados). Si los niveles se construyeron con la purga fusionada, los nodos no homogéneos
+ * ya están vacíos y ningún enlace apunta a ellos, así que no hace falta recorrer la pirámide; con
+ * config.validar_purga_fusionada se comprueba que el resultado coincide con el de la purga por separado.
+ * Por último, compacta los niveles que han quedado casi vacíos (ver compactarNiveles).
+ * 
+ */
+void Piramide::purga() {
+    metricas.iniciarFase("purga");
+    if (niveles_purgados) {
+        std::cout << "\t\tNodos no homogéneos ya eliminados al construir los niveles..." << std::endl;
+        if (config.validar_purga_fusionada) {
+            validarPurgaFusionada();
+        }
+    } else {
+        purgarNoHomogeneos();
+        cortarEnlacesPurgados();
+    }
+
+    compactarNiveles();
+    metricas.terminarFase(piramide);
+}
+
+/**
+ * @brief Recorre la pirámide desde el nivel más alto hasta el más bajo y elimina los nodos no homogéneos.
+ */
+void Piramide::purgarNoHomogeneos() {
+    // Eliminar nodos no homogéneos
+    std::cout << "\t\tEliminando nodos no homogéneos..." << std::endl;
+    for (int n = num_niv - 1; n >= 0; n--) {
+        Nivel& nivel = piramide[n];
+        std::size_t tam_nivel = nivel.size();
+        auto medida = metricas.medirNivel(n);
+        metricas.anotarVisitas(n, tam_nivel);
+
+        for (std::size_t k = 0; k < tam_nivel; k++) {
+            // Si el nodo no es homogéneo, inicializarlo vacío.
+            if (nivel.homog[k] != 1) {
+                nivel.reset(k);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Recorre la pirámide desde el nivel más alto hasta el más bajo y elimina los enlaces con padres eliminados.
+ * 
+ * Un nodo conserva su padre mientras este siga existiendo, aunque el padre sea huérfano: los nodos huérfanos
+ * homogéneos son las raíces de las regiones. Como un padre solo se enlaza con sus hijos cuando se fusiona
+ * (y entonces es homogéneo), tras purgarNoHomogeneos ningún enlace debería apuntar a un nodo vacío; esta
+ * pasada lo garantiza si los niveles se modificaron por otro camino.
+ */
+void Piramide::cortarEnlacesPurgados() {
+    // Actualizar relaciones entre nodos y sus padres
+    std::cout << "\t\tActualizando relaciones entre nodos y sus padres..." << std::endl;
+    for (int n = num_niv - 1; n >= 0; n--) {
+        Nivel& nivel = piramide[n];
+        std::size_t tam_nivel = nivel.size();
+        auto medida = metricas.medirNivel(n);
+        metricas.anotarVisitas(n, tam_nivel);
+
+        for (std::size_t k = 0; k < tam_nivel; k++) {
+            // Si el nodo es válido y no es huérfano, actualizar la relación con su padre
+            if (!nivel.esVacio(k) && nivel.padre[k] != -1) {
+                const Nivel& superior = piramide[n + 1];
+
+                // Si el padre del nodo ha sido eliminado, eliminar la relación entre el nodo y su padre
+                if (superior.esVacio(nivel.padre[k])) {
+                    nivel.padre[k] = -1;
+                }
+            }
+        }
+    }
+}
+
+/**
+ * @brief Comprueba que la construcción con la purga fusionada da el mismo resultado que construir y purgar por separado.
+ * 
+ * Guarda una copia de las columnas de todos los niveles, vuelve a construir los niveles superiores sin purga fusionada,
+ * aplica las dos pasadas de purga y compara columna a columna. Informa de las primeras diferencias y lanza
+ * std::runtime_error si hay alguna. Duplica el tiempo de construcción y la memoria de los niveles, así que solo
+ * está pensada para validar cambios.
+ */
+void Piramide::validarPurgaFusionada() {
+    std::cout << "\t\tValidando la purga fusionada..." << std::endl;
+
+    // Copia de las columnas de un nivel
+    struct CopiaNivel {
+        std::vector<int8_t> homog;
+        std::vector<int> area, padre, estaciones;
+        std::vector<uint32_t> clase;
+    };
+    std::vector<CopiaNivel> fusionada;
+    for (const Nivel& nivel : piramide) {
+        fusionada.push_back({std::vector<int8_t>(nivel.homog.begin(), nivel.homog.end()),
+                             std::vector<int>(nivel.area.begin(), nivel.area.end()),
+                             std::vector<int>(nivel.padre.begin(), nivel.padre.end()),
+                             std::vector<int>(nivel.estaciones.begin(), nivel.estaciones.end()),
+                             std::vector<uint32_t>(nivel.clase.begin(), nivel.clase.end())});
+    }
+
+    // Repetir la construcción y la purga por separado
+    std::fill(piramide[0].padre.begin(), piramide[0].padre.end(), -1);
+    niveles_purgados = false;
+    inicializarNivelesRestantes();
+    purgarNoHomogeneos();
+    cortarEnlacesPurgados();
+    niveles_purgados = true;
+
+    // Comparar columna a columna
+    const std::size_t max_diferencias_mostradas = 20;
+    std::size_t num_diferencias = 0;
+    for (int n = 0; n < num_niv; n++) {
+        const Nivel& nivel = piramide[n];
+        const CopiaNivel& copia = fusionada[n];
+        auto comparar = [&](const char* nombre, const auto& fusionados, const auto& columna) {
+            for (std::size_t k = 0; k < columna.size(); k++) {
+                if (fusionados[k] != columna[k]) {
+                    if (num_diferencias < max_diferencias_mostradas) {
+                        std::cerr << "\t\tNivel " << n << ", celda " << k << ": " << nombre << " = "
+                                  << +fusionados[k] << " con la purga fusionada y " << +columna[k] << " por separado"
+                                  << std::endl;
+                    }
+                    num_diferencias++;
+                }
+            }
+        };
+        comparar("homog", copia.homog, nivel.homog);
+        comparar("area", copia.area, nivel.area);
+        comparar("padre", copia.padre, nivel.padre);
+        comparar("clase", copia.clase, nivel.clase);
+        comparar("estaciones", copia.estaciones, nivel.estaciones);
+    }
+
+    if (num_diferencias > 0) {
+        throw std::runtime_error("Error: la purga fusionada difiere de la purga por separado en "
+                                 + std::to_string(num_diferencias) + " valores.");
+    }
+    std::cout << "\t\tLa purga fusionada coincide con la purga por separado." << std::endl;
+}
+
+/**
+ * @brief Pasa a la forma dispersa los niveles con pocos nodos no vacíos.
+ * 
+ * Un nivel se compacta si la fracción de sus celdas que no están vacías es menor que config.densidad_dispersa.
+ * Los niveles dispersos solo guardan sus nodos no vacíos y un mapa de bits de las celdas ocupadas, así que su
+ * memoria pasa a depender del área homogénea y no del tamaño de la rejilla.
+ * 
+ */
+void Piramide::compactarNiveles() {
+    std::cout << "\t\tCompactando niveles dispersos..." << std::endl;
+    std::size_t memoria_antes = 0;
+    std::size_t memoria_despues = 0;
+    int num_dispersos = 0;
+    for (Nivel& nivel : piramide) {
+        memoria_antes += nivel.memoria();
+        std::size_t tam_nivel = nivel.size();
+        if (!nivel.disperso && tam_nivel > 0
+            && static_cast<double>(nivel.numNoVacios()) < config.densidad_dispersa * static_cast<double>(tam_nivel)) {
+            nivel.compactar();
+        }
+        if (nivel.disperso) {
+            num_dispersos++;
+        }
+        memoria_despues += nivel.memoria();
+    }
+    std::cout << "\t\t" << num_dispersos << " de " << num_niv << " niveles dispersos, memoria de los niveles: "
+              << memoria_antes / (1024 * 1024) << " MB -> " << memoria_despues / (1024 * 1024) << " MB" << std::endl;
+}
+
+
+/**
+ * @brief Enlaza nodos en la pirámide según criterios específicos.
+ * 
+ * Esta función enlaza nodos en la pirámide siguiendo criterios específicos y de acuerdo con la función enlazarConMejorCandidato.
+ * Primero recorre la pirámide desde el nivel más alto hasta el más bajo en busca de nodos enlazables, visitando solo los
+ * nodos no vacíos de cada nivel. Si se encuentra un nodo enlazable, se intenta enlazar con el mejor candidato.
+ * 
+ * Cada enlace cambia el área de los antepasados del nuevo padre (y del anterior), y con ella la elección de los nodos
+ * que los tienen como candidatos; solo esos nodos se añaden a la cola de trabajo (ver sumarAreaEnlace). Después de la
+ * pasada inicial se procesa la cola por rondas, cada una de arriba abajo, hasta que se vacía: el coste de converger
+ * depende del número de enlaces que cambian y no del tamaño de la pirámide. Las estadísticas de la pasada inicial y
+ * de la cola quedan en estadisticas_enlaza. Con los enlaces ya definitivos, se construyen las listas de hijos.
+ * 
+ */
+void Piramide::enlaza() {
+    metricas.iniciarFase("enlaza");
+    estadisticas_enlaza = EstadisticasEnlaza();
+    prepararColaEnlaza();
+
+    // Pasada inicial: recorrer la pirámide desde el nivel más alto hasta el más bajo (el último nivel no tiene padres)
+    metricas.anotarIteracion();
+    for (int n = num_niv - 2; n >= 0; n--) {
+        auto medida = metricas.medirNivel(n);
+        std::size_t visitados = 0;
+        piramide[n].recorrerNodos([&](std::size_t k) {
+            visitados++;
+            evaluarEnlace(n, k);
+        });
+        metricas.anotarVisitas(n, visitados);
+    }
+    procesarColaEnlaza();
+
+    cola_enlaza.clear();
+    en_cola_enlaza.clear();
+    construirHijos();
+    informarEnlaza();
+    metricas.terminarFase(piramide);
+}
+
+/**
+ * @brief Prepara la cola de trabajo de enlaza, vacía, con un mapa de bits por nivel.
+ * 
+ * Si los mapas de bits ya existen (se conservan entre actualizaciones, ver actualizar), no se vuelven a reservar:
+ * al vaciarse la cola quedan a cero.
+ */
+void Piramide::prepararColaEnlaza(){
+    cola_enlaza.assign(num_niv, std::vector<std::size_t>());
+    en_cola_enlaza.resize(num_niv);
+    for (int n = 0; n < num_niv; n++) {
+        if (en_cola_enlaza[n].size() != (piramide[n].size() + 63) / 64) {
+            en_cola_enlaza[n].assign((piramide[n].size() + 63) / 64, 0);
+        }
+    }
+}
+
+/**
+ * @brief Evalúa el enlace de un nodo con enlazarConMejorCandidato, si es enlazable.
+ * 
+ * Durante una actualización anota antes el estado del nodo (ver anotarEnlacePrevio).
+ * 
+ * @param n Nivel del nodo.
+ * @param k Índice del nodo en su nivel.
+ */
+void Piramide::evaluarEnlace(int n, std::size_t k){
+    estadisticas_enlaza.evaluados++;
+    if (!enlaces_previos.empty()) {
+        anotarEnlacePrevio(n, k);
+    }
+    Nodo nodo_enlazable = nodo(n, k);
+    if (!nodo_enlazable.esEnlazable()) {
+        return;
+    }
+    bool era_huerfano = nodo_enlazable.esHuerfano();
+    if (enlazarConMejorCandidato(nodo_enlazable)) {
+        if (era_huerfano) {
+            estadisticas_enlaza.enlaces_nuevos++;
+        } else {
+            estadisticas_enlaza.reenlaces++;
+        }
+    }
+}
+
+/**
+ * @brief Añade un nodo a la cola de trabajo de enlaza, si no está ya en ella y no está vacío.
+ * 
+ * Los nodos del último nivel no tienen candidatos y no se encolan.
+ * 
+ * @param n Nivel del nodo.
+ * @param k Índice del nodo en su nivel.
+ */
+void Piramide::encolarEnlace(int n, std::size_t k){
+    uint64_t& palabra = en_cola_enlaza[n][k >> 6];
+    uint64_t bit = uint64_t{1} << (k & 63);
+    if (n + 1 >= num_niv || (palabra & bit) != 0 || piramide[n].esVacio(k)) {
+        return;
+    }
+    palabra |= bit;
+    cola_enlaza[n].push_back(k);
+    estadisticas_enlaza.encolados++;
+    estadisticas_enlaza.pendientes++;
+    estadisticas_enlaza.cola_maxima = std::max(estadisticas_enlaza.cola_maxima, estadisticas_enlaza.pendientes);
+}
+
+/**
+ * @brief Procesa la cola de trabajo de enlaza por rondas hasta que se vacía.
+ * 
+ * Cada ronda recorre los niveles de arriba abajo; los nodos que se encolan durante una ronda se evalúan en la
+ * siguiente.
+ */
+void Piramide::procesarColaEnlaza(){
+    std::vector<std::size_t> ronda;
+    while (estadisticas_enlaza.pendientes > 0) {
+        metricas.anotarIteracion();
+        estadisticas_enlaza.rondas++;
+        for (int n = num_niv - 2; n >= 0; n--) {
+            if (cola_enlaza[n].empty()) {
+                continue;
+            }
+            auto medida = metricas.medirNivel(n);
+            ronda.swap(cola_enlaza[n]);
+            cola_enlaza[n].clear();
+            estadisticas_enlaza.pendientes -= ronda.size();
+            for (std::size_t k : ronda) {
+                en_cola_enlaza[n][k >> 6] &= ~(uint64_t{1} << (k & 63));
+            }
+            for (std::size_t k : ronda) {
+                evaluarEnlace(n, k);
+            }
+            metricas.anotarVisitas(n, ronda.size());
+        }
+    }
+}
+
+/**
+ * @brief Muestra las estadísticas de la última ejecución de enlaza.
+ */
+void Piramide::informarEnlaza() const {
+    std::cout << "\t\t" << estadisticas_enlaza.enlaces_nuevos << " enlaces nuevos y " << estadisticas_enlaza.reenlaces
+              << " cambios de padre; " << estadisticas_enlaza.evaluados << " nodos evaluados, "
+              << estadisticas_enlaza.encolados << " de ellos en " << estadisticas_enlaza.rondas
+              << " rondas de la cola (maximo " << estadisticas_enlaza.cola_maxima << " pendientes)" << std::endl;
+}
+
+/**
+ * @brief Clasifica los nodos de la Pirámide para generar regiones.
+ * 
+ * Cada nodo huérfano no vacío es la raíz de una región nueva (crearClase) y cada nodo con padre pertenece a la
+ * región de su padre (incluirEnClase). Las fusiones entre regiones se guardan como uniones en una estructura de
+ * conjuntos disjuntos, de modo que se pueden hacer desde varios hilos a la vez. Las pasadas son:
+ *  1. Contar las raíces de cada banda de filas de cada nivel, para numerar de antemano sus regiones provisionales.
+ *  2. Etiquetar los niveles de arriba abajo: dentro de un nivel, cada banda solo lee las regiones del nivel
+ *     superior, ya etiquetado, así que las bandas se etiquetan en paralelo. A la vez, cada banda suma el bloque de
+ *     celdas de sus nodos a las estadísticas de su región provisional, en una tabla propia (ver anotarBloqueRegion).
+ *  3. Fusionar cada raíz con sus vecinas de la misma clase (fusionarConVecinos), ya con todas las regiones
+ *     provisionales asignadas. Como la unión cuelga siempre la raíz mayor de la menor, el resultado no depende del
+ *     orden de las uniones.
+ *  4. Aplanar: sustituir cada región provisional por el número denso de su conjunto, en [0, num_regiones).
+ *  5. Combinar las tablas de las bandas en tabla_regiones, ya con las regiones densas.
+ * Solo se visitan los nodos no vacíos de cada nivel. El resultado no depende del número de hilos: las regiones
+ * quedan numeradas en el orden de su primera raíz, de arriba abajo y en orden fila-mayor.
+ */
+void Piramide::clasifica() {
+    metricas.iniciarFase("clasifica");
+    int num_hilos = hilosEfectivos(config.num_hilos);
+
+    // 1. Contar las raíces de cada banda; primera_region[n][b] es la primera región provisional de la banda b
+    std::cout << "\t\tContando las raices de las regiones..." << std::endl;
+    std::vector<std::vector<uint32_t>> primera_region(num_niv);
+    std::vector<int> filas_banda(num_niv);
+    uint32_t num_raices = 0;
+    for (int n = num_niv - 1; n >= 0; n--) {
+        const Nivel& nivel = piramide[n];
+        filas_banda[n] = filasPorBanda(nivel.num_filas, num_hilos);
+        int num_bandas = (nivel.num_filas + filas_banda[n] - 1) / filas_banda[n];
+        std::vector<uint32_t> raices(num_bandas, 0);
+        paraleloPara(num_hilos, num_bandas, [&](std::size_t banda) {
+            uint32_t num = 0;
+            nivel.recorrerTramo(tramoBanda(nivel, filas_banda[n], banda, false),
+                                tramoBanda(nivel, filas_banda[n], banda, true),
+                                [&](std::size_t, std::size_t p) { num += nivel.padre[p] == -1; });
+            raices[banda] = num;
+        });
+
+        primera_region[n].resize(num_bandas);
+        for (int b = 0; b < num_bandas; b++) {
+            primera_region[n][b] = num_raices;
+            num_raices += raices[b];
+        }
+    }
+    conjuntos_regiones.reiniciar(num_raices);
+
+    // 2. Etiquetar los niveles de arriba abajo con las regiones provisionales, acumulando las estadísticas de cada
+    // región provisional en una tabla propia de cada banda
+    std::cout << "\t\tEtiquetando " << num_raices << " raices..." << std::endl;
+    std::vector<std::vector<AcumuladorRegiones>> parciales(num_niv);
+    for (int n = num_niv - 1; n >= 0; n--) {
+        Nivel& nivel = piramide[n];
+        auto medida = metricas.medirNivel(n);
+        std::atomic<std::size_t> visitados{0};
+        nivel.reservarRegiones();
+        parciales[n].resize(primera_region[n].size());
+
+        paraleloPara(num_hilos, primera_region[n].size(), [&](std::size_t banda) {
+            uint32_t siguiente = primera_region[n][banda];
+            std::size_t num = 0;
+            nivel.recorrerTramo(tramoBanda(nivel, filas_banda[n], banda, false),
+                                tramoBanda(nivel, filas_banda[n], banda, true), [&](std::size_t k, std::size_t p) {
+                num++;
+                if (nivel.padre[p] == -1) {
+                    // Si el Nodo es huérfano (no tiene padre), crea una nueva clase
+                    crearClase(nivel, p, siguiente++);
+                } else {
+                    // Si el Nodo no es huérfano, lo incluye en la clase de su Nodo padre
+                    incluirEnClase(nivel, p, piramide[n + 1]);
+                }
+                anotarBloqueRegion(nivel, k, p, parciales[n][banda]);
+            });
+            visitados += num;
+        });
+        metricas.anotarVisitas(n, visitados);
+    }
+
+    // 3. Fusionar las raíces con sus vecinas de la misma clase
+    std::cout << "\t\tFusionando regiones..." << std::endl;
+    for (int n = num_niv - 1; n >= 0; n--) {
+        const Nivel& nivel = piramide[n];
+        auto medida = metricas.medirNivel(n);
+        paraleloPara(num_hilos, primera_region[n].size(), [&](std::size_t banda) {
+            nivel.recorrerTramo(tramoBanda(nivel, filas_banda[n], banda, false),
+                                tramoBanda(nivel, filas_banda[n], banda, true), [&](std::size_t k, std::size_t p) {
+                if (nivel.padre[p] != -1) {
+                    return;
+                }
+                Nodo raiz = nodo(n, k);
+                fusionarConVecinos(raiz);
+            });
+        });
+    }
+
+    // 4. Aplanar las regiones provisionales en regiones densas
+    std::vector<uint32_t> etiquetas = conjuntos_regiones.etiquetasDensas(num_regiones);
+    conjuntos_regiones.clear();
+    regiones_libres.clear();
+    const std::size_t NODOS_TAREA = 1 << 16;
+    for (int n = num_niv - 1; n >= 0; n--) {
+        Columna<uint32_t>& region = piramide[n].region;
+        auto medida = metricas.medirNivel(n);
+        paraleloPara(num_hilos, (region.size() + NODOS_TAREA - 1) / NODOS_TAREA, [&](std::size_t tarea) {
+            std::size_t fin = std::min(region.size(), (tarea + 1) * NODOS_TAREA);
+            for (std::size_t p = tarea * NODOS_TAREA; p < fin; p++) {
+                if (region[p] != REGION_VACIA) {
+                    region[p] = etiquetas[region[p]];
+                }
+            }
+        });
+    }
+
+    // 5. Combinar las estadísticas de las bandas en la tabla de regiones
+    tabla_regiones.reiniciar(num_regiones, num_filas, num_columnas);
+    for (const std::vector<AcumuladorRegiones>& nivel : parciales) {
+        for (const AcumuladorRegiones& parcial : nivel) {
+            tabla_regiones.combinar(parcial, *piramide[0].atributos, etiquetas);
+        }
+    }
+    std::cout << "\t\t" << num_regiones << " regiones." << std::endl;
+    metricas.terminarFase(piramide);
+}
+
+/**
+ * @brief Anota para la región de un nodo el bloque de celdas de la base que representa (pasada 2 de clasifica).
+ * 
+ * Un nodo homogéneo del nivel n cubre un bloque de 2^n x 2^n celdas con su clase, del que forman parte sus hijos
+ * naturales, así que cada celda se cuenta una sola vez en el nodo más alto de su cadena de padres naturales: los
+ * nodos cuyo padre es el natural no anotan nada y los demás (raíces y nodos enlazados con un padre vecino) anotan
+ * su bloque entero, que se suma de una vez al combinar las tablas (ver TablaRegiones::combinar). Los hijos
+ * enlazados de un nodo suman sus propios bloques, así que el área de una región es la suma de las áreas de sus
+ * raíces. Con tolerancias de similitud, un bloque fusionado por parecido se anota con las clases de sus hijos (ver
+ * anotarBloqueClases), así que los rangos de los umbrales son los de las celdas de la base.
+ * 
+ * @param nivel Nivel del nodo, con la región del nodo ya asignada.
+ * @param indice Índice del nodo en su nivel.
+ * @param posicion Posición del nodo en las columnas del nivel.
+ * @param acumulador Bloques anotados por la banda del nodo.
+ */
+void Piramide::anotarBloqueRegion(const Nivel& nivel, std::size_t indice, std::size_t posicion,
+                                  AcumuladorRegiones& acumulador) const {
+    const int n = nivel.nivel;
+    const int fila = nivel.fila(indice);
+    const int columna = nivel.columna(indice);
+    const int padre = nivel.padre[posicion];
+    if (padre != -1 && static_cast<std::size_t>(padre) == piramide[n + 1].indice(fila / 2, columna / 2)) {
+        return;
+    }
+    anotarBloqueClases(nivel.region[posicion], n, fila, columna, acumulador);
+}
+
+/**
+ * @brief Anota el bloque de celdas de un nodo homogéneo para una región, con las clases de las celdas de la base.
+ * 
+ * Un nodo fusionado por parecido (caso 2) tiene como clase la media de las de sus cuatro hijos naturales, que
+ * siguen siendo homogéneos y cubren su bloque. En lugar de su bloque se anotan los de sus hijos, bajando hasta los
+ * nodos cuyos hijos tienen su misma clase (caso 1) o hasta la base: así los rangos de los umbrales de la región
+ * son los de las celdas y no los de las medias. Sin tolerancias de similitud los hijos de un nodo homogéneo
+ * tienen siempre su clase, así que no se baja nunca.
+ * 
+ * @param region Región del bloque.
+ * @param n Nivel del nodo.
+ * @param fila Fila del nodo en su nivel.
+ * @param columna Columna del nodo en su nivel.
+ * @param acumulador Bloques anotados por la banda del nodo.
+ */
+void Piramide::anotarBloqueClases(uint32_t region, int n, int fila, int columna,
+                                  AcumuladorRegiones& acumulador) const {
+    const Nivel& nivel = piramide[n];
+    const uint32_t clase = nivel.clase[nivel.posicion(nivel.indice(fila, columna))];
+    if (n > 0) {
+        const Nivel& inferior = piramide[n - 1];
+        std::size_t NO = inferior.indice(fila * 2, columna * 2);
+        const std::size_t hijos[4] = {NO, NO + 1, NO + inferior.num_columnas, NO + inferior.num_columnas + 1};
+        bool fusionado = false;
+        bool homogeneos = true;
+        for (std::size_t hijo : hijos) {
+            std::size_t q = inferior.posicion(hijo);
+            fusionado = fusionado || inferior.clase[q] != clase;
+            homogeneos = homogeneos && inferior.homog[q] == 1;
+        }
+        if (fusionado && homogeneos) {
+            for (int i = 0; i < 2; i++) {
+                for (int j = 0; j < 2; j++) {
+                    anotarBloqueClases(region, n - 1, fila * 2 + i, columna * 2 + j, acumulador);
+                }
+            }
+            return;
+        }
+    }
+    acumulador.anotar(region, clase, n, fila, columna);
+}
+
+/**
+ * @brief Calcula la tabla de estadísticas de las regiones de una Pirámide ya clasificada.
+ * 
+ * Hace la misma suma por bloques que clasifica() (ver anotarBloqueRegion) a partir de la columna de regiones, por
+ * bandas de filas en paralelo. actualizar() la llama al terminar y sirve para recuperar la tabla tras
+ * cargarInstantanea(), que la vacía.
+ */
+void Piramide::calcularEstadisticasRegiones() {
+    if (num_niv == 0 || piramide[0].region.size() == 0) {
+        throw std::runtime_error("Error: solo se pueden calcular las estadisticas de una piramide ya clasificada.");
+    }
+    int num_hilos = hilosEfectivos(config.num_hilos);
+    tabla_regiones.reiniciar(num_regiones, num_filas, num_columnas);
+    for (int n = num_niv - 1; n >= 0; n--) {
+        const Nivel& nivel = piramide[n];
+        int filas_banda = filasPorBanda(nivel.num_filas, num_hilos);
+        std::vector<AcumuladorRegiones> parciales((nivel.num_filas + filas_banda - 1) / filas_banda);
+        paraleloPara(num_hilos, parciales.size(), [&](std::size_t banda) {
+            nivel.recorrerTramo(tramoBanda(nivel, filas_banda, banda, false), tramoBanda(nivel, filas_banda, banda, true),
+                                [&](std::size_t k, std::size_t p) { anotarBloqueRegion(nivel, k, p, parciales[banda]); });
+        });
+        for (const AcumuladorRegiones& parcial : parciales) {
+            tabla_regiones.combinar(parcial, *piramide[0].atributos);
+        }
+    }
+    std::cout << "\t\tEstadisticas de " << num_regiones - regiones_libres.size() << " regiones calculadas." << std::endl;
+}
+
+/**
+ * @brief Actualiza la Pirámide ya clasificada con un lote de celdas de la base cambiadas, sin reconstruirla.
+ * 
+ * Solo cambian los antepasados naturales de las celdas (el nodo del nivel n que cubre la celda (i, j) es
+ * (i >> n, j >> n)), los nodos enlazados con ellos y las regiones a las que pertenecen, así que el trabajo depende
+ * del número de celdas cambiadas por la altura de la pirámide y no del tamaño de la base. Las fases son:
+ *  1. Escribir los nuevos valores en la base, con los atributos redondeados a config.precision_atributos.
+ *  2. Desenlazar los antepasados, de arriba abajo: cada uno se suelta de su padre, restando su área a los
+ *     antepasados de este (ver sumarAreaEnlace), y suelta a sus hijos, naturales o enlazados, que quedan huérfanos.
+ *  3. Reconstruirlos de abajo arriba con las reglas de inicializarTramo y fusionarParecidos. Los que no se fusionan
+ *     quedan vacíos, como tras purga(), y ningún enlace apunta a ellos.
+ *  4. Enlazar con la cola de trabajo de enlaza, empezando por los nodos reconstruidos, los huérfanos y los que
+ *     tienen a alguno de ellos como candidato.
+ *  5. Recalcular las listas de hijos de los padres que han ganado o perdido hijos (ver Nivel::actualizarHijos).
+ *  6. Reetiquetar las regiones de los nodos cuyo padre ha cambiado y de sus descendientes, y volver a unir las
+ *     raíces vecinas de la misma clase alrededor de los nodos que han cambiado (ver actualizarRegiones).
+ *     La tabla de estadísticas de las regiones se vuelve a calcular entera (ver calcularEstadisticasRegiones),
+ *     porque sus rectángulos y rangos no se pueden restar: es la única fase que recorre toda la pirámide.
+ * 
+ * Los niveles siguen la forma que tenían: los dispersos reciben posiciones para los nodos nuevos (ver
+ * Nivel::ocupar) y no se vuelven a compactar. Si algún nodo del nivel más alto pasa a ser homogéneo, la pirámide
+ * crece hasta el nivel en el que dejen de serlo (ver ampliarNivel); los niveles que se quedan vacíos se conservan.
+ * El resultado de enlaza es, como el de la construcción completa, un punto fijo en el que ningún nodo tiene un
+ * candidato mejor que su padre, aunque puede no ser el mismo, porque depende del orden en el que se evalúan los
+ * nodos. La pirámide puede estar construida o cargada de una instantánea.
+ * 
+ * @param cambios Nuevos valores de las celdas (el id de cada una es su índice plano en la base); si una celda
+ *                aparece varias veces, vale la última.
+ */
+void Piramide::actualizar(const std::vector<FilaCSV>& cambios) {
+    if (num_niv == 0 || piramide[0].region.size() == 0) {
+        throw std::runtime_error("Error: solo se puede actualizar una piramide ya clasificada.");
+    }
+    Nivel& base = piramide[0];
+    for (std::size_t c = 0; c < cambios.size(); c++) {
+        if (cambios[c].id < 0 || static_cast<std::size_t>(cambios[c].id) >= base.size()) {
+            throw std::runtime_error("Error: la celda " + std::to_string(cambios[c].id) + " del cambio "
+                                     + std::to_string(c + 1) + " esta fuera de la base.");
+        }
+    }
+    metricas.iniciarFase("actualizar");
+    std::cout << "\t\tActualizando " << cambios.size() << " celdas de la base..." << std::endl;
+
+    // 1. Clase y estaciones nuevas de cada celda, sin las que no cambian
+    TablaAtributos& tabla = *base.atributos;
+    std::unordered_map<std::size_t, std::pair<uint32_t, int>> valores;
+    std::size_t num_redondeados = 0;
+    for (const FilaCSV& cambio : cambios) {
+        AtributosSuelo atributos{cambio.capacidad_campo_media, cambio.pendiente_3clases, cambio.porosidad_media,
+                                 cambio.punto_marchitez_medio, cambio.umbral_humedo, cambio.umbral_intermedio,
+                                 cambio.umbral_seco};
+        for (int c = 0; c < NUM_ATRIBUTOS_SUELO; c++) {
+            num_redondeados += !redondearPrecision(atributos.*CAMPOS_ATRIBUTOS[c], config.precision_atributos[c]);
+        }
+        valores[static_cast<std::size_t>(cambio.id)] = {tabla.internar(atributos), cambio.estaciones};
+    }
+    if (num_redondeados > 0) {
+        std::cout << "\t\t" << num_redondeados << " valores que no se conservan con la precision elegida; se guardan "
+                  << "redondeados." << std::endl;
+    }
+    std::vector<std::vector<std::size_t>> afectados(num_niv);
+    for (const auto& valor : valores) {
+        std::size_t p = base.posicion(valor.first);
+        if (base.homog[p] != 1 || base.clase[p] != valor.second.first || base.estaciones[p] != valor.second.second) {
+            afectados[0].push_back(valor.first);
+        }
+    }
+    if (afectados[0].empty()) {
+        std::cout << "\t\tNinguna celda cambia." << std::endl;
+        metricas.terminarFase(piramide, false);
+        return;
+    }
+
+    // Antepasados naturales que existen en cada nivel, en orden fila-mayor
+    std::sort(afectados[0].begin(), afectados[0].end());
+    for (int n = 1; n < num_niv; n++) {
+        afectados[n] = recogerPadres(n, afectados[n - 1]);
+    }
+
+    // La tabla puede tener clases nuevas, y la pirámide puede venir de una instantánea sin la similitud preparada
+    similitud.preparar(config.tolerancia_absoluta, config.tolerancia_relativa, nucleoDisponible(config.nucleo_2x2));
+    if (similitud.activa()) {
+        similitud.actualizar(tabla);
+    }
+    estadisticas_enlaza = EstadisticasEnlaza();
+    prepararColaEnlaza();
+    enlaces_previos.assign(num_niv, std::unordered_map<std::size_t, EnlacePrevio>());
+
+    // 2. Desenlazar los antepasados, de arriba abajo
+    for (int n = num_niv - 1; n >= 0; n--) {
+        auto medida = metricas.medirNivel(n);
+        metricas.anotarVisitas(n, afectados[n].size());
+        for (std::size_t k : afectados[n]) {
+            desenlazarNodo(n, k);
+        }
+    }
+
+    // 3. Reconstruirlos de abajo arriba
+    std::vector<std::size_t> nuevos;
+    for (std::size_t k : afectados[0]) {
+        if (base.esVacio(k)) {
+            nuevos.push_back(k);
+        }
+    }
+    base.ocupar(nuevos);
+    for (std::size_t k : afectados[0]) {
+        std::size_t p = base.posicion(k);
+        base.homog[p] = 1;
+        base.area[p] = 1;
+        base.clase[p] = valores[k].first;
+        base.estaciones[p] = valores[k].second;
+        encolarEnlace(0, k);
+    }
+    std::size_t num_fusionados = 0;
+    for (int n = 1; n < num_niv; n++) {
+        auto medida = metricas.medirNivel(n);
+        num_fusionados += reconstruirNodos(n, afectados[n]);
+    }
+
+    // Si algún nodo reconstruido del nivel más alto es homogéneo, la pirámide había terminado antes que su
+    // geometría (ver inicializarNivelesRestantes) y crece un nivel, cuyos únicos nodos posibles son sus padres
+    while (num_niv < geometria->num_niv
+           && std::any_of(afectados[num_niv - 1].begin(), afectados[num_niv - 1].end(), [&](std::size_t k) {
+                  const Nivel& superior = piramide[num_niv - 1];
+                  return superior.homog[superior.posicion(k)] == 1;
+              })) {
+        ampliarNivel();
+        const int n = num_niv - 1;
+        const Nivel& nivel = piramide[n];
+        afectados.push_back(recogerPadres(n, afectados[n - 1]));
+
+        // La cola de enlaza ya tiene trabajo de los niveles inferiores: solo se añade el nivel nuevo
+        enlaces_previos.emplace_back();
+        cola_enlaza.emplace_back();
+        en_cola_enlaza.emplace_back((nivel.size() + 63) / 64, 0);
+        auto medida = metricas.medirNivel(n);
+        for (std::size_t k : afectados[n]) {
+            desenlazarNodo(n, k);
+        }
+        num_fusionados += reconstruirNodos(n, afectados[n]);
+    }
+
+    // 4. Enlazar, con la cola de trabajo de enlaza
+    procesarColaEnlaza();
+    informarEnlaza();
+
+    // 5. y 6. Listas de hijos y regiones de los nodos cuyo padre ha cambiado
+    for (int n = 1; n < num_niv; n++) {
+        std::vector<std::size_t> padres;
+        const Nivel& inferior = piramide[n - 1];
+        for (const auto& previo : enlaces_previos[n - 1]) {
+            std::size_t p = inferior.posicion(previo.first);
+            int actual = inferior.homog[p] == -1 ? -1 : inferior.padre[p];
+            int anterior = previo.second.vacio ? -1 : previo.second.padre;
+            if (actual != anterior) {
+                if (anterior != -1) {
+                    padres.push_back(static_cast<std::size_t>(anterior));
+                }
+                if (actual != -1) {
+                    padres.push_back(static_cast<std::size_t>(actual));
+                }
+            }
+        }
+        piramide[n].actualizarHijos(inferior, std::move(padres));
+    }
+    std::size_t num_etiquetados = actualizarRegiones();
+    enlaces_previos.clear();
+    // Los rectángulos y rangos de las regiones no se pueden restar: la tabla se vuelve a calcular entera
+    calcularEstadisticasRegiones();
+
+    std::size_t num_tocados = 0;
+    for (const std::vector<std::size_t>& nivel : afectados) {
+        num_tocados += nivel.size();
+    }
+    std::cout << "\t\t" << afectados[0].size() << " celdas cambiadas, " << num_tocados << " antepasados reconstruidos ("
+              << num_fusionados << " homogeneos), " << num_etiquetados << " nodos reetiquetados; "
+              << num_regiones - regiones_libres.size() << " regiones." << std::endl;
+    metricas.terminarFase(piramide, false);
+}
 
-                id_nodo++;
-            }
+/**
+ * @brief Obtiene los padres naturales que existen en el nivel n de unos nodos del nivel n - 1.
+ * 
+ * @param n Nivel de los padres (n >= 1).
+ * @param hijos Índices planos de los nodos del nivel n - 1.
+ * @return Índices planos de los padres en el nivel n, en orden fila-mayor y sin repetir.
+ */
+std::vector<std::size_t> Piramide::recogerPadres(int n, const std::vector<std::size_t>& hijos) const {
+    const Nivel& inferior = piramide[n - 1];
+    const Nivel& nivel = piramide[n];
+    std::vector<std::size_t> padres;
+    padres.reserve(hijos.size());
+    for (std::size_t k : hijos) {
+        int i = inferior.fila(k) / 2;
+        int j = inferior.columna(k) / 2;
+        if (i < nivel.num_filas && j < nivel.num_columnas) {
+            padres.push_back(nivel.indice(i, j));
         }
-        // Añadir el nivel inicializado a la estructura de la pirámide
-        piramide.push_back(std::move(level));
     }
-    std::cout << "\t\tPiramide inicializada..." << std::endl;
+    std::sort(padres.begin(), padres.end());
+    padres.erase(std::unique(padres.begin(), padres.end()), padres.end());
+    return padres;
 }
 
+/**
+ * @brief Actualiza la Pirámide con las celdas de un archivo CSV de cambios (ver leerCambiosCSV y actualizar).
+ * 
+ * @param ruta Ruta del archivo de cambios, con el mismo formato que el CSV de la base.
+ */
+void Piramide::actualizarDesdeCSV(const std::string& ruta) {
+    std::cout << "\tLeyendo los cambios de " << ruta << "..." << std::endl;
+    actualizar(leerCambiosCSV(ruta));
+}
 
 /**
- * @brief Lee los datos de un archivo CSV y asigna los valores a los nodos de la pirámide.
+ * @brief Anota el padre de un nodo antes de cambiarlo durante una actualización, si no estaba ya anotado.
+ * 
+ * @param n Nivel del nodo.
+ * @param k Índice del nodo en su nivel.
+ */
+void Piramide::anotarEnlacePrevio(int n, std::size_t k){
+    const Nivel& nivel = piramide[n];
+    std::size_t p = nivel.posicion(k);
+    enlaces_previos[n].emplace(k, EnlacePrevio{nivel.padre[p], nivel.homog[p] == -1});
+}
+
+/**
+ * @brief Suelta un nodo de su padre y de sus hijos antes de reconstruirlo (fase 2 de actualizar).
  * 
- * Esta función lee un archivo CSV llamado "completo0.csv" y extrae los datos para cada nodo.
- * A continuación, asigna los valores extraídos a las propiedades de los nodos correspondientes en
- * la estructura de la pirámide.
+ * El área del nodo se resta a su padre y a los antepasados de este. Los hijos quedan huérfanos y se encolan para
+ * volver a enlazarlos. Se llama de arriba abajo, así que los hijos naturales de un nodo reconstruido ya están
+ * sueltos al llegar a ellos.
  * 
+ * @param n Nivel del nodo.
+ * @param k Índice del nodo en su nivel.
  */
-void Piramide::leerArchivoCSV() {
-    // Abrir el archivo CSV
-    std::ifstream file("completo0.csv");
-    if (!file) {
-        throw std::runtime_error("Error: no se pudo abrir el archivo.");
+void Piramide::desenlazarNodo(int n, std::size_t k){
+    Nivel& nivel = piramide[n];
+    anotarEnlacePrevio(n, k);
+    std::size_t p = nivel.posicion(k);
+    if (nivel.homog[p] == -1) {
         return;
     }
-
-    std::string line;
-
-    // Leer encabezado
-    std::cout << "\t\tLeyendo encabezado del archivo..." << std::endl;
-    std::getline(file, line);
-    std::cout << "\t\tLeyendo cada linea del archivo..." << std::endl;
-    // Leer y procesar cada línea del archivo CSV
-    while (std::getline(file, line)) {
-        std::stringstream ss(line);
-        std::string id_str, capacidad_campo_media_str, estaciones_str, pendiente_3clases_str,
-                    porosidad_media_str, punto_marchitez_medio_str, umbral_humedo_str,
-                    umbral_intermedio_str, umbral_seco_str;
-
-        // Extraer los valores de la línea actual
-        std::getline(ss, id_str, ',');
-        std::getline(ss, capacidad_campo_media_str, ',');
-        std::getline(ss, estaciones_str, ',');
-        std::getline(ss, pendiente_3clases_str, ',');
-        std::getline(ss, porosidad_media_str, ',');
-        std::getline(ss, punto_marchitez_medio_str, ',');
-        std::getline(ss, umbral_humedo_str, ',');
-        std::getline(ss, umbral_intermedio_str, ',');
-        std::getline(ss, umbral_seco_str, ',');
-
-        // Convertir los valores extraídos a sus tipos correspondientes
-        int id = std::stoi(id_str);
-        double capacidad_campo_media = std::stod(capacidad_campo_media_str);
-        int estaciones = std::stoi(estaciones_str);
-        double pendiente_3clases = std::stod(pendiente_3clases_str);
-        double porosidad_media = std::stod(porosidad_media_str);
-        double punto_marchitez_medio = std::stod(punto_marchitez_medio_str);
-        double umbral_humedo = std::stod(umbral_humedo_str);
-        double umbral_intermedio = std::stod(umbral_intermedio_str);
-        double umbral_seco = std::stod(umbral_seco_str);
-
-        // Encontrar el nodo correspondiente en la pirámide
-        int nivel, fila, columna;
-        std::tie(nivel, fila, columna) = get_nivel_fila_columna(id);
-        Nodo& Nodoi = piramide[nivel][fila][columna];
-
-        // Asignar los valores extraídos a las propiedades del nodo
-        Nodoi.nivel = nivel;
-        Nodoi.fila = fila;
-        Nodoi.columna = columna;
-        Nodoi.capacidad_campo_media = capacidad_campo_media;
-        Nodoi.estaciones = estaciones;
-        Nodoi.pendiente_3clases = pendiente_3clases;
-        Nodoi.porosidad_media = porosidad_media;
-        Nodoi.umbral_humedo = umbral_humedo;
-        Nodoi.umbral_intermedio = umbral_intermedio;
-        Nodoi.umbral_seco = umbral_seco;
-        Nodoi.homog = 1;
-        Nodoi.area = 1;
+    if (nivel.padre[p] != -1) {
+        sumarAreaEnlace(n + 1, static_cast<std::size_t>(nivel.padre[p]), -nivel.area[p]);
+        nivel.padre[p] = -1;
     }
-    std::cout << "\t\tArchivo CSV leido y asignado a la base..." << std::endl;
+    if (n == 0) {
+        return;
+    }
+    Nivel& inferior = piramide[n - 1];
+    inferior.recorrerBloqueHijos(nivel.fila(k), nivel.columna(k), [&](std::size_t h, std::size_t q) {
+        if (inferior.padre[q] == static_cast<int>(k)) {
+            anotarEnlacePrevio(n - 1, h);
+            inferior.padre[q] = -1;
+            encolarEnlace(n - 1, h);
+        }
+    });
 }
 
 /**
- * @brief Inicializa los niveles restantes de la pirámide, estableciendo relaciones entre nodos y calculando sus atributos.
+ * @brief Reconstruye nodos sueltos a partir de sus cuatro hijos naturales (fase 3 de actualizar).
  * 
- * Esta función inicializa los niveles restantes de la pirámide (niveles superiores) a partir de los nodos de nivel inferior.
- * Comprueba si los nodos de la base son iguales y homogéneos, y en caso afirmativo, establece sus atributos y relaciones.
- * También evalúa si los nodos son parecidos y homogéneos, en cuyo caso aún falta implementar la funcionalidad correspondiente.
+ * Aplica a cada nodo las reglas de inicializarTramo (caso 1) y fusionarParecidos (caso 2), en orden fila-mayor:
+ * si se fusiona, pasa a ser el padre de sus cuatro hijos, que dejan el padre al que estuvieran enlazados; si no,
+ * queda vacío. Los nodos del bloque de 4x4 bajo cada uno, que lo tienen como candidato, y el propio nodo se
+ * encolan para enlaza.
  * 
- * Base_NO  Base_NE
- * Base_SO  Base_SE
+ * @param n Nivel de los nodos (n >= 1).
+ * @param indices Índices de los nodos, en orden fila-mayor, ya desenlazados.
+ * @return Número de nodos fusionados.
  */
-void Piramide::inicializarNivelesRestantes(){
-    // Recorrer todos los niveles restantes
-    std::cout << "\t\tInicializando el resto de niveles..." << std::endl;
-    for (int n = 1; n < num_niv; n++) {
-        int tam_fila, tam_columna;
-        // Obtener el tamaño del nivel actual
-        std::tie(tam_fila, tam_columna) = getTam(n);
-        // Recorrer todas las filas y columnas del nivel actual
-        for (int i = 0; i < tam_fila; i++) {
-            for (int j = 0; j < tam_columna; j++) {
-                Nodo& Nodoi = piramide[n][i][j];
-                Nodo& Base_NO = piramide[n-1][i*2][j*2];
-                Nodo& Base_NE = piramide[n-1][i*2][j*2+1];
-                Nodo& Base_SO = piramide[n-1][i*2+1][j*2];
-                Nodo& Base_SE = piramide[n-1][i*2+1][j*2+1];
-                
-                //Caso 1: Nodos de la base son iguales y homogéneos.
-                if(nodosSonIguales(Base_NO, Base_NE, Base_SO, Base_SE) && nodosSonHomogeneos(Base_NO, Base_NE, Base_SO, Base_SE)){
-                    Nodoi.homog = 1;
-                    Nodoi.area = Base_NO.area + Base_NE.area + Base_SO.area + Base_SE.area;
-                    Nodoi.capacidad_campo_media = Base_NO.capacidad_campo_media;
-                    Nodoi.estaciones = Base_NO.estaciones;
-                    Nodoi.pendiente_3clases = Base_NO.pendiente_3clases;
-                    Nodoi.porosidad_media = Base_NO.porosidad_media;
-                    Nodoi.umbral_humedo = Base_NO.umbral_humedo;
-                    Nodoi.umbral_intermedio = Base_NO.umbral_intermedio;
-                    Nodoi.umbral_seco = Base_NO.umbral_seco;
-                    Base_NO.setPadre(Nodoi);
-                    Base_NE.setPadre(Nodoi);
-                    Base_SO.setPadre(Nodoi);
-                    Base_SE.setPadre(Nodoi);
-                }
-                //Caso 2: Nodos de la base son suficientemente parecidos (umbral de similitud) y homogéneos.
-                /*
-                else if (nodosSonParecidos(Base_NO, Base_NE, Base_SO, Base_SE, similitud) && nodosSonHomogeneos(Base_NO, Base_NE, Base_SO, Base_SE)){
+std::size_t Piramide::reconstruirNodos(int n, const std::vector<std::size_t>& indices){
+    Nivel& nivel = piramide[n];
+    Nivel& inferior = piramide[n - 1];
+    TablaAtributos& tabla = *nivel.atributos;
 
-                }
-                */
+    // Clase de cada nodo que se fusiona (CLASE_VACIA si no se fusiona)
+    std::vector<uint32_t> clases(indices.size(), CLASE_VACIA);
+    std::vector<std::size_t> nuevos;
+    for (std::size_t c = 0; c < indices.size(); c++) {
+        std::size_t k = indices[c];
+        std::size_t NO = inferior.indice(nivel.fila(k) * 2, nivel.columna(k) * 2);
+        const std::size_t hijos[4] = {inferior.posicion(NO), inferior.posicion(NO + 1),
+                                      inferior.posicion(NO + inferior.num_columnas),
+                                      inferior.posicion(NO + inferior.num_columnas + 1)};
+        if (!nodosSonHomogeneos(inferior, hijos[0], hijos[1], hijos[2], hijos[3])) {
+            continue;
+        }
+        if (nodosSonIguales(inferior, hijos[0], hijos[1], hijos[2], hijos[3])) {
+            clases[c] = inferior.clase[hijos[0]];
+        } else if (similitud.activa() && nodosSonParecidos(inferior, hijos[0], hijos[1], hijos[2], hijos[3])) {
+            // Los hijos homogéneos cubren bloques completos: la media se pondera por el área natural, como en la
+            // construcción, y no por la que tienen tras enlaza
+            const AtributosSuelo* atributos[4];
+            const int areas[4] = {1 << (2 * (n - 1)), 1 << (2 * (n - 1)), 1 << (2 * (n - 1)), 1 << (2 * (n - 1))};
+            for (int h = 0; h < 4; h++) {
+                atributos[h] = &tabla[inferior.clase[hijos[h]]];
+            }
+            clases[c] = tabla.internar(mediaAtributos(atributos, areas, 4));
+        }
+        if (clases[c] != CLASE_VACIA && nivel.esVacio(k)) {
+            nuevos.push_back(k);
+        }
+    }
+    if (similitud.activa()) {
+        similitud.actualizar(tabla);
+    }
+    nivel.ocupar(nuevos);
 
-                //Caso 3: Los nodos de la base son diferentes o no homogéneos.   
-                else{
-                    Nodoi.homog = 0;
+    std::size_t num_fusionados = 0;
+    for (std::size_t c = 0; c < indices.size(); c++) {
+        std::size_t k = indices[c];
+        std::size_t p = nivel.posicion(k);
+        if (clases[c] == CLASE_VACIA) {
+            if (nivel.homog[p] != -1) {
+                nivel.reset(k);
+            }
+        } else {
+            std::size_t NO = inferior.indice(nivel.fila(k) * 2, nivel.columna(k) * 2);
+            const std::size_t hijos[4] = {NO, NO + 1, NO + inferior.num_columnas, NO + inferior.num_columnas + 1};
+            nivel.homog[p] = 1;
+            nivel.clase[p] = clases[c];
+            nivel.estaciones[p] = inferior.estaciones[inferior.posicion(NO)];
+            nivel.area[p] = 0;
+            for (std::size_t hijo : hijos) {
+                std::size_t q = inferior.posicion(hijo);
+                anotarEnlacePrevio(n - 1, hijo);
+                if (inferior.padre[q] != -1) {
+                    sumarAreaEnlace(n, static_cast<std::size_t>(inferior.padre[q]), -inferior.area[q]);
                 }
+                inferior.padre[q] = static_cast<int>(k);
+                nivel.area[p] += inferior.area[q];
             }
+            num_fusionados++;
         }
+        inferior.recorrerBloqueHijos(nivel.fila(k), nivel.columna(k), [&](std::size_t h, std::size_t) {
+            encolarEnlace(n - 1, h);
+        });
+        encolarEnlace(n, k);
     }
-    std::cout << "\t\tTerminado de inicializar los demás niveles..." << std::endl;
+    return num_fusionados;
 }
 
 /**
- * @brief Elimina nodos no homogéneos de la pirámide y actualiza las relaciones entre nodos y sus padres.
+ * @brief Reetiqueta las regiones tras cambiar los enlaces en una actualización (fase 6 de actualizar).
  * 
- * Esta función purga la pirámide eliminando nodos no homogéneos y actualizando las relaciones de los nodos restantes con sus padres.
- * Primero, recorre la pirámide desde el nivel más alto hasta el más bajo y elimina los nodos no homogéneos.
- * Luego, recorre la pirámide de nuevo desde el nivel más alto hasta el más bajo, actualizando las relaciones entre nodos y sus padres.
+ * Una región es un conjunto de raíces del mismo nivel y la misma clase unidas de vecina en vecina (ver
+ * fusionarConVecinos) junto con los árboles de enlaces que cuelgan de ellas. Solo los nodos anotados en
+ * enlaces_previos pueden haber dejado de ser raíces, haber pasado a serlo o haber cambiado de clase, así que solo
+ * pueden partirse las regiones que tenían alguno de ellos como raíz y solo pueden unirse regiones a través de
+ * ellos. Las regiones que tenían una raíz anotada se deshacen y sus raíces se vuelven a unir, con la misma
+ * estructura de conjuntos disjuntos que clasifica(). Las pasadas son:
+ *  1. Recoger las raíces afectadas: las anotadas, más las de las regiones que se deshacen, que se recorren de vecina
+ *     en vecina entre las raíces que tenían la misma región antes de la actualización.
+ *  2. Unir cada raíz afectada con sus vecinas de la misma clase que también son raíces. Si la vecina no es una raíz
+ *     afectada, su región no cambia y se une entera.
+ *  3. Numerar las regiones resultantes. Una región que se une a otras que no cambian toma el menor de sus números;
+ *     si no, conserva el de la primera de sus raíces que ya lo era, si ninguna otra región lo ha tomado. Los
+ *     números que quedan sin usar pasan a estar libres, y las regiones sin número toman el menor libre o, si no
+ *     hay, num_regiones.
+ *  4. Dar su región a las raíces y a sus descendientes y, de arriba abajo y en orden fila-mayor, a los nodos
+ *     anotados que tienen padre, que toman la de este; si cambia, la pasan a sus descendientes.
  * 
+ * @return Número de nodos cuya región ha cambiado.
  */
-void Piramide::purga() {
-    // Eliminar nodos no homogéneos
-    std::cout << "\t\tEliminando nodos no homogéneos..." << std::endl;
-    for (int n = num_niv - 1; n >= 0; n--) {
-        int tam_fila, tam_columna;
-        std::tie(tam_fila, tam_columna) = getTam(n);
-
-        for (int i = 0; i < tam_fila; i++) {
-            for (int j = 0; j < tam_columna; j++) {
-                Nodo& Nodoi = piramide[n][i][j];
+std::size_t Piramide::actualizarRegiones(){
+    // Nodos anotados de cada nivel, en orden fila-mayor
+    std::vector<std::vector<std::size_t>> anotados(num_niv);
+    for (int n = 0; n < num_niv; n++) {
+        for (const auto& previo : enlaces_previos[n]) {
+            anotados[n].push_back(previo.first);
+        }
+        std::sort(anotados[n].begin(), anotados[n].end());
+    }
+    auto esRaiz = [&](int n, std::size_t k) {
+        const Nivel& nivel = piramide[n];
+        std::size_t p = nivel.posicion(k);
+        return nivel.homog[p] != -1 && nivel.padre[p] == -1;
+    };
+    // Los nodos no anotados no han cambiado de padre ni de estado
+    auto eraRaiz = [&](int n, std::size_t k) {
+        auto previo = enlaces_previos[n].find(k);
+        if (previo == enlaces_previos[n].end()) {
+            return esRaiz(n, k);
+        }
+        return !previo->second.vacio && previo->second.padre == -1;
+    };
 
-                // Si el nodo no es homogéneo, inicializarlo vacío.
-                if (!Nodoi.esHomogeneo()) {
-                    Nodoi.reset();
-                }
+    // 1. Raíces afectadas de cada nivel y números de las regiones que se deshacen
+    std::vector<std::vector<std::size_t>> afectadas(num_niv);
+    std::unordered_set<uint32_t> deshechas;
+    for (int n = 0; n < num_niv; n++) {
+        const Nivel& nivel = piramide[n];
+        std::unordered_set<std::size_t> visitadas;
+        std::vector<std::size_t> pendientes;
+        auto visitar = [&](std::size_t k) {
+            if (esRaiz(n, k)) {
+                afectadas[n].push_back(k);
+            }
+            if (eraRaiz(n, k) && visitadas.insert(k).second) {
+                pendientes.push_back(k);
             }
+        };
+        for (std::size_t k : anotados[n]) {
+            visitar(k);
+        }
+        // Las regiones todavía tienen el número anterior a la actualización
+        while (!pendientes.empty()) {
+            std::size_t k = pendientes.back();
+            pendientes.pop_back();
+            uint32_t region = nivel.region[nivel.posicion(k)];
+            deshechas.insert(region);
+            nivel.recorrerVecinos(k, [&](std::size_t v, std::size_t q) {
+                if (nivel.region[q] == region) {
+                    visitar(v);
+                }
+            });
         }
+        std::sort(afectadas[n].begin(), afectadas[n].end());
+        afectadas[n].erase(std::unique(afectadas[n].begin(), afectadas[n].end()), afectadas[n].end());
     }
 
-    // Actualizar relaciones entre nodos y sus padres
-    std::cout << "\t\tActualizando relaciones entre nodos y sus padres..." << std::endl;
+    // 2. Unir las raíces afectadas, de arriba abajo y en orden fila-mayor, con sus vecinas. Las regiones que no
+    // cambian son un elemento más, tras las raíces, representado por una de sus raíces
+    std::vector<std::pair<int, std::size_t>> raices;
+    std::vector<std::unordered_map<std::size_t, uint32_t>> elemento(num_niv);
     for (int n = num_niv - 1; n >= 0; n--) {
-        int tam_fila, tam_columna;
-        std::tie(tam_fila, tam_columna) = getTam(n);
-
-        for (int i = 0; i < tam_fila; i++) {
-            for (int j = 0; j < tam_columna; j++) {
-                Nodo& Nodoi = piramide[n][i][j];
+        for (std::size_t k : afectadas[n]) {
+            elemento[n][k] = static_cast<uint32_t>(raices.size());
+            raices.push_back({n, k});
+        }
+    }
+    std::vector<std::pair<uint32_t, uint32_t>> uniones;
+    std::unordered_map<uint32_t, uint32_t> elemento_externo;
+    std::vector<std::pair<int, std::size_t>> externas;
+    for (uint32_t e = 0; e < raices.size(); e++) {
+        const int n = raices[e].first;
+        const Nivel& nivel = piramide[n];
+        const uint32_t clase = nivel.clase[nivel.posicion(raices[e].second)];
+        nivel.recorrerVecinos(raices[e].second, [&](std::size_t v, std::size_t q) {
+            if (nivel.padre[q] != -1 || nivel.clase[q] != clase) {
+                return;
+            }
+            auto interno = elemento[n].find(v);
+            if (interno != elemento[n].end()) {
+                uniones.push_back({e, interno->second});
+                return;
+            }
+            auto externo = elemento_externo.emplace(nivel.region[q],
+                                                    static_cast<uint32_t>(raices.size() + externas.size()));
+            if (externo.second) {
+                externas.push_back({n, v});
+            }
+            uniones.push_back({e, externo.first->second});
+        });
+    }
+    ConjuntosDisjuntos conjuntos;
+    conjuntos.reiniciar(raices.size() + externas.size());
+    for (const auto& union_raices : uniones) {
+        conjuntos.unir(union_raices.first, union_raices.second);
+    }
+    uint32_t num_conjuntos = 0;
+    std::vector<uint32_t> conjunto = conjuntos.etiquetasDensas(num_conjuntos);
 
-                // Si el nodo es válido y no es huérfano, actualizar la relación con su padre
-                if (Nodoi.id != -1 && !Nodoi.esHuerfano()) {
-                    Nodo &padre = Nodoi.getPadre();
+    // 3. Número de cada región: el menor de las regiones que no cambian con las que se une o el de una de sus raíces
+    std::vector<uint32_t> numero(num_conjuntos, REGION_VACIA);
+    for (uint32_t x = 0; x < externas.size(); x++) {
+        const Nivel& nivel = piramide[externas[x].first];
+        uint32_t region = nivel.region[nivel.posicion(externas[x].second)];
+        uint32_t& numero_conjunto = numero[conjunto[raices.size() + x]];
+        numero_conjunto = std::min(numero_conjunto, region);
+    }
+    std::unordered_set<uint32_t> tomados;
+    for (uint32_t e = 0; e < raices.size(); e++) {
+        const int n = raices[e].first;
+        const std::size_t k = raices[e].second;
+        const Nivel& nivel = piramide[n];
+        uint32_t region = nivel.region[nivel.posicion(k)];
+        if (numero[conjunto[e]] == REGION_VACIA && eraRaiz(n, k) && tomados.insert(region).second) {
+            numero[conjunto[e]] = region;
+        }
+    }
+    for (uint32_t region : deshechas) {
+        if (tomados.count(region) == 0) {
+            regiones_libres.push_back(region);
+        }
+    }
+    // Las regiones que no cambian y se unen a otra con menor número se vuelven a etiquetar enteras; sus raíces son
+    // las que tienen su número y no están afectadas (una raíz nueva puede tener todavía el número de su antiguo padre)
+    std::vector<std::pair<std::pair<int, std::size_t>, uint32_t>> reetiquetadas;
+    for (uint32_t x = 0; x < externas.size(); x++) {
+        const int n = externas[x].first;
+        const Nivel& nivel = piramide[n];
+        uint32_t region = nivel.region[nivel.posicion(externas[x].second)];
+        uint32_t numero_conjunto = numero[conjunto[raices.size() + x]];
+        if (region == numero_conjunto) {
+            continue;
+        }
+        regiones_libres.push_back(region);
+        std::unordered_set<std::size_t> visitadas = {externas[x].second};
+        std::vector<std::size_t> pendientes = {externas[x].second};
+        while (!pendientes.empty()) {
+            std::size_t k = pendientes.back();
+            pendientes.pop_back();
+            reetiquetadas.push_back({{n, k}, numero_conjunto});
+            nivel.recorrerVecinos(k, [&](std::size_t v, std::size_t q) {
+                if (nivel.region[q] == region && nivel.padre[q] == -1 && elemento[n].count(v) == 0
+                    && visitadas.insert(v).second) {
+                    pendientes.push_back(v);
+                }
+            });
+        }
+    }
+    std::sort(regiones_libres.begin(), regiones_libres.end(), std::greater<uint32_t>());
+    for (uint32_t& numero_conjunto : numero) {
+        if (numero_conjunto != REGION_VACIA) {
+            continue;
+        }
+        if (!regiones_libres.empty()) {
+            numero_conjunto = regiones_libres.back();
+            regiones_libres.pop_back();
+        } else {
+            numero_conjunto = num_regiones++;
+        }
+    }
 
-                    // Si el padre del nodo es huérfano, eliminar la relación entre el nodo y su padre
-                    if (padre.esHuerfano()) {
-                        Nodoi.parricida();
-                    }
+    // 4. Etiquetar las raíces y sus descendientes, y después los nodos anotados con padre, de arriba abajo
+    std::size_t num_etiquetados = 0;
+    for (uint32_t e = 0; e < raices.size(); e++) {
+        num_etiquetados += etiquetarSubarbol(raices[e].first, raices[e].second, numero[conjunto[e]]);
+    }
+    for (const auto& reetiquetada : reetiquetadas) {
+        num_etiquetados += etiquetarSubarbol(reetiquetada.first.first, reetiquetada.first.second, reetiquetada.second);
+    }
+    for (int n = num_niv - 1; n >= 0; n--) {
+        Nivel& nivel = piramide[n];
+        auto medida = metricas.medirNivel(n);
+        for (std::size_t k : anotados[n]) {
+            std::size_t p = nivel.posicion(k);
+            if (nivel.homog[p] == -1) {
+                if (nivel.region[p] != REGION_VACIA) {
+                    nivel.region[p] = REGION_VACIA;
+                    num_etiquetados++;
                 }
+            } else if (nivel.padre[p] != -1) {
+                const Nivel& superior = piramide[n + 1];
+                uint32_t region = superior.region[superior.posicion(static_cast<std::size_t>(nivel.padre[p]))];
+                num_etiquetados += etiquetarSubarbol(n, k, region);
             }
         }
+        metricas.anotarVisitas(n, anotados[n].size() + afectadas[n].size());
     }
+    return num_etiquetados;
 }
 
-
 /**
- * @brief Enlaza nodos en la pirámide según criterios específicos.
+ * @brief Da una región a un nodo y a sus descendientes, sin bajar por los que ya la tienen.
  * 
- * Esta función enlaza nodos en la pirámide siguiendo criterios específicos y de acuerdo con la función enlazarConMejorCandidato.
- * Recorre la pirámide desde el nivel más alto hasta el más bajo en busca de nodos enlazables.
- * Si se encuentra un nodo enlazable, se intenta enlazar con el mejor candidato.
- * Este proceso se repite hasta que no haya cambios.
+ * Los hijos de cada nodo se buscan en el bloque de 4x4 del nivel inferior (ver Nivel::recorrerBloqueHijos), así
+ * que no hace falta que las listas de hijos estén al día.
  * 
+ * @param n Nivel del nodo.
+ * @param k Índice del nodo en su nivel.
+ * @param region Región.
+ * @return Número de nodos cuya región ha cambiado.
  */
-void Piramide::enlaza() {
-    int nivel, fila, col;
-    int tam_niv;
-    bool hayCambios = false;
-    Nodo nodo_enlazable;
-
-    do {
-        hayCambios = false;
+std::size_t Piramide::etiquetarSubarbol(int n, std::size_t k, uint32_t region){
+    std::size_t num_etiquetados = 0;
+    std::vector<std::pair<int, std::size_t>> pendientes = {{n, k}};
+    while (!pendientes.empty()) {
+        int m = pendientes.back().first;
+        std::size_t indice = pendientes.back().second;
+        pendientes.pop_back();
+        Nivel& nivel = piramide[m];
+        std::size_t p = nivel.posicion(indice);
+        if (nivel.region[p] == region) {
+            continue;
+        }
+        nivel.region[p] = region;
+        num_etiquetados++;
+        if (m == 0) {
+            continue;
+        }
+        const Nivel& inferior = piramide[m - 1];
+        inferior.recorrerBloqueHijos(nivel.fila(indice), nivel.columna(indice), [&](std::size_t h, std::size_t q) {
+            if (inferior.padre[q] == static_cast<int>(indice)) {
+                pendientes.push_back({m - 1, h});
+            }
+        });
+    }
+    return num_etiquetados;
+}
 
-        // Recorrer la pirámide desde el nivel más alto hasta el más bajo
-        for (int n = num_niv - 1; n >= 0; n--) {
-            int tam_fila, tam_columna;
-            std::tie(tam_fila, tam_columna) = getTam(n);
+/**
+ * @brief Obtiene el número de filas de cada banda al repartir un nivel entre hilos.
+ * 
+ * @param tam_fila Número de filas del nivel.
+ * @param num_hilos Número de hilos.
+ * @return config.filas_por_banda o, si es 0, las filas para tener unas ocho bandas por hilo.
+ */
+int Piramide::filasPorBanda(int tam_fila, int num_hilos) const {
+    return config.filas_por_banda > 0 ? config.filas_por_banda : std::max(1, tam_fila / (num_hilos * 8));
+}
 
-            // Recorrer filas y columnas del nivel actual
-            for (int i = 0; i < tam_fila; i++) {
-                for (int j = 0; j < tam_columna; j++) {
+/**
+ * @brief Obtiene el comienzo o el final de una banda de filas como índice plano del nivel.
+ * 
+ * @param nivel Nivel.
+ * @param filas_banda Filas por banda.
+ * @param banda Número de banda.
+ * @param fin Si es verdadero, se devuelve el índice siguiente a la última celda de la banda.
+ * @return Índice plano.
+ */
+std::size_t Piramide::tramoBanda(const Nivel& nivel, int filas_banda, std::size_t banda, bool fin) const {
+    std::size_t fila = std::min<std::size_t>((banda + (fin ? 1 : 0)) * filas_banda, nivel.num_filas);
+    return fila * static_cast<std::size_t>(nivel.num_columnas);
+}
 
-                    Nodo& Nodoi = piramide[n][i][j];
-                    // Si el nodo es válido, verificar si es enlazable
-                    if (Nodoi.id != -1) {
-                        if (nodo_enlazable.esEnlazable()) {
-                            // Intentar enlazar con el mejor candidato y actualizar hayCambios
-                            hayCambios = enlazarConMejorCandidato(nodo_enlazable);
-                        }
-                    }
-                }
-            }
-        }
-    } while (hayCambios);
+/**
+ * @brief Guarda la Pirámide construida en una instantánea binaria (ver escribirInstantanea).
+ * 
+ * La instantánea contiene todos los niveles: forma, atributos, homogeneidad, enlaces con el padre, listas de
+ * hijos y regiones, además de la tabla de atributos y de las tolerancias y la precisión de la configuración. Se
+ * puede cargar después con cargarInstantanea sin repetir ninguna fase de la construcción.
+ * 
+ * @param ruta Ruta de la instantánea.
+ */
+void Piramide::guardarInstantanea(const std::string& ruta) const {
+    std::cout << "\tGuardando la instantanea " << ruta << "..." << std::endl;
+    ParametrosInstantanea parametros{config.tolerancia_absoluta, config.tolerancia_relativa,
+                                     config.precision_atributos};
+    escribirInstantanea(ruta, piramide, num_regiones, parametros, config.num_hilos);
 }
 
 /**
- * @brief Clasifica los nodos de la Pirámide para generar regiones.
+ * @brief Exporta el ráster de etiquetas de región de la base (ver exportarEtiquetas en exportacion_etiquetas.h).
+ * 
+ * Se registra como la fase "exportacion" de las métricas, con los bytes escritos, y se informa del rendimiento y
+ * de cuánto ha esperado la expansión al disco y el disco a la expansión.
+ * 
+ * @param ruta Ruta del ráster; binario, por tramos si termina en ".rle" o CSV si termina en ".csv".
+ * @return Celdas y bytes escritos y tiempos de la exportación.
  */
-void Piramide::clasifica() {
-    int nivel, fila, col;
-    int tam_niv;
-    bool esFusionado;
-    int area_min_paic;
-    int m, n;
-            
-    // Recorre los niveles de la Pirámide de forma descendente
-    for (int n = num_niv; n >= 0; n--) {
-        int tam_fila, tam_columna;
-        std::tie(tam_fila, tam_columna) = getTam(n);
-        
-        // Recorre las filas y columnas de cada nivel
-        for (int i = 0; i < tam_fila; i++) {
-            for (int j = 0; j < tam_columna; j++) {
-                Nodo& Nodoi = piramide[n][j][i];
-                
-                // Si el Nodo es válido
-                if (Nodoi.id != -1) {
-                    // Si el Nodo es huérfano (no tiene padre)
-                    if (Nodoi.esHuerfano()){
-                        esFusionado = false;
-                        
-                        // Verifica si el Nodo es fusionable
-                        if (Nodoi.esFusionable(area_min_paic)) {
-                            // Intenta fusionar el Nodo con el mejor candidato
-                            esFusionado = fusionarConMejorCandidato(Nodoi);
-                        }
+ResumenExportacion Piramide::exportarEtiquetas(const std::string& ruta) {
+    std::cout << "\tExportando las etiquetas de las regiones a " << ruta << "..." << std::endl;
+    metricas.iniciarFase("exportacion");
+    ResumenExportacion resumen = ::exportarEtiquetas(ruta, piramide, config.num_hilos);
+    metricas.anotarBytesEscritos(resumen.bytes);
+    metricas.terminarFase(piramide, false);
+    double megas = static_cast<double>(resumen.bytes) / (1 << 20);
+    std::cout << "\t\t" << resumen.celdas << " celdas en " << resumen.bandas << " bandas, " << megas << " MB en "
+              << resumen.segundos << " s (" << (resumen.segundos > 0 ? megas / resumen.segundos : 0) << " MB/s)."
+              << std::endl;
+    std::cout << "\t\tEspera de la expansion: " << resumen.segundos_espera_expansion
+              << " s, espera de la escritura: " << resumen.segundos_espera_escritura << " s." << std::endl;
+    return resumen;
+}
 
-                        // Si el Nodo no pudo ser fusionado y sigue siendo válido
-                        if ((!esFusionado) && Nodoi.id != -1) {
-                            // Crea una nueva clase para el Nodo
-                            crearClase(Nodoi);
-                        }                         
-                    } else {  
-                        // Si el Nodo no es huérfano, lo incluye en la clase de su Nodo padre
-                        incluirEnClase(Nodoi, Nodoi.getPadre());
-                    }
-                }
-            }
-        }
-    }        
+/**
+ * @brief Carga la Pirámide de una instantánea en lugar de construirla.
+ * 
+ * Crea los niveles con las dimensiones guardadas (ver inicializarPiramide) y proyecta en ellos las columnas del
+ * archivo (ver proyectarInstantanea): la carga no depende del tamaño de la pirámide y las páginas se leen de disco
+ * a medida que se usan. Debe llamarse en una Pirámide creada sin construir (construir = false).
+ * 
+ * Las tolerancias y la precisión de los atributos de la configuración pasan a ser las guardadas, de modo que
+ * actualizar() compara y redondea los cambios como la construcción que generó la instantánea.
+ * 
+ * @param ruta Ruta de la instantánea.
+ */
+void Piramide::cargarInstantanea(const std::string& ruta) {
+    std::cout << "\tCargando la instantanea " << ruta << "..." << std::endl;
+    ResumenInstantanea resumen = leerResumenInstantanea(ruta);
+    config.num_filas = resumen.num_filas;
+    config.num_columnas = resumen.num_columnas;
+    config.tolerancia_absoluta = resumen.parametros.tolerancia_absoluta;
+    config.tolerancia_relativa = resumen.parametros.tolerancia_relativa;
+    config.precision_atributos = resumen.parametros.precision_atributos;
+    inicializarPiramide();
+    if (resumen.num_niveles > num_niv) {
+        throw std::runtime_error("Error: la instantanea " + ruta + " tiene " + std::to_string(resumen.num_niveles)
+                                 + " niveles y su base solo admite " + std::to_string(num_niv) + ".");
+    }
+    // Las pirámides se guardan con sus niveles efectivos (ver inicializarNivelesRestantes)
+    truncarNiveles(resumen.num_niveles);
+    proyectarInstantanea(ruta, piramide, config.verificar_instantanea, config.num_hilos);
+    num_regiones = resumen.num_regiones;
+    regiones_libres.clear();
+    tabla_regiones.clear();
+    niveles_purgados = true;
+    std::cout << "\t" << num_regiones << " regiones y " << piramide[0].atributos->size()
+              << " combinaciones distintas de atributos." << std::endl;
 }
 
 /**
@@ -345,34 +1820,38 @@ void Piramide::clasifica() {
  * Esta función calcula el nivel, fila y columna de un nodo en la pirámide
  * a partir de su ID. La pirámide se compone de varios niveles, donde cada
  * nivel tiene un número específico de filas y columnas.
- * La función calcula la posición del nodo en la pirámide iterativamente,
- * sumando el tamaño de los niveles hasta que se alcanza el nivel correcto.
- * Luego, calcula las coordenadas de fila y columna del nodo en dicho nivel.
+ * El nivel se busca en la tabla inicio_ids (primer ID de cada nivel), que tiene
+ * como mucho 32 entradas, y las coordenadas se obtienen del resto dentro del nivel.
+ * Los tamaños de los niveles se toman tal cual, así que es válido también con
+ * dimensiones impares.
  */
-std::tuple<int, int, int> Piramide::get_nivel_fila_columna(int id) {
-    int nivel = 0;
-    int tam_nivel = FILAS * COLUMNAS;
-    int tam_acumulado = FILAS * COLUMNAS;
-
-    // Buscar el nivel correspondiente al ID
-    while (id >= tam_acumulado) {
-        nivel++;
-        tam_nivel = tam_nivel / 4;
-        tam_acumulado += tam_nivel;
-    }
-
-    // Calcular el tamaño de fila y columna en el nivel encontrado
-    int tam_fila, tam_columna;
-    std::tie(tam_fila, tam_columna) = getTam(nivel);
+std::tuple<int, int, int> Piramide::get_nivel_fila_columna(int id) const {
+    // Último nivel cuyo primer ID es menor o igual que id (los niveles vacíos comparten inicio con el siguiente)
+    const std::vector<int>& inicio_ids = geometria->inicio_ids;
+    int nivel = static_cast<int>(std::upper_bound(inicio_ids.begin(), inicio_ids.begin() + num_niv, id)
+                                 - inicio_ids.begin()) - 1;
 
     // Calcular las coordenadas de fila y columna dentro del nivel
-    int resto = id % tam_nivel;
+    int resto = id - inicio_ids[nivel];
+    int tam_columna = piramide[nivel].num_columnas;
     int fila = resto / tam_columna;
     int columna = resto % tam_columna;
 
     return std::make_tuple(nivel, fila, columna);
 }
 
+/**
+ * @brief Obtiene el ID de un nodo a partir de su nivel, fila y columna.
+ * 
+ * @param nivel El nivel del nodo.
+ * @param fila La fila del nodo en su nivel.
+ * @param columna La columna del nodo en su nivel.
+ * @return El ID del nodo.
+ */
+int Piramide::get_id(int nivel, int fila, int columna) const {
+    return geometria->inicio_ids[nivel] + fila * piramide[nivel].num_columnas + columna;
+}
+
 
 /**
  * @brief Obtiene el tamaño de un nivel específico de la pirámide en términos de filas y columnas.
@@ -381,14 +1860,37 @@ std::tuple<int, int, int> Piramide::get_nivel_fila_columna(int id) {
  * @return Un tuple con el tamaño de filas y columnas del nivel.
  * 
  * Esta función calcula el tamaño de un nivel específico de la pirámide en términos de filas y columnas.
- * El tamaño se reduce a la mitad en cada nivel sucesivo de la pirámide.
+ * El tamaño se reduce a la mitad (redondeando hacia abajo) en cada nivel sucesivo de la pirámide.
  */
 std::tuple<int, int> Piramide::getTam(int nivel) const {
-    int tam_fila = num_filas / std::pow(2, nivel);
-    int tam_columna = num_columnas / std::pow(2, nivel);
+    int tam_fila = num_filas >> nivel;
+    int tam_columna = num_columnas >> nivel;
     return std::make_tuple(tam_fila, tam_columna);
 }
 
+/**
+ * @brief Obtiene la vista de un nodo a partir de su nivel, fila y columna.
+ * 
+ * @param nivel El nivel del nodo.
+ * @param fila La fila del nodo en su nivel.
+ * @param columna La columna del nodo en su nivel.
+ * @return Vista Nodo sobre las columnas del nivel.
+ */
+Nodo Piramide::nodo(int nivel, int fila, int columna) {
+    return Nodo(piramide, nivel, piramide[nivel].indice(fila, columna));
+}
+
+/**
+ * @brief Obtiene la vista de un nodo a partir de su nivel y su índice plano en el nivel.
+ * 
+ * @param nivel El nivel del nodo.
+ * @param indice El índice del nodo en orden fila-mayor.
+ * @return Vista Nodo sobre las columnas del nivel.
+ */
+Nodo Piramide::nodo(int nivel, std::size_t indice) {
+    return Nodo(piramide, nivel, indice);
+}
+
 /**
  * @brief Verifica si los cuatro nodos base son iguales en base a sus atributos.
  * 
@@ -402,24 +1904,26 @@ std::tuple<int, int> Piramide::getTam(int nivel) const {
  * Los nodos se consideran iguales si todos sus atributos correspondientes son iguales.
  */
 bool Piramide::nodosSonIguales(Nodo& Base_NO, Nodo& Base_NE, Nodo& Base_SO, Nodo& Base_SE) {
-    std::array<double, 4> parametros[7] = {
-        {Base_NO.capacidad_campo_media, Base_NE.capacidad_campo_media, Base_SO.capacidad_campo_media, Base_SE.capacidad_campo_media},
-        {Base_NO.pendiente_3clases, Base_NE.pendiente_3clases, Base_SO.pendiente_3clases, Base_SE.pendiente_3clases},
-        {Base_NO.porosidad_media, Base_NE.porosidad_media, Base_SO.porosidad_media, Base_SE.porosidad_media},
-        {Base_NO.punto_marchitez_medio, Base_NE.punto_marchitez_medio, Base_SO.punto_marchitez_medio, Base_SE.punto_marchitez_medio},
-        {Base_NO.umbral_humedo, Base_NE.umbral_humedo, Base_SO.umbral_humedo, Base_SE.umbral_humedo},
-        {Base_NO.umbral_intermedio, Base_NE.umbral_intermedio, Base_SO.umbral_intermedio, Base_SE.umbral_intermedio},
-        {Base_NO.umbral_seco, Base_NE.umbral_seco, Base_SO.umbral_seco, Base_SE.umbral_seco}
-    };
-    
-    // Verificar si todos los atributos correspondientes son iguales entre los nodos
-    for (const auto& parametro : parametros) {
-        if (!std::equal(parametro.begin() + 1, parametro.end(), parametro.begin())) {
-            return false;
-        }
-    }
-    
-    return true;
+    const Nivel& base = piramide[Base_NO.nivel];
+    return nodosSonIguales(base, base.posicion(Base_NO.getIndice()), base.posicion(Base_NE.getIndice()),
+                           base.posicion(Base_SO.getIndice()), base.posicion(Base_SE.getIndice()));
+}
+
+/**
+ * @brief Verifica si los cuatro nodos base de un nivel son iguales, comparando sus clases de atributos.
+ * 
+ * Dos nodos tienen los mismos atributos si y solo si tienen la misma clase en la tabla de atributos.
+ * 
+ * @param base Nivel al que pertenecen los cuatro nodos.
+ * @param NO Posición del nodo base noroeste en las columnas del nivel (en un nivel denso, su índice).
+ * @param NE Posición del nodo base noreste.
+ * @param SO Posición del nodo base suroeste.
+ * @param SE Posición del nodo base sureste.
+ * @return Verdadero si los nodos base son iguales, falso en caso contrario.
+ */
+bool Piramide::nodosSonIguales(const Nivel& base, std::size_t NO, std::size_t NE, std::size_t SO, std::size_t SE) const {
+    const Columna<uint32_t>& clase = base.clase;
+    return clase[NE] == clase[NO] && clase[SO] == clase[NO] && clase[SE] == clase[NO];
 }
 
 /**
@@ -436,7 +1940,23 @@ bool Piramide::nodosSonIguales(Nodo& Base_NO, Nodo& Base_NE, Nodo& Base_SO, Nodo
  * la función devuelve verdadero. En caso contrario, devuelve falso.
  */
 bool Piramide::nodosSonHomogeneos(Nodo& Base_NO, Nodo& Base_NE, Nodo& Base_SO, Nodo& Base_SE) {
-    if (Base_NO.homog == 1 && Base_NE.homog == 1 && Base_SO.homog == 1 && Base_SE.homog == 1) {
+    const Nivel& base = piramide[Base_NO.nivel];
+    return nodosSonHomogeneos(base, base.posicion(Base_NO.getIndice()), base.posicion(Base_NE.getIndice()),
+                              base.posicion(Base_SO.getIndice()), base.posicion(Base_SE.getIndice()));
+}
+
+/**
+ * @brief Verifica si los cuatro nodos base de un nivel son homogéneos, leyendo solo la columna 'homog'.
+ * 
+ * @param base Nivel al que pertenecen los cuatro nodos.
+ * @param NO Posición del nodo base noroeste en las columnas del nivel (en un nivel denso, su índice).
+ * @param NE Posición del nodo base noreste.
+ * @param SO Posición del nodo base suroeste.
+ * @param SE Posición del nodo base sureste.
+ * @return Verdadero si los nodos base son homogéneos, falso en caso contrario.
+ */
+bool Piramide::nodosSonHomogeneos(const Nivel& base, std::size_t NO, std::size_t NE, std::size_t SO, std::size_t SE) const {
+    if (base.homog[NO] == 1 && base.homog[NE] == 1 && base.homog[SO] == 1 && base.homog[SE] == 1) {
         return true;
     }
     else {
@@ -444,27 +1964,266 @@ bool Piramide::nodosSonHomogeneos(Nodo& Base_NO, Nodo& Base_NE, Nodo& Base_SO, N
     }
 }
 
+/**
+ * @brief Verifica si los atributos de los cuatro nodos base de un nivel son parecidos (caso 2).
+ * 
+ * Compara las clases de los nodos con el núcleo de similitud (ver SimilitudAtributos), dentro de las tolerancias
+ * config.tolerancia_absoluta y config.tolerancia_relativa. Las clases deben estar ya cuantizadas.
+ * 
+ * @param base Nivel al que pertenecen los cuatro nodos, que deben ser no vacíos.
+ * @param NO Posición del nodo base noroeste en las columnas del nivel (en un nivel denso, su índice).
+ * @param NE Posición del nodo base noreste.
+ * @param SO Posición del nodo base suroeste.
+ * @param SE Posición del nodo base sureste.
+ * @return Verdadero si en cada atributo la diferencia entre los nodos está dentro de la tolerancia.
+ */
+bool Piramide::nodosSonParecidos(const Nivel& base, std::size_t NO, std::size_t NE, std::size_t SO, std::size_t SE) const {
+    return similitud.parecidas(base.clase[NO], base.clase[NE], base.clase[SO], base.clase[SE]);
+}
+
+/**
+ * @brief Fusiona los bloques 2x2 del nivel n - 1 que son homogéneos y parecidos, pero no iguales (caso 2).
+ * 
+ * Se llama cuando el nivel n ya está construido con los bloques iguales (caso 1). Primero se buscan en paralelo,
+ * por bandas, los padres no fusionados cuyos cuatro hijos son homogéneos y parecidos. Después se fusionan en orden
+ * fila-mayor desde un solo hilo: cada padre recibe la suma de las áreas, la media de los atributos de sus hijos
+ * ponderada por el área (que se añade a la tabla de atributos como una clase más) y las estaciones del hijo NO,
+ * y pasa a ser el padre de los cuatro. Así las clases nuevas se numeran igual con cualquier número de hilos, y se
+ * cuantizan antes de construir el nivel siguiente, que compara los padres fusionados.
+ * 
+ * @param n Nivel de los padres (n >= 1), denso.
+ * @return Número de padres fusionados.
+ */
+std::size_t Piramide::fusionarParecidos(int n){
+    Nivel& nivel = piramide[n];
+    Nivel& base = piramide[n-1];
+    int num_hilos = hilosEfectivos(config.num_hilos);
+    int filas_banda = filasPorBanda(nivel.num_filas, num_hilos);
+    int num_bandas = (nivel.num_filas + filas_banda - 1) / filas_banda;
 
-bool Piramide::enlazarConMejorCandidato(Nodo& nodo_enlazable){
-    //falta por implementar
-    return false;
+    std::vector<std::vector<std::size_t>> parecidos(num_bandas);
+    paraleloPara(num_hilos, num_bandas, [&](std::size_t banda) {
+        int fila_fin = std::min((static_cast<int>(banda) + 1) * filas_banda, nivel.num_filas);
+        for (int i = static_cast<int>(banda) * filas_banda; i < fila_fin; i++) {
+            for (int j = 0; j < nivel.num_columnas; j++) {
+                std::size_t Nodoi = nivel.indice(i, j);
+                std::size_t Base_NO = base.indice(i*2, j*2);
+                std::size_t Base_SO = Base_NO + base.num_columnas;
+                if (nivel.homog[Nodoi] != 1 && nodosSonHomogeneos(base, Base_NO, Base_NO + 1, Base_SO, Base_SO + 1)
+                    && nodosSonParecidos(base, Base_NO, Base_NO + 1, Base_SO, Base_SO + 1)) {
+                    parecidos[banda].push_back(Nodoi);
+                }
+            }
+        }
+    });
+
+    TablaAtributos& tabla = *nivel.atributos;
+    std::size_t num_fusionados = 0;
+    for (const std::vector<std::size_t>& banda : parecidos) {
+        for (std::size_t Nodoi : banda) {
+            std::size_t Base_NO = base.indice(nivel.fila(Nodoi) * 2, nivel.columna(Nodoi) * 2);
+            std::size_t Base_SO = Base_NO + base.num_columnas;
+            const std::size_t hijos[4] = {Base_NO, Base_NO + 1, Base_SO, Base_SO + 1};
+            const AtributosSuelo* atributos[4];
+            int areas[4];
+            for (int h = 0; h < 4; h++) {
+                atributos[h] = &base.atributosDe(hijos[h]);
+                areas[h] = base.area[hijos[h]];
+            }
+            AtributosSuelo media = mediaAtributos(atributos, areas, 4);
+
+            nivel.homog[Nodoi] = 1;
+            nivel.area[Nodoi] = areas[0] + areas[1] + areas[2] + areas[3];
+            nivel.clase[Nodoi] = tabla.internar(media);
+            nivel.estaciones[Nodoi] = base.estaciones[Base_NO];
+            for (std::size_t hijo : hijos) {
+                base.padre[hijo] = static_cast<int>(Nodoi);
+            }
+            num_fusionados++;
+        }
+    }
+    similitud.actualizar(tabla);
+    return num_fusionados;
 }
 
-bool Piramide::fusionarConMejorCandidato(Nodo& nodo){
-    //falta por implementar
-    return false;
+
+/**
+ * @brief Construye las listas de hijos de todos los niveles (ver Nivel::construirHijos).
+ * 
+ * Las listas de cada nivel solo dependen de los enlaces del nivel inferior, así que los niveles se construyen en
+ * paralelo. Hay que volver a construirlas si cambian los enlaces.
+ */
+void Piramide::construirHijos(){
+    std::cout << "\t\tConstruyendo las listas de hijos..." << std::endl;
+    paraleloPara(config.num_hilos, num_niv > 0 ? num_niv - 1 : 0, [&](std::size_t n) {
+        piramide[n + 1].construirHijos(piramide[n]);
+    });
 }
 
-void Piramide::crearClase(Nodo& nodo){
-    //falta por implementar
-    return;
+/**
+ * @brief Enlaza un nodo con el mejor de sus padres candidatos.
+ * 
+ * Los candidatos son los cuatro nodos del nivel superior que tocan al nodo: su padre natural (el del bloque 2x2 al
+ * que pertenece) y los tres padres vecinos en la dirección de la esquina del bloque en la que está el nodo, como en
+ * una pirámide solapada. Un candidato es válido si es homogéneo y tiene la misma clase de atributos que el nodo;
+ * el mejor es el de mayor área sin contar la del propio nodo (en caso de empate, el primero en orden fila-mayor).
+ * Un nodo enlazado solo cambia de padre si el candidato es estrictamente mejor que el padre actual, así que los
+ * enlaces no oscilan. Al cambiar el enlace se actualiza el área del padre nuevo y la del anterior, y la de sus
+ * antepasados (ver sumarAreaEnlace).
+ * 
+ * @param nodo_enlazable Nodo enlazable (ver Nodo::esEnlazable).
+ * @return Verdadero si el nodo ha cambiado de padre.
+ */
+bool Piramide::enlazarConMejorCandidato(Nodo& nodo_enlazable){
+    const int n = nodo_enlazable.nivel;
+    const Nivel& superior = piramide[n + 1];
+    const int actual = nodo_enlazable.padre;
+
+    // Filas y columnas de los candidatos: la del padre natural y la vecina del lado del nodo
+    const int fila_natural = nodo_enlazable.fila / 2;
+    const int columna_natural = nodo_enlazable.columna / 2;
+    int filas[2] = {fila_natural, fila_natural + (nodo_enlazable.fila % 2 == 0 ? -1 : 1)};
+    int columnas[2] = {columna_natural, columna_natural + (nodo_enlazable.columna % 2 == 0 ? -1 : 1)};
+    if (filas[0] > filas[1]) {
+        std::swap(filas[0], filas[1]);
+    }
+    if (columnas[0] > columnas[1]) {
+        std::swap(columnas[0], columnas[1]);
+    }
+
+    long long area_actual = -1;
+    long long mejor_area = -1;
+    int mejor = -1;
+    for (int i : filas) {
+        if (i < 0 || i >= superior.num_filas) {
+            continue;
+        }
+        for (int j : columnas) {
+            if (j < 0 || j >= superior.num_columnas) {
+                continue;
+            }
+            int candidato = static_cast<int>(superior.indice(i, j));
+            std::size_t p = superior.posicion(candidato);
+            if (superior.homog[p] != 1 || superior.clase[p] != nodo_enlazable.clase) {
+                continue;
+            }
+            long long area = superior.area[p] - (candidato == actual ? nodo_enlazable.area : 0);
+            if (candidato == actual) {
+                area_actual = area;
+            }
+            if (area > mejor_area) {
+                mejor_area = area;
+                mejor = candidato;
+            }
+        }
+    }
+
+    if (mejor == -1 || mejor == actual || mejor_area <= area_actual) {
+        return false;
+    }
+    if (actual != -1) {
+        sumarAreaEnlace(n + 1, actual, -nodo_enlazable.area);
+    }
+    nodo_enlazable.padre = mejor;
+    sumarAreaEnlace(n + 1, mejor, nodo_enlazable.area);
+    return true;
 }
 
-void Piramide::incluirEnClase(Nodo &nodo, Nodo &padre){
-    //falta por implementar
-    return;
+/**
+ * @brief Suma un área a un nodo y a sus antepasados, y encola los nodos cuya elección depende de ellos.
+ * 
+ * Cada nodo cuya área cambia es candidato de los nodos del nivel inferior que rodean a sus hijos naturales (el
+ * anillo de 12 nodos del bloque 4x4 centrado en ellos); esos nodos se añaden a la cola de enlaza.
+ * 
+ * @param n Nivel del nodo.
+ * @param indice Índice del nodo en su nivel.
+ * @param area Área a sumar (negativa para restar).
+ */
+void Piramide::sumarAreaEnlace(int n, std::size_t indice, int area){
+    while (true) {
+        Nivel& nivel = piramide[n];
+        std::size_t p = nivel.posicion(indice);
+        nivel.area[p] += area;
+
+        // Encolar los nodos del anillo del nivel inferior que no están ya en la cola
+        const Nivel& inferior = piramide[n - 1];
+        int fila = nivel.fila(indice) * 2;
+        int columna = nivel.columna(indice) * 2;
+        for (int i = std::max(fila - 1, 0); i <= std::min(fila + 2, inferior.num_filas - 1); i++) {
+            for (int j = std::max(columna - 1, 0); j <= std::min(columna + 2, inferior.num_columnas - 1); j++) {
+                bool hijo_natural = (i == fila || i == fila + 1) && (j == columna || j == columna + 1);
+                if (!hijo_natural) {
+                    encolarEnlace(n - 1, inferior.indice(i, j));
+                }
+            }
+        }
+
+        if (nivel.padre[p] == -1) {
+            return;
+        }
+        indice = static_cast<std::size_t>(nivel.padre[p]);
+        n++;
+    }
 }
 
+/**
+ * @brief Fusiona la región de un nodo raíz con las de sus vecinos que también son raíces de su misma clase.
+ * 
+ * Los vecinos son los nodos de su nivel que comparten un lado con él: sus bloques de celdas se tocan y son de la
+ * misma clase, pero no los une ningún enlace. Al unir cada raíz con todos ellos, una zona de la misma clase queda
+ * en una sola región aunque sus raíces no se enlacen entre sí. Se llama desde varios hilos a la vez durante
+ * clasifica(), cuando todos los nodos tienen ya su región provisional; cada fusión se hace con fusionarClases.
+ * 
+ * @param nodo Nodo huérfano.
+ * @return Verdadero si se ha fusionado con alguna región distinta de la suya.
+ */
+bool Piramide::fusionarConVecinos(Nodo& nodo){
+    const Nivel& nivel = piramide[nodo.nivel];
+    const uint32_t clase = nivel.clase[nivel.posicion(nodo.getIndice())];
+    bool fusionado = false;
+    nivel.recorrerVecinos(nodo.getIndice(), [&](std::size_t k, std::size_t p) {
+        if (nivel.padre[p] == -1 && nivel.clase[p] == clase) {
+            Nodo vecino(piramide, nodo.nivel, k);
+            fusionado |= fusionarClases(nodo, vecino);
+        }
+    });
+    return fusionado;
+}
 
+/**
+ * @brief Une las regiones de dos nodos no vacíos.
+ * 
+ * Se puede llamar desde varios hilos a la vez mientras se clasifica la Pirámide.
+ * 
+ * @param nodo Nodo.
+ * @param candidato Nodo con cuya región se fusiona la del primero.
+ * @return Verdadero si las regiones eran distintas.
+ */
+bool Piramide::fusionarClases(Nodo& nodo, Nodo& candidato){
+    const Nivel& nivel = piramide[nodo.nivel];
+    const Nivel& nivel_candidato = piramide[candidato.nivel];
+    return conjuntos_regiones.unir(nivel.region[nivel.posicion(nodo.getIndice())],
+                                   nivel_candidato.region[nivel_candidato.posicion(candidato.getIndice())]);
+}
 
+/**
+ * @brief Crea una región nueva con raíz en un nodo.
+ * 
+ * @param nivel Nivel del nodo.
+ * @param posicion Posición del nodo en las columnas del nivel.
+ * @param region Región provisional de la raíz.
+ */
+void Piramide::crearClase(Nivel& nivel, std::size_t posicion, uint32_t region){
+    nivel.region[posicion] = region;
+}
 
+/**
+ * @brief Incluye un nodo en la región de su padre, que ya debe estar etiquetado.
+ * 
+ * @param nivel Nivel del nodo.
+ * @param posicion Posición del nodo en las columnas del nivel.
+ * @param superior Nivel del padre.
+ */
+void Piramide::incluirEnClase(Nivel& nivel, std::size_t posicion, const Nivel& superior){
+    nivel.region[posicion] = superior.region[superior.posicion(nivel.padre[posicion])];
+}
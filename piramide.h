@@ -2,6 +2,15 @@
 #define PIRAMIDE_H
 
 #include "nodo.h"
+#include "conjuntos_disjuntos.h"
+#include "configuracion.h"
+#include "estadisticas_regiones.h"
+#include "exportacion_etiquetas.h"
+#include "lector_csv.h"
+#include "metricas.h"
+#include "nucleo_2x2.h"
+#include "pool_memoria.h"
+#include "similitud.h"
 
 
 #include <iostream>
@@ -11,21 +20,73 @@
 #include <cmath>
 #include <algorithm>
 #include <array>
+#include <memory>
+#include <tuple>
+#include <unordered_map>
 
 
-const int FILAS = 6715;
-const int COLUMNAS = 13901;
+/**
+ * @brief Estadísticas de la última ejecución de Piramide::enlaza.
+ */
+struct EstadisticasEnlaza {
+    // Nodos evaluados, en la pasada inicial y en la cola de trabajo
+    std::size_t evaluados = 0;
+    // Nodos huérfanos enlazados y nodos que han cambiado de padre
+    std::size_t enlaces_nuevos = 0;
+    std::size_t reenlaces = 0;
+    // Rondas de la cola de trabajo tras la pasada inicial
+    std::size_t rondas = 0;
+    // Nodos añadidos a la cola, nodos pendientes en ella y máximo de nodos pendientes
+    std::size_t encolados = 0;
+    std::size_t pendientes = 0;
+    std::size_t cola_maxima = 0;
+};
+
+/**
+ * @brief Geometría de una pirámide, que solo depende de las dimensiones de la base.
+ */
+struct GeometriaPiramide {
+    int num_filas = 0;
+    int num_columnas = 0;
+    int num_niv = 0;
+    // Primer ID de cada nivel, más el número total de nodos al final (num_niv + 1 entradas)
+    std::vector<int> inicio_ids;
+};
+
+// Calcula la geometría de la pirámide de una base; lanza std::runtime_error si tiene demasiados nodos
+std::shared_ptr<const GeometriaPiramide> calcularGeometria(int num_filas, int num_columnas);
+
+/**
+ * @brief Padre de un nodo antes de cambiarlo durante Piramide::actualizar.
+ */
+struct EnlacePrevio {
+    int padre;
+    // Verdadero si el nodo estaba vacío
+    bool vacio;
+};
 
 /**
  * @brief Clase Piramide, representa una estructura de pirámide de nodos.
  */
 class Piramide {
 public:
-    // Dimensiones de la base de la pirámide (es cuadrada)
+    // Número de niveles efectivos (hasta el último con nodos homogéneos, ver inicializarNivelesRestantes) y
+    // dimensiones de la base de la pirámide (tomadas de la configuración)
     int num_niv, num_filas, num_columnas;
 
-    // Constructor de la clase
-    Piramide() {
+    // Parámetros de construcción (archivo de entrada, número de hilos...)
+    Configuracion config;
+
+    // Constructor de la clase; con construir = false solo guarda la configuración y las fases se llaman aparte
+    Piramide(const Configuracion& config = Configuracion(), bool construir = true) : config{config} {
+        if (construir) {
+            ejecutarFases();
+        }
+    }
+
+    // Construye la Pirámide con todas las fases y guarda la instantánea, las regiones, las etiquetas y las métricas
+    // pedidas en la configuración
+    void ejecutarFases() {
         std::cout << std::endl << "Iniciando init()..." << std::endl;
         init();
         std::cout << std::endl << "Iniciando purga()..." << std::endl;
@@ -34,6 +95,18 @@ public:
         enlaza();
         std::cout << std::endl << "Iniciando clasifica()..." << std::endl;
         clasifica();
+        if (!config.archivo_instantanea.empty()) {
+            guardarInstantanea(config.archivo_instantanea);
+        }
+        if (!config.archivo_regiones.empty()) {
+            tabla_regiones.guardar(config.archivo_regiones);
+        }
+        if (!config.archivo_etiquetas.empty()) {
+            exportarEtiquetas(config.archivo_etiquetas);
+        }
+        if (!config.archivo_metricas.empty()) {
+            metricas.guardar(config.archivo_metricas);
+        }
         std::cout << std::endl << "FIN" << std::endl;
     }
 
@@ -43,31 +116,133 @@ public:
     void enlaza();
     void clasifica();
 
-    // Método para obtener el nivel, fila y columna de un nodo dado su ID
-    std::tuple<int, int, int> get_nivel_fila_columna(int id);
+    // Métodos para actualizar la Pirámide ya clasificada con celdas de la base cambiadas, sin reconstruirla
+    void actualizar(const std::vector<FilaCSV>& cambios);
+    void actualizarDesdeCSV(const std::string& ruta);
+
+    // Métodos para guardar la Pirámide construida en una instantánea binaria y para cargarla sin construirla
+    void guardarInstantanea(const std::string& ruta) const;
+    void cargarInstantanea(const std::string& ruta);
+
+    // Método para exportar la región de cada celda de la base de la Pirámide clasificada (ver exportarEtiquetas)
+    ResumenExportacion exportarEtiquetas(const std::string& ruta);
+
+    // Métodos para obtener el nivel, fila y columna de un nodo dado su ID, y el ID dado su nivel, fila y columna
+    std::tuple<int, int, int> get_nivel_fila_columna(int id) const;
+    int get_id(int nivel, int fila, int columna) const;
 
     // Método para obtener el tamaño (filas y columnas) de un nivel dado
     std::tuple<int, int> getTam(int nivel) const;
 
+    // Métodos para obtener la vista de un nodo por (nivel, fila, columna) o por índice plano
+    Nodo nodo(int nivel, int fila, int columna);
+    Nodo nodo(int nivel, std::size_t indice);
+
     // Métodos para leer e inicializar la Pirámide
     void leerArchivoCSV();
+    bool leerCacheBase();
+    void escribirCacheBase();
     void inicializarPiramide();
-    void inicializarNivelesRestantes();
+    void reservarNivel(int n);
+    void truncarNiveles(int niveles);
+    void ampliarNivel();
+    void prepararReduccion();
+    void inicializarNivelesRestantes(int primer_nivel = 1);
+    void inicializarTesela(int n0, int n_fin, int lado, int tf, int tc);
+    void inicializarTramo(int n, int i, int j_inicio, int j_fin);
+    void construirEnDisco();
+
+    // Métodos para purgar la Pirámide
+    void purgarNoHomogeneos();
+    void cortarEnlacesPurgados();
+    void validarPurgaFusionada();
+    void compactarNiveles();
 
     // Métodos para comparar nodos y verificar homogeneidad
     bool nodosSonIguales(Nodo& Base_NO, Nodo& Base_NE, Nodo& Base_SO, Nodo& Base_SE);
     bool nodosSonHomogeneos(Nodo& Base_NO, Nodo& Base_NE, Nodo& Base_SO, Nodo& Base_SE);
+    bool nodosSonIguales(const Nivel& base, std::size_t NO, std::size_t NE, std::size_t SO, std::size_t SE) const;
+    bool nodosSonHomogeneos(const Nivel& base, std::size_t NO, std::size_t NE, std::size_t SO, std::size_t SE) const;
+    bool nodosSonParecidos(const Nivel& base, std::size_t NO, std::size_t NE, std::size_t SO, std::size_t SE) const;
+
+    // Método para fusionar los bloques 2x2 homogéneos con atributos parecidos (caso 2) del nivel n
+    std::size_t fusionarParecidos(int n);
 
     // Métodos para enlazar y fusionar nodos
     bool enlazarConMejorCandidato(Nodo& nodo_enlazable);
-    bool fusionarConMejorCandidato(Nodo& nodo);
+    void sumarAreaEnlace(int n, std::size_t indice, int area);
+    void construirHijos();
+    void prepararColaEnlaza();
+    void evaluarEnlace(int n, std::size_t indice);
+    void encolarEnlace(int n, std::size_t indice);
+    void procesarColaEnlaza();
+    void informarEnlaza() const;
+    bool fusionarConVecinos(Nodo& nodo);
+    bool fusionarClases(Nodo& nodo, Nodo& candidato);
     
-    // Métodos para crear e incluir nodos en clases
-    void crearClase(Nodo& nodo);
-    void incluirEnClase(Nodo &nodo, Nodo &padre);
+    // Métodos para crear e incluir nodos en clases (regiones), por su posición en las columnas del nivel
+    void crearClase(Nivel& nivel, std::size_t posicion, uint32_t region);
+    void incluirEnClase(Nivel& nivel, std::size_t posicion, const Nivel& superior);
+
+    // Métodos para las estadísticas de las regiones (ver TablaRegiones): sumar el bloque de un nodo a la región
+    // que tiene en la columna 'region', con las clases de las celdas de la base, y recalcular la tabla de una
+    // Pirámide ya clasificada
+    void anotarBloqueRegion(const Nivel& nivel, std::size_t indice, std::size_t posicion,
+                            AcumuladorRegiones& acumulador) const;
+    void anotarBloqueClases(uint32_t region, int n, int fila, int columna, AcumuladorRegiones& acumulador) const;
+    void calcularEstadisticasRegiones();
+
+    // Métodos para las fases de actualizar(): recoger, desenlazar y reconstruir los antepasados de las celdas
+    // cambiadas y reetiquetar las regiones de los nodos que han cambiado de padre
+    std::vector<std::size_t> recogerPadres(int n, const std::vector<std::size_t>& hijos) const;
+    void anotarEnlacePrevio(int n, std::size_t indice);
+    void desenlazarNodo(int n, std::size_t indice);
+    std::size_t reconstruirNodos(int n, const std::vector<std::size_t>& indices);
+    std::size_t actualizarRegiones();
+    std::size_t etiquetarSubarbol(int n, std::size_t indice, uint32_t region);
+
+    // Métodos para repartir las filas de un nivel en bandas
+    int filasPorBanda(int tam_fila, int num_hilos) const;
+    std::size_t tramoBanda(const Nivel& nivel, int filas_banda, std::size_t banda, bool fin) const;
+
+    // Reducción vectorizada de los bloques 2x2 (nullptr = comparación escalar nodo a nodo)
+    FuncionReduccion2x2 reduccion_2x2 = nullptr;
+
+    // Comparación por similitud de los atributos de los bloques 2x2 (caso 2), preparada en prepararReduccion()
+    SimilitudAtributos similitud;
+
+    // Verdadero si los niveles superiores se construyeron con la purga fusionada
+    bool niveles_purgados = false;
+
+    // Estadísticas de la última ejecución de enlaza()
+    EstadisticasEnlaza estadisticas_enlaza;
+    // Cola de trabajo de enlaza(): nodos pendientes de cada nivel y mapa de bits de los nodos que ya están en ella
+    std::vector<std::vector<std::size_t>> cola_enlaza;
+    std::vector<std::vector<uint64_t>> en_cola_enlaza;
+
+    // Regiones provisionales durante clasifica(), unidas al fusionar regiones
+    ConjuntosDisjuntos conjuntos_regiones;
+    // Número de regiones tras clasifica() (la región de cada nodo está en la columna 'region' de su nivel)
+    uint32_t num_regiones = 0;
+    // Números de región que han quedado libres en actualizar(), de mayor a menor (no se guardan en la instantánea)
+    std::vector<uint32_t> regiones_libres;
+    // Estadísticas de cada región, calculadas en clasifica() y de nuevo al final de actualizar() (vacía tras
+    // cargarInstantanea(); ver calcularEstadisticasRegiones)
+    TablaRegiones tabla_regiones;
+    // Padre previo de los nodos que cambian durante actualizar(), por nivel e índice plano
+    std::vector<std::unordered_map<std::size_t, EnlacePrevio>> enlaces_previos;
+
+    // Métricas de cada fase y nivel (vacías si se compila con PIRAMIDE_METRICAS = 0)
+    Metricas metricas;
+
+    // Contenedor de la Pirámide, con un Nivel (almacenado por columnas) por cada nivel
+    std::vector<Nivel> piramide;
 
-    // Contenedor de la Pirámide, que almacena nodos en niveles, filas y columnas
-    std::vector<std::vector<std::vector<Nodo>>> piramide;
+    // Geometría de la pirámide, compartida con las demás de las mismas dimensiones (ver construirLote); sus
+    // inicio_ids valen para los num_niv primeros niveles aunque la pirámide se haya truncado
+    std::shared_ptr<const GeometriaPiramide> geometria;
+    // Pool del que toman sus columnas los niveles (nullptr = memoria nueva); se fija antes de init()
+    std::shared_ptr<PoolMemoria> pool;
 };
 
 #endif // PIRAMIDE_H
@@ -0,0 +1,97 @@
+#include "pool_memoria.h"
+
+namespace {
+
+// Un bloque libre se reutiliza para peticiones de al menos esta fracción de su tamaño
+const std::size_t HOLGURA_REUTILIZACION = 2;
+
+} // namespace
+
+/**
+ * @brief Constructor del pool.
+ * 
+ * @param bytes_maximos Bytes máximos en bloques libres (0 = sin límite).
+ */
+PoolMemoria::PoolMemoria(std::size_t bytes_maximos) : estado{std::make_shared<Estado>()} {
+    estado->bytes_maximos = bytes_maximos;
+}
+
+/**
+ * @brief Destructor del pool: libera los bloques libres. Los que siguen en uso se liberan al devolverlos.
+ */
+PoolMemoria::~PoolMemoria() {
+    std::multimap<std::size_t, std::shared_ptr<void>> libres;
+    std::lock_guard<std::mutex> lock(estado->mutex);
+    estado->activo = false;
+    libres.swap(estado->libres);
+    estado->estadisticas.bytes_libres = 0;
+}
+
+/**
+ * @brief Toma un bloque del pool o, si no hay uno libre adecuado, reserva uno nuevo.
+ * 
+ * Se elige el menor bloque libre de al menos 'bytes' bytes, siempre que no pase del doble: los tamaños de las
+ * columnas de los niveles se repiten de una pirámide a otra de la misma malla, y así un bloque de la base no se
+ * gasta en un nivel pequeño. Un bloque reutilizado conserva el tamaño de página con el que se reservó.
+ * 
+ * @param bytes Tamaño pedido, en bytes.
+ * @param paginas Tamaño de página de los bloques nuevos (ver reservarPaginas).
+ * @return Bloque sin inicializar (con la alineación de operator new), que vuelve al pool al liberarlo.
+ */
+std::shared_ptr<void> PoolMemoria::tomar(std::size_t bytes, PaginasGrandes paginas) {
+    std::shared_ptr<void> bloque;
+    std::size_t capacidad = bytes;
+    {
+        std::lock_guard<std::mutex> lock(estado->mutex);
+        auto libre = estado->libres.lower_bound(bytes);
+        if (libre != estado->libres.end() && libre->first / HOLGURA_REUTILIZACION <= bytes) {
+            capacidad = libre->first;
+            bloque = std::move(libre->second);
+            estado->libres.erase(libre);
+            estado->estadisticas.bytes_libres -= capacidad;
+            estado->estadisticas.reutilizados++;
+            estado->estadisticas.bytes_reutilizados += capacidad;
+        } else {
+            estado->estadisticas.nuevos++;
+            estado->estadisticas.bytes_nuevos += capacidad;
+        }
+    }
+    if (!bloque) {
+        bloque = reservarPaginas(capacidad, paginas);
+    }
+
+    // El bloque vuelve al pool al liberar el último shared_ptr entregado; si no cabe o el pool ya no existe, se
+    // libera al destruir la copia de 'bloque' del borrador
+    void* datos = bloque.get();
+    std::shared_ptr<Estado> destino = estado;
+    return std::shared_ptr<void>(datos, [destino, capacidad, bloque](void*) mutable {
+        std::unique_lock<std::mutex> lock(destino->mutex);
+        EstadisticasPool& estadisticas = destino->estadisticas;
+        if (destino->activo && (destino->bytes_maximos == 0
+                                || estadisticas.bytes_libres + capacidad <= destino->bytes_maximos)) {
+            destino->libres.emplace(capacidad, std::move(bloque));
+            estadisticas.bytes_libres += capacidad;
+            return;
+        }
+        lock.unlock();
+        bloque.reset();
+    });
+}
+
+/**
+ * @brief Libera los bloques libres guardados en el pool; los que están en uso volverán a él al liberarlos.
+ */
+void PoolMemoria::vaciar() {
+    std::multimap<std::size_t, std::shared_ptr<void>> libres;
+    std::lock_guard<std::mutex> lock(estado->mutex);
+    libres.swap(estado->libres);
+    estado->estadisticas.bytes_libres = 0;
+}
+
+/**
+ * @brief Obtiene las estadísticas de uso del pool.
+ */
+EstadisticasPool PoolMemoria::estadisticas() const {
+    std::lock_guard<std::mutex> lock(estado->mutex);
+    return estado->estadisticas;
+}
@@ -0,0 +1,69 @@
+#ifndef POOL_MEMORIA_H
+#define POOL_MEMORIA_H
+
+#include "memoria_paginas.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+
+/**
+ * @brief Estadísticas de uso de un PoolMemoria.
+ */
+struct EstadisticasPool {
+    // Bloques entregados reutilizando uno devuelto y bloques reservados nuevos
+    std::size_t reutilizados = 0;
+    std::size_t nuevos = 0;
+    // Bytes entregados reutilizando bloques y bytes reservados nuevos
+    std::size_t bytes_reutilizados = 0;
+    std::size_t bytes_nuevos = 0;
+    // Bytes en bloques libres guardados en el pool
+    std::size_t bytes_libres = 0;
+};
+
+/**
+ * @brief Pool de bloques de memoria que se reciclan en lugar de devolverse al sistema.
+ * 
+ * Las columnas de una pirámide son bloques grandes, que el sistema reserva con mmap y devuelve con munmap al
+ * liberarlos: cada pirámide nueva vuelve a pagar los fallos de página al escribirlos por primera vez. Los bloques
+ * que se toman del pool vuelven a él cuando se libera el último shared_ptr que los usa, con sus páginas ya en
+ * memoria, y la siguiente petición de un tamaño parecido los reutiliza. Pensado para construir muchas pirámides
+ * de la misma malla seguidas o a la vez (ver construirLote), en las que los tamaños se repiten.
+ * 
+ * Se puede usar desde varios hilos a la vez. Los bloques entregados pueden sobrevivir al pool: al volver, se
+ * liberan si el pool ya no existe.
+ */
+class PoolMemoria {
+public:
+    // Con bytes_maximos > 0, los bloques devueltos que no caben en ese límite de bytes libres se liberan
+    explicit PoolMemoria(std::size_t bytes_maximos = 0);
+    ~PoolMemoria();
+
+    PoolMemoria(const PoolMemoria&) = delete;
+    PoolMemoria& operator=(const PoolMemoria&) = delete;
+
+    // Bloque de al menos 'bytes' bytes sin inicializar, que vuelve al pool al liberar el último shared_ptr; los
+    // bloques nuevos se reservan con el tamaño de página pedido
+    std::shared_ptr<void> tomar(std::size_t bytes, PaginasGrandes paginas = PaginasGrandes::No);
+
+    // Libera los bloques libres guardados en el pool
+    void vaciar();
+
+    EstadisticasPool estadisticas() const;
+
+private:
+    struct Estado {
+        std::mutex mutex;
+        // Bloques libres por tamaño
+        std::multimap<std::size_t, std::shared_ptr<void>> libres;
+        std::size_t bytes_maximos = 0;
+        bool activo = true;
+        EstadisticasPool estadisticas;
+    };
+
+    std::shared_ptr<Estado> estado;
+};
+
+#endif // POOL_MEMORIA_H
@@ -0,0 +1,34 @@
+#ifndef SALIDA_NULA_H
+#define SALIDA_NULA_H
+
+#include <ostream>
+#include <streambuf>
+
+/**
+ * @brief Buffer que descarta todo lo que se escribe en él.
+ */
+class BufferNulo : public std::streambuf {
+protected:
+    int overflow(int c) override { return traits_type::not_eof(c); }
+};
+
+/**
+ * @brief Descarta lo que se escribe en un flujo mientras vive el objeto.
+ * 
+ * Al destruirlo, también si se sale del ámbito por una excepción, el flujo vuelve a escribir en su buffer anterior.
+ */
+class SilenciarFlujo {
+public:
+    explicit SilenciarFlujo(std::ostream& flujo) : flujo{flujo}, anterior{flujo.rdbuf(&nulo)} {}
+    ~SilenciarFlujo() { flujo.rdbuf(anterior); }
+
+    SilenciarFlujo(const SilenciarFlujo&) = delete;
+    SilenciarFlujo& operator=(const SilenciarFlujo&) = delete;
+
+private:
+    BufferNulo nulo;
+    std::ostream& flujo;
+    std::streambuf* anterior;
+};
+
+#endif // SALIDA_NULA_H
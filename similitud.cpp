@@ -0,0 +1,229 @@
+#include "similitud.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SIMILITUD_X86 1
+#endif
+
+namespace {
+
+static_assert(NUM_ATRIBUTOS_SUELO <= CARRILES_SIMILITUD, "Los atributos no caben en los carriles de similitud");
+
+// Mayor valor absoluto de un carril: la resta de dos valores y la suma de tolerancia y holgura caben en 32 bits
+const int32_t LIMITE_CARRIL = 1 << 29;
+// Los valores de la base se escalan para que el mayor quede por debajo de 2^28
+const int BITS_VALOR = 28;
+
+/**
+ * @brief Convierte un valor a punto fijo.
+ * 
+ * @param valor Valor.
+ * @param escala Escala del carril.
+ * @return Valor redondeado y saturado a LIMITE_CARRIL (0 si no es finito).
+ */
+int32_t cuantizar(double valor, double escala) {
+    double escalado = std::nearbyint(valor * escala);
+    if (!std::isfinite(escalado)) {
+        return std::isnan(escalado) ? 0 : (escalado > 0 ? LIMITE_CARRIL : -LIMITE_CARRIL);
+    }
+    return static_cast<int32_t>(std::max<double>(-LIMITE_CARRIL, std::min<double>(LIMITE_CARRIL, escalado)));
+}
+
+/**
+ * @brief Comparación de cuatro clases sin vectorizar.
+ */
+bool parecidasEscalar(const int32_t* valores, const int32_t* holguras, const int32_t* tolerancias,
+                      const uint32_t* clases) {
+    for (int c = 0; c < CARRILES_SIMILITUD; c++) {
+        int32_t mayor = valores[clases[0] * CARRILES_SIMILITUD + c];
+        int32_t menor = mayor;
+        int32_t holgura = holguras[clases[0] * CARRILES_SIMILITUD + c];
+        for (int q = 1; q < 4; q++) {
+            std::size_t k = static_cast<std::size_t>(clases[q]) * CARRILES_SIMILITUD + c;
+            mayor = std::max(mayor, valores[k]);
+            menor = std::min(menor, valores[k]);
+            holgura = std::max(holgura, holguras[k]);
+        }
+        if (mayor - menor > tolerancias[c] + holgura) {
+            return false;
+        }
+    }
+    return true;
+}
+
+#ifdef SIMILITUD_X86
+
+// SSE2 no tiene máximo ni mínimo de enteros de 32 bits: se eligen con la comparación
+__attribute__((target("sse2")))
+inline __m128i mayorSSE2(__m128i a, __m128i b) {
+    __m128i a_mayor = _mm_cmpgt_epi32(a, b);
+    return _mm_or_si128(_mm_and_si128(a_mayor, a), _mm_andnot_si128(a_mayor, b));
+}
+
+__attribute__((target("sse2")))
+inline __m128i menorSSE2(__m128i a, __m128i b) {
+    __m128i a_mayor = _mm_cmpgt_epi32(a, b);
+    return _mm_or_si128(_mm_and_si128(a_mayor, b), _mm_andnot_si128(a_mayor, a));
+}
+
+__attribute__((target("sse2")))
+bool parecidasSSE2(const int32_t* valores, const int32_t* holguras, const int32_t* tolerancias,
+                   const uint32_t* clases) {
+    // Cuatro carriles por registro: dos mitades por clase
+    __m128i fuera = _mm_setzero_si128();
+    for (int mitad = 0; mitad < CARRILES_SIMILITUD; mitad += 4) {
+        __m128i v[4], h[4];
+        for (int q = 0; q < 4; q++) {
+            std::size_t k = static_cast<std::size_t>(clases[q]) * CARRILES_SIMILITUD + mitad;
+            v[q] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(valores + k));
+            h[q] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(holguras + k));
+        }
+        __m128i mayor = mayorSSE2(mayorSSE2(v[0], v[1]), mayorSSE2(v[2], v[3]));
+        __m128i menor = menorSSE2(menorSSE2(v[0], v[1]), menorSSE2(v[2], v[3]));
+        __m128i holgura = mayorSSE2(mayorSSE2(h[0], h[1]), mayorSSE2(h[2], h[3]));
+        __m128i limite = _mm_add_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(tolerancias + mitad)), holgura);
+        fuera = _mm_or_si128(fuera, _mm_cmpgt_epi32(_mm_sub_epi32(mayor, menor), limite));
+    }
+    return _mm_movemask_epi8(fuera) == 0;
+}
+
+__attribute__((target("avx2")))
+bool parecidasAVX2(const int32_t* valores, const int32_t* holguras, const int32_t* tolerancias,
+                   const uint32_t* clases) {
+    // Los ocho carriles de una clase en un registro
+    __m256i v[4], h[4];
+    for (int q = 0; q < 4; q++) {
+        std::size_t k = static_cast<std::size_t>(clases[q]) * CARRILES_SIMILITUD;
+        v[q] = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(valores + k));
+        h[q] = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(holguras + k));
+    }
+    __m256i mayor = _mm256_max_epi32(_mm256_max_epi32(v[0], v[1]), _mm256_max_epi32(v[2], v[3]));
+    __m256i menor = _mm256_min_epi32(_mm256_min_epi32(v[0], v[1]), _mm256_min_epi32(v[2], v[3]));
+    __m256i holgura = _mm256_max_epi32(_mm256_max_epi32(h[0], h[1]), _mm256_max_epi32(h[2], h[3]));
+    __m256i limite = _mm256_add_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(tolerancias)), holgura);
+    __m256i fuera = _mm256_cmpgt_epi32(_mm256_sub_epi32(mayor, menor), limite);
+    return _mm256_testz_si256(fuera, fuera) != 0;
+}
+
+#endif // SIMILITUD_X86
+
+} // namespace
+
+/**
+ * @brief Obtiene la función de comparación de cuatro clases de un núcleo.
+ * 
+ * @param nucleo Núcleo ya resuelto con nucleoDisponible.
+ * @return Función de comparación del núcleo (la escalar para el núcleo escalar).
+ */
+FuncionParecidas funcionParecidas(NucleoSimd nucleo) {
+    switch (nucleo) {
+#ifdef SIMILITUD_X86
+    case NucleoSimd::SSE2:
+        return parecidasSSE2;
+    case NucleoSimd::AVX2:
+        return parecidasAVX2;
+#endif
+    default:
+        return parecidasEscalar;
+    }
+}
+
+/**
+ * @brief Fija las tolerancias de similitud y el núcleo de comparación.
+ * 
+ * Las clases cuantizadas se descartan; la escala de cada atributo se elige en la siguiente llamada a actualizar().
+ * 
+ * @param absoluta Tolerancia absoluta de cada atributo, en sus unidades.
+ * @param relativa Tolerancia relativa de cada atributo, como fracción del mayor valor absoluto.
+ * @param nucleo Núcleo ya resuelto con nucleoDisponible.
+ */
+void SimilitudAtributos::preparar(const AtributosSuelo& absoluta, const AtributosSuelo& relativa, NucleoSimd nucleo) {
+    this->absoluta = absoluta;
+    this->relativa = relativa;
+    valores.clear();
+    holguras.clear();
+    activada = false;
+    for (int c = 0; c < NUM_ATRIBUTOS_SUELO; c++) {
+        activada = activada || absoluta.*CAMPOS_ATRIBUTOS[c] > 0 || relativa.*CAMPOS_ATRIBUTOS[c] > 0;
+    }
+
+    funcion = funcionParecidas(nucleo);
+}
+
+/**
+ * @brief Cuantiza las clases nuevas de la tabla de atributos.
+ * 
+ * En la primera llamada tras preparar() se elige la escala de cada atributo, una potencia de dos tal que el mayor
+ * valor absoluto de la tabla quede por debajo de 2^28, y se cuantizan las tolerancias absolutas. Las clases que se
+ * añaden después al fusionar bloques parecidos son medias de otras, así que no se salen de ese rango.
+ * 
+ * @param tabla Tabla de atributos de la Pirámide.
+ */
+void SimilitudAtributos::actualizar(const TablaAtributos& tabla) {
+    const std::vector<AtributosSuelo>& clases = tabla.entradas();
+    std::size_t primera = valores.size() / CARRILES_SIMILITUD;
+    if (primera == 0) {
+        for (int c = 0; c < CARRILES_SIMILITUD; c++) {
+            double mayor = 0;
+            for (std::size_t k = 0; c < NUM_ATRIBUTOS_SUELO && k < clases.size(); k++) {
+                double valor = std::fabs(clases[k].*CAMPOS_ATRIBUTOS[c]);
+                if (std::isfinite(valor)) {
+                    mayor = std::max(mayor, valor);
+                }
+            }
+            escalas[c] = std::ldexp(1.0, mayor > 0 ? BITS_VALOR - 1 - std::ilogb(mayor) : BITS_VALOR / 2);
+            tolerancias[c] = c < NUM_ATRIBUTOS_SUELO ? cuantizar(absoluta.*CAMPOS_ATRIBUTOS[c], escalas[c]) : 0;
+        }
+    }
+
+    valores.resize(clases.size() * CARRILES_SIMILITUD, 0);
+    holguras.resize(clases.size() * CARRILES_SIMILITUD, 0);
+    for (std::size_t k = primera; k < clases.size(); k++) {
+        for (int c = 0; c < NUM_ATRIBUTOS_SUELO; c++) {
+            double valor = clases[k].*CAMPOS_ATRIBUTOS[c];
+            valores[k * CARRILES_SIMILITUD + c] = cuantizar(valor, escalas[c]);
+            double holgura = relativa.*CAMPOS_ATRIBUTOS[c] * std::fabs(valor);
+            holguras[k * CARRILES_SIMILITUD + c] = cuantizar(holgura, escalas[c]);
+        }
+    }
+}
+
+/**
+ * @brief Comprueba si cuatro clases son parecidas.
+ * 
+ * @param NO Clase del nodo noroeste.
+ * @param NE Clase del nodo noreste.
+ * @param SO Clase del nodo suroeste.
+ * @param SE Clase del nodo sureste.
+ * @return Verdadero si en cada atributo la diferencia entre el mayor y el menor valor está dentro de la tolerancia.
+ */
+bool SimilitudAtributos::parecidas(uint32_t NO, uint32_t NE, uint32_t SO, uint32_t SE) const {
+    const uint32_t clases[4] = {NO, NE, SO, SE};
+    return funcion(valores.data(), holguras.data(), tolerancias, clases);
+}
+
+/**
+ * @brief Calcula la media de los atributos de varios nodos ponderada por su área.
+ * 
+ * @param atributos Atributos de cada nodo.
+ * @param areas Área de cada nodo.
+ * @param num Número de nodos.
+ * @return Atributos medios.
+ */
+AtributosSuelo mediaAtributos(const AtributosSuelo* const atributos[], const int areas[], int num) {
+    AtributosSuelo media = {};
+    double area_total = 0;
+    for (int k = 0; k < num; k++) {
+        for (int c = 0; c < NUM_ATRIBUTOS_SUELO; c++) {
+            media.*CAMPOS_ATRIBUTOS[c] += atributos[k]->*CAMPOS_ATRIBUTOS[c] * areas[k];
+        }
+        area_total += areas[k];
+    }
+    for (int c = 0; c < NUM_ATRIBUTOS_SUELO; c++) {
+        media.*CAMPOS_ATRIBUTOS[c] /= area_total;
+    }
+    return media;
+}
@@ -0,0 +1,63 @@
+#ifndef SIMILITUD_H
+#define SIMILITUD_H
+
+#include "configuracion.h"
+#include "tabla_atributos.h"
+
+#include <cstdint>
+#include <vector>
+
+// Carriles de cada clase en el núcleo de similitud: los siete atributos de suelo y umbrales y uno de relleno
+const int CARRILES_SIMILITUD = 8;
+
+// Comprueba si las cuatro clases son parecidas a partir de sus carriles cuantizados (ver SimilitudAtributos)
+using FuncionParecidas = bool (*)(const int32_t* valores, const int32_t* holguras, const int32_t* tolerancias,
+                                  const uint32_t* clases);
+
+// Función de comparación del núcleo (la escalar para el núcleo escalar), para comprobar los núcleos vectorizados
+FuncionParecidas funcionParecidas(NucleoSimd nucleo);
+
+/**
+ * @brief Comparación de las clases de atributos por similitud, con los atributos cuantizados en punto fijo.
+ * 
+ * Cada clase de la tabla de atributos se guarda como CARRILES_SIMILITUD enteros de 32 bits, uno por atributo,
+ * con una escala por atributo elegida a partir de los valores de la base. Cuatro clases son parecidas si en cada
+ * atributo la diferencia entre el mayor y el menor valor no supera la tolerancia absoluta más la relativa por el
+ * mayor valor absoluto de las cuatro. La parte relativa de cada clase (su holgura) se guarda ya multiplicada,
+ * así que comparar cuatro clases son unos pocos máximos, mínimos, sumas y comparaciones enteras sobre un
+ * registro AVX2 (o dos SSE2).
+ * 
+ * parecidas() se puede llamar desde varios hilos a la vez; preparar() y actualizar() no.
+ */
+class SimilitudAtributos {
+public:
+    // Fija las tolerancias y el núcleo, y olvida las clases cuantizadas
+    void preparar(const AtributosSuelo& absoluta, const AtributosSuelo& relativa, NucleoSimd nucleo);
+
+    // Verdadero si alguna tolerancia es mayor que 0
+    bool activa() const { return activada; }
+
+    // Cuantiza las clases añadidas a la tabla desde la llamada anterior
+    void actualizar(const TablaAtributos& tabla);
+
+    // Verdadero si las cuatro clases, ya cuantizadas, son parecidas
+    bool parecidas(uint32_t NO, uint32_t NE, uint32_t SO, uint32_t SE) const;
+
+private:
+    // Carriles de cada clase (CARRILES_SIMILITUD por clase): valor y holgura relativa
+    std::vector<int32_t> valores;
+    std::vector<int32_t> holguras;
+    // Tolerancia absoluta cuantizada de cada carril
+    int32_t tolerancias[CARRILES_SIMILITUD] = {};
+    // Tolerancias pedidas y escala de cada atributo (valor cuantizado = valor * escala)
+    AtributosSuelo absoluta = {};
+    AtributosSuelo relativa = {};
+    double escalas[CARRILES_SIMILITUD] = {};
+    FuncionParecidas funcion = nullptr;
+    bool activada = false;
+};
+
+// Media de los atributos de varios nodos ponderada por su área
+AtributosSuelo mediaAtributos(const AtributosSuelo* const atributos[], const int areas[], int num);
+
+#endif // SIMILITUD_H
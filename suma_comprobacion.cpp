@@ -0,0 +1,70 @@
+#include "suma_comprobacion.h"
+#include "archivo_mapeado.h"
+#include "paralelo.h"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+const uint64_t PRIMO_SUMA = 0x100000001b3ULL;
+const std::size_t TAM_BLOQUE_SUMA = 1 << 20;
+
+} // namespace
+
+/**
+ * @brief Añade un valor a una suma de comprobación (FNV-1a por palabras, con una mezcla final de los bits altos).
+ * 
+ * @param suma Suma acumulada.
+ * @param valor Valor a añadir.
+ * @return Nueva suma.
+ */
+uint64_t mezclarSuma(uint64_t suma, uint64_t valor) {
+    suma = (suma ^ valor) * PRIMO_SUMA;
+    return suma ^ (suma >> 32);
+}
+
+/**
+ * @brief Calcula la suma de comprobación de un buffer.
+ * 
+ * El buffer se divide en bloques de 1 MiB que se resumen en paralelo y se combinan en orden,
+ * así que el resultado no depende del número de hilos.
+ * 
+ * @param datos Comienzo del buffer.
+ * @param bytes Tamaño del buffer.
+ * @param num_hilos Número de hilos.
+ * @param liberar Si es verdadero, cada bloque se devuelve al sistema tras sumarlo (solo para proyecciones de
+ *                archivo sin modificar), de modo que la suma no deja todo el archivo en memoria.
+ * @return Suma de comprobación.
+ */
+uint64_t sumaComprobacion(const void* datos, std::size_t bytes, int num_hilos, bool liberar) {
+    const unsigned char* octetos = static_cast<const unsigned char*>(datos);
+    std::size_t num_bloques = (bytes + TAM_BLOQUE_SUMA - 1) / TAM_BLOQUE_SUMA;
+    std::vector<uint64_t> sumas(num_bloques);
+
+    paraleloPara(num_hilos, num_bloques, [&](std::size_t b) {
+        const unsigned char* inicio = octetos + b * TAM_BLOQUE_SUMA;
+        std::size_t tam = std::min(TAM_BLOQUE_SUMA, bytes - b * TAM_BLOQUE_SUMA);
+        uint64_t suma = BASE_SUMA;
+        std::size_t i = 0;
+        for (; i + sizeof(uint64_t) <= tam; i += sizeof(uint64_t)) {
+            uint64_t palabra;
+            std::memcpy(&palabra, inicio + i, sizeof(palabra));
+            suma = mezclarSuma(suma, palabra);
+        }
+        for (; i < tam; i++) {
+            suma = mezclarSuma(suma, inicio[i]);
+        }
+        sumas[b] = suma;
+        if (liberar) {
+            liberarPaginas(inicio, tam);
+        }
+    });
+
+    uint64_t suma = mezclarSuma(BASE_SUMA, bytes);
+    for (uint64_t suma_bloque : sumas) {
+        suma = mezclarSuma(suma, suma_bloque);
+    }
+    return suma;
+}
@@ -0,0 +1,17 @@
+#ifndef SUMA_COMPROBACION_H
+#define SUMA_COMPROBACION_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Valor inicial de las sumas de comprobación
+const uint64_t BASE_SUMA = 0xcbf29ce484222325ULL;
+
+// Añade un valor a una suma de comprobación
+uint64_t mezclarSuma(uint64_t suma, uint64_t valor);
+
+// Suma de comprobación de un buffer, calculada en paralelo por bloques; con liberar, cada bloque de una proyección de
+// archivo sin modificar se devuelve al sistema tras sumarlo
+uint64_t sumaComprobacion(const void* datos, std::size_t bytes, int num_hilos, bool liberar = false);
+
+#endif // SUMA_COMPROBACION_H
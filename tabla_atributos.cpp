@@ -0,0 +1,224 @@
+#include "tabla_atributos.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+#include <stdexcept>
+
+namespace {
+
+/**
+ * @brief Orden total entre valores: los NaN van al final.
+ * 
+ * @return Negativo, cero o positivo si a es menor, igual o mayor que b.
+ */
+int compararValores(double a, double b) {
+    bool nan_a = std::isnan(a);
+    bool nan_b = std::isnan(b);
+    if (nan_a || nan_b) {
+        return static_cast<int>(nan_a) - static_cast<int>(nan_b);
+    }
+    return a < b ? -1 : (b < a ? 1 : 0);
+}
+
+} // namespace
+
+/**
+ * @brief Compara dos combinaciones de atributos campo a campo.
+ * 
+ * Usa la igualdad de double, igual que la comparación de atributos de la construcción de la pirámide.
+ */
+bool AtributosSuelo::operator==(const AtributosSuelo& otros) const {
+    for (int c = 0; c < NUM_ATRIBUTOS_SUELO; c++) {
+        if (!(this->*CAMPOS_ATRIBUTOS[c] == otros.*CAMPOS_ATRIBUTOS[c])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Calcula el hash de una combinación de atributos a partir de los bits de sus campos.
+ * 
+ * -0.0 se trata como 0.0, ya que ambos son iguales según el operador ==.
+ */
+std::size_t HashAtributos::operator()(const AtributosSuelo& atributos) const {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (int c = 0; c < NUM_ATRIBUTOS_SUELO; c++) {
+        double valor = atributos.*CAMPOS_ATRIBUTOS[c] + 0.0;
+        uint64_t bits;
+        std::memcpy(&bits, &valor, sizeof(bits));
+        hash = (hash ^ bits) * 0x100000001b3ULL;
+        hash ^= hash >> 29;
+    }
+    return static_cast<std::size_t>(hash);
+}
+
+/**
+ * @brief Redondea un valor a la precisión con la que se guarda su atributo.
+ * 
+ * Un valor se conserva si el valor redondeado se lee igual que el original:
+ *  - Simple: el float más próximo, escrito con los menos dígitos que lo identifican (std::to_chars), se lee como el
+ *    mismo double; con los datos del CSV, que tienen pocas cifras, esto ocurre si el float guarda todas sus cifras.
+ *  - Fijo16: round(valor * escala) cabe en 16 bits con signo y, dividido por la escala, vuelve a dar el valor.
+ * Si se conserva, el valor no cambia. Si no, se sustituye por la lectura del valor redondeado (saturado al rango
+ * del tipo), de modo que dos valores que no se distinguen con la precisión elegida dan la misma clase.
+ * 
+ * @param valor Valor, se actualiza.
+ * @param precision Precisión del atributo.
+ * @return Verdadero si el valor se conserva, falso en caso contrario.
+ */
+bool redondearPrecision(double& valor, const PrecisionAtributo& precision) {
+    double redondeado = valor;
+    switch (precision.tipo) {
+    case Precision::Doble:
+        return true;
+    case Precision::Simple: {
+        if (std::isnan(valor)) {
+            return true;
+        }
+        float simple = static_cast<float>(std::max<double>(-FLT_MAX, std::min<double>(FLT_MAX, valor)));
+        if (std::isinf(valor)) {
+            simple = static_cast<float>(valor);
+        }
+        char texto[32];
+        std::to_chars_result escrito = std::to_chars(texto, texto + sizeof(texto), simple);
+        std::from_chars(texto, escrito.ptr, redondeado);
+        break;
+    }
+    case Precision::Fijo16: {
+        double escalado = std::nearbyint(valor * precision.escala);
+        if (std::isnan(escalado)) {
+            escalado = 0;
+        }
+        escalado = std::max<double>(INT16_MIN, std::min<double>(INT16_MAX, escalado));
+        redondeado = escalado / precision.escala;
+        break;
+    }
+    }
+    bool conservado = redondeado == valor;
+    valor = redondeado;
+    return conservado;
+}
+
+/**
+ * @brief Resume las precisiones de los atributos en un entero.
+ * 
+ * Se guarda en la caché de la base, que contiene los valores ya redondeados, para descartarla si cambian.
+ * 
+ * @param precision Precisión de cada atributo.
+ * @return 0 si todos los atributos son Doble; si no, un hash de los tipos y las escalas de punto fijo.
+ */
+uint64_t firmaPrecision(const PrecisionAtributos& precision) {
+    uint64_t hash = 0;
+    for (int c = 0; c < NUM_ATRIBUTOS_SUELO; c++) {
+        if (precision[c].tipo == Precision::Doble) {
+            continue;
+        }
+        uint64_t bits = 0;
+        if (precision[c].tipo == Precision::Fijo16) {
+            std::memcpy(&bits, &precision[c].escala, sizeof(bits));
+        }
+        hash = (hash ^ (static_cast<uint64_t>(c) << 8 | static_cast<uint64_t>(precision[c].tipo))) * 0x100000001b3ULL;
+        hash = (hash ^ bits) * 0x100000001b3ULL;
+        hash ^= hash >> 29;
+    }
+    return hash;
+}
+
+/**
+ * @brief Obtiene la clase de una combinación de atributos; si no estaba en la tabla, le asigna la siguiente.
+ * 
+ * @param atributos Combinación de atributos.
+ * @return Clase de la combinación.
+ */
+uint32_t TablaAtributos::internar(const AtributosSuelo& atributos) {
+    std::lock_guard<std::mutex> bloqueo(cerrojo);
+    auto encontrada = indices.find(atributos);
+    if (encontrada != indices.end()) {
+        return encontrada->second;
+    }
+    if (clases.size() >= CLASE_VACIA) {
+        throw std::runtime_error("Error: demasiadas combinaciones distintas de atributos.");
+    }
+    uint32_t clase = static_cast<uint32_t>(clases.size());
+    clases.push_back(atributos);
+    indices.emplace(atributos, clase);
+    return clase;
+}
+
+/**
+ * @brief Obtiene el número de clases de la tabla.
+ * 
+ * @return Número de combinaciones distintas de atributos.
+ */
+std::size_t TablaAtributos::size() const {
+    return clases.size();
+}
+
+/**
+ * @brief Obtiene las combinaciones de atributos de la tabla.
+ * 
+ * @return Combinaciones, indexadas por clase.
+ */
+const std::vector<AtributosSuelo>& TablaAtributos::entradas() const {
+    return clases;
+}
+
+/**
+ * @brief Sustituye el contenido de la tabla, por ejemplo al cargarla de la caché de la base.
+ * 
+ * @param nuevas Combinaciones de atributos; la clase de cada una es su posición.
+ */
+void TablaAtributos::asignar(std::vector<AtributosSuelo> nuevas) {
+    std::lock_guard<std::mutex> bloqueo(cerrojo);
+    clases = std::move(nuevas);
+    indices.clear();
+    for (std::size_t c = 0; c < clases.size(); c++) {
+        indices.emplace(clases[c], static_cast<uint32_t>(c));
+    }
+}
+
+/**
+ * @brief Ordena las clases por sus atributos.
+ * 
+ * Cuando la tabla se llena desde varios hilos, el orden en el que aparecen las clases depende del reparto
+ * del trabajo. Tras ordenarla, las clases solo dependen de los datos.
+ * 
+ * @return Nueva clase de cada clase anterior; los nodos deben traducirse con ella.
+ */
+std::vector<uint32_t> TablaAtributos::ordenar() {
+    std::vector<uint32_t> orden(clases.size());
+    std::iota(orden.begin(), orden.end(), 0);
+    std::sort(orden.begin(), orden.end(), [this](uint32_t a, uint32_t b) {
+        for (int c = 0; c < NUM_ATRIBUTOS_SUELO; c++) {
+            int comparacion = compararValores(clases[a].*CAMPOS_ATRIBUTOS[c], clases[b].*CAMPOS_ATRIBUTOS[c]);
+            if (comparacion != 0) {
+                return comparacion < 0;
+            }
+        }
+        return false;
+    });
+
+    std::vector<AtributosSuelo> ordenadas;
+    ordenadas.reserve(clases.size());
+    std::vector<uint32_t> nuevas(clases.size());
+    for (std::size_t c = 0; c < orden.size(); c++) {
+        ordenadas.push_back(clases[orden[c]]);
+        nuevas[orden[c]] = static_cast<uint32_t>(c);
+    }
+    asignar(std::move(ordenadas));
+    return nuevas;
+}
+
+/**
+ * @brief Elimina todas las clases de la tabla.
+ */
+void TablaAtributos::clear() {
+    std::lock_guard<std::mutex> bloqueo(cerrojo);
+    clases.clear();
+    indices.clear();
+}
@@ -0,0 +1,116 @@
+#ifndef TABLA_ATRIBUTOS_H
+#define TABLA_ATRIBUTOS_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief Atributos de suelo y umbrales de un nodo.
+ * 
+ * Proceden de un número pequeño de clases de suelo y terreno, así que la mayoría de los nodos
+ * comparten exactamente la misma combinación de valores con muchos otros.
+ */
+struct AtributosSuelo {
+    double capacidad_campo_media;
+    double pendiente_3clases;
+    double porosidad_media;
+    double punto_marchitez_medio;
+    double umbral_humedo;
+    double umbral_intermedio;
+    double umbral_seco;
+
+    // Dos combinaciones son iguales si lo son todos sus atributos
+    bool operator==(const AtributosSuelo& otros) const;
+};
+
+// Número de atributos de suelo y umbrales de AtributosSuelo
+const int NUM_ATRIBUTOS_SUELO = 7;
+static_assert(sizeof(AtributosSuelo) == NUM_ATRIBUTOS_SUELO * sizeof(double), "AtributosSuelo tiene otros campos");
+
+// Campos de AtributosSuelo en orden, para recorrerlos por número: atributos.*CAMPOS_ATRIBUTOS[c]
+constexpr double AtributosSuelo::* CAMPOS_ATRIBUTOS[NUM_ATRIBUTOS_SUELO] = {
+    &AtributosSuelo::capacidad_campo_media, &AtributosSuelo::pendiente_3clases, &AtributosSuelo::porosidad_media,
+    &AtributosSuelo::punto_marchitez_medio, &AtributosSuelo::umbral_humedo, &AtributosSuelo::umbral_intermedio,
+    &AtributosSuelo::umbral_seco};
+
+/**
+ * @brief Precisión con la que se guardan los valores de un atributo al leer la base.
+ */
+enum class Precision {
+    // double, sin redondeo
+    Doble,
+    // El float más próximo (unos 7 dígitos significativos)
+    Simple,
+    // Entero de 16 bits con signo multiplicado por una escala
+    Fijo16
+};
+
+/**
+ * @brief Precisión de un atributo y, en punto fijo, su escala (valor guardado = round(valor * escala) / escala).
+ */
+struct PrecisionAtributo {
+    Precision tipo = Precision::Doble;
+    // Unidades de punto fijo por unidad del atributo (1000 = tres decimales)
+    double escala = 1000;
+};
+
+// Precisión de cada atributo, en el orden de los campos de AtributosSuelo
+using PrecisionAtributos = std::array<PrecisionAtributo, NUM_ATRIBUTOS_SUELO>;
+
+// Redondea un valor a la precisión dada; devuelve falso si el valor no se conserva
+bool redondearPrecision(double& valor, const PrecisionAtributo& precision);
+
+// Resume las precisiones en un entero (0 si todos los atributos son Doble), para invalidar las cachés
+uint64_t firmaPrecision(const PrecisionAtributos& precision);
+
+/**
+ * @brief Función hash de AtributosSuelo, coherente con su operador ==.
+ */
+struct HashAtributos {
+    std::size_t operator()(const AtributosSuelo& atributos) const;
+};
+
+// Clase de los nodos vacíos
+const uint32_t CLASE_VACIA = UINT32_MAX;
+
+/**
+ * @brief Tabla que asigna a cada combinación distinta de atributos un identificador de clase denso.
+ * 
+ * Los nodos solo guardan su clase y los atributos se consultan en la tabla cuando hacen falta. Dos nodos
+ * tienen los mismos atributos si y solo si tienen la misma clase, así que compararlos es comparar dos enteros.
+ * internar() se puede llamar desde varios hilos a la vez, pero no mientras otros hilos consultan la tabla.
+ */
+class TablaAtributos {
+public:
+    // Devuelve la clase de una combinación de atributos, añadiéndola si es nueva
+    uint32_t internar(const AtributosSuelo& atributos);
+
+    // Atributos de una clase
+    const AtributosSuelo& operator[](uint32_t clase) const { return clases[clase]; }
+
+    // Número de clases distintas
+    std::size_t size() const;
+
+    // Combinaciones de atributos, indexadas por clase
+    const std::vector<AtributosSuelo>& entradas() const;
+
+    // Sustituye el contenido de la tabla por las combinaciones dadas (la clase de cada una es su posición)
+    void asignar(std::vector<AtributosSuelo> nuevas);
+
+    // Ordena las clases por sus atributos y devuelve la nueva clase de cada clase anterior
+    std::vector<uint32_t> ordenar();
+
+    // Vacía la tabla
+    void clear();
+
+private:
+    std::vector<AtributosSuelo> clases;
+    std::unordered_map<AtributosSuelo, uint32_t, HashAtributos> indices;
+    std::mutex cerrojo;
+};
+
+#endif // TABLA_ATRIBUTOS_H
@@ -0,0 +1,22 @@
+#ifndef TIPOS_COLUMNA_H
+#define TIPOS_COLUMNA_H
+
+#include <cstdint>
+
+// Tipos de elemento de las columnas guardadas en la caché de la base y en las instantáneas; los valores forman parte
+// de ambos formatos y no se pueden cambiar
+const uint32_t TIPO_INT8 = 1;
+const uint32_t TIPO_INT32 = 2;
+const uint32_t TIPO_DOUBLE = 3;
+const uint32_t TIPO_UINT32 = 4;
+const uint32_t TIPO_UINT64 = 5;
+
+// Tipo de elemento de una columna de T
+template <typename T> uint32_t tipoColumna();
+template <> inline uint32_t tipoColumna<int8_t>() { return TIPO_INT8; }
+template <> inline uint32_t tipoColumna<int>() { return TIPO_INT32; }
+template <> inline uint32_t tipoColumna<double>() { return TIPO_DOUBLE; }
+template <> inline uint32_t tipoColumna<uint32_t>() { return TIPO_UINT32; }
+template <> inline uint32_t tipoColumna<uint64_t>() { return TIPO_UINT64; }
+
+#endif // TIPOS_COLUMNA_H